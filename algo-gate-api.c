@@ -324,6 +324,7 @@ void init_null_algo_gate( algo_gate_t* gate )
    gate->init_nonceptr            = (void*)&std_init_nonceptr;
    gate->do_all_threads           = (void*)&return_true;
    gate->get_pseudo_random_data   = (void*)&do_nothing;
+   gate->prehash                  = (void*)&do_nothing;
 }
 
 // called by each thread that uses the gate
@@ -119,6 +119,8 @@ void   *( *backup_work_data )        ( struct work* );
 void   *( *restore_work_data )       ( struct work* );
 bool   *( *do_all_threads )          ();
 void   *( *get_pseudo_random_data )  ( struct work*, char*, int );
+// first stage midstate over the nonce invariant part of the header
+void   *( *prehash )                 ( struct work* );
 
 // special safe optional case, default is non-null, but one algo needs null
 void   *( *init_nonceptr )           ( struct work*, struct work* ,uint32_t**,
@@ -203,10 +203,13 @@ void scrypt(const uint8_t *password, size_t password_len, const uint8_t *salt, s
 #define chunk_bytes 1024
 #endif
 
-void my_scrypt(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len, uint8_t *out)
+#if ((512 + 2) * chunk_bytes) > MY_SCRYPT_SCRATCH_SIZE
+#error "MY_SCRYPT_SCRATCH_SIZE too small for SCRYPT_BLOCK_BYTES"
+#endif
+
+void my_scrypt(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len, uint8_t *out, uint8_t *scratch)
 {
-	scrypt_aligned_alloc YX, V;
-	uint8_t *X, *Y;
+	uint8_t *X, *Y, *V;
 
 #if !defined(SCRYPT_CHOOSE_COMPILETIME)
 	scrypt_ROMixfn scrypt_ROMix = scrypt_getROMix();
@@ -222,24 +225,18 @@ void my_scrypt(const uint8_t *password, size_t password_len, const uint8_t *salt
 	}
 #endif
 */
-	V = scrypt_alloc((uint64_t)512 * chunk_bytes);
-	YX = scrypt_alloc(2 * chunk_bytes);
+	V = scratch;
 
 	/* 1: X = PBKDF2(password, salt) */
-	Y = YX.ptr;
+	Y = V + 512 * chunk_bytes;
 	X = Y + chunk_bytes;
 	scrypt_pbkdf2(password, password_len, salt, salt_len, 1, X, chunk_bytes);
 
 	/* 2: X = ROMix(X) */
-	scrypt_ROMix((scrypt_mix_word_t *)X, (scrypt_mix_word_t *)Y, (scrypt_mix_word_t *)V.ptr, 512, 1);
+	scrypt_ROMix((scrypt_mix_word_t *)X, (scrypt_mix_word_t *)Y, (scrypt_mix_word_t *)V, 512, 1);
 
 	/* 3: Out = PBKDF2(password, X) */
 	scrypt_pbkdf2(password, password_len, X, chunk_bytes, 1, out, 32);
-
-	scrypt_ensure_zero(YX.ptr, 2 * chunk_bytes);
-
-	scrypt_free(&V);
-	scrypt_free(&YX);
 }
 
 #if defined( _WINDOWS )
@@ -31,5 +31,12 @@ typedef void (*scrypt_fatal_errorfn)(const char *msg);
 void scrypt_set_fatal_error(scrypt_fatal_errorfn fn);
 
 void scrypt(const unsigned char *password, size_t password_len, const unsigned char *salt, size_t salt_len, unsigned char Nfactor, unsigned char rfactor, unsigned char pfactor, unsigned char *out, size_t bytes);
-void my_scrypt(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len, uint8_t *out);
+/*
+	my_scrypt: N = 512, r = 1, p = 1 with Salsa64/8 (256 byte chunks).
+	scratch must be MY_SCRYPT_SCRATCH_SIZE bytes aligned to 64, it holds V
+	followed by Y and X so nothing is allocated per hash.
+*/
+#define MY_SCRYPT_SCRATCH_SIZE ((512 + 2) * 256)
+
+void my_scrypt(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len, uint8_t *out, uint8_t *scratch);
 #endif /* AR2_SCRYPT_JANE_H */
@@ -159,4 +159,119 @@ static BLAKE2_INLINE __m128i fBlaMka(__m128i x, __m128i y) {
         UNDIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1);                         \
     } while ((void)0, 0)
 
+#if defined(__AVX2__)
+
+/* The same rounds on ymm registers. All operations stay within 128 bit
+ * lanes, so BLAKE2_ROUND_AVX2 runs two independent BLAKE2_ROUNDs, one per
+ * lane. BLAKE2_ROUND_4x64 runs one round with a whole state in 4 ymm. */
+
+#define r16_256                                                                \
+    (_mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,    \
+                      2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define r24_256                                                                \
+    (_mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,    \
+                      3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define _mm256_roti_epi64(x, c)                                                \
+    (-(c) == 32)                                                               \
+        ? _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))                   \
+        : (-(c) == 24)                                                         \
+              ? _mm256_shuffle_epi8((x), r24_256)                              \
+              : (-(c) == 16)                                                   \
+                    ? _mm256_shuffle_epi8((x), r16_256)                        \
+                    : _mm256_xor_si256(_mm256_srli_epi64((x), -(c)),           \
+                                       _mm256_add_epi64((x), (x)))
+
+static BLAKE2_INLINE __m256i fBlaMka_256(__m256i x, __m256i y) {
+    const __m256i z = _mm256_mul_epu32(x, y);
+    return _mm256_add_epi64(_mm256_add_epi64(x, y), _mm256_add_epi64(z, z));
+}
+
+#define G_AVX2(A, B, C, D, r0, r1)                                             \
+    do {                                                                       \
+        A = fBlaMka_256(A, B);                                                 \
+        D = _mm256_xor_si256(D, A);                                            \
+        D = _mm256_roti_epi64(D, r0);                                          \
+        C = fBlaMka_256(C, D);                                                 \
+        B = _mm256_xor_si256(B, C);                                            \
+        B = _mm256_roti_epi64(B, r1);                                          \
+    } while ((void)0, 0)
+
+#define G1_AVX2(A0, B0, C0, D0, A1, B1, C1, D1)                                \
+    do {                                                                       \
+        G_AVX2(A0, B0, C0, D0, -32, -24);                                      \
+        G_AVX2(A1, B1, C1, D1, -32, -24);                                      \
+    } while ((void)0, 0)
+
+#define G2_AVX2(A0, B0, C0, D0, A1, B1, C1, D1)                                \
+    do {                                                                       \
+        G_AVX2(A0, B0, C0, D0, -16, -63);                                      \
+        G_AVX2(A1, B1, C1, D1, -16, -63);                                      \
+    } while ((void)0, 0)
+
+#define DIAGONALIZE_AVX2(A0, B0, C0, D0, A1, B1, C1, D1)                       \
+    do {                                                                       \
+        __m256i t0 = _mm256_alignr_epi8(B1, B0, 8);                            \
+        __m256i t1 = _mm256_alignr_epi8(B0, B1, 8);                            \
+        B0 = t0;                                                               \
+        B1 = t1;                                                               \
+                                                                               \
+        t0 = C0;                                                               \
+        C0 = C1;                                                               \
+        C1 = t0;                                                               \
+                                                                               \
+        t0 = _mm256_alignr_epi8(D1, D0, 8);                                    \
+        t1 = _mm256_alignr_epi8(D0, D1, 8);                                    \
+        D0 = t1;                                                               \
+        D1 = t0;                                                               \
+    } while ((void)0, 0)
+
+#define UNDIAGONALIZE_AVX2(A0, B0, C0, D0, A1, B1, C1, D1)                     \
+    do {                                                                       \
+        __m256i t0 = _mm256_alignr_epi8(B0, B1, 8);                            \
+        __m256i t1 = _mm256_alignr_epi8(B1, B0, 8);                            \
+        B0 = t0;                                                               \
+        B1 = t1;                                                               \
+                                                                               \
+        t0 = C0;                                                               \
+        C0 = C1;                                                               \
+        C1 = t0;                                                               \
+                                                                               \
+        t0 = _mm256_alignr_epi8(D0, D1, 8);                                    \
+        t1 = _mm256_alignr_epi8(D1, D0, 8);                                    \
+        D0 = t1;                                                               \
+        D1 = t0;                                                               \
+    } while ((void)0, 0)
+
+#define BLAKE2_ROUND_AVX2(A0, A1, B0, B1, C0, C1, D0, D1)                      \
+    do {                                                                       \
+        G1_AVX2(A0, B0, C0, D0, A1, B1, C1, D1);                               \
+        G2_AVX2(A0, B0, C0, D0, A1, B1, C1, D1);                               \
+                                                                               \
+        DIAGONALIZE_AVX2(A0, B0, C0, D0, A1, B1, C1, D1);                      \
+                                                                               \
+        G1_AVX2(A0, B0, C0, D0, A1, B1, C1, D1);                               \
+        G2_AVX2(A0, B0, C0, D0, A1, B1, C1, D1);                               \
+                                                                               \
+        UNDIAGONALIZE_AVX2(A0, B0, C0, D0, A1, B1, C1, D1);                    \
+    } while ((void)0, 0)
+
+#define BLAKE2_ROUND_4x64(A, B, C, D)                                          \
+    do {                                                                       \
+        G_AVX2(A, B, C, D, -32, -24);                                          \
+        G_AVX2(A, B, C, D, -16, -63);                                          \
+                                                                               \
+        B = _mm256_permute4x64_epi64(B, _MM_SHUFFLE(0, 3, 2, 1));              \
+        C = _mm256_permute4x64_epi64(C, _MM_SHUFFLE(1, 0, 3, 2));              \
+        D = _mm256_permute4x64_epi64(D, _MM_SHUFFLE(2, 1, 0, 3));              \
+                                                                               \
+        G_AVX2(A, B, C, D, -32, -24);                                          \
+        G_AVX2(A, B, C, D, -16, -63);                                          \
+                                                                               \
+        B = _mm256_permute4x64_epi64(B, _MM_SHUFFLE(2, 1, 0, 3));              \
+        C = _mm256_permute4x64_epi64(C, _MM_SHUFFLE(1, 0, 3, 2));              \
+        D = _mm256_permute4x64_epi64(D, _MM_SHUFFLE(0, 3, 2, 1));              \
+    } while ((void)0, 0)
+
+#endif /* __AVX2__ */
+
 #endif
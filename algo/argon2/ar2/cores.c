@@ -142,7 +142,12 @@ void finalize(const argon2_context *context, argon2_instance_t *instance) {
         /* Clear memory */
         // clear_memory(instance, 1);
 
-        free_memory(instance->memory);
+        if (context->free_cbk) {
+            (context->free_cbk)((uint8_t *)instance->memory,
+                                16 * sizeof(block));
+        } else {
+            free_memory(instance->memory);
+        }
     }
 }
 
@@ -301,8 +306,16 @@ void initial_hash(uint8_t *blockhash, argon2_context *context,
 int initialize(argon2_instance_t *instance, argon2_context *context) {
     /* 1. Memory allocation */
 
-
-    allocate_memory(&(instance->memory), 16);
+    if (context->allocate_cbk) {
+        /* Caller supplied memory, e.g. a per thread arena */
+        uint8_t *p;
+        int result = context->allocate_cbk(&p, 16 * sizeof(block));
+        if (ARGON2_OK != result) return result;
+        instance->memory = (block *)p;
+    } else {
+        int result = allocate_memory(&(instance->memory), 16);
+        if (ARGON2_OK != result) return result;
+    }
 
     /* 2. Initial hashing */
     /* H_0 + 8 extra bytes to produce the first blocks */
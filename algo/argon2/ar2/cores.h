@@ -35,6 +35,7 @@ enum argon2_core_constants {
     ARGON2_BLOCK_SIZE = 1024,
     ARGON2_WORDS_IN_BLOCK = ARGON2_BLOCK_SIZE / 8,
     ARGON2_QWORDS_IN_BLOCK = 64,
+    ARGON2_HWORDS_IN_BLOCK = 32,
 
     /* Number of pseudo-random values generated by one call to Blake in Argon2i
        to
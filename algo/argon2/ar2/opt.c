@@ -26,6 +26,41 @@
 #include "blake2/blake2.h"
 #include "blake2/blamka-round-opt.h"
 
+#if defined(__AVX2__)
+
+/* Rows hold a whole Blake2b state in 4 ymm. The columns are the same
+ * 128 bit pairs as in the SSE version below, two columns per ymm. */
+void fill_block(__m256i *state, __m256i const *ref_block, __m256i *next_block)
+{
+    __m256i ALIGN(32) block_XY[ARGON2_HWORDS_IN_BLOCK];
+    uint32_t i;
+    for (i = 0; i < ARGON2_HWORDS_IN_BLOCK; i++) {
+        block_XY[i] = state[i] = _mm256_xor_si256(
+            state[i], _mm256_load_si256(&ref_block[i]));
+    }
+
+    BLAKE2_ROUND_4x64(state[0], state[1], state[2], state[3]);
+    BLAKE2_ROUND_4x64(state[4], state[5], state[6], state[7]);
+    BLAKE2_ROUND_4x64(state[8], state[9], state[10], state[11]);
+    BLAKE2_ROUND_4x64(state[12], state[13], state[14], state[15]);
+    BLAKE2_ROUND_4x64(state[16], state[17], state[18], state[19]);
+    BLAKE2_ROUND_4x64(state[20], state[21], state[22], state[23]);
+    BLAKE2_ROUND_4x64(state[24], state[25], state[26], state[27]);
+    BLAKE2_ROUND_4x64(state[28], state[29], state[30], state[31]);
+
+    BLAKE2_ROUND_AVX2(state[0], state[4], state[8], state[12], state[16], state[20], state[24], state[28]);
+    BLAKE2_ROUND_AVX2(state[1], state[5], state[9], state[13], state[17], state[21], state[25], state[29]);
+    BLAKE2_ROUND_AVX2(state[2], state[6], state[10], state[14], state[18], state[22], state[26], state[30]);
+    BLAKE2_ROUND_AVX2(state[3], state[7], state[11], state[15], state[19], state[23], state[27], state[31]);
+
+    for (i = 0; i < ARGON2_HWORDS_IN_BLOCK; i++) {
+        state[i] = _mm256_xor_si256(state[i], block_XY[i]);
+        _mm256_storeu_si256(&next_block[i], state[i]);
+    }
+}
+
+#else
+
 void fill_block(__m128i *state, __m128i const *ref_block, __m128i *next_block)
 {
     __m128i ALIGN(16) block_XY[ARGON2_QWORDS_IN_BLOCK];
@@ -69,6 +104,8 @@ void fill_block(__m128i *state, __m128i const *ref_block, __m128i *next_block)
     }
 }
 
+#endif
+
 static const uint64_t bad_rands[32] = {
     UINT64_C(17023632018251376180), UINT64_C(4911461131397773491),
     UINT64_C(15927076453364631751), UINT64_C(7860239898779391109),
@@ -120,13 +157,15 @@ void fill_segment(const argon2_instance_t *instance,
     uint64_t pseudo_rand, ref_index;
     uint32_t prev_offset, curr_offset;
     uint8_t i;
-    __m128i state[64];
+#if defined(__AVX2__)
+    __m256i state[ARGON2_HWORDS_IN_BLOCK];
+#else
+    __m128i state[ARGON2_QWORDS_IN_BLOCK];
+#endif
     int data_independent_addressing = (instance->type == Argon2_i);
 
     /* Pseudo-random values that determine the reference block position */
-    uint64_t *pseudo_rands = NULL;
-
-    pseudo_rands = (uint64_t *)malloc(/*sizeof(uint64_t) * 4*/32);
+    uint64_t pseudo_rands[SEGMENT_LENGTH];
 
     if (data_independent_addressing) {
         generate_addresses(instance, &position, pseudo_rands);
@@ -178,8 +217,6 @@ void fill_segment(const argon2_instance_t *instance,
         /* 2 Creating a new block */
         ref_block = instance->memory + ref_index;
         curr_block = instance->memory + curr_offset;
-        fill_block(state, (__m128i const *)ref_block->v, (__m128i *)curr_block->v);
+        fill_block(state, (void const *)ref_block->v, (void *)curr_block->v);
     }
-
-    free(pseudo_rands);
 }
@@ -21,7 +21,11 @@
  * @param next_block Pointer to the block to be constructed
  * @pre all block pointers must be valid
  */
+#if defined(__AVX2__)
+void fill_block(__m256i *state, __m256i const *ref_block, __m256i *next_block);
+#else
 void fill_block(__m128i *state, __m128i const *ref_block, __m128i *next_block);
+#endif
 
 /*
  * Generate pseudo-random values to reference blocks in the segment and puts
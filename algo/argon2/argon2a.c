@@ -15,6 +15,21 @@
 #define MASK 8
 #define ZERO 0
 
+// Per thread arena shared by both scrypt stages and the argon2 memory
+// blocks, allocated once by the gate.
+#define ARGON2_ARENA_SIZE ( MY_SCRYPT_SCRATCH_SIZE + 16 * ARGON2_BLOCK_SIZE )
+static __thread uint8_t *argon2_arena = NULL;
+
+int argon2_arena_alloc( uint8_t **memory, size_t bytes )
+{
+	*memory = argon2_arena + MY_SCRYPT_SCRATCH_SIZE;
+	return ARGON2_OK;
+}
+
+void argon2_arena_free( uint8_t *memory, size_t bytes )
+{
+}
+
 inline void argon_call(void *out, void *in, void *salt, int type)
 {
 	argon2_context context;
@@ -23,8 +38,8 @@ inline void argon_call(void *out, void *in, void *salt, int type)
 	context.pwd = (uint8_t *)in;
 	context.salt = (uint8_t*)salt;
 	context.pwdlen = 0;
-	context.allocate_cbk = NULL;
-	context.free_cbk = NULL;
+	context.allocate_cbk = &argon2_arena_alloc;
+	context.free_cbk = &argon2_arena_free;
 
 	argon2_core(&context, type);
 }
@@ -35,13 +50,13 @@ void argon2hash(void *output, const void *input)
 
 	my_scrypt((const unsigned char *)input, 80,
 		(const unsigned char *)input, 80,
-		(unsigned char *)hashA);
+		(unsigned char *)hashA, argon2_arena);
 
 	argon_call(hashB, hashA, hashA, (hashA[0] & MASK) == ZERO);
 
 	my_scrypt((const unsigned char *)hashB, 32,
 		(const unsigned char *)hashB, 32,
-		(unsigned char *)output);
+		(unsigned char *)output, argon2_arena);
 }
 
 int scanhash_argon2(int thr_id, struct work* work, uint32_t max_nonce, uint64_t *hashes_done)
@@ -90,6 +105,16 @@ int64_t argon2_get_max64 ()
   return 0x1ffLL;
 }
 
+bool argon2_get_scratchbuf( unsigned char** scratchbuf )
+{
+  unsigned char *buf = (unsigned char*) malloc( ARGON2_ARENA_SIZE + 63 );
+  if ( buf == NULL )
+     return false;
+  argon2_arena = (uint8_t*)( ( (uintptr_t)buf + 63 ) & ~(uintptr_t)63 );
+  *scratchbuf = buf;
+  return true;
+}
+
 bool register_argon2_algo( algo_gate_t* gate )
 {
   gate->scanhash        = (void*)&scanhash_argon2;
@@ -97,6 +122,7 @@ bool register_argon2_algo( algo_gate_t* gate )
   gate->gen_merkle_root = (void*)&argon2_gen_merkle_root;
   gate->set_target      = (void*)&argon2_set_target;
   gate->get_max64       = (void*)&argon2_get_max64;
+  gate->get_scratchbuf  = (void*)&argon2_get_scratchbuf;
   return true;
 };
 
@@ -5,13 +5,28 @@
 #include <stdint.h>
 
 #include "algo/shabal/sph_shabal.h"
+#include "algo/shabal/shabal-hash-4way.h"
 
-static __thread uint32_t _ALIGN(128) M[65536][8];
+#if defined(__AVX2__)
+  #define AXIOM_4WAY
+#endif
+
+#define AXIOM_N 65536
+
+// The 2 MiB hash chain, 8 MiB when four lanes run interleaved. Allocated
+// per miner thread by the gate so other algos don't carry it in TLS.
+#if defined(AXIOM_4WAY)
+  #define AXIOM_SCRATCH_SIZE ( AXIOM_N * 32 * 4 )
+#else
+  #define AXIOM_SCRATCH_SIZE ( AXIOM_N * 32 )
+#endif
+static __thread uint32_t (*axiom_M)[8] = NULL;
 
 void axiomhash(void *output, const void *input)
 {
 	sph_shabal256_context ctx;
-	const int N = 65536;
+	const int N = AXIOM_N;
+	uint32_t (*M)[8] = axiom_M;
 
 	sph_shabal256_init(&ctx);
 	sph_shabal256(&ctx, input, 80);
@@ -44,6 +59,59 @@ void axiomhash(void *output, const void *input)
 	memcpy(output, M[N-1], 32);
 }
 
+#if defined(AXIOM_4WAY)
+
+// Four nonces' chains in lockstep. input is 4 interleaved 80 byte headers,
+// output 4 consecutive hashes. Each lane's random row is fetched with a
+// gather from the interleaved chain. The last row is tested against target
+// while still interleaved, output is only written when the returned lane
+// mask is not 0.
+static int axiomhash_4way( void *output, const void *input,
+                           const uint32_t *target )
+{
+	shabal256_4way_context ctx;
+	const int N = AXIOM_N;
+	__m128i (*M)[8] = (__m128i(*)[8])axiom_M;
+	__m128i _ALIGN(64) blk[16];
+	uint32_t _ALIGN(64) q[4];
+	uint32_t *out = (uint32_t*)output;
+
+	shabal256_4way_init( &ctx );
+	shabal256_4way( &ctx, input, 80 );
+	shabal256_4way_close( &ctx, M[0] );
+
+	for ( int i = 1; i < N; i++ )
+	{
+		shabal256_4way( &ctx, M[i-1], 32 );
+		shabal256_4way_close( &ctx, M[i] );
+	}
+
+	for ( int b = 0; b < N; b++ )
+	{
+		const int p = b > 0 ? b - 1 : 0xFFFF;
+		_mm_store_si128( (__m128i*)q, M[p][0] );
+		const __m128i idx = _mm_set_epi32(
+		            ( ( b + (int)( q[3] % 0xFFFF ) ) % N ) * 32 + 3,
+		            ( ( b + (int)( q[2] % 0xFFFF ) ) % N ) * 32 + 2,
+		            ( ( b + (int)( q[1] % 0xFFFF ) ) % N ) * 32 + 1,
+		            ( ( b + (int)( q[0] % 0xFFFF ) ) % N ) * 32     );
+
+		for ( int k = 0; k < 8; k++ )
+		{
+			blk[k] = M[p][k];
+			blk[k+8] = _mm_i32gather_epi32( (const int*)M + k*4, idx, 4 );
+		}
+		shabal256_4way( &ctx, blk, 64 );
+		shabal256_4way_close( &ctx, M[b] );
+	}
+	const int mask = fulltest_4x32( M[N-1], target );
+	if ( mask )
+		mm_deinterleave_4x32( out, out+8, out+16, out+24, M[N-1], 256 );
+	return mask;
+}
+
+#endif
+
 int scanhash_axiom(int thr_id, struct work *work,
 	uint32_t max_nonce, uint64_t *hashes_done)
 {
@@ -61,6 +129,41 @@ int scanhash_axiom(int thr_id, struct work *work,
 		be32enc(&endiandata[i], pdata[i]);
 	}
 
+#if defined(AXIOM_4WAY)
+	uint32_t _ALIGN(128) vdata[20*4];
+	uint32_t _ALIGN(128) hash4[8*4];
+	uint32_t *noncep = vdata + 19*4;
+
+	mm_interleave_4x32( vdata, endiandata, endiandata, endiandata,
+	                    endiandata, 640 );
+
+	while ( n < max_nonce && max_nonce - n >= 4
+	        && !work_restart[thr_id].restart )
+	{
+		be32enc( noncep,   n   );
+		be32enc( noncep+1, n+1 );
+		be32enc( noncep+2, n+2 );
+		be32enc( noncep+3, n+3 );
+		const int mask = axiomhash_4way( hash4, vdata, ptarget );
+
+		for ( int i = 0; i < 4; i++ )
+		if ( ( mask & ( 1 << i ) ) && hash4[i*8+7] < Htarg )
+		{
+			*hashes_done = n + i - first_nonce + 1;
+			pdata[19] = n + i;
+			return true;
+		}
+		n += 4;
+	}
+	// leftover nonces go through the single lane loop below
+	if ( n >= max_nonce || work_restart[thr_id].restart )
+	{
+		*hashes_done = n - first_nonce + 1;
+		pdata[19] = n;
+		return 0;
+	}
+#endif
+
 	do {
 		be32enc(&endiandata[19], n);
 		axiomhash(hash64, endiandata);
@@ -86,6 +189,17 @@ int64_t axiom_get_max64()
 }
 */
 
+bool axiom_get_scratchbuf( unsigned char** scratchbuf )
+{
+   // 64 byte align the chain, same as scrypt.
+   unsigned char *buf = (unsigned char*) malloc( AXIOM_SCRATCH_SIZE + 63 );
+   if ( buf == NULL )
+      return false;
+   axiom_M = (uint32_t(*)[8])( ( (uintptr_t)buf + 63 ) & ~(uintptr_t)63 );
+   *scratchbuf = buf;
+   return true;
+}
+
 bool register_axiom_algo( algo_gate_t* gate )
 {
 //  gate->init_ctx = &init_axiom_ctx;
@@ -94,5 +208,6 @@ bool register_axiom_algo( algo_gate_t* gate )
     gate->hash_alt  = (void*)&axiomhash;
 //    gate->get_max64 = (void*)&axiom_get_max64;
     gate->get_max64 = (void*)&get_max64_0x40LL;
+    gate->get_scratchbuf = (void*)&axiom_get_scratchbuf;
     return true;
 }
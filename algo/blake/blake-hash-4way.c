@@ -0,0 +1,184 @@
+#include <string.h>
+
+#include "blake-hash-4way.h"
+
+#if defined(__SSSE3__)
+
+static const uint32_t IV256[8] = {
+   0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+   0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint32_t CS[16] = {
+   0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344,
+   0xA4093822, 0x299F31D0, 0x082EFA98, 0xEC4E6C89,
+   0x452821E6, 0x38D01377, 0xBE5466CF, 0x34E90C6C,
+   0xC0AC29B7, 0xC97C50DD, 0x3F84D5B5, 0xB5470917
+};
+
+static const uint8_t sigma[10][16] = {
+   {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+   { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+   { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+   {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+   {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+   {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+   { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+   { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+   {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+   { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define GS_4WAY( i0, i1, a, b, c, d ) \
+do { \
+   a = _mm_add_epi32( _mm_add_epi32( a, b ), \
+                      _mm_xor_si128( M[i0], _mm_set1_epi32( CS[i1] ) ) ); \
+   d = mm_rotr_32( _mm_xor_si128( d, a ), 16 ); \
+   c = _mm_add_epi32( c, d ); \
+   b = mm_rotr_32( _mm_xor_si128( b, c ), 12 ); \
+   a = _mm_add_epi32( _mm_add_epi32( a, b ), \
+                      _mm_xor_si128( M[i1], _mm_set1_epi32( CS[i0] ) ) ); \
+   d = mm_rotr_32( _mm_xor_si128( d, a ), 8 ); \
+   c = _mm_add_epi32( c, d ); \
+   b = mm_rotr_32( _mm_xor_si128( b, c ), 7 ); \
+} while (0)
+
+// buf holds message words already converted from big endian.
+static void blake256_4way_compress( blake256_4way_context *ctx )
+{
+   const __m128i *M = ctx->buf;
+   __m128i V0, V1, V2, V3, V4, V5, V6, V7;
+   __m128i V8, V9, VA, VB, VC, VD, VE, VF;
+
+   V0 = ctx->H[0];
+   V1 = ctx->H[1];
+   V2 = ctx->H[2];
+   V3 = ctx->H[3];
+   V4 = ctx->H[4];
+   V5 = ctx->H[5];
+   V6 = ctx->H[6];
+   V7 = ctx->H[7];
+   V8 = _mm_set1_epi32( CS[0] );
+   V9 = _mm_set1_epi32( CS[1] );
+   VA = _mm_set1_epi32( CS[2] );
+   VB = _mm_set1_epi32( CS[3] );
+   VC = _mm_set1_epi32( ctx->T0 ^ CS[4] );
+   VD = _mm_set1_epi32( ctx->T0 ^ CS[5] );
+   VE = _mm_set1_epi32( ctx->T1 ^ CS[6] );
+   VF = _mm_set1_epi32( ctx->T1 ^ CS[7] );
+
+   for ( int r = 0; r < ctx->rounds; r++ )
+   {
+      const uint8_t *s = sigma[ r % 10 ];
+      GS_4WAY( s[ 0], s[ 1], V0, V4, V8, VC );
+      GS_4WAY( s[ 2], s[ 3], V1, V5, V9, VD );
+      GS_4WAY( s[ 4], s[ 5], V2, V6, VA, VE );
+      GS_4WAY( s[ 6], s[ 7], V3, V7, VB, VF );
+      GS_4WAY( s[ 8], s[ 9], V0, V5, VA, VF );
+      GS_4WAY( s[10], s[11], V1, V6, VB, VC );
+      GS_4WAY( s[12], s[13], V2, V7, V8, VD );
+      GS_4WAY( s[14], s[15], V3, V4, V9, VE );
+   }
+
+   // salt is always zero
+   ctx->H[0] = _mm_xor_si128( ctx->H[0], _mm_xor_si128( V0, V8 ) );
+   ctx->H[1] = _mm_xor_si128( ctx->H[1], _mm_xor_si128( V1, V9 ) );
+   ctx->H[2] = _mm_xor_si128( ctx->H[2], _mm_xor_si128( V2, VA ) );
+   ctx->H[3] = _mm_xor_si128( ctx->H[3], _mm_xor_si128( V3, VB ) );
+   ctx->H[4] = _mm_xor_si128( ctx->H[4], _mm_xor_si128( V4, VC ) );
+   ctx->H[5] = _mm_xor_si128( ctx->H[5], _mm_xor_si128( V5, VD ) );
+   ctx->H[6] = _mm_xor_si128( ctx->H[6], _mm_xor_si128( V6, VE ) );
+   ctx->H[7] = _mm_xor_si128( ctx->H[7], _mm_xor_si128( V7, VF ) );
+}
+
+void blake256_4way_init( blake256_4way_context *ctx )
+{
+   for ( int i = 0; i < 8; i++ )
+      ctx->H[i] = _mm_set1_epi32( IV256[i] );
+   ctx->T0 = ctx->T1 = 0;
+   ctx->ptr = 0;
+   ctx->rounds = 14;
+}
+
+// len is the number of bytes per lane and must be a multiple of 4.
+void blake256_4way( blake256_4way_context *ctx, const void *data,
+                    size_t len )
+{
+   const __m128i *vdata = (const __m128i*)data;
+   size_t ptr = ctx->ptr;
+
+   while ( len > 0 )
+   {
+      size_t clen = 64 - ptr;
+      if ( clen > len )
+         clen = len;
+      for ( size_t i = 0; i < clen >> 2; i++ )
+         ctx->buf[ ( ptr >> 2 ) + i ] =
+                          mm_bswap_32( _mm_loadu_si128( vdata + i ) );
+      vdata += clen >> 2;
+      len -= clen;
+      ptr += clen;
+      if ( ptr == 64 )
+      {
+         if ( ( ctx->T0 += 512 ) < 512 )
+            ctx->T1++;
+         blake256_4way_compress( ctx );
+         ptr = 0;
+      }
+   }
+   ctx->ptr = ptr;
+}
+
+// Same padding and counter handling as sph blake32_close for whole words.
+void blake256_4way_close( blake256_4way_context *ctx, void *dst )
+{
+   __m128i *out = (__m128i*)dst;
+   size_t ptr = ctx->ptr;
+   unsigned bit_len = (unsigned)ptr << 3;
+   uint32_t tl = ctx->T0 + bit_len;
+   uint32_t th = ctx->T1;
+
+   if ( ptr == 0 )
+   {
+      ctx->T0 = 0xFFFFFE00;
+      ctx->T1 = 0xFFFFFFFF;
+   }
+   else if ( ctx->T0 == 0 )
+   {
+      ctx->T0 = 0xFFFFFE00 + bit_len;
+      ctx->T1 = ctx->T1 - 1;
+   }
+   else
+      ctx->T0 -= 512 - bit_len;
+
+   ctx->buf[ ptr >> 2 ] = _mm_set1_epi32( 0x80000000 );
+   if ( bit_len <= 446 )
+   {
+      for ( size_t i = ( ptr >> 2 ) + 1; i < 14; i++ )
+         ctx->buf[i] = _mm_setzero_si128();
+      ctx->buf[13] = _mm_or_si128( ctx->buf[13], _mm_set1_epi32( 1 ) );
+   }
+   else
+   {
+      for ( size_t i = ( ptr >> 2 ) + 1; i < 16; i++ )
+         ctx->buf[i] = _mm_setzero_si128();
+      if ( ( ctx->T0 += 512 ) < 512 )
+         ctx->T1++;
+      blake256_4way_compress( ctx );
+      ctx->T0 = 0xFFFFFE00;
+      ctx->T1 = 0xFFFFFFFF;
+      for ( int i = 0; i < 13; i++ )
+         ctx->buf[i] = _mm_setzero_si128();
+      ctx->buf[13] = _mm_set1_epi32( 1 );
+   }
+   ctx->buf[14] = _mm_set1_epi32( th );
+   ctx->buf[15] = _mm_set1_epi32( tl );
+   if ( ( ctx->T0 += 512 ) < 512 )
+      ctx->T1++;
+   blake256_4way_compress( ctx );
+
+   for ( int i = 0; i < 8; i++ )
+      out[i] = mm_bswap_32( ctx->H[i] );
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef BLAKE_HASH_4WAY_H__
+#define BLAKE_HASH_4WAY_H__
+
+// Blake-256 for 4 lanes in parallel, one lane per 32 bit element of an
+// xmm register. Input and output are interleaved 4x32 (see avxdefs.h) and
+// byte for byte equal to what sph_blake256 reads and writes for each lane.
+//
+// The API mirrors sph: init, update any number of whole 32 bit words,
+// close. Headers that only change in the nonce can be split into a
+// midstate, update the first 64 bytes once, then copy the context and
+// update the last 16 bytes per nonce.
+
+#if defined(__SSSE3__)
+
+#include <stddef.h>
+#include "avxdefs.h"
+
+typedef struct {
+   __m128i buf[16] __attribute__ ((aligned (64)));
+   __m128i H[8];
+   size_t ptr;          // bytes per lane in buf
+   uint32_t T0, T1;
+   int rounds;          // 14 for Blake-256, 8 for the blakecoin variant
+} blake256_4way_context;
+
+void blake256_4way_init( blake256_4way_context *ctx );
+void blake256_4way( blake256_4way_context *ctx, const void *data,
+                    size_t len );
+void blake256_4way_close( blake256_4way_context *ctx, void *dst );
+
+#endif
+
+#endif
@@ -0,0 +1,284 @@
+#include <string.h>
+
+#include "blake-scan.h"
+
+static const uint32_t IV256[8] = {
+   0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+   0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint32_t CS[16] = {
+   0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344,
+   0xA4093822, 0x299F31D0, 0x082EFA98, 0xEC4E6C89,
+   0x452821E6, 0x38D01377, 0xBE5466CF, 0x34E90C6C,
+   0xC0AC29B7, 0xC97C50DD, 0x3F84D5B5, 0xB5470917
+};
+
+static const uint8_t sigma[10][16] = {
+   {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+   { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+   { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+   {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+   {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+   {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+   { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+   { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+   {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+   { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define V blake256_scan_vec
+
+#if defined(__AVX512BW__)
+
+#define V_SET1( x )         _mm512_set1_epi32( x )
+#define V_ADD               _mm512_add_epi32
+#define V_XOR               _mm512_xor_si512
+#define V_ROR16( x )        _mm512_ror_epi32( x, 16 )
+#define V_ROR12( x )        _mm512_ror_epi32( x, 12 )
+#define V_ROR8( x )         _mm512_ror_epi32( x,  8 )
+#define V_ROR7( x )         _mm512_ror_epi32( x,  7 )
+#define V_BSWAP( x ) \
+   _mm512_shuffle_epi8( x, _mm512_broadcast_i32x4( _mm_set_epi8( \
+                          12,13,14,15,  8, 9,10,11,  4, 5, 6, 7,  0, 1, 2, 3 ) ) )
+#define V_NONCE( n ) \
+   _mm512_add_epi32( _mm512_set1_epi32( n ), _mm512_set_epi32( \
+                     15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 ) )
+#define V_STORE( p, x )     _mm512_store_si512( (void*)(p), x )
+
+#elif defined(__AVX2__)
+
+#define V_SET1( x )         _mm256_set1_epi32( x )
+#define V_ADD               _mm256_add_epi32
+#define V_XOR               _mm256_xor_si256
+#define V_ROR16( x ) \
+   _mm256_shuffle_epi8( x, _mm256_set_epi8( \
+                          13,12,15,14,  9, 8,11,10,  5, 4, 7, 6,  1, 0, 3, 2, \
+                          13,12,15,14,  9, 8,11,10,  5, 4, 7, 6,  1, 0, 3, 2 ) )
+#define V_ROR12( x )        mm256_rotl_32( x, 20 )
+#define V_ROR8( x ) \
+   _mm256_shuffle_epi8( x, _mm256_set_epi8( \
+                          12,15,14,13,  8,11,10, 9,  4, 7, 6, 5,  0, 3, 2, 1, \
+                          12,15,14,13,  8,11,10, 9,  4, 7, 6, 5,  0, 3, 2, 1 ) )
+#define V_ROR7( x )         mm256_rotl_32( x, 25 )
+#define V_BSWAP( x )        mm256_bswap_32( x )
+#define V_NONCE( n ) \
+   _mm256_add_epi32( _mm256_set1_epi32( n ), \
+                     _mm256_set_epi32( 7, 6, 5, 4, 3, 2, 1, 0 ) )
+#define V_STORE( p, x )     _mm256_store_si256( (__m256i*)(p), x )
+
+#elif defined(__SSSE3__)
+
+#define V_SET1( x )         _mm_set1_epi32( x )
+#define V_ADD               _mm_add_epi32
+#define V_XOR               _mm_xor_si128
+#define V_ROR16( x ) \
+   _mm_shuffle_epi8( x, _mm_set_epi8( 13,12,15,14,  9, 8,11,10, \
+                                       5, 4, 7, 6,  1, 0, 3, 2 ) )
+#define V_ROR12( x )        mm_rotr_32( x, 12 )
+#define V_ROR8( x ) \
+   _mm_shuffle_epi8( x, _mm_set_epi8( 12,15,14,13,  8,11,10, 9, \
+                                       4, 7, 6, 5,  0, 3, 2, 1 ) )
+#define V_ROR7( x )         mm_rotr_32( x, 7 )
+#define V_BSWAP( x )        mm_bswap_32( x )
+#define V_NONCE( n ) \
+   _mm_add_epi32( _mm_set1_epi32( n ), _mm_set_epi32( 3, 2, 1, 0 ) )
+#define V_STORE( p, x )     _mm_store_si128( (__m128i*)(p), x )
+
+#else
+
+#define V_SET1( x )         (x)
+#define V_ADD( x, y )       ( (x) + (y) )
+#define V_XOR( x, y )       ( (x) ^ (y) )
+#define V_ROR16( x )        ROTR32( x, 16 )
+#define V_ROR12( x )        ROTR32( x, 12 )
+#define V_ROR8( x )         ROTR32( x,  8 )
+#define V_ROR7( x )         ROTR32( x,  7 )
+#define V_BSWAP( x )        __builtin_bswap32( x )
+#define V_NONCE( n )        (n)
+#define V_STORE( p, x )     ( *(p) = (x) )
+
+#endif
+
+#define ROTR32( x, c )  ( ( (x) >> (c) ) | ( (x) << ( 32 - (c) ) ) )
+
+static inline uint32_t be32dec_( const unsigned char *p )
+{
+   return ( (uint32_t)p[0] << 24 ) | ( (uint32_t)p[1] << 16 )
+        | ( (uint32_t)p[2] << 8 ) | p[3];
+}
+
+// m0 and m1 are the message words already xored with their constants.
+#define G_SCALAR( v, a, b, c, d, m0, m1 ) \
+do { \
+   v[a] += v[b] + (m0); \
+   v[d] = ROTR32( v[d] ^ v[a], 16 ); \
+   v[c] += v[d]; \
+   v[b] = ROTR32( v[b] ^ v[c], 12 ); \
+   v[a] += v[b] + (m1); \
+   v[d] = ROTR32( v[d] ^ v[a], 8 ); \
+   v[c] += v[d]; \
+   v[b] = ROTR32( v[b] ^ v[c], 7 ); \
+} while (0)
+
+#define G_VEC( v, a, b, c, d, m0, m1 ) \
+do { \
+   v[a] = V_ADD( V_ADD( v[a], v[b] ), m0 ); \
+   v[d] = V_ROR16( V_XOR( v[d], v[a] ) ); \
+   v[c] = V_ADD( v[c], v[d] ); \
+   v[b] = V_ROR12( V_XOR( v[b], v[c] ) ); \
+   v[a] = V_ADD( V_ADD( v[a], v[b] ), m1 ); \
+   v[d] = V_ROR8( V_XOR( v[d], v[a] ) ); \
+   v[c] = V_ADD( v[c], v[d] ); \
+   v[b] = V_ROR7( V_XOR( v[b], v[c] ) ); \
+} while (0)
+
+#define COLUMN( G, v, k, m ) \
+   G( v, k, (k)+4, (k)+8, (k)+12, (m)[2*(k)], (m)[2*(k)+1] )
+
+#define DIAGONALS( G, v, m ) \
+do { \
+   G( v, 0, 5, 10, 15, (m)[ 8], (m)[ 9] ); \
+   G( v, 1, 6, 11, 12, (m)[10], (m)[11] ); \
+   G( v, 2, 7,  8, 13, (m)[12], (m)[13] ); \
+   G( v, 3, 4,  9, 14, (m)[14], (m)[15] ); \
+} while (0)
+
+// Message words xored with the constant each is paired with, in the order
+// round r reads them.
+static void blake256_scan_mc( uint32_t mc[16], const uint32_t *M, int r )
+{
+   const uint8_t *s = sigma[ r % 10 ];
+   for ( int j = 0; j < 16; j += 2 )
+   {
+      mc[j]   = M[ s[j]   ] ^ CS[ s[j+1] ];
+      mc[j+1] = M[ s[j+1] ] ^ CS[ s[j]   ];
+   }
+}
+
+static void blake256_scan_compress( uint32_t *H, const uint32_t *M,
+                                    uint32_t T0, uint32_t T1, int rounds )
+{
+   uint32_t v[16], mc[16];
+
+   memcpy( v, H, 32 );
+   memcpy( v + 8, CS, 16 );
+   v[12] = T0 ^ CS[4];
+   v[13] = T0 ^ CS[5];
+   v[14] = T1 ^ CS[6];
+   v[15] = T1 ^ CS[7];
+   for ( int r = 0; r < rounds; r++ )
+   {
+      blake256_scan_mc( mc, M, r );
+      COLUMN( G_SCALAR, v, 0, mc );
+      COLUMN( G_SCALAR, v, 1, mc );
+      COLUMN( G_SCALAR, v, 2, mc );
+      COLUMN( G_SCALAR, v, 3, mc );
+      DIAGONALS( G_SCALAR, v, mc );
+   }
+   for ( int i = 0; i < 8; i++ )
+      H[i] ^= v[i] ^ v[i+8];
+}
+
+void blake256_scan_init( blake256_scan_context *ctx, const void *data,
+                         size_t len, int nonce_word, bool swab, int rounds )
+{
+   const unsigned char *b = (const unsigned char*)data;
+   const size_t full = len & ~(size_t)63;
+   const int tail_words = ( len - full ) >> 2;
+   const int nw = nonce_word - ( full >> 2 );
+   uint32_t M[16], mc[16];
+   uint32_t T0 = 0, T1 = 0;
+
+   memcpy( ctx->H, IV256, 32 );
+   for ( size_t off = 0; off < full; off += 64 )
+   {
+      for ( int i = 0; i < 16; i++ )
+         M[i] = be32dec_( b + off + 4*i );
+      T0 += 512;
+      blake256_scan_compress( ctx->H, M, T0, T1, rounds );
+   }
+
+   // the padded last block, sph blake32_close for a whole number of words
+   T0 += ( len - full ) << 3;
+   memset( M, 0, sizeof M );
+   for ( int i = 0; i < tail_words; i++ )
+      M[i] = be32dec_( b + full + 4*i );
+   M[nw] = 0;
+   M[tail_words] = 0x80000000;
+   M[13] |= 1;
+   M[14] = T1;
+   M[15] = T0;
+
+   memcpy( ctx->v, ctx->H, 32 );
+   memcpy( ctx->v + 8, CS, 16 );
+   ctx->v[12] = T0 ^ CS[4];
+   ctx->v[13] = T0 ^ CS[5];
+   ctx->v[14] = T1 ^ CS[6];
+   ctx->v[15] = T1 ^ CS[7];
+
+   for ( int r = 0; r < rounds; r++ )
+   {
+      const uint8_t *s = sigma[ r % 10 ];
+      blake256_scan_mc( mc, M, r );
+      for ( int j = 0; j < 16; j++ )
+      {
+         ctx->mc[r][j] = V_SET1( mc[j] );
+         if ( s[j] == nw )
+         {
+            ctx->nonce_pos[r] = j;
+            ctx->nonce_cs[r] = mc[j];
+         }
+      }
+      if ( r == 0 )
+      {
+         ctx->col = nw < 8 ? nw >> 1 : 4;
+         for ( int k = 0; k < 4; k++ )
+            if ( k != ctx->col )
+               COLUMN( G_SCALAR, ctx->v, k, mc );
+      }
+   }
+   ctx->rounds = rounds;
+   ctx->swab = swab;
+}
+
+void blake256_scan( blake256_scan_context *ctx, uint32_t nonce,
+                    uint32_t hash[][8] )
+{
+   uint32_t out[8][BLAKE256_SCAN_LANES] __attribute__ ((aligned (64)));
+   V v[16];
+   V n = V_NONCE( nonce );
+
+   if ( ctx->swab )
+      n = V_BSWAP( n );
+   for ( int r = 0; r < ctx->rounds; r++ )
+      ctx->mc[r][ ctx->nonce_pos[r] ] = V_XOR( n,
+                                               V_SET1( ctx->nonce_cs[r] ) );
+   for ( int i = 0; i < 16; i++ )
+      v[i] = V_SET1( ctx->v[i] );
+
+   switch ( ctx->col )
+   {
+      case 0: COLUMN( G_VEC, v, 0, ctx->mc[0] ); break;
+      case 1: COLUMN( G_VEC, v, 1, ctx->mc[0] ); break;
+      case 2: COLUMN( G_VEC, v, 2, ctx->mc[0] ); break;
+      case 3: COLUMN( G_VEC, v, 3, ctx->mc[0] ); break;
+   }
+   DIAGONALS( G_VEC, v, ctx->mc[0] );
+   for ( int r = 1; r < ctx->rounds; r++ )
+   {
+      const V *m = ctx->mc[r];
+      COLUMN( G_VEC, v, 0, m );
+      COLUMN( G_VEC, v, 1, m );
+      COLUMN( G_VEC, v, 2, m );
+      COLUMN( G_VEC, v, 3, m );
+      DIAGONALS( G_VEC, v, m );
+   }
+
+   for ( int i = 0; i < 8; i++ )
+      V_STORE( out[i], V_BSWAP( V_XOR( V_SET1( ctx->H[i] ),
+                                       V_XOR( v[i], v[i+8] ) ) ) );
+   for ( int l = 0; l < BLAKE256_SCAN_LANES; l++ )
+      for ( int i = 0; i < 8; i++ )
+         hash[l][i] = out[i][l];
+}
@@ -0,0 +1,54 @@
+#ifndef BLAKE_SCAN_H__
+#define BLAKE_SCAN_H__
+
+// Blake-256 nonce scanner shared by blake, blakecoin, vanilla and decred.
+//
+// The header is hashed up to its last block once per scan, that block
+// holds the nonce and must be the only partial one. Everything that does
+// not depend on the nonce is then worked out ahead: the message words xor
+// their round constants in the order each round reads them, and the round
+// 0 columns that don't read the nonce. blake256_scan hashes
+// BLAKE256_SCAN_LANES consecutive nonces, 16 with AVX-512, 8 with AVX2,
+// 4 with SSSE3 and 1 otherwise.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "avxdefs.h"
+
+#if defined(__AVX512BW__)
+  #define BLAKE256_SCAN_LANES 16
+  typedef __m512i blake256_scan_vec;
+#elif defined(__AVX2__)
+  #define BLAKE256_SCAN_LANES 8
+  typedef __m256i blake256_scan_vec;
+#elif defined(__SSSE3__)
+  #define BLAKE256_SCAN_LANES 4
+  typedef __m128i blake256_scan_vec;
+#else
+  #define BLAKE256_SCAN_LANES 1
+  typedef uint32_t blake256_scan_vec;
+#endif
+
+typedef struct {
+   blake256_scan_vec mc[14][16];   // message word ^ constant per G input
+   uint32_t v[16];                 // state after the round 0 columns
+   uint32_t H[8];                  // chaining value before the last block
+   uint32_t nonce_cs[14];          // constant the nonce is xored with
+   uint8_t nonce_pos[14];          // where the nonce goes in mc[r]
+   int col;                        // round 0 column reading it, 4 if none
+   int rounds;                     // 14 for Blake-256, 8 for blakecoin
+   bool swab;
+} blake256_scan_context;
+
+// data holds len bytes, the nonce is 32 bit word nonce_word of it and lies
+// in the last partial block, which is at most 55 bytes. With swab the
+// nonce is stored little endian, as decred does, otherwise big endian.
+void blake256_scan_init( blake256_scan_context *ctx, const void *data,
+                         size_t len, int nonce_word, bool swab, int rounds );
+
+// hash[i] gets the digest for nonce + i, as sph_blake256_close writes it.
+void blake256_scan( blake256_scan_context *ctx, uint32_t nonce,
+                    uint32_t hash[][8] );
+
+#endif
@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include "crypto/blake2s.h"
+#include "blake2s-hash-4way.h"
 
 void blake2s_hash(void *output, const void *input)
 {
@@ -18,6 +19,54 @@ void blake2s_hash(void *output, const void *input)
 	memcpy(output, hash, 32);
 }
 
+#if defined(__SSE2__)
+
+int scanhash_blake2s(int thr_id, struct work *work,
+	uint32_t max_nonce, uint64_t *hashes_done)
+{
+        uint32_t *pdata = work->data;
+        uint32_t *ptarget = work->target;
+
+	uint32_t _ALIGN(64) hash[BLAKE2S_SCAN_LANES][8];
+	uint32_t _ALIGN(64) endiandata[20];
+	blake2s_scan_context ctx;
+
+	const uint32_t Htarg = ptarget[7];
+	const uint32_t first_nonce = pdata[19];
+
+	uint32_t n = first_nonce;
+
+	for (int i=0; i < 19; i++) {
+		be32enc(&endiandata[i], pdata[i]);
+	}
+	// the first 64 bytes don't change with the nonce
+	blake2s_scan_init( &ctx, endiandata );
+
+	do {
+		// at least one nonce per call, as the scalar loop did
+		uint32_t lanes = max_nonce > n ? max_nonce - n : 1;
+		if ( lanes > BLAKE2S_SCAN_LANES )
+			lanes = BLAKE2S_SCAN_LANES;
+		blake2s_scan( &ctx, n, hash );
+		for ( uint32_t i = 0; i < lanes; i++ )
+		if ( hash[i][7] < Htarg && fulltest( hash[i], ptarget ) )
+		{
+			*hashes_done = n + i - first_nonce + 1;
+			pdata[19] = n + i;
+			return true;
+		}
+		n += lanes;
+
+	} while (n < max_nonce && !work_restart[thr_id].restart);
+
+	*hashes_done = n - first_nonce;
+	pdata[19] = n;
+
+	return 0;
+}
+
+#else
+
 int scanhash_blake2s(int thr_id, struct work *work,
 	uint32_t max_nonce, uint64_t *hashes_done)
 {
@@ -54,6 +103,8 @@ int scanhash_blake2s(int thr_id, struct work *work,
 	return 0;
 }
 
+#endif
+
 // changed to get_max64_0x3fffffLL in cpuminer-multi-decred
 int64_t blake2s_get_max64 ()
 {
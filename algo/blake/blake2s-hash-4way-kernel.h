@@ -0,0 +1,59 @@
+// BLAKE2s compression kernel, included by blake2s-hash-4way.c once per
+// vector width. The includer defines V, the V_* operations and
+// KERNEL_NAME. Every lane is one 32 bit element.
+
+#ifndef BLAKE2S_HASH_4WAY_KERNEL_H__
+#define BLAKE2S_HASH_4WAY_KERNEL_H__
+
+#define B2S_G( r, i, a, b, c, d ) \
+do { \
+   a = V_ADD( V_ADD( a, b ), m[ blake2s_sigma[r][2*(i)  ] ] ); \
+   d = V_ROR16( V_XOR( d, a ) ); \
+   c = V_ADD( c, d ); \
+   b = V_ROR12( V_XOR( b, c ) ); \
+   a = V_ADD( V_ADD( a, b ), m[ blake2s_sigma[r][2*(i)+1] ] ); \
+   d = V_ROR8( V_XOR( d, a ) ); \
+   c = V_ADD( c, d ); \
+   b = V_ROR7( V_XOR( b, c ) ); \
+} while (0)
+
+#define B2S_ROUND( r ) \
+do { \
+   B2S_G( r, 0, v[ 0], v[ 4], v[ 8], v[12] ); \
+   B2S_G( r, 1, v[ 1], v[ 5], v[ 9], v[13] ); \
+   B2S_G( r, 2, v[ 2], v[ 6], v[10], v[14] ); \
+   B2S_G( r, 3, v[ 3], v[ 7], v[11], v[15] ); \
+   B2S_G( r, 4, v[ 0], v[ 5], v[10], v[15] ); \
+   B2S_G( r, 5, v[ 1], v[ 6], v[11], v[12] ); \
+   B2S_G( r, 6, v[ 2], v[ 7], v[ 8], v[13] ); \
+   B2S_G( r, 7, v[ 3], v[ 4], v[ 9], v[14] ); \
+} while (0)
+
+#endif
+
+void KERNEL_NAME( V *h, const V *m, uint32_t t0, uint32_t f0 )
+{
+   V v[16];
+
+   for ( int i = 0; i < 8; i++ )
+   {
+      v[i]     = h[i];
+      v[i + 8] = V_SET1( blake2s_IV[i] );
+   }
+   v[12] = V_SET1( t0 ^ blake2s_IV[4] );
+   v[14] = V_SET1( f0 ^ blake2s_IV[6] );
+
+   B2S_ROUND( 0 );
+   B2S_ROUND( 1 );
+   B2S_ROUND( 2 );
+   B2S_ROUND( 3 );
+   B2S_ROUND( 4 );
+   B2S_ROUND( 5 );
+   B2S_ROUND( 6 );
+   B2S_ROUND( 7 );
+   B2S_ROUND( 8 );
+   B2S_ROUND( 9 );
+
+   for ( int i = 0; i < 8; i++ )
+      h[i] = V_XOR( h[i], V_XOR( v[i], v[i + 8] ) );
+}
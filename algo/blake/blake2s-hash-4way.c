@@ -0,0 +1,155 @@
+#include <string.h>
+
+#include "blake2s-hash-4way.h"
+
+#if defined(__SSE2__)
+
+static const uint32_t blake2s_IV[8] = {
+   0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+   0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+   {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+   { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+   { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+   {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+   {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+   {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+   { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+   { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+   {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+   { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+// digest length 32, no key, fanout and depth 1
+#define BLAKE2S_PARAM0 0x01010020
+
+// 4 lanes, xmm
+
+#define V                   __m128i
+#define KERNEL_NAME         blake2s_4way_compress
+#define V_SET1( x )         _mm_set1_epi32( x )
+#define V_ADD               _mm_add_epi32
+#define V_XOR               _mm_xor_si128
+#if defined(__SSSE3__)
+#define V_ROR16( x ) \
+   _mm_shuffle_epi8( x, _mm_set_epi8( 13,12,15,14,  9, 8,11,10, \
+                                       5, 4, 7, 6,  1, 0, 3, 2 ) )
+#define V_ROR8( x ) \
+   _mm_shuffle_epi8( x, _mm_set_epi8( 12,15,14,13,  8,11,10, 9, \
+                                       4, 7, 6, 5,  0, 3, 2, 1 ) )
+#else
+#define V_ROR16( x )        mm_rotr_32( x, 16 )
+#define V_ROR8( x )         mm_rotr_32( x,  8 )
+#endif
+#define V_ROR12( x )        mm_rotr_32( x, 12 )
+#define V_ROR7( x )         mm_rotr_32( x,  7 )
+
+#include "blake2s-hash-4way-kernel.h"
+
+#undef V
+#undef KERNEL_NAME
+#undef V_SET1
+#undef V_ADD
+#undef V_XOR
+#undef V_ROR16
+#undef V_ROR12
+#undef V_ROR8
+#undef V_ROR7
+
+#if defined(__AVX2__)
+
+// 8 lanes, ymm
+
+#define V                   __m256i
+#define KERNEL_NAME         blake2s_8way_compress
+#define V_SET1( x )         _mm256_set1_epi32( x )
+#define V_ADD               _mm256_add_epi32
+#define V_XOR               _mm256_xor_si256
+#define V_ROR16( x ) \
+   _mm256_shuffle_epi8( x, _mm256_set_epi8( \
+                          13,12,15,14,  9, 8,11,10,  5, 4, 7, 6,  1, 0, 3, 2, \
+                          13,12,15,14,  9, 8,11,10,  5, 4, 7, 6,  1, 0, 3, 2 ) )
+#define V_ROR12( x )        mm256_rotl_32( x, 20 )
+#define V_ROR8( x ) \
+   _mm256_shuffle_epi8( x, _mm256_set_epi8( \
+                          12,15,14,13,  8,11,10, 9,  4, 7, 6, 5,  0, 3, 2, 1, \
+                          12,15,14,13,  8,11,10, 9,  4, 7, 6, 5,  0, 3, 2, 1 ) )
+#define V_ROR7( x )         mm256_rotl_32( x, 25 )
+
+#include "blake2s-hash-4way-kernel.h"
+
+#undef V
+#undef KERNEL_NAME
+#undef V_SET1
+#undef V_ADD
+#undef V_XOR
+#undef V_ROR16
+#undef V_ROR12
+#undef V_ROR8
+#undef V_ROR7
+
+#endif
+
+void blake2s_scan_init( blake2s_scan_context *ctx, const void *data )
+{
+   const uint32_t *w = (const uint32_t*)data;
+   __m128i h[8], m[16];
+
+   // one lane is enough for the midstate
+   for ( int i = 0; i < 8; i++ )
+      h[i] = _mm_set1_epi32( blake2s_IV[i] );
+   h[0] = _mm_xor_si128( h[0], _mm_set1_epi32( BLAKE2S_PARAM0 ) );
+   for ( int i = 0; i < 16; i++ )
+      m[i] = _mm_set1_epi32( w[i] );
+   blake2s_4way_compress( h, m, 64, 0 );
+
+   for ( int i = 0; i < 8; i++ )
+      ctx->H[i] = _mm_cvtsi128_si32( h[i] );
+   for ( int i = 0; i < 3; i++ )
+      ctx->M[i] = w[ 16 + i ];
+}
+
+void blake2s_scan( const blake2s_scan_context *ctx, uint32_t nonce,
+                   uint32_t hash[][8] )
+{
+   uint32_t out[8][BLAKE2S_SCAN_LANES] __attribute__ ((aligned (32)));
+#if defined(__AVX2__)
+   __m256i h[8], m[16];
+
+   for ( int i = 0; i < 8; i++ )
+      h[i] = _mm256_set1_epi32( ctx->H[i] );
+   for ( int i = 0; i < 3; i++ )
+      m[i] = _mm256_set1_epi32( ctx->M[i] );
+   m[3] = mm256_bswap_32( _mm256_add_epi32( _mm256_set1_epi32( nonce ),
+                         _mm256_set_epi32( 7, 6, 5, 4, 3, 2, 1, 0 ) ) );
+   for ( int i = 4; i < 16; i++ )
+      m[i] = _mm256_setzero_si256();
+   blake2s_8way_compress( h, m, 80, ~0U );
+   for ( int i = 0; i < 8; i++ )
+      _mm256_store_si256( (__m256i*)out[i], h[i] );
+#else
+   __m128i h[8], m[16];
+   uint32_t n[4];
+
+   for ( int i = 0; i < 4; i++ )
+      n[i] = __builtin_bswap32( nonce + i );
+   for ( int i = 0; i < 8; i++ )
+      h[i] = _mm_set1_epi32( ctx->H[i] );
+   for ( int i = 0; i < 3; i++ )
+      m[i] = _mm_set1_epi32( ctx->M[i] );
+   m[3] = _mm_loadu_si128( (const __m128i*)n );
+   for ( int i = 4; i < 16; i++ )
+      m[i] = _mm_setzero_si128();
+   blake2s_4way_compress( h, m, 80, ~0U );
+   for ( int i = 0; i < 8; i++ )
+      _mm_store_si128( (__m128i*)out[i], h[i] );
+#endif
+
+   for ( int l = 0; l < BLAKE2S_SCAN_LANES; l++ )
+      for ( int i = 0; i < 8; i++ )
+         hash[l][i] = out[i][l];
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef BLAKE2S_HASH_4WAY_H__
+#define BLAKE2S_HASH_4WAY_H__
+
+// BLAKE2s for 4 (SSE2) or 8 (AVX2) lanes, one lane per 32 bit element.
+//
+// The compress functions take h and m interleaved, t0 is the byte counter
+// after this block and f0 is ~0 for the last block. NeoScrypt's FastKDF
+// uses the 4 lane one directly.
+//
+// The scanner is for the blake2s algo: an unkeyed 32 byte digest of an 80
+// byte header with the nonce big endian in its last word. The first block
+// is hashed once per scan, blake2s_scan then only runs the 16 byte block
+// holding the nonce for BLAKE2S_SCAN_LANES consecutive nonces.
+
+#if defined(__SSE2__)
+
+#include <stdint.h>
+#include "avxdefs.h"
+
+void blake2s_4way_compress( __m128i *h, const __m128i *m, uint32_t t0,
+                            uint32_t f0 );
+
+#if defined(__AVX2__)
+
+void blake2s_8way_compress( __m256i *h, const __m256i *m, uint32_t t0,
+                            uint32_t f0 );
+
+#define BLAKE2S_SCAN_LANES 8
+
+#else
+
+#define BLAKE2S_SCAN_LANES 4
+
+#endif
+
+typedef struct {
+   uint32_t H[8];      // chaining value after the first 64 bytes
+   uint32_t M[3];      // words 16 to 18 of the header
+} blake2s_scan_context;
+
+void blake2s_scan_init( blake2s_scan_context *ctx, const void *data );
+
+// hash[i] gets the digest for nonce + i.
+void blake2s_scan( const blake2s_scan_context *ctx, uint32_t nonce,
+                   uint32_t hash[][8] );
+
+#endif
+
+#endif
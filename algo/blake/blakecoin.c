@@ -2,6 +2,7 @@
 #include "algo-gate-api.h"
 #define BLAKE32_ROUNDS 8
 #include "sph_blake.h"
+#include "blake-scan.h"
 
 void blakecoin_init(void *cc);
 void blakecoin(void *cc, const void *data, size_t len);
@@ -51,8 +52,9 @@ int scanhash_blakecoin(int thr_id, struct work *work, uint32_t max_nonce,
 	const uint32_t first_nonce = pdata[19];
 	uint32_t HTarget = ptarget[7];
 
-	uint32_t _ALIGN(32) hash64[8];
+	uint32_t _ALIGN(64) hash[BLAKE256_SCAN_LANES][8];
 	uint32_t _ALIGN(32) endiandata[20];
+	blake256_scan_context ctx;
 
 	uint32_t n = first_nonce;
 
@@ -65,34 +67,30 @@ int scanhash_blakecoin(int thr_id, struct work *work, uint32_t max_nonce,
 	for (int kk=0; kk < 19; kk++) {
 		be32enc(&endiandata[kk], ((uint32_t*)pdata)[kk]);
 	};
+	blake256_scan_init( &ctx, endiandata, 80, 19, false, 8 );
 
 #ifdef DEBUG_ALGO
 	applog(LOG_DEBUG,"[%d] Target=%08x %08x", thr_id, ptarget[6], ptarget[7]);
 #endif
 
 	do {
-		be32enc(&endiandata[19], n);
-		blakecoinhash(hash64, endiandata);
-#ifndef DEBUG_ALGO
-		if (hash64[7] <= HTarget && fulltest(hash64, ptarget)) {
-			*hashes_done = n - first_nonce + 1;
+		// at least one nonce per call, as the scalar loop did
+		uint32_t lanes = max_nonce > n ? max_nonce - n : 1;
+		if ( lanes > BLAKE256_SCAN_LANES )
+			lanes = BLAKE256_SCAN_LANES;
+		blake256_scan( &ctx, n, hash );
+		for ( uint32_t i = 0; i < lanes; i++ )
+		if ( hash[i][7] <= HTarget && fulltest( hash[i], ptarget ) )
+		{
+			*hashes_done = n + i - first_nonce + 1;
+			pdata[19] = n + i;
 			return true;
 		}
-#else
-		if (!(n % 0x1000) && !thr_id) printf(".");
-		if (hash64[7] == 0) {
-			printf("[%d]",thr_id);
-			if (fulltest(hash64, ptarget)) {
-				*hashes_done = n - first_nonce + 1;
-				return true;
-			}
-		}
-#endif
-		n++; pdata[19] = n;
+		n += lanes;
 
 	} while (n < max_nonce && !work_restart[thr_id].restart);
 
-	*hashes_done = n - first_nonce + 1;
+	*hashes_done = n - first_nonce;
 	pdata[19] = n;
 	return 0;
 }
@@ -1,6 +1,7 @@
 #include "miner.h"
 #include "algo-gate-api.h"
 #include "sph_blake.h"
+#include "blake-scan.h"
 
 #include <string.h>
 #include <stdint.h>
@@ -39,9 +40,10 @@ void decred_hash_simple(void *state, const void *input)
 int scanhash_decred(int thr_id, struct work *work, uint32_t max_nonce, uint64_t *hashes_done)
 {
         uint32_t _ALIGN(128) endiandata[48];
-        uint32_t _ALIGN(128) hash32[8];
+        uint32_t _ALIGN(128) hash[BLAKE256_SCAN_LANES][8];
         uint32_t *pdata = work->data;
         uint32_t *ptarget = work->target;
+        blake256_scan_context ctx;
 
         #define DCR_NONCE_OFT32 35
 
@@ -52,39 +54,39 @@ int scanhash_decred(int thr_id, struct work *work, uint32_t max_nonce, uint64_t
 
         ctx_midstate_done = false;
 
-#if 1
+        // the nonce is stored little endian, the scanner swaps it
         memcpy(endiandata, pdata, 180);
-#else
-        for (int k=0; k < (180/4); k++)
-                be32enc(&endiandata[k], pdata[k]);
-#endif
+        blake256_scan_init( &ctx, endiandata, 180, DCR_NONCE_OFT32, true, 14 );
 
 #ifdef DEBUG_ALGO
         if (!thr_id) applog(LOG_DEBUG,"[%d] Target=%08x %08x", thr_id, ptarget[6], ptarget[7]);
 #endif
 
         do {
-                //be32enc(&endiandata[DCR_NONCE_OFT32], n);
-                endiandata[DCR_NONCE_OFT32] = n;
-                decred_hash(hash32, endiandata);
-
-                if (hash32[7] <= HTarget && fulltest(hash32, ptarget)) {
-                        work_set_target_ratio(work, hash32);
-                        *hashes_done = n - first_nonce + 1;
+                // at least one nonce per call, as the scalar loop did
+                uint32_t lanes = max_nonce > n ? max_nonce - n : 1;
+                if ( lanes > BLAKE256_SCAN_LANES )
+                        lanes = BLAKE256_SCAN_LANES;
+                blake256_scan( &ctx, n, hash );
+
+                for ( uint32_t i = 0; i < lanes; i++ )
+                if (hash[i][7] <= HTarget && fulltest(hash[i], ptarget)) {
+                        work_set_target_ratio(work, hash[i]);
+                        *hashes_done = n + i - first_nonce + 1;
 #ifdef DEBUG_ALGO
-                        applog(LOG_BLUE, "Nonce : %08x %08x", n, swab32(n));
+                        applog(LOG_BLUE, "Nonce : %08x %08x", n + i, swab32(n + i));
                         applog_hash(ptarget);
-                        applog_compare_hash(hash32, ptarget);
+                        applog_compare_hash(hash[i], ptarget);
 #endif
-                        pdata[DCR_NONCE_OFT32] = n;
+                        pdata[DCR_NONCE_OFT32] = n + i;
                         return 1;
                 }
 
-                n++;
+                n += lanes;
 
         } while (n < max_nonce && !work_restart[thr_id].restart);
 
-        *hashes_done = n - first_nonce + 1;
+        *hashes_done = n - first_nonce;
         pdata[DCR_NONCE_OFT32] = n;
         return 0;
 }
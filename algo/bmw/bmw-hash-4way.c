@@ -0,0 +1,430 @@
+#include <string.h>
+
+#include "bmw-hash-4way.h"
+#include "sph_bmw.h"
+
+// Same structure and names as the small (32 bit) half of sph_bmw.c.
+
+static const uint32_t IV256[16] = {
+   0x40414243, 0x44454647, 0x48494A4B, 0x4C4D4E4F,
+   0x50515253, 0x54555657, 0x58595A5B, 0x5C5D5E5F,
+   0x60616263, 0x64656667, 0x68696A6B, 0x6C6D6E6F,
+   0x70717273, 0x74757677, 0x78797A7B, 0x7C7D7E7F
+};
+
+static const uint32_t final_s[16] = {
+   0xaaaaaaa0, 0xaaaaaaa1, 0xaaaaaaa2, 0xaaaaaaa3,
+   0xaaaaaaa4, 0xaaaaaaa5, 0xaaaaaaa6, 0xaaaaaaa7,
+   0xaaaaaaa8, 0xaaaaaaa9, 0xaaaaaaaa, 0xaaaaaaab,
+   0xaaaaaaac, 0xaaaaaaad, 0xaaaaaaae, 0xaaaaaaaf
+};
+
+#define ADD( a, b )   _mm_add_epi32( a, b )
+#define SUB( a, b )   _mm_sub_epi32( a, b )
+#define XOR( a, b )   _mm_xor_si128( a, b )
+
+#define ss0(x) XOR( XOR( _mm_srli_epi32( x, 1 ), _mm_slli_epi32( x, 3 ) ), \
+                    XOR( mm_rotl_32( x,  4 ), mm_rotl_32( x, 19 ) ) )
+#define ss1(x) XOR( XOR( _mm_srli_epi32( x, 1 ), _mm_slli_epi32( x, 2 ) ), \
+                    XOR( mm_rotl_32( x,  8 ), mm_rotl_32( x, 23 ) ) )
+#define ss2(x) XOR( XOR( _mm_srli_epi32( x, 2 ), _mm_slli_epi32( x, 1 ) ), \
+                    XOR( mm_rotl_32( x, 12 ), mm_rotl_32( x, 25 ) ) )
+#define ss3(x) XOR( XOR( _mm_srli_epi32( x, 2 ), _mm_slli_epi32( x, 2 ) ), \
+                    XOR( mm_rotl_32( x, 15 ), mm_rotl_32( x, 29 ) ) )
+#define ss4(x) XOR( _mm_srli_epi32( x, 1 ), x )
+#define ss5(x) XOR( _mm_srli_epi32( x, 2 ), x )
+#define rs1(x) mm_rotl_32( x,  3 )
+#define rs2(x) mm_rotl_32( x,  7 )
+#define rs3(x) mm_rotl_32( x, 13 )
+#define rs4(x) mm_rotl_32( x, 16 )
+#define rs5(x) mm_rotl_32( x, 19 )
+#define rs6(x) mm_rotl_32( x, 23 )
+#define rs7(x) mm_rotl_32( x, 27 )
+
+// M[j] is rotated by j + 1, j is a literal so every count is an immediate.
+#define MROT( j )   mm_rotl_32( M[ (j) & 15 ], ( (j) & 15 ) + 1 )
+
+#define add_elt_s( j ) \
+   XOR( ADD( SUB( ADD( MROT( j ), MROT( (j) + 3 ) ), MROT( (j) + 10 ) ), \
+             _mm_set1_epi32( ( (j) + 16 ) * 0x05555555U ) ), \
+        H[ ( (j) + 7 ) & 15 ] )
+
+#define expand1s( i ) \
+   ADD( ADD( ADD( ADD( ss1( qt[(i)-16] ), ss2( qt[(i)-15] ) ), \
+                  ADD( ss3( qt[(i)-14] ), ss0( qt[(i)-13] ) ) ), \
+             ADD( ADD( ss1( qt[(i)-12] ), ss2( qt[(i)-11] ) ), \
+                  ADD( ss3( qt[(i)-10] ), ss0( qt[(i)- 9] ) ) ) ), \
+        ADD( ADD( ADD( ADD( ss1( qt[(i)- 8] ), ss2( qt[(i)- 7] ) ), \
+                       ADD( ss3( qt[(i)- 6] ), ss0( qt[(i)- 5] ) ) ), \
+                  ADD( ADD( ss1( qt[(i)- 4] ), ss2( qt[(i)- 3] ) ), \
+                       ADD( ss3( qt[(i)- 2] ), ss0( qt[(i)- 1] ) ) ) ), \
+             add_elt_s( (i)-16 ) ) )
+
+#define expand2s( i ) \
+   ADD( ADD( ADD( ADD( qt[(i)-16], rs1( qt[(i)-15] ) ), \
+                  ADD( qt[(i)-14], rs2( qt[(i)-13] ) ) ), \
+             ADD( ADD( qt[(i)-12], rs3( qt[(i)-11] ) ), \
+                  ADD( qt[(i)-10], rs4( qt[(i)- 9] ) ) ) ), \
+        ADD( ADD( ADD( ADD( qt[(i)- 8], rs5( qt[(i)- 7] ) ), \
+                       ADD( qt[(i)- 6], rs6( qt[(i)- 5] ) ) ), \
+                  ADD( ADD( qt[(i)- 4], rs7( qt[(i)- 3] ) ), \
+                       ADD( ss4( qt[(i)- 2] ), ss5( qt[(i)- 1] ) ) ) ), \
+             add_elt_s( (i)-16 ) ) )
+
+// Ws from sph_bmw.c, i0 o1 i1 o2 i2 ... evaluated left to right.
+#define W5( i0, o1, i1, o2, i2, o3, i3, o4, i4 ) \
+   o4( o3( o2( o1( mh[i0], mh[i1] ), mh[i2] ), mh[i3] ), mh[i4] )
+
+static void compress_small_4way( const __m128i *M, const __m128i H[16],
+                                 __m128i dH[16] )
+{
+   __m128i qt[32], xl, xh;
+   __m128i mh[16];
+
+   for ( int i = 0; i < 16; i++ )
+      mh[i] = XOR( M[i], H[i] );
+
+   qt[ 0] = ADD( ss0( W5(  5, SUB,  7, ADD, 10, ADD, 13, ADD, 14 ) ), H[ 1] );
+   qt[ 1] = ADD( ss1( W5(  6, SUB,  8, ADD, 11, ADD, 14, SUB, 15 ) ), H[ 2] );
+   qt[ 2] = ADD( ss2( W5(  0, ADD,  7, ADD,  9, SUB, 12, ADD, 15 ) ), H[ 3] );
+   qt[ 3] = ADD( ss3( W5(  0, SUB,  1, ADD,  8, SUB, 10, ADD, 13 ) ), H[ 4] );
+   qt[ 4] = ADD( ss4( W5(  1, ADD,  2, ADD,  9, SUB, 11, SUB, 14 ) ), H[ 5] );
+   qt[ 5] = ADD( ss0( W5(  3, SUB,  2, ADD, 10, SUB, 12, ADD, 15 ) ), H[ 6] );
+   qt[ 6] = ADD( ss1( W5(  4, SUB,  0, SUB,  3, SUB, 11, ADD, 13 ) ), H[ 7] );
+   qt[ 7] = ADD( ss2( W5(  1, SUB,  4, SUB,  5, SUB, 12, SUB, 14 ) ), H[ 8] );
+   qt[ 8] = ADD( ss3( W5(  2, SUB,  5, SUB,  6, ADD, 13, SUB, 15 ) ), H[ 9] );
+   qt[ 9] = ADD( ss4( W5(  0, SUB,  3, ADD,  6, SUB,  7, ADD, 14 ) ), H[10] );
+   qt[10] = ADD( ss0( W5(  8, SUB,  1, SUB,  4, SUB,  7, ADD, 15 ) ), H[11] );
+   qt[11] = ADD( ss1( W5(  8, SUB,  0, SUB,  2, SUB,  5, ADD,  9 ) ), H[12] );
+   qt[12] = ADD( ss2( W5(  1, ADD,  3, SUB,  6, SUB,  9, ADD, 10 ) ), H[13] );
+   qt[13] = ADD( ss3( W5(  2, ADD,  4, ADD,  7, ADD, 10, ADD, 11 ) ), H[14] );
+   qt[14] = ADD( ss4( W5(  3, SUB,  5, ADD,  8, SUB, 11, SUB, 12 ) ), H[15] );
+   qt[15] = ADD( ss0( W5( 12, SUB,  4, SUB,  6, SUB,  9, ADD, 13 ) ), H[ 0] );
+
+   qt[16] = expand1s( 16 );
+   qt[17] = expand1s( 17 );
+   qt[18] = expand2s( 18 );
+   qt[19] = expand2s( 19 );
+   qt[20] = expand2s( 20 );
+   qt[21] = expand2s( 21 );
+   qt[22] = expand2s( 22 );
+   qt[23] = expand2s( 23 );
+   qt[24] = expand2s( 24 );
+   qt[25] = expand2s( 25 );
+   qt[26] = expand2s( 26 );
+   qt[27] = expand2s( 27 );
+   qt[28] = expand2s( 28 );
+   qt[29] = expand2s( 29 );
+   qt[30] = expand2s( 30 );
+   qt[31] = expand2s( 31 );
+
+   xl = XOR( XOR( XOR( qt[16], qt[17] ), XOR( qt[18], qt[19] ) ),
+             XOR( XOR( qt[20], qt[21] ), XOR( qt[22], qt[23] ) ) );
+   xh = XOR( xl, XOR( XOR( XOR( qt[24], qt[25] ), XOR( qt[26], qt[27] ) ),
+                      XOR( XOR( qt[28], qt[29] ), XOR( qt[30], qt[31] ) ) ) );
+
+#define SL( x, n )  _mm_slli_epi32( x, n )
+#define SR( x, n )  _mm_srli_epi32( x, n )
+
+   dH[ 0] = ADD( XOR( XOR( SL( xh,  5 ), SR( qt[16],  5 ) ), M[ 0] ),
+                 XOR( XOR( xl, qt[24] ), qt[ 0] ) );
+   dH[ 1] = ADD( XOR( XOR( SR( xh,  7 ), SL( qt[17],  8 ) ), M[ 1] ),
+                 XOR( XOR( xl, qt[25] ), qt[ 1] ) );
+   dH[ 2] = ADD( XOR( XOR( SR( xh,  5 ), SL( qt[18],  5 ) ), M[ 2] ),
+                 XOR( XOR( xl, qt[26] ), qt[ 2] ) );
+   dH[ 3] = ADD( XOR( XOR( SR( xh,  1 ), SL( qt[19],  5 ) ), M[ 3] ),
+                 XOR( XOR( xl, qt[27] ), qt[ 3] ) );
+   dH[ 4] = ADD( XOR( XOR( SR( xh,  3 ), qt[20] ), M[ 4] ),
+                 XOR( XOR( xl, qt[28] ), qt[ 4] ) );
+   dH[ 5] = ADD( XOR( XOR( SL( xh,  6 ), SR( qt[21],  6 ) ), M[ 5] ),
+                 XOR( XOR( xl, qt[29] ), qt[ 5] ) );
+   dH[ 6] = ADD( XOR( XOR( SR( xh,  4 ), SL( qt[22],  6 ) ), M[ 6] ),
+                 XOR( XOR( xl, qt[30] ), qt[ 6] ) );
+   dH[ 7] = ADD( XOR( XOR( SR( xh, 11 ), SL( qt[23],  2 ) ), M[ 7] ),
+                 XOR( XOR( xl, qt[31] ), qt[ 7] ) );
+   dH[ 8] = ADD( ADD( mm_rotl_32( dH[4],  9 ), XOR( XOR( xh, qt[24] ), M[ 8] ) ),
+                 XOR( XOR( SL( xl, 8 ), qt[23] ), qt[ 8] ) );
+   dH[ 9] = ADD( ADD( mm_rotl_32( dH[5], 10 ), XOR( XOR( xh, qt[25] ), M[ 9] ) ),
+                 XOR( XOR( SR( xl, 6 ), qt[16] ), qt[ 9] ) );
+   dH[10] = ADD( ADD( mm_rotl_32( dH[6], 11 ), XOR( XOR( xh, qt[26] ), M[10] ) ),
+                 XOR( XOR( SL( xl, 6 ), qt[17] ), qt[10] ) );
+   dH[11] = ADD( ADD( mm_rotl_32( dH[7], 12 ), XOR( XOR( xh, qt[27] ), M[11] ) ),
+                 XOR( XOR( SL( xl, 4 ), qt[18] ), qt[11] ) );
+   dH[12] = ADD( ADD( mm_rotl_32( dH[0], 13 ), XOR( XOR( xh, qt[28] ), M[12] ) ),
+                 XOR( XOR( SR( xl, 3 ), qt[19] ), qt[12] ) );
+   dH[13] = ADD( ADD( mm_rotl_32( dH[1], 14 ), XOR( XOR( xh, qt[29] ), M[13] ) ),
+                 XOR( XOR( SR( xl, 4 ), qt[20] ), qt[13] ) );
+   dH[14] = ADD( ADD( mm_rotl_32( dH[2], 15 ), XOR( XOR( xh, qt[30] ), M[14] ) ),
+                 XOR( XOR( SR( xl, 7 ), qt[21] ), qt[14] ) );
+   dH[15] = ADD( ADD( mm_rotl_32( dH[3], 16 ), XOR( XOR( xh, qt[31] ), M[15] ) ),
+                 XOR( XOR( SR( xl, 2 ), qt[22] ), qt[15] ) );
+
+#undef SL
+#undef SR
+}
+
+void bmw256_4way_init( bmw256_4way_context *ctx )
+{
+   for ( int i = 0; i < 16; i++ )
+      ctx->H[i] = _mm_set1_epi32( IV256[i] );
+   ctx->ptr = 0;
+   ctx->bit_count = 0;
+}
+
+void bmw256_4way( bmw256_4way_context *ctx, const void *data, size_t len )
+{
+   const __m128i *vdata = (const __m128i*)data;
+   size_t ptr = ctx->ptr;
+   __m128i htmp[16];
+
+   ctx->bit_count += (uint64_t)len << 3;
+   while ( len > 0 )
+   {
+      size_t clen = 64 - ptr;
+      if ( clen > len )
+         clen = len;
+      for ( size_t i = 0; i < clen >> 2; i++ )
+         ctx->buf[ ( ptr >> 2 ) + i ] = _mm_loadu_si128( vdata + i );
+      vdata += clen >> 2;
+      len -= clen;
+      ptr += clen;
+      if ( ptr == 64 )
+      {
+         compress_small_4way( ctx->buf, ctx->H, htmp );
+         memcpy( ctx->H, htmp, sizeof htmp );
+         ptr = 0;
+      }
+   }
+   ctx->ptr = ptr;
+}
+
+void bmw256_4way_close( bmw256_4way_context *ctx, void *dst )
+{
+   __m128i *out = (__m128i*)dst;
+   __m128i h1[16], h2[16], *h = ctx->H;
+   size_t ptr = ctx->ptr;
+
+   ctx->buf[ ptr >> 2 ] = _mm_set1_epi32( 0x80 );
+   ptr += 4;
+   if ( ptr > 56 )
+   {
+      for ( size_t i = ptr >> 2; i < 16; i++ )
+         ctx->buf[i] = _mm_setzero_si128();
+      compress_small_4way( ctx->buf, h, h1 );
+      ptr = 0;
+      h = h1;
+   }
+   for ( size_t i = ptr >> 2; i < 14; i++ )
+      ctx->buf[i] = _mm_setzero_si128();
+   ctx->buf[14] = _mm_set1_epi32( (uint32_t)ctx->bit_count );
+   ctx->buf[15] = _mm_set1_epi32( (uint32_t)( ctx->bit_count >> 32 ) );
+   compress_small_4way( ctx->buf, h, h2 );
+
+   for ( int i = 0; i < 16; i++ )
+      h1[i] = _mm_set1_epi32( final_s[i] );
+   compress_small_4way( h2, h1, ctx->buf );
+
+   for ( int i = 0; i < 8; i++ )
+      _mm_storeu_si128( out + i, ctx->buf[ 8 + i ] );
+}
+
+#if defined(__AVX2__)
+
+// The big (64 bit) half, same names with the b suffix as in sph_bmw.c.
+
+static const uint64_t IV512[16] = {
+   0x8081828384858687, 0x88898A8B8C8D8E8F,
+   0x9091929394959697, 0x98999A9B9C9D9E9F,
+   0xA0A1A2A3A4A5A6A7, 0xA8A9AAABACADAEAF,
+   0xB0B1B2B3B4B5B6B7, 0xB8B9BABBBCBDBEBF,
+   0xC0C1C2C3C4C5C6C7, 0xC8C9CACBCCCDCECF,
+   0xD0D1D2D3D4D5D6D7, 0xD8D9DADBDCDDDEDF,
+   0xE0E1E2E3E4E5E6E7, 0xE8E9EAEBECEDEEEF,
+   0xF0F1F2F3F4F5F6F7, 0xF8F9FAFBFCFDFEFF
+};
+
+static const uint64_t final_b[16] = {
+   0xaaaaaaaaaaaaaaa0, 0xaaaaaaaaaaaaaaa1,
+   0xaaaaaaaaaaaaaaa2, 0xaaaaaaaaaaaaaaa3,
+   0xaaaaaaaaaaaaaaa4, 0xaaaaaaaaaaaaaaa5,
+   0xaaaaaaaaaaaaaaa6, 0xaaaaaaaaaaaaaaa7,
+   0xaaaaaaaaaaaaaaa8, 0xaaaaaaaaaaaaaaa9,
+   0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaab,
+   0xaaaaaaaaaaaaaaac, 0xaaaaaaaaaaaaaaad,
+   0xaaaaaaaaaaaaaaae, 0xaaaaaaaaaaaaaaaf
+};
+
+#define ADDb( a, b )   _mm256_add_epi64( a, b )
+#define SUBb( a, b )   _mm256_sub_epi64( a, b )
+#define XORb( a, b )   _mm256_xor_si256( a, b )
+
+#define sb0(x) XORb( XORb( _mm256_srli_epi64( x, 1 ), _mm256_slli_epi64( x, 3 ) ), \
+                     XORb( mm256_rotl_64( x,  4 ), mm256_rotl_64( x, 37 ) ) )
+#define sb1(x) XORb( XORb( _mm256_srli_epi64( x, 1 ), _mm256_slli_epi64( x, 2 ) ), \
+                     XORb( mm256_rotl_64( x, 13 ), mm256_rotl_64( x, 43 ) ) )
+#define sb2(x) XORb( XORb( _mm256_srli_epi64( x, 2 ), _mm256_slli_epi64( x, 1 ) ), \
+                     XORb( mm256_rotl_64( x, 19 ), mm256_rotl_64( x, 53 ) ) )
+#define sb3(x) XORb( XORb( _mm256_srli_epi64( x, 2 ), _mm256_slli_epi64( x, 2 ) ), \
+                     XORb( mm256_rotl_64( x, 28 ), mm256_rotl_64( x, 59 ) ) )
+#define sb4(x) XORb( _mm256_srli_epi64( x, 1 ), x )
+#define sb5(x) XORb( _mm256_srli_epi64( x, 2 ), x )
+#define rb1(x) mm256_rotl_64( x,  5 )
+#define rb2(x) mm256_rotl_64( x, 11 )
+#define rb3(x) mm256_rotl_64( x, 27 )
+#define rb4(x) mm256_rotl_64( x, 32 )
+#define rb5(x) mm256_rotl_64( x, 37 )
+#define rb6(x) mm256_rotl_64( x, 43 )
+#define rb7(x) mm256_rotl_64( x, 53 )
+
+#define MROTb( j )   mm256_rotl_64( M[ (j) & 15 ], ( (j) & 15 ) + 1 )
+
+#define add_elt_b( j ) \
+   XORb( ADDb( SUBb( ADDb( MROTb( j ), MROTb( (j) + 3 ) ), MROTb( (j) + 10 ) ), \
+               _mm256_set1_epi64x( ( (j) + 16 ) * 0x0555555555555555ULL ) ), \
+         H[ ( (j) + 7 ) & 15 ] )
+
+#define expand1b( i ) \
+   ADDb( ADDb( ADDb( ADDb( sb1( qt[(i)-16] ), sb2( qt[(i)-15] ) ), \
+                     ADDb( sb3( qt[(i)-14] ), sb0( qt[(i)-13] ) ) ), \
+               ADDb( ADDb( sb1( qt[(i)-12] ), sb2( qt[(i)-11] ) ), \
+                     ADDb( sb3( qt[(i)-10] ), sb0( qt[(i)- 9] ) ) ) ), \
+         ADDb( ADDb( ADDb( ADDb( sb1( qt[(i)- 8] ), sb2( qt[(i)- 7] ) ), \
+                           ADDb( sb3( qt[(i)- 6] ), sb0( qt[(i)- 5] ) ) ), \
+                     ADDb( ADDb( sb1( qt[(i)- 4] ), sb2( qt[(i)- 3] ) ), \
+                           ADDb( sb3( qt[(i)- 2] ), sb0( qt[(i)- 1] ) ) ) ), \
+               add_elt_b( (i)-16 ) ) )
+
+#define expand2b( i ) \
+   ADDb( ADDb( ADDb( ADDb( qt[(i)-16], rb1( qt[(i)-15] ) ), \
+                     ADDb( qt[(i)-14], rb2( qt[(i)-13] ) ) ), \
+               ADDb( ADDb( qt[(i)-12], rb3( qt[(i)-11] ) ), \
+                     ADDb( qt[(i)-10], rb4( qt[(i)- 9] ) ) ) ), \
+         ADDb( ADDb( ADDb( ADDb( qt[(i)- 8], rb5( qt[(i)- 7] ) ), \
+                           ADDb( qt[(i)- 6], rb6( qt[(i)- 5] ) ) ), \
+                     ADDb( ADDb( qt[(i)- 4], rb7( qt[(i)- 3] ) ), \
+                           ADDb( sb4( qt[(i)- 2] ), sb5( qt[(i)- 1] ) ) ) ), \
+               add_elt_b( (i)-16 ) ) )
+
+#define W5b( i0, o1, i1, o2, i2, o3, i3, o4, i4 ) \
+   o4( o3( o2( o1( mh[i0], mh[i1] ), mh[i2] ), mh[i3] ), mh[i4] )
+
+static void compress_big_4way( const __m256i *M, const __m256i H[16],
+                               __m256i dH[16] )
+{
+   __m256i qt[32], xl, xh;
+   __m256i mh[16];
+
+   for ( int i = 0; i < 16; i++ )
+      mh[i] = XORb( M[i], H[i] );
+
+   qt[ 0] = ADDb( sb0( W5b(  5, SUBb,  7, ADDb, 10, ADDb, 13, ADDb, 14 ) ), H[ 1] );
+   qt[ 1] = ADDb( sb1( W5b(  6, SUBb,  8, ADDb, 11, ADDb, 14, SUBb, 15 ) ), H[ 2] );
+   qt[ 2] = ADDb( sb2( W5b(  0, ADDb,  7, ADDb,  9, SUBb, 12, ADDb, 15 ) ), H[ 3] );
+   qt[ 3] = ADDb( sb3( W5b(  0, SUBb,  1, ADDb,  8, SUBb, 10, ADDb, 13 ) ), H[ 4] );
+   qt[ 4] = ADDb( sb4( W5b(  1, ADDb,  2, ADDb,  9, SUBb, 11, SUBb, 14 ) ), H[ 5] );
+   qt[ 5] = ADDb( sb0( W5b(  3, SUBb,  2, ADDb, 10, SUBb, 12, ADDb, 15 ) ), H[ 6] );
+   qt[ 6] = ADDb( sb1( W5b(  4, SUBb,  0, SUBb,  3, SUBb, 11, ADDb, 13 ) ), H[ 7] );
+   qt[ 7] = ADDb( sb2( W5b(  1, SUBb,  4, SUBb,  5, SUBb, 12, SUBb, 14 ) ), H[ 8] );
+   qt[ 8] = ADDb( sb3( W5b(  2, SUBb,  5, SUBb,  6, ADDb, 13, SUBb, 15 ) ), H[ 9] );
+   qt[ 9] = ADDb( sb4( W5b(  0, SUBb,  3, ADDb,  6, SUBb,  7, ADDb, 14 ) ), H[10] );
+   qt[10] = ADDb( sb0( W5b(  8, SUBb,  1, SUBb,  4, SUBb,  7, ADDb, 15 ) ), H[11] );
+   qt[11] = ADDb( sb1( W5b(  8, SUBb,  0, SUBb,  2, SUBb,  5, ADDb,  9 ) ), H[12] );
+   qt[12] = ADDb( sb2( W5b(  1, ADDb,  3, SUBb,  6, SUBb,  9, ADDb, 10 ) ), H[13] );
+   qt[13] = ADDb( sb3( W5b(  2, ADDb,  4, ADDb,  7, ADDb, 10, ADDb, 11 ) ), H[14] );
+   qt[14] = ADDb( sb4( W5b(  3, SUBb,  5, ADDb,  8, SUBb, 11, SUBb, 12 ) ), H[15] );
+   qt[15] = ADDb( sb0( W5b( 12, SUBb,  4, SUBb,  6, SUBb,  9, ADDb, 13 ) ), H[ 0] );
+
+   qt[16] = expand1b( 16 );
+   qt[17] = expand1b( 17 );
+   qt[18] = expand2b( 18 );
+   qt[19] = expand2b( 19 );
+   qt[20] = expand2b( 20 );
+   qt[21] = expand2b( 21 );
+   qt[22] = expand2b( 22 );
+   qt[23] = expand2b( 23 );
+   qt[24] = expand2b( 24 );
+   qt[25] = expand2b( 25 );
+   qt[26] = expand2b( 26 );
+   qt[27] = expand2b( 27 );
+   qt[28] = expand2b( 28 );
+   qt[29] = expand2b( 29 );
+   qt[30] = expand2b( 30 );
+   qt[31] = expand2b( 31 );
+
+   xl = XORb( XORb( XORb( qt[16], qt[17] ), XORb( qt[18], qt[19] ) ),
+              XORb( XORb( qt[20], qt[21] ), XORb( qt[22], qt[23] ) ) );
+   xh = XORb( xl, XORb( XORb( XORb( qt[24], qt[25] ), XORb( qt[26], qt[27] ) ),
+                        XORb( XORb( qt[28], qt[29] ), XORb( qt[30], qt[31] ) ) ) );
+
+#define SL( x, n )  _mm256_slli_epi64( x, n )
+#define SR( x, n )  _mm256_srli_epi64( x, n )
+
+   dH[ 0] = ADDb( XORb( XORb( SL( xh,  5 ), SR( qt[16],  5 ) ), M[ 0] ),
+                  XORb( XORb( xl, qt[24] ), qt[ 0] ) );
+   dH[ 1] = ADDb( XORb( XORb( SR( xh,  7 ), SL( qt[17],  8 ) ), M[ 1] ),
+                  XORb( XORb( xl, qt[25] ), qt[ 1] ) );
+   dH[ 2] = ADDb( XORb( XORb( SR( xh,  5 ), SL( qt[18],  5 ) ), M[ 2] ),
+                  XORb( XORb( xl, qt[26] ), qt[ 2] ) );
+   dH[ 3] = ADDb( XORb( XORb( SR( xh,  1 ), SL( qt[19],  5 ) ), M[ 3] ),
+                  XORb( XORb( xl, qt[27] ), qt[ 3] ) );
+   dH[ 4] = ADDb( XORb( XORb( SR( xh,  3 ), qt[20] ), M[ 4] ),
+                  XORb( XORb( xl, qt[28] ), qt[ 4] ) );
+   dH[ 5] = ADDb( XORb( XORb( SL( xh,  6 ), SR( qt[21],  6 ) ), M[ 5] ),
+                  XORb( XORb( xl, qt[29] ), qt[ 5] ) );
+   dH[ 6] = ADDb( XORb( XORb( SR( xh,  4 ), SL( qt[22],  6 ) ), M[ 6] ),
+                  XORb( XORb( xl, qt[30] ), qt[ 6] ) );
+   dH[ 7] = ADDb( XORb( XORb( SR( xh, 11 ), SL( qt[23],  2 ) ), M[ 7] ),
+                  XORb( XORb( xl, qt[31] ), qt[ 7] ) );
+   dH[ 8] = ADDb( ADDb( mm256_rotl_64( dH[4],  9 ), XORb( XORb( xh, qt[24] ), M[ 8] ) ),
+                  XORb( XORb( SL( xl, 8 ), qt[23] ), qt[ 8] ) );
+   dH[ 9] = ADDb( ADDb( mm256_rotl_64( dH[5], 10 ), XORb( XORb( xh, qt[25] ), M[ 9] ) ),
+                  XORb( XORb( SR( xl, 6 ), qt[16] ), qt[ 9] ) );
+   dH[10] = ADDb( ADDb( mm256_rotl_64( dH[6], 11 ), XORb( XORb( xh, qt[26] ), M[10] ) ),
+                  XORb( XORb( SL( xl, 6 ), qt[17] ), qt[10] ) );
+   dH[11] = ADDb( ADDb( mm256_rotl_64( dH[7], 12 ), XORb( XORb( xh, qt[27] ), M[11] ) ),
+                  XORb( XORb( SL( xl, 4 ), qt[18] ), qt[11] ) );
+   dH[12] = ADDb( ADDb( mm256_rotl_64( dH[0], 13 ), XORb( XORb( xh, qt[28] ), M[12] ) ),
+                  XORb( XORb( SR( xl, 3 ), qt[19] ), qt[12] ) );
+   dH[13] = ADDb( ADDb( mm256_rotl_64( dH[1], 14 ), XORb( XORb( xh, qt[29] ), M[13] ) ),
+                  XORb( XORb( SR( xl, 4 ), qt[20] ), qt[13] ) );
+   dH[14] = ADDb( ADDb( mm256_rotl_64( dH[2], 15 ), XORb( XORb( xh, qt[30] ), M[14] ) ),
+                  XORb( XORb( SR( xl, 7 ), qt[21] ), qt[14] ) );
+   dH[15] = ADDb( ADDb( mm256_rotl_64( dH[3], 16 ), XORb( XORb( xh, qt[31] ), M[15] ) ),
+                  XORb( XORb( SR( xl, 2 ), qt[22] ), qt[15] ) );
+
+#undef SL
+#undef SR
+}
+
+#endif
+
+void bmw512_x4( void * const hash[4], int len )
+{
+#if defined(__AVX2__)
+   __m256i M[16] __attribute__ ((aligned (64)));
+   __m256i h1[16], h2[16];
+
+   // the padded block: message, the 0x80 byte, zeros, 64 bit bit count
+   memset( M, 0, sizeof M );
+   mm256_interleave_4x64( M, hash[0], hash[1], hash[2], hash[3], len << 3 );
+   M[ len >> 3 ] = _mm256_set1_epi64x( 0x80 );
+   M[15] = _mm256_set1_epi64x( (uint64_t)len << 3 );
+
+   for ( int i = 0; i < 16; i++ )
+      h1[i] = _mm256_set1_epi64x( IV512[i] );
+   compress_big_4way( M, h1, h2 );
+   for ( int i = 0; i < 16; i++ )
+      h1[i] = _mm256_set1_epi64x( final_b[i] );
+   compress_big_4way( h2, h1, M );
+
+   mm256_deinterleave_4x64( hash[0], hash[1], hash[2], hash[3], M + 8, 512 );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      sph_bmw512_context ctx;
+      sph_bmw512_init( &ctx );
+      sph_bmw512( &ctx, hash[i], len );
+      sph_bmw512_close( &ctx, hash[i] );
+   }
+#endif
+}
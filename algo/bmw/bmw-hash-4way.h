@@ -0,0 +1,30 @@
+#ifndef BMW_HASH_4WAY_H__
+#define BMW_HASH_4WAY_H__
+
+// BMW-256 for 4 lanes in parallel, one lane per 32 bit element of an xmm
+// register. Input and output are interleaved 4x32, lengths are bytes per
+// lane and must be a multiple of 4. Output matches sph_bmw256 per lane.
+
+#include <stddef.h>
+#include "avxdefs.h"
+
+typedef struct {
+   __m128i buf[16] __attribute__ ((aligned (64)));
+   __m128i H[16];
+   size_t ptr;          // bytes per lane in buf
+   uint64_t bit_count;
+} bmw256_4way_context;
+
+void bmw256_4way_init( bmw256_4way_context *ctx );
+void bmw256_4way( bmw256_4way_context *ctx, const void *data, size_t len );
+void bmw256_4way_close( bmw256_4way_context *ctx, void *dst );
+
+// BMW-512 of 4 independent short messages, one lane per 64 bit element of
+// a ymm register with AVX2, otherwise one at a time through sph_bmw.
+// hash[i] holds len bytes of message i on entry and its 64 byte digest on
+// return. len is a multiple of 8 up to 112, so the padded message is a
+// single block, which covers the 64 byte chain stages and 80 byte headers.
+
+void bmw512_x4( void * const hash[4], int len );
+
+#endif
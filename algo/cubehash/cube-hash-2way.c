@@ -0,0 +1,354 @@
+#include <string.h>
+
+#include "cube-hash-2way.h"
+#include "sse2/cubehash_sse2.h"
+
+#if defined(__AVX2__)
+
+static void transform_2way( __m256i *x, int rounds )
+{
+   int r;
+   __m256i x0, x1, x2, x3, x4, x5, x6, x7;
+   __m256i y0, y1, y2, y3;
+
+   x0 = x[0];
+   x1 = x[1];
+   x2 = x[2];
+   x3 = x[3];
+   x4 = x[4];
+   x5 = x[5];
+   x6 = x[6];
+   x7 = x[7];
+
+   for ( r = 0; r < rounds; ++r )
+   {
+      x4 = _mm256_add_epi32( x0, x4 );
+      x5 = _mm256_add_epi32( x1, x5 );
+      x6 = _mm256_add_epi32( x2, x6 );
+      x7 = _mm256_add_epi32( x3, x7 );
+      y0 = x2;
+      y1 = x3;
+      y2 = x0;
+      y3 = x1;
+      x0 = mm256_rotl_32( y0, 7 );
+      x1 = mm256_rotl_32( y1, 7 );
+      x2 = mm256_rotl_32( y2, 7 );
+      x3 = mm256_rotl_32( y3, 7 );
+      x0 = _mm256_xor_si256( x0, x4 );
+      x1 = _mm256_xor_si256( x1, x5 );
+      x2 = _mm256_xor_si256( x2, x6 );
+      x3 = _mm256_xor_si256( x3, x7 );
+      x4 = _mm256_shuffle_epi32( x4, 0x4e );
+      x5 = _mm256_shuffle_epi32( x5, 0x4e );
+      x6 = _mm256_shuffle_epi32( x6, 0x4e );
+      x7 = _mm256_shuffle_epi32( x7, 0x4e );
+      x4 = _mm256_add_epi32( x0, x4 );
+      x5 = _mm256_add_epi32( x1, x5 );
+      x6 = _mm256_add_epi32( x2, x6 );
+      x7 = _mm256_add_epi32( x3, x7 );
+      y0 = x1;
+      y1 = x0;
+      y2 = x3;
+      y3 = x2;
+      x0 = mm256_rotl_32( y0, 11 );
+      x1 = mm256_rotl_32( y1, 11 );
+      x2 = mm256_rotl_32( y2, 11 );
+      x3 = mm256_rotl_32( y3, 11 );
+      x0 = _mm256_xor_si256( x0, x4 );
+      x1 = _mm256_xor_si256( x1, x5 );
+      x2 = _mm256_xor_si256( x2, x6 );
+      x3 = _mm256_xor_si256( x3, x7 );
+      x4 = _mm256_shuffle_epi32( x4, 0xb1 );
+      x5 = _mm256_shuffle_epi32( x5, 0xb1 );
+      x6 = _mm256_shuffle_epi32( x6, 0xb1 );
+      x7 = _mm256_shuffle_epi32( x7, 0xb1 );
+   }
+
+   x[0] = x0;
+   x[1] = x1;
+   x[2] = x2;
+   x[3] = x3;
+   x[4] = x4;
+   x[5] = x5;
+   x[6] = x6;
+   x[7] = x7;
+}
+
+void cube_2way_init( cube_2way_context *ctx, int hashbitlen, int rounds,
+                     int blockbytes )
+{
+   ctx->hashbitlen = hashbitlen;
+   ctx->rounds = rounds;
+   ctx->blockbytes = blockbytes;
+   for ( int i = 0; i < 8; ++i )
+      ctx->x[i] = _mm256_setzero_si256();
+   ctx->x[0] = _mm256_set_epi32( 0, rounds, blockbytes, hashbitlen / 8,
+                                 0, rounds, blockbytes, hashbitlen / 8 );
+   for ( int i = 0; i < 10; ++i )
+      transform_2way( ctx->x, ctx->rounds );
+   ctx->pos = 0;
+}
+
+void cube_2way_update( cube_2way_context *ctx, const void *data,
+                       size_t len )
+{
+   const __m256i *vdata = (const __m256i*)data;
+
+   for ( ; len >= 16; len -= 16, vdata++ )
+   {
+      ctx->x[ ctx->pos >> 4 ] = _mm256_xor_si256( ctx->x[ ctx->pos >> 4 ],
+                                          _mm256_loadu_si256( vdata ) );
+      ctx->pos += 16;
+      if ( ctx->pos == ctx->blockbytes )
+      {
+         transform_2way( ctx->x, ctx->rounds );
+         ctx->pos = 0;
+      }
+   }
+}
+
+void cube_2way_close( cube_2way_context *ctx, void *dst )
+{
+   __m256i *out = (__m256i*)dst;
+
+   ctx->x[ ctx->pos >> 4 ] = _mm256_xor_si256( ctx->x[ ctx->pos >> 4 ],
+                             _mm256_set_epi32( 0, 0, 0, 0x80, 0, 0, 0, 0x80 ) );
+   transform_2way( ctx->x, ctx->rounds );
+   ctx->x[7] = _mm256_xor_si256( ctx->x[7],
+                             _mm256_set_epi32( 1, 0, 0, 0, 1, 0, 0, 0 ) );
+   for ( int i = 0; i < 10; ++i )
+      transform_2way( ctx->x, ctx->rounds );
+
+   for ( int i = 0; i < ctx->hashbitlen / 128; i++ )
+      _mm256_storeu_si256( out + i, ctx->x[i] );
+}
+
+// State after the 10 initial rounds of CubeHash16/32 with a 256 and a 512
+// bit digest, they only depend on the parameters.
+
+static const uint32_t cube_iv256[32] __attribute__ ((aligned (16))) =
+{
+   0xEA2BD4B4, 0xCCD6F29F, 0x63117E71, 0x35481EAE,
+   0x22512D5B, 0xE5D94E63, 0x7E624131, 0xF4CC12BE,
+   0xC2D0B696, 0x42AF2070, 0xD0720C35, 0x3361DA8C,
+   0x28CCECA4, 0x8EF8AD83, 0x4680AC00, 0x40E5FBAB,
+   0xD89041C3, 0x6107FBD5, 0x6C859D41, 0xF0B26679,
+   0x09392549, 0x5FA25603, 0x65C892FD, 0x93CB6285,
+   0x2AF2B5AE, 0x9E4B4E60, 0x774ABFDD, 0x85254725,
+   0x15815AEB, 0x4AB6AAD6, 0x9CDAF8AF, 0xD6032C0A
+};
+
+static const uint32_t cube_iv512[32] __attribute__ ((aligned (16))) =
+{
+   0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E,
+   0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+   0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537,
+   0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+   0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532,
+   0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+   0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576,
+   0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+#if defined(__AVX512F__)
+
+// 4 lanes, one in each 128 bit quarter of the zmm registers.
+
+static void transform_4way( __m512i *x, int rounds )
+{
+   int r;
+   __m512i x0, x1, x2, x3, x4, x5, x6, x7;
+   __m512i y0, y1, y2, y3;
+
+   x0 = x[0];
+   x1 = x[1];
+   x2 = x[2];
+   x3 = x[3];
+   x4 = x[4];
+   x5 = x[5];
+   x6 = x[6];
+   x7 = x[7];
+
+   for ( r = 0; r < rounds; ++r )
+   {
+      x4 = _mm512_add_epi32( x0, x4 );
+      x5 = _mm512_add_epi32( x1, x5 );
+      x6 = _mm512_add_epi32( x2, x6 );
+      x7 = _mm512_add_epi32( x3, x7 );
+      y0 = x2;
+      y1 = x3;
+      y2 = x0;
+      y3 = x1;
+      x0 = _mm512_rol_epi32( y0, 7 );
+      x1 = _mm512_rol_epi32( y1, 7 );
+      x2 = _mm512_rol_epi32( y2, 7 );
+      x3 = _mm512_rol_epi32( y3, 7 );
+      x0 = _mm512_xor_si512( x0, x4 );
+      x1 = _mm512_xor_si512( x1, x5 );
+      x2 = _mm512_xor_si512( x2, x6 );
+      x3 = _mm512_xor_si512( x3, x7 );
+      x4 = _mm512_shuffle_epi32( x4, 0x4e );
+      x5 = _mm512_shuffle_epi32( x5, 0x4e );
+      x6 = _mm512_shuffle_epi32( x6, 0x4e );
+      x7 = _mm512_shuffle_epi32( x7, 0x4e );
+      x4 = _mm512_add_epi32( x0, x4 );
+      x5 = _mm512_add_epi32( x1, x5 );
+      x6 = _mm512_add_epi32( x2, x6 );
+      x7 = _mm512_add_epi32( x3, x7 );
+      y0 = x1;
+      y1 = x0;
+      y2 = x3;
+      y3 = x2;
+      x0 = _mm512_rol_epi32( y0, 11 );
+      x1 = _mm512_rol_epi32( y1, 11 );
+      x2 = _mm512_rol_epi32( y2, 11 );
+      x3 = _mm512_rol_epi32( y3, 11 );
+      x0 = _mm512_xor_si512( x0, x4 );
+      x1 = _mm512_xor_si512( x1, x5 );
+      x2 = _mm512_xor_si512( x2, x6 );
+      x3 = _mm512_xor_si512( x3, x7 );
+      x4 = _mm512_shuffle_epi32( x4, 0xb1 );
+      x5 = _mm512_shuffle_epi32( x5, 0xb1 );
+      x6 = _mm512_shuffle_epi32( x6, 0xb1 );
+      x7 = _mm512_shuffle_epi32( x7, 0xb1 );
+   }
+
+   x[0] = x0;
+   x[1] = x1;
+   x[2] = x2;
+   x[3] = x3;
+   x[4] = x4;
+   x[5] = x5;
+   x[6] = x6;
+   x[7] = x7;
+}
+
+// hash[i] holds len bytes of lane i, a multiple of 16, and gets the
+// hashbytes long digest.
+static void cube_4way_fixed( void * const hash[4], int len,
+                             const uint32_t *iv, int hashbytes )
+{
+   const __m128i * const *in = (const __m128i * const*)hash;
+   __m128i * const *out = (__m128i * const*)hash;
+   __m512i x[8];
+   int i;
+
+   for ( i = 0; i < 8; i++ )
+      x[i] = _mm512_broadcast_i32x4(
+                        _mm_load_si128( (const __m128i*)iv + i ) );
+   for ( i = 0; i < len / 16; i++ )
+   {
+      const __m512i m = _mm512_inserti64x4( _mm512_castsi256_si512(
+                      _mm256_inserti128_si256( _mm256_castsi128_si256(
+                          _mm_loadu_si128( in[0] + i ) ),
+                          _mm_loadu_si128( in[1] + i ), 1 ) ),
+                      _mm256_inserti128_si256( _mm256_castsi128_si256(
+                          _mm_loadu_si128( in[2] + i ) ),
+                          _mm_loadu_si128( in[3] + i ), 1 ), 1 );
+      x[ i & 1 ] = _mm512_xor_si512( x[ i & 1 ], m );
+      if ( i & 1 )
+         transform_4way( x, 16 );
+   }
+
+   // padding and finalization as cube_2way_close
+   x[ i & 1 ] = _mm512_xor_si512( x[ i & 1 ],
+                      _mm512_broadcast_i32x4( _mm_set_epi32( 0, 0, 0, 0x80 ) ) );
+   transform_4way( x, 16 );
+   x[7] = _mm512_xor_si512( x[7],
+                      _mm512_broadcast_i32x4( _mm_set_epi32( 1, 0, 0, 0 ) ) );
+   for ( i = 0; i < 10; i++ )
+      transform_4way( x, 16 );
+
+   for ( i = 0; i < hashbytes / 16; i++ )
+   {
+      _mm_storeu_si128( out[0] + i, _mm512_extracti32x4_epi32( x[i], 0 ) );
+      _mm_storeu_si128( out[1] + i, _mm512_extracti32x4_epi32( x[i], 1 ) );
+      _mm_storeu_si128( out[2] + i, _mm512_extracti32x4_epi32( x[i], 2 ) );
+      _mm_storeu_si128( out[3] + i, _mm512_extracti32x4_epi32( x[i], 3 ) );
+   }
+}
+
+#else
+
+// hash[i] holds len bytes of lane i, a multiple of 16, and gets the
+// hashbytes long digest.
+static void cube_2way_fixed( void * const hash[2], int len,
+                             const uint32_t *iv, int hashbytes )
+{
+   const __m128i * const *in = (const __m128i * const*)hash;
+   __m128i * const *out = (__m128i * const*)hash;
+   __m256i x[8];
+   int i;
+
+   for ( i = 0; i < 8; i++ )
+      x[i] = _mm256_broadcastsi128_si256(
+                        _mm_load_si128( (const __m128i*)iv + i ) );
+   for ( i = 0; i < len / 16; i++ )
+   {
+      x[ i & 1 ] = _mm256_xor_si256( x[ i & 1 ],
+                      _mm256_inserti128_si256( _mm256_castsi128_si256(
+                          _mm_loadu_si128( in[0] + i ) ),
+                          _mm_loadu_si128( in[1] + i ), 1 ) );
+      if ( i & 1 )
+         transform_2way( x, 16 );
+   }
+
+   // padding and finalization as cube_2way_close
+   x[ i & 1 ] = _mm256_xor_si256( x[ i & 1 ],
+                      _mm256_set_epi32( 0, 0, 0, 0x80, 0, 0, 0, 0x80 ) );
+   transform_2way( x, 16 );
+   x[7] = _mm256_xor_si256( x[7], _mm256_set_epi32( 1, 0, 0, 0, 1, 0, 0, 0 ) );
+   for ( i = 0; i < 10; i++ )
+      transform_2way( x, 16 );
+
+   for ( i = 0; i < hashbytes / 16; i++ )
+   {
+      _mm_storeu_si128( out[0] + i, _mm256_castsi256_si128( x[i] ) );
+      _mm_storeu_si128( out[1] + i, _mm256_extracti128_si256( x[i], 1 ) );
+   }
+}
+
+#endif
+
+#endif
+
+void cube256_x4( void * const hash[4], int len )
+{
+#if defined(__AVX512F__)
+   cube_4way_fixed( hash, len, cube_iv256, 32 );
+#elif defined(__AVX2__)
+   cube_2way_fixed( hash, len, cube_iv256, 32 );
+   cube_2way_fixed( hash + 2, len, cube_iv256, 32 );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      cubehashParam ctx;
+      cubehashInit( &ctx, 256, 16, 32 );
+      cubehashUpdate( &ctx, (const byte*)hash[i], len );
+      cubehashDigest( &ctx, (byte*)hash[i] );
+   }
+#endif
+}
+
+void cube512_x4( void * const hash[4], int len )
+{
+#if defined(__AVX512F__)
+   cube_4way_fixed( hash, len, cube_iv512, 64 );
+#elif defined(__AVX2__)
+   cube_2way_fixed( hash, len, cube_iv512, 64 );
+   cube_2way_fixed( hash + 2, len, cube_iv512, 64 );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      if ( len == 64 )
+         cubehash512_64( hash[i], hash[i] );
+      else
+      {
+         cubehashParam ctx;
+         cubehashInit( &ctx, 512, 16, 32 );
+         cubehashUpdate( &ctx, (const byte*)hash[i], len );
+         cubehashDigest( &ctx, (byte*)hash[i] );
+      }
+   }
+#endif
+}
@@ -0,0 +1,38 @@
+#ifndef CUBE_HASH_2WAY_H__
+#define CUBE_HASH_2WAY_H__
+
+// CubeHash16/32 for 2 lanes in parallel, the AVX2 port of the SSE2
+// transform in sse2/cubehash_sse2.c with one lane in each 128 bit half of
+// the ymm registers. Input and output are interleaved 2x128, lengths are
+// bytes per lane and must be a multiple of 16.
+
+#if defined(__AVX2__)
+
+#include <stddef.h>
+#include "avxdefs.h"
+
+typedef struct {
+   __m256i x[8] __attribute__ ((aligned (64)));
+   int hashbitlen;
+   int rounds;
+   int blockbytes;
+   int pos;             // bytes per lane absorbed into the current block
+} cube_2way_context;
+
+void cube_2way_init( cube_2way_context *ctx, int hashbitlen, int rounds,
+                     int blockbytes );
+void cube_2way_update( cube_2way_context *ctx, const void *data,
+                       size_t len );
+void cube_2way_close( cube_2way_context *ctx, void *dst );
+
+#endif
+
+// CubeHash16/32 of 4 independent messages in place, four per zmm register
+// with AVX512F, two per ymm register with AVX2 and one at a time with SSE2.
+// hash[i] holds len bytes of message i, a multiple of 16, and gets its
+// 32 or 64 byte digest.
+
+void cube256_x4( void * const hash[4], int len );
+void cube512_x4( void * const hash[4], int len );
+
+#endif
@@ -232,3 +232,48 @@ int cubehashDigest(cubehashParam *sp, byte *digest)
 
     return SUCCESS;
 }
+
+#if defined(OPTIMIZE_SSE2)
+
+/* State after cubehashInit(512, 16, 32), the 10 initial rounds only
+ * depend on the parameters. */
+static const uint32_t IV512[32] __attribute__ ((aligned (16))) = {
+    0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E,
+    0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+    0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537,
+    0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+    0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532,
+    0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+    0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576,
+    0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+int cubehash512_64(void *digest, const void *data)
+{
+    cubehashParam sp;
+    const __m128i *in = (const __m128i*) data;
+    __m128i *out = (__m128i*) digest;
+    int i;
+
+    sp.rounds = CUBEHASH_ROUNDS;
+    for (i = 0; i < 8; ++i) sp.x[i] = _mm_load_si128((const __m128i*)IV512 + i);
+
+    /* two full 32 byte blocks */
+    sp.x[0] = _mm_xor_si128(sp.x[0], _mm_loadu_si128(in));
+    sp.x[1] = _mm_xor_si128(sp.x[1], _mm_loadu_si128(in + 1));
+    transform(&sp);
+    sp.x[0] = _mm_xor_si128(sp.x[0], _mm_loadu_si128(in + 2));
+    sp.x[1] = _mm_xor_si128(sp.x[1], _mm_loadu_si128(in + 3));
+    transform(&sp);
+
+    /* padding block and finalization, see cubehashDigest with pos 0 */
+    sp.x[0] = _mm_xor_si128(sp.x[0], _mm_set_epi32(0, 0, 0, 0x80));
+    transform(&sp);
+    sp.x[7] = _mm_xor_si128(sp.x[7], _mm_set_epi32(1, 0, 0, 0));
+    for (i = 0; i < 10; ++i) transform(&sp);
+
+    for (i = 0; i < 4; ++i) _mm_storeu_si128(out + i, sp.x[i]);
+    return SUCCESS;
+}
+
+#endif
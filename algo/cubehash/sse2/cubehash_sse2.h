@@ -56,6 +56,12 @@ int cubehashUpdate(cubehashParam* sp, const byte *data, size_t size);
 //BEECRYPTAPI
 int cubehashDigest(cubehashParam* sp, byte *digest);
 
+#if defined(OPTIMIZE_SSE2)
+/* CubeHash16/32-512 of exactly 64 bytes, same result as init, update and
+ * digest but without a context to set up or copy. */
+int cubehash512_64(void *digest, const void *data);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
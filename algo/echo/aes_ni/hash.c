@@ -585,6 +585,51 @@ HashReturn final_echo(hashState_echo *state, BitSequence *hashval)
 
 
 
+// ECHO-512 of exactly 64 bytes. The message and all of the padding fit in
+// one 128 byte block, so it's a single compression straight from the IV
+// without a context to initialize or copy.
+HashReturn echo512_64(void *hashval, const void *data)
+{
+	hashState_echo ctx;
+	unsigned char block[128] __attribute__ ((aligned (16)));
+	int i;
+
+	ctx.uHashSize = 512;
+	ctx.uBlockLength = 128;
+	ctx.uRounds = 10;
+	ctx.hashsize = _mm_set_epi32(0, 0, 0, 0x00000200);
+	ctx.const1536 = _mm_set_epi32(0x00000000, 0x00000000, 0x00000000, 0x00000400);
+
+	for(i = 0; i < 4; i++)
+	{
+		ctx.state[i][0] = ctx.hashsize;
+		ctx.state[i][1] = ctx.hashsize;
+		ctx.state[i][2] = _mm_setzero_si128();
+		ctx.state[i][3] = _mm_setzero_si128();
+	}
+
+	// Compress adds const1536 back, the counter ends up at the 512 bits
+	// of message in the block, same as final_echo.
+	ctx.k = _mm_sub_epi64(_mm_set_epi32(0, 0, 0, 512), ctx.const1536);
+
+	memcpy(block, data, 64);
+	block[64] = 0x80;
+	memset(block + 65, 0, 128 - 65 - 18);
+	*((unsigned short*)(block + 128 - 18)) = 512;
+	*((DataLength*)(block + 128 - 16)) = 512;
+	*((DataLength*)(block + 128 - 8)) = 0;
+
+	Compress(&ctx, block, 1);
+
+	_mm_storeu_si128((__m128i*)hashval + 0, ctx.state[0][0]);
+	_mm_storeu_si128((__m128i*)hashval + 1, ctx.state[1][0]);
+	_mm_storeu_si128((__m128i*)hashval + 2, ctx.state[2][0]);
+	_mm_storeu_si128((__m128i*)hashval + 3, ctx.state[3][0]);
+
+	return SUCCESS;
+}
+
+
 HashReturn hash_echo(int hashbitlen, const BitSequence *data, DataLength databitlen, BitSequence *hashval)
 {
 	HashReturn hRet;
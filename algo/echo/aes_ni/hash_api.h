@@ -63,6 +63,8 @@ HashReturn update_echo(hashState_echo *state, const BitSequence *data, DataLengt
 
 HashReturn final_echo(hashState_echo *state, BitSequence *hashval);
 
+HashReturn echo512_64(void *hashval, const void *data);
+
 HashReturn hash_echo(int hashbitlen, const BitSequence *data, DataLength databitlen, BitSequence *hashval);
 
 
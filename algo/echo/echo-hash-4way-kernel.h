@@ -0,0 +1,123 @@
+// Echo-512 kernel, included by echo-hash-4way.c once per vector width.
+// The includer defines V, LANES, the V_* operations, KERNEL_TARGET and
+// KERNEL_NAME. Every operation works within 128 bit lanes, so each lane
+// runs the AES-NI code of aes_ni/hash.c on its own message.
+
+#ifndef ECHO_HASH_4WAY_KERNEL_H__
+#define ECHO_HASH_4WAY_KERNEL_H__
+
+// Two AES rounds on one 128 bit word, the first keyed by the counter.
+#define EV_SUBBYTES( s, i, j ) \
+do { \
+   s[i][j] = V_AESENC( s[i][j], k1 ); \
+   s[i][j] = V_AESENC( s[i][j], V_ZERO ); \
+   k1 = V_ADD32( k1, const1 ); \
+} while (0)
+
+// u = 2 * x in GF(2^8) for every byte.
+#define EV_MUL2( u, x ) \
+do { \
+   t1 = V_AND( V_SRLI16( x, 7 ), lsbmask ); \
+   u = V_XOR( V_ADD8( x, x ), V_SHUF8( mul2mask, t1 ) ); \
+} while (0)
+
+// BigShiftRows and BigMixColumns for column j of s1 into s2.
+#define EV_MIXBYTES( s1, s2, j ) \
+do { \
+   const V a0 = s1[0][j]; \
+   const V a1 = s1[1][(j + 1) & 3]; \
+   const V a2 = s1[2][(j + 2) & 3]; \
+   const V a3 = s1[3][(j + 3) & 3]; \
+   EV_MUL2( u, a0 ); \
+   s2[0][j] = u; \
+   s2[1][j] = a0; \
+   s2[2][j] = a0; \
+   s2[3][j] = V_XOR( u, a0 ); \
+   EV_MUL2( u, a1 ); \
+   s2[0][j] = V_XOR( s2[0][j], V_XOR( u, a1 ) ); \
+   s2[1][j] = V_XOR( s2[1][j], u ); \
+   s2[2][j] = V_XOR( s2[2][j], a1 ); \
+   s2[3][j] = V_XOR( s2[3][j], a1 ); \
+   EV_MUL2( u, a2 ); \
+   s2[0][j] = V_XOR( s2[0][j], a2 ); \
+   s2[1][j] = V_XOR( s2[1][j], V_XOR( u, a2 ) ); \
+   s2[2][j] = V_XOR( s2[2][j], u ); \
+   s2[3][j] = V_XOR( s2[3][j], a2 ); \
+   EV_MUL2( u, a3 ); \
+   s2[0][j] = V_XOR( s2[0][j], a3 ); \
+   s2[1][j] = V_XOR( s2[1][j], a3 ); \
+   s2[2][j] = V_XOR( s2[2][j], V_XOR( u, a3 ) ); \
+   s2[3][j] = V_XOR( s2[3][j], u ); \
+} while (0)
+
+#define EV_ROUND( s1, s2 ) \
+do { \
+   for ( int j = 0; j < 4; j++ ) \
+   { \
+      EV_SUBBYTES( s1, 0, j ); \
+      EV_SUBBYTES( s1, 1, j ); \
+      EV_SUBBYTES( s1, 2, j ); \
+      EV_SUBBYTES( s1, 3, j ); \
+   } \
+   EV_MIXBYTES( s1, s2, 0 ); \
+   EV_MIXBYTES( s1, s2, 1 ); \
+   EV_MIXBYTES( s1, s2, 2 ); \
+   EV_MIXBYTES( s1, s2, 3 ); \
+} while (0)
+
+#endif
+
+// hash[i] holds len bytes of lane i, at most 109, and gets the digest.
+KERNEL_TARGET
+static void KERNEL_NAME( void * const hash[], int len )
+{
+   __m128i blk[8][LANES] __attribute__ ((aligned (64)));
+   V s[4][4], s2[4][4];
+   V k1, t1, u;
+   const V const1 = V_BCAST( _mm_set_epi32( 0, 0, 0, 1 ) );
+   const V mul2mask = V_BCAST( _mm_set_epi32( 0, 0, 0, 0x00001b00 ) );
+   const V lsbmask = V_SET1_32( 0x01010101 );
+   const V hashsize = V_BCAST( _mm_set_epi32( 0, 0, 0, 512 ) );
+
+   // padded message, one block per lane: 0x80, the digest size in bits
+   // at byte 110 and the message size in bits at byte 112
+   for ( int l = 0; l < LANES; l++ )
+   {
+      unsigned char b[128];
+      const uint64_t bits = (uint64_t)len << 3;
+      memcpy( b, hash[l], len );
+      b[len] = 0x80;
+      memset( b + len + 1, 0, 110 - len - 1 );
+      b[110] = 512 & 0xff;
+      b[111] = 512 >> 8;
+      memcpy( b + 112, &bits, 8 );
+      memset( b + 120, 0, 8 );
+      for ( int j = 0; j < 8; j++ )
+         blk[j][l] = _mm_loadu_si128( (const __m128i*)b + j );
+   }
+
+   for ( int i = 0; i < 4; i++ )
+   {
+      s[i][0] = hashsize;
+      s[i][1] = hashsize;
+      s[i][2] = V_LOAD( blk[i] );
+      s[i][3] = V_LOAD( blk[4+i] );
+   }
+
+   // the counter is the number of message bits hashed so far
+   k1 = V_BCAST( _mm_set_epi32( 0, 0, 0, len << 3 ) );
+
+   for ( int r = 0; r < 5; r++ )
+   {
+      EV_ROUND( s, s2 );
+      EV_ROUND( s2, s );
+   }
+
+   // feed forward, only the first 512 bits of the state are output
+   for ( int i = 0; i < 4; i++ )
+      V_STORE( blk[i], V_XOR( V_XOR( s[i][0], s[i][2] ),
+                              V_XOR( hashsize, V_LOAD( blk[i] ) ) ) );
+   for ( int l = 0; l < LANES; l++ )
+      for ( int j = 0; j < 4; j++ )
+         _mm_storeu_si128( (__m128i*)hash[l] + j, blk[j][l] );
+}
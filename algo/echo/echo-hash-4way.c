@@ -0,0 +1,139 @@
+#include <string.h>
+#include <immintrin.h>
+
+#include "miner.h"
+#include "echo-hash-4way.h"
+
+#ifdef NO_AES_NI
+  #include "sph_echo.h"
+#else
+  #include "aes_ni/hash_api.h"
+#endif
+
+// The kernels are built with target attributes rather than build flags so
+// one binary carries them and uses them only on cpus that have VAES.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) \
+    && ( __GNUC__ >= 8 )
+  #define ECHO_VAES 1
+#endif
+
+#if defined(ECHO_VAES)
+
+// 2 lanes, ymm
+
+#define V                   __m256i
+#define LANES               2
+#define KERNEL_TARGET       __attribute__ ((target("avx2,vaes")))
+#define KERNEL_NAME         echo512_2way_vaes
+#define V_ZERO              _mm256_setzero_si256()
+#define V_LOAD( p )         _mm256_load_si256( (const __m256i*)(p) )
+#define V_STORE( p, x )     _mm256_store_si256( (__m256i*)(p), x )
+#define V_BCAST( x )        _mm256_broadcastsi128_si256( x )
+#define V_SET1_32( x )      _mm256_set1_epi32( x )
+#define V_XOR               _mm256_xor_si256
+#define V_AND               _mm256_and_si256
+#define V_ADD8              _mm256_add_epi8
+#define V_ADD32             _mm256_add_epi32
+#define V_SRLI16            _mm256_srli_epi16
+#define V_SHUF8             _mm256_shuffle_epi8
+#define V_AESENC            _mm256_aesenc_epi128
+
+#include "echo-hash-4way-kernel.h"
+
+#undef V
+#undef LANES
+#undef KERNEL_TARGET
+#undef KERNEL_NAME
+#undef V_ZERO
+#undef V_LOAD
+#undef V_STORE
+#undef V_BCAST
+#undef V_SET1_32
+#undef V_XOR
+#undef V_AND
+#undef V_ADD8
+#undef V_ADD32
+#undef V_SRLI16
+#undef V_SHUF8
+#undef V_AESENC
+
+// 4 lanes, zmm
+
+#define V                   __m512i
+#define LANES               4
+#define KERNEL_TARGET       __attribute__ ((target("avx512f,avx512bw,vaes")))
+#define KERNEL_NAME         echo512_4way_vaes
+#define V_ZERO              _mm512_setzero_si512()
+#define V_LOAD( p )         _mm512_load_si512( (const void*)(p) )
+#define V_STORE( p, x )     _mm512_store_si512( (void*)(p), x )
+#define V_BCAST( x )        _mm512_broadcast_i32x4( x )
+#define V_SET1_32( x )      _mm512_set1_epi32( x )
+#define V_XOR               _mm512_xor_si512
+#define V_AND               _mm512_and_si512
+#define V_ADD8              _mm512_add_epi8
+#define V_ADD32             _mm512_add_epi32
+#define V_SRLI16            _mm512_srli_epi16
+#define V_SHUF8             _mm512_shuffle_epi8
+#define V_AESENC            _mm512_aesenc_epi128
+
+#include "echo-hash-4way-kernel.h"
+
+#endif   // ECHO_VAES
+
+static void echo512_x4_aesni( void * const hash[4], int len )
+{
+   for ( int i = 0; i < 4; i++ )
+   {
+#ifdef NO_AES_NI
+      sph_echo512_context ctx;
+      sph_echo512_init( &ctx );
+      sph_echo512( &ctx, hash[i], len );
+      sph_echo512_close( &ctx, hash[i] );
+#else
+      if ( len == 64 )
+         echo512_64( hash[i], hash[i] );
+      else
+      {
+         hashState_echo ctx;
+         init_echo( &ctx, 512 );
+         update_echo( &ctx, (const BitSequence*)hash[i],
+                      (DataLength)len << 3 );
+         final_echo( &ctx, (BitSequence*)hash[i] );
+      }
+#endif
+   }
+}
+
+#if defined(ECHO_VAES)
+
+static void echo512_x4_2way( void * const hash[4], int len )
+{
+   echo512_2way_vaes( hash, len );
+   echo512_2way_vaes( hash + 2, len );
+}
+
+static void echo512_x4_4way( void * const hash[4], int len )
+{
+   echo512_4way_vaes( hash, len );
+}
+
+#endif
+
+static void ( *echo512_x4_fn )( void * const*, int ) = NULL;
+
+void echo512_x4( void * const hash[4], int len )
+{
+   // Every thread picks the same kernel, a racing first call is harmless.
+   if ( !echo512_x4_fn )
+   {
+#if defined(ECHO_VAES)
+      if ( has_vaes() && has_avx512() )
+         echo512_x4_fn = echo512_x4_4way;
+      else if ( has_vaes() )
+         echo512_x4_fn = echo512_x4_2way;
+      else
+#endif
+         echo512_x4_fn = echo512_x4_aesni;
+   }
+   echo512_x4_fn( hash, len );
+}
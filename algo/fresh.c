@@ -7,20 +7,25 @@
 #include <stdio.h>
 
 #include "algo/shavite/sph_shavite.h"
+#include "algo/shavite/shavite-hash-4way.h"
+#include "algo/simd/simd-hash-4way.h"
 #include "algo/simd/sph_simd.h"
 #include "algo/echo/sph_echo.h"
+#ifndef NO_AES_NI
+#include "algo/echo/echo-hash-4way.h"
+#endif
 
 //#define DEBUG_ALGO
 
-extern void freshhash(void* output, const void* input, uint32_t len)
+// Everything up to the final Echo, the result is left in hash+64.
+static inline void freshhash_front( unsigned char *hash, const void *input,
+                                    uint32_t len )
 {
-	unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
 	#define hashA hash
 	#define hashB hash+64
 
 	sph_shavite512_context ctx_shavite;
 	sph_simd512_context ctx_simd;
-	sph_echo512_context ctx_echo;
 
 	sph_shavite512_init(&ctx_shavite);
 	sph_shavite512(&ctx_shavite, input, len);
@@ -30,13 +35,20 @@ extern void freshhash(void* output, const void* input, uint32_t len)
 	sph_simd512(&ctx_simd, hashA, 64);
 	sph_simd512_close(&ctx_simd, hashB);
 
-	sph_shavite512_init(&ctx_shavite);
-	sph_shavite512(&ctx_shavite, hashB, 64);
-	sph_shavite512_close(&ctx_shavite, hashA);
+	shavite512_64( hashA, hashB );
 
 	sph_simd512_init(&ctx_simd);
 	sph_simd512(&ctx_simd, hashA, 64);
 	sph_simd512_close(&ctx_simd, hashB);
+}
+
+extern void freshhash(void* output, const void* input, uint32_t len)
+{
+	unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
+
+	sph_echo512_context ctx_echo;
+
+	freshhash_front( hash, input, len );
 
 	sph_echo512_init(&ctx_echo);
 	sph_echo512(&ctx_echo, hashB, 64);
@@ -45,6 +57,28 @@ extern void freshhash(void* output, const void* input, uint32_t len)
 	memcpy(output, hash, 32);
 }
 
+#ifndef NO_AES_NI
+
+// input is 4 consecutive headers of len bytes, output 4 consecutive hashes.
+// The same stages as freshhash with all 4 lanes going through each at once.
+static void freshhash_4way( void *output, const void *input, uint32_t len )
+{
+	unsigned char hash[4][128] __attribute__ ((aligned (64)));
+	void * const lanesA[4] = { hash[0], hash[1], hash[2], hash[3] };
+
+	for ( int i = 0; i < 4; i++ )
+		memcpy( hash[i], (const unsigned char*)input + len*i, len );
+	shavite512_x4( lanesA, len );
+	simd512_x4( lanesA, 64 );
+	shavite512_x4( lanesA, 64 );
+	simd512_x4( lanesA, 64 );
+	echo512_x4( lanesA, 64 );
+	for ( int i = 0; i < 4; i++ )
+		memcpy( (unsigned char*)output + 32*i, hash[i], 32 );
+}
+
+#endif
+
 int scanhash_fresh(int thr_id, struct work *work,
 				uint32_t max_nonce, uint64_t *hashes_done)
 {
@@ -83,6 +117,33 @@ int scanhash_fresh(int thr_id, struct work *work,
 	for (int kk=0; kk < 32; kk++) {
 		be32enc(&endiandata[kk], ((uint32_t*)pdata)[kk]);
 	};
+#ifndef NO_AES_NI
+	// Shavite and Echo take 4 nonces at a time, with VAES they run side by side.
+	// The odd nonces at the end go through the single lane loop below.
+	{
+		uint32_t data4[4][20] __attribute__((aligned(64)));
+		uint32_t hash4[4][8] __attribute__((aligned(64)));
+
+		for ( int i = 0; i < 4; i++ )
+			memcpy( data4[i], endiandata, 80 );
+		while ( n + 1 < max_nonce && max_nonce - n > 4
+		        && !work_restart[thr_id].restart )
+		{
+			for ( int i = 0; i < 4; i++ )
+				be32enc( &data4[i][19], n + 1 + i );
+			freshhash_4way( hash4, data4, 80 );
+			for ( int i = 0; i < 4; i++ )
+			if ( hash4[i][7] <= Htarg && fulltest( hash4[i], ptarget ) )
+			{
+				pdata[19] = n + 1 + i;
+				*hashes_done = pdata[19] - first_nonce + 1;
+				return true;
+			}
+			n += 4;
+		}
+	}
+#endif
+
 #ifdef DEBUG_ALGO
 	if (Htarg != 0)
 		printf("[%d] Htarg=%X\n", thr_id, Htarg);
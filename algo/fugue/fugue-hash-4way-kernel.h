@@ -0,0 +1,180 @@
+// Fugue-512 kernel, included by fugue-hash-4way.c once per vector width.
+// The includer defines V, LANES, the V_* operations, KERNEL_TARGET and
+// KERNEL_NAME. Every operation works within 128 bit lanes, so each lane
+// runs sph_fugue.c on its own message.
+//
+// The 36 word state of a lane is held in 9 vectors, x[g] element e is
+// word 4g+e. Rather than renaming words as sph_fugue does, the state is
+// rotated for real, so TIX, CMIX and SMIX always touch the same words.
+
+#ifndef FUGUE_HASH_4WAY_KERNEL_H__
+#define FUGUE_HASH_4WAY_KERNEL_H__
+
+// u = 2 * x in GF(2^8) for every byte.
+#define FV_MUL2( u, x ) \
+do { \
+   V m_; \
+   u = x; \
+   V_MUL2( u, m_, k1b ); \
+} while (0)
+
+// Rotate the state right by n words, n = 4a + r.
+#define FV_ROR( x, a, r ) \
+do { \
+   V y_[9]; \
+   for ( int g = 0; g < 9; g++ ) \
+      y_[g] = (r) ? V_ALIGNR( x[ ( g + 9 - (a) ) % 9 ], \
+                              x[ ( g + 8 - (a) ) % 9 ], 16 - 4*(r) ) \
+                  : x[ ( g + 9 - (a) ) % 9 ]; \
+   for ( int g = 0; g < 9; g++ ) \
+      x[g] = y_[g]; \
+} while (0)
+
+// SMIX of words 0 to 3. The S-box comes from aesenclast, the input is
+// shuffled by the inverse of ShiftRows first so it cancels. Super-Mix
+// is the column mix of N = circ(1,4,7,1) moved along the diagonals plus,
+// for every row, the sum of the row without its diagonal byte times
+// 1, 1, 7 and 4 in columns 0 to 3.
+#define FV_SMIX( x ) \
+do { \
+   V s_, s2_, s4_, s7_, c_, t_, t2_, t4_; \
+   s_ = V_AESENCLAST( V_SHUF8( x, inv_shift_rows ), V_ZERO ); \
+   FV_MUL2( s2_, s_ ); \
+   FV_MUL2( s4_, s2_ ); \
+   s7_ = V_XOR( V_XOR( s4_, s2_ ), s_ ); \
+   c_ = V_XOR( V_XOR( s_, V_SHUF8( s4_, rotl8 ) ), \
+               V_XOR( V_SHUF8( s7_, rotl16 ), V_SHUF8( s_, rotl24 ) ) ); \
+   t_ = V_XOR( s_, V_SHUF32( s_, 0x4e ) ); \
+   t_ = V_XOR( V_XOR( t_, V_SHUF32( t_, 0xb1 ) ), V_SHUF8( s_, diag ) ); \
+   FV_MUL2( t2_, t_ ); \
+   FV_MUL2( t4_, t2_ ); \
+   x = V_XOR( V_XOR( V_SHUF8( c_, diag_cols ), V_AND( t_, w012 ) ), \
+              V_XOR( V_AND( t2_, w2 ), V_AND( t4_, w23 ) ) ); \
+} while (0)
+
+// ROR3, CMIX36, SMIX
+#define FV_SUBROUND( x ) \
+do { \
+   V t_; \
+   FV_ROR( x, 0, 3 ); \
+   t_ = V_AND( x[1], w012 ); \
+   x[0] = V_XOR( x[0], t_ ); \
+   x[4] = V_XOR( x[4], V_BSLLI( t_, 8 ) ); \
+   x[5] = V_XOR( x[5], V_BSRLI( t_, 8 ) ); \
+   FV_SMIX( x[0] ); \
+} while (0)
+
+// TIX4 for the input word in element 0 of q, then 4 subrounds.
+#define FV_ROUND( x, q ) \
+do { \
+   x[5] = V_XOR( x[5], V_BSLLI( V_AND( x[0], w0 ), 8 ) ); \
+   x[0] = V_XOR( V_ANDNOT( w0, x[0] ), q ); \
+   x[2] = V_XOR( x[2], q ); \
+   x[0] = V_XOR( x[0], V_BSLLI( V_AND( x[6], w0 ), 4 ) ); \
+   x[1] = V_XOR( x[1], V_BSRLI( x[6], 12 ) ); \
+   x[1] = V_XOR( x[1], V_BSLLI( V_AND( x[7], w2 ), 4 ) ); \
+   FV_SUBROUND( x ); \
+   FV_SUBROUND( x ); \
+   FV_SUBROUND( x ); \
+   FV_SUBROUND( x ); \
+} while (0)
+
+// Word 0 into words 4, i, j and k, where i, j and k are 8 to 31.
+#define FV_SPREAD( x, i, j, k ) \
+do { \
+   const V b_ = V_SHUF32( x[0], 0 ); \
+   x[1] = V_XOR( x[1], V_AND( b_, w0 ) ); \
+   x[(i)/4] = V_XOR( x[(i)/4], V_AND( b_, V_BCAST( wsel[(i)%4] ) ) ); \
+   x[(j)/4] = V_XOR( x[(j)/4], V_AND( b_, V_BCAST( wsel[(j)%4] ) ) ); \
+   x[(k)/4] = V_XOR( x[(k)/4], V_AND( b_, V_BCAST( wsel[(k)%4] ) ) ); \
+} while (0)
+
+static const uint32_t fugue_wsel[4][4] __attribute__ ((aligned (16))) =
+{
+   { 0xffffffff, 0, 0, 0 }, { 0, 0xffffffff, 0, 0 },
+   { 0, 0, 0xffffffff, 0 }, { 0, 0, 0, 0xffffffff }
+};
+
+#endif
+
+// hash[i] holds len bytes of lane i, a multiple of 4 and at most 120,
+// and gets the digest.
+KERNEL_TARGET
+static void KERNEL_NAME( void * const hash[], int len )
+{
+   __m128i blk[32][LANES] __attribute__ ((aligned (64)));
+   const __m128i *wsel = (const __m128i*)fugue_wsel;
+   const int words = ( len >> 2 ) + 2;
+   V x[9];
+   const V w0 = V_BCAST( wsel[0] );
+   const V w2 = V_BCAST( wsel[2] );
+   const V w012 = V_BCAST( _mm_set_epi32( 0, -1, -1, -1 ) );
+   const V w23 = V_BCAST( _mm_set_epi32( -1, -1, 0, 0 ) );
+   const V k1b = V_SET1_32( 0x1b1b1b1b );
+   const V inv_shift_rows = V_BCAST( _mm_set_epi8( 3, 6, 9, 12, 15, 2, 5,
+                                         8, 11, 14, 1, 4, 7, 10, 13, 0 ) );
+   const V rotl8 = V_BCAST( _mm_set_epi8( 14, 13, 12, 15, 10, 9, 8, 11,
+                                          6, 5, 4, 7, 2, 1, 0, 3 ) );
+   const V rotl16 = V_BCAST( _mm_set_epi8( 13, 12, 15, 14, 9, 8, 11, 10,
+                                           5, 4, 7, 6, 1, 0, 3, 2 ) );
+   const V rotl24 = V_BCAST( _mm_set_epi8( 12, 15, 14, 13, 8, 11, 10, 9,
+                                           4, 7, 6, 5, 0, 3, 2, 1 ) );
+   const V diag = V_BCAST( _mm_set_epi8( 3, 6, 9, 12, 3, 6, 9, 12,
+                                         3, 6, 9, 12, 3, 6, 9, 12 ) );
+   const V diag_cols = V_BCAST( _mm_set_epi8( 15, 2, 5, 8, 11, 14, 1, 4,
+                                          7, 10, 13, 0, 3, 6, 9, 12 ) );
+   const V bswap = V_BCAST( _mm_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3 ) );
+
+   // the big endian message words followed by the 64 bit bit count, one
+   // word per vector in element 0
+   for ( int l = 0; l < LANES; l++ )
+   {
+      const unsigned char *b = (const unsigned char*)hash[l];
+      for ( int m = 0; m < words - 2; m++ )
+         blk[m][l] = _mm_cvtsi32_si128( ( (uint32_t)b[4*m] << 24 )
+                       | ( b[4*m+1] << 16 ) | ( b[4*m+2] << 8 ) | b[4*m+3] );
+      blk[words-2][l] = _mm_setzero_si128();
+      blk[words-1][l] = _mm_cvtsi32_si128( len << 3 );
+   }
+
+   for ( int g = 0; g < 5; g++ )
+      x[g] = V_ZERO;
+   for ( int g = 5; g < 9; g++ )
+      x[g] = V_BCAST( _mm_load_si128( (const __m128i*)IV512 + g - 5 ) );
+
+   for ( int m = 0; m < words; m++ )
+   {
+      const V q = V_LOAD( blk[m] );
+      FV_ROUND( x, q );
+   }
+
+   for ( int i = 0; i < 32; i++ )
+      FV_SUBROUND( x );
+
+   for ( int i = 0; i < 13; i++ )
+   {
+      FV_SPREAD( x,  9, 18, 27 );
+      FV_ROR( x, 2, 1 );
+      FV_SMIX( x[0] );
+      FV_SPREAD( x, 10, 18, 27 );
+      FV_ROR( x, 2, 1 );
+      FV_SMIX( x[0] );
+      FV_SPREAD( x, 10, 19, 27 );
+      FV_ROR( x, 2, 1 );
+      FV_SMIX( x[0] );
+      FV_SPREAD( x, 10, 19, 28 );
+      FV_ROR( x, 2, 0 );
+      FV_SMIX( x[0] );
+   }
+   FV_SPREAD( x, 9, 18, 27 );
+
+   // words 1-4, 9-12, 18-21 and 27-30, big endian
+   V_STORE( blk[0], V_SHUF8( V_ALIGNR( x[1], x[0],  4 ), bswap ) );
+   V_STORE( blk[1], V_SHUF8( V_ALIGNR( x[3], x[2],  4 ), bswap ) );
+   V_STORE( blk[2], V_SHUF8( V_ALIGNR( x[5], x[4],  8 ), bswap ) );
+   V_STORE( blk[3], V_SHUF8( V_ALIGNR( x[7], x[6], 12 ), bswap ) );
+   for ( int l = 0; l < LANES; l++ )
+      for ( int j = 0; j < 4; j++ )
+         _mm_storeu_si128( (__m128i*)hash[l] + j, blk[j][l] );
+}
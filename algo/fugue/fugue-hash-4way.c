@@ -0,0 +1,217 @@
+#include <string.h>
+#include <immintrin.h>
+
+#include "miner.h"
+#include "fugue-hash-4way.h"
+#include "sph_fugue.h"
+
+#ifndef NO_AES_NI
+
+static const uint32_t IV512[16] __attribute__ ((aligned (16))) =
+{
+   0x8807a57e, 0xe616af75, 0xc5d3e4db, 0xac9ab027,
+   0xd915f117, 0xb6eecc54, 0x06e8020b, 0x4a92efd1,
+   0xaac6e2c9, 0xddb21398, 0xcae65838, 0x437f203f,
+   0x25ea78e7, 0x951fddd6, 0xda6ed11d, 0xe13e3567
+};
+
+// 1 lane, xmm
+
+#define V                   __m128i
+#define LANES               1
+#define KERNEL_TARGET
+#define KERNEL_NAME         fugue512_aesni
+#define V_LOAD( p )         _mm_load_si128( (const __m128i*)(p) )
+#define V_STORE( p, x )     _mm_store_si128( (__m128i*)(p), x )
+#define V_BCAST( x )        (x)
+#define V_ZERO              _mm_setzero_si128()
+#define V_SET1_32( x )      _mm_set1_epi32( x )
+#define V_XOR               _mm_xor_si128
+#define V_AND               _mm_and_si128
+#define V_ANDNOT            _mm_andnot_si128
+#define V_BSLLI             _mm_slli_si128
+#define V_BSRLI             _mm_srli_si128
+#define V_SHUF8             _mm_shuffle_epi8
+#define V_SHUF32            _mm_shuffle_epi32
+#define V_ALIGNR            _mm_alignr_epi8
+#define V_AESENCLAST        _mm_aesenclast_si128
+#define V_MUL2( i, j, k ) \
+do { \
+   j = _mm_and_si128( _mm_cmpgt_epi8( V_ZERO, i ), k ); \
+   i = _mm_xor_si128( _mm_add_epi8( i, i ), j ); \
+} while (0)
+
+#include "fugue-hash-4way-kernel.h"
+
+#undef V
+#undef LANES
+#undef KERNEL_TARGET
+#undef KERNEL_NAME
+#undef V_LOAD
+#undef V_STORE
+#undef V_BCAST
+#undef V_ZERO
+#undef V_SET1_32
+#undef V_XOR
+#undef V_AND
+#undef V_ANDNOT
+#undef V_BSLLI
+#undef V_BSRLI
+#undef V_SHUF8
+#undef V_SHUF32
+#undef V_ALIGNR
+#undef V_AESENCLAST
+#undef V_MUL2
+
+// The VAES kernels are built with target attributes rather than build
+// flags so one binary carries them and uses them only on cpus that have it.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) \
+    && ( __GNUC__ >= 8 )
+  #define FUGUE_VAES 1
+#endif
+
+#endif   // !NO_AES_NI
+
+#if defined(FUGUE_VAES)
+
+// 2 lanes, ymm
+
+#define V                   __m256i
+#define LANES               2
+#define KERNEL_TARGET       __attribute__ ((target("avx2,vaes")))
+#define KERNEL_NAME         fugue512_2way_vaes
+#define V_LOAD( p )         _mm256_load_si256( (const __m256i*)(p) )
+#define V_STORE( p, x )     _mm256_store_si256( (__m256i*)(p), x )
+#define V_BCAST( x )        _mm256_broadcastsi128_si256( x )
+#define V_ZERO              _mm256_setzero_si256()
+#define V_SET1_32( x )      _mm256_set1_epi32( x )
+#define V_XOR               _mm256_xor_si256
+#define V_AND               _mm256_and_si256
+#define V_ANDNOT            _mm256_andnot_si256
+#define V_BSLLI             _mm256_bslli_epi128
+#define V_BSRLI             _mm256_bsrli_epi128
+#define V_SHUF8             _mm256_shuffle_epi8
+#define V_SHUF32            _mm256_shuffle_epi32
+#define V_ALIGNR            _mm256_alignr_epi8
+#define V_AESENCLAST        _mm256_aesenclast_epi128
+#define V_MUL2( i, j, k ) \
+do { \
+   j = _mm256_and_si256( _mm256_cmpgt_epi8( V_ZERO, i ), k ); \
+   i = _mm256_xor_si256( _mm256_add_epi8( i, i ), j ); \
+} while (0)
+
+#include "fugue-hash-4way-kernel.h"
+
+#undef V
+#undef LANES
+#undef KERNEL_TARGET
+#undef KERNEL_NAME
+#undef V_LOAD
+#undef V_STORE
+#undef V_BCAST
+#undef V_ZERO
+#undef V_SET1_32
+#undef V_XOR
+#undef V_AND
+#undef V_ANDNOT
+#undef V_BSLLI
+#undef V_BSRLI
+#undef V_SHUF8
+#undef V_SHUF32
+#undef V_ALIGNR
+#undef V_AESENCLAST
+#undef V_MUL2
+
+// 4 lanes, zmm
+
+#define V                   __m512i
+#define LANES               4
+#define KERNEL_TARGET       __attribute__ ((target("avx512f,avx512bw,vaes")))
+#define KERNEL_NAME         fugue512_4way_vaes
+#define V_LOAD( p )         _mm512_load_si512( (const void*)(p) )
+#define V_STORE( p, x )     _mm512_store_si512( (void*)(p), x )
+#define V_BCAST( x )        _mm512_broadcast_i32x4( x )
+#define V_ZERO              _mm512_setzero_si512()
+#define V_SET1_32( x )      _mm512_set1_epi32( x )
+#define V_XOR               _mm512_xor_si512
+#define V_AND               _mm512_and_si512
+#define V_ANDNOT            _mm512_andnot_si512
+#define V_BSLLI             _mm512_bslli_epi128
+#define V_BSRLI             _mm512_bsrli_epi128
+#define V_SHUF8             _mm512_shuffle_epi8
+#define V_SHUF32            _mm512_shuffle_epi32
+#define V_ALIGNR            _mm512_alignr_epi8
+#define V_AESENCLAST        _mm512_aesenclast_epi128
+#define V_MUL2( i, j, k ) \
+do { \
+   j = _mm512_maskz_mov_epi8( _mm512_movepi8_mask( i ), k ); \
+   i = _mm512_xor_si512( _mm512_add_epi8( i, i ), j ); \
+} while (0)
+
+#include "fugue-hash-4way-kernel.h"
+
+#endif   // FUGUE_VAES
+
+void fugue512_64( void *out, const void *in )
+{
+#ifdef NO_AES_NI
+   sph_fugue512_context ctx;
+   sph_fugue512_init( &ctx );
+   sph_fugue512( &ctx, in, 64 );
+   sph_fugue512_close( &ctx, out );
+#else
+   void * const hash[1] = { out };
+   if ( out != in )
+      memcpy( out, in, 64 );
+   fugue512_aesni( hash, 64 );
+#endif
+}
+
+static void fugue512_x4_1way( void * const hash[4], int len )
+{
+   for ( int i = 0; i < 4; i++ )
+   {
+#ifdef NO_AES_NI
+      sph_fugue512_context ctx;
+      sph_fugue512_init( &ctx );
+      sph_fugue512( &ctx, hash[i], len );
+      sph_fugue512_close( &ctx, hash[i] );
+#else
+      fugue512_aesni( hash + i, len );
+#endif
+   }
+}
+
+#if defined(FUGUE_VAES)
+
+static void fugue512_x4_2way( void * const hash[4], int len )
+{
+   fugue512_2way_vaes( hash, len );
+   fugue512_2way_vaes( hash + 2, len );
+}
+
+static void fugue512_x4_4way( void * const hash[4], int len )
+{
+   fugue512_4way_vaes( hash, len );
+}
+
+#endif
+
+static void ( *fugue512_x4_fn )( void * const*, int ) = NULL;
+
+void fugue512_x4( void * const hash[4], int len )
+{
+   // Every thread picks the same kernel, a racing first call is harmless.
+   if ( !fugue512_x4_fn )
+   {
+#if defined(FUGUE_VAES)
+      if ( has_vaes() && has_avx512() )
+         fugue512_x4_fn = fugue512_x4_4way;
+      else if ( has_vaes() )
+         fugue512_x4_fn = fugue512_x4_2way;
+      else
+#endif
+         fugue512_x4_fn = fugue512_x4_1way;
+   }
+   fugue512_x4_fn( hash, len );
+}
@@ -0,0 +1,18 @@
+#ifndef FUGUE_HASH_4WAY_H__
+#define FUGUE_HASH_4WAY_H__
+
+// Fugue-512 of short messages with AES-NI in place of the sph tables.
+//
+// fugue512_64 hashes a 64 byte chain stage. fugue512_x4 hashes 4
+// independent messages: with VAES they run side by side, one per 128 bit
+// lane of a zmm register (AVX512BW) or two per ymm register (AVX2),
+// otherwise one at a time. The kernel is picked at run time on the first
+// call. hash[i] holds len bytes of message i on entry and its 64 byte
+// digest on return, len is a multiple of 4 and at most 120.
+//
+// Without AES-NI both fall back to sph_fugue512.
+
+void fugue512_64( void *out, const void *in );
+void fugue512_x4( void * const hash[4], int len );
+
+#endif
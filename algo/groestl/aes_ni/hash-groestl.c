@@ -6,6 +6,7 @@
  * This code is placed in the public domain
  */
 
+#include <string.h>
 #include "hash-groestl.h"
 #include "miner.h"
 
@@ -272,6 +273,45 @@ HashReturn_gr final_groestl(hashState_groestl* ctx,
   return SUCCESS_GR;
 }
 
+/* the round constants are globals normally set up by init_groestl */
+static pthread_once_t groestl512_64_once = PTHREAD_ONCE_INIT;
+
+static void groestl512_64_set_constants(void) {
+  int i;
+
+  SET_CONSTANTS();
+}
+
+/* Groestl-512 of exactly 64 bytes. Message, padding and block counter fit
+   in one block, so it's one transform and the output transformation on a
+   stack state, no context to initialise or copy. */
+HashReturn_gr groestl512_64(void* output, const void* input) {
+  __attribute__ ((aligned (32))) u64 chaining[SIZE/8];
+  __attribute__ ((aligned (32))) u64 block[SIZE/8];
+  u8 *m = (u8*)block;
+  int i;
+
+  pthread_once(&groestl512_64_once, groestl512_64_set_constants);
+
+  for (i=0; i<SIZE/8; i++)
+    chaining[i] = 0;
+  chaining[COLS-1] = U64BIG((u64)LENGTH);
+  INIT(chaining);
+
+  memcpy(m, input, 64);
+  m[64] = 0x80;
+  memset(m+65, 0, SIZE-65);
+  /* block counter, one block, big endian */
+  m[SIZE-1] = 1;
+
+  TF1024(chaining, block);
+  OF1024(chaining);
+  asm volatile ("emms");
+
+  memcpy(output, (u8*)chaining + SIZE - LENGTH/8, LENGTH/8);
+  return SUCCESS_GR;
+}
+
 /* hash bit sequence */
 HashReturn_gr hash_groestl(int hashbitlen,
 		const BitSequence_gr* data, 
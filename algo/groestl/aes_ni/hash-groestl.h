@@ -103,4 +103,7 @@ HashReturn_gr final_groestl(hashState_groestl*, BitSequence_gr*);
 HashReturn_gr hash_groestl(int, const BitSequence_gr*, DataLength_gr, BitSequence_gr*);
 /* NIST API end   */
 
+/* fixed 64 byte input, no context */
+HashReturn_gr groestl512_64(void*, const void*);
+
 #endif /* __hash_h */
@@ -0,0 +1,428 @@
+// Groestl-512 kernel, included by groestl-hash-4way.c once per vector
+// width. The includer defines V, LANES, the V_* operations, KERNEL_TARGET
+// and KERNEL_NAME. Every operation works within 128 bit lanes, so each
+// lane runs the code of aes_ni/groestl-intr-aes.h on its own message.
+
+#ifndef GROESTL_HASH_4WAY_KERNEL_H__
+#define GROESTL_HASH_4WAY_KERNEL_H__
+
+// MixBytes from "Byte Slicing Groestl", same register schedule as
+// groestl-intr-aes.h with the three spills kept in locals.
+#define GV_MIXBYTES( a0, a1, a2, a3, a4, a5, a6, a7, \
+                     b0, b1, b2, b3, b4, b5, b6, b7 ) \
+do { \
+  b6 = a0; \
+  b7 = a1; \
+  a0 = V_XOR( a0, a1 ); \
+  b0 = a2; \
+  a1 = V_XOR( a1, a2 ); \
+  b1 = a3; \
+  a2 = V_XOR( a2, a3 ); \
+  b2 = a4; \
+  a3 = V_XOR( a3, a4 ); \
+  b3 = a5; \
+  a4 = V_XOR( a4, a5 ); \
+  b4 = a6; \
+  a5 = V_XOR( a5, a6 ); \
+  b5 = a7; \
+  a6 = V_XOR( a6, a7 ); \
+  a7 = V_XOR( a7, b6 ); \
+  b0 = V_XOR( b0, a4 ); \
+  b6 = V_XOR( b6, a4 ); \
+  b1 = V_XOR( b1, a5 ); \
+  b7 = V_XOR( b7, a5 ); \
+  b2 = V_XOR( b2, a6 ); \
+  b0 = V_XOR( b0, a6 ); \
+  TEMP0 = b0; \
+  b3 = V_XOR( b3, a7 ); \
+  b1 = V_XOR( b1, a7 ); \
+  TEMP1 = b1; \
+  b4 = V_XOR( b4, a0 ); \
+  b2 = V_XOR( b2, a0 ); \
+  b0 = a0; \
+  b5 = V_XOR( b5, a1 ); \
+  b3 = V_XOR( b3, a1 ); \
+  b1 = a1; \
+  b6 = V_XOR( b6, a2 ); \
+  b4 = V_XOR( b4, a2 ); \
+  TEMP2 = a2; \
+  b7 = V_XOR( b7, a3 ); \
+  b5 = V_XOR( b5, a3 ); \
+  a0 = V_XOR( a0, a3 ); \
+  a1 = V_XOR( a1, a4 ); \
+  a2 = V_XOR( a2, a5 ); \
+  a3 = V_XOR( a3, a6 ); \
+  a4 = V_XOR( a4, a7 ); \
+  a5 = V_XOR( a5, b0 ); \
+  a6 = V_XOR( a6, b1 ); \
+  a7 = V_XOR( a7, TEMP2 ); \
+  b1 = all_1b; \
+  V_MUL2( a0, b0, b1 ); \
+  a0 = V_XOR( a0, TEMP0 ); \
+  V_MUL2( a1, b0, b1 ); \
+  a1 = V_XOR( a1, TEMP1 ); \
+  V_MUL2( a2, b0, b1 ); \
+  a2 = V_XOR( a2, b2 ); \
+  V_MUL2( a3, b0, b1 ); \
+  a3 = V_XOR( a3, b3 ); \
+  V_MUL2( a4, b0, b1 ); \
+  a4 = V_XOR( a4, b4 ); \
+  V_MUL2( a5, b0, b1 ); \
+  a5 = V_XOR( a5, b5 ); \
+  V_MUL2( a6, b0, b1 ); \
+  a6 = V_XOR( a6, b6 ); \
+  V_MUL2( a7, b0, b1 ); \
+  a7 = V_XOR( a7, b7 ); \
+  V_MUL2( a0, b0, b1 ); \
+  b5 = V_XOR( b5, a0 ); \
+  V_MUL2( a1, b0, b1 ); \
+  b6 = V_XOR( b6, a1 ); \
+  V_MUL2( a2, b0, b1 ); \
+  b7 = V_XOR( b7, a2 ); \
+  V_MUL2( a5, b0, b1 ); \
+  b2 = V_XOR( b2, a5 ); \
+  V_MUL2( a6, b0, b1 ); \
+  b3 = V_XOR( b3, a6 ); \
+  V_MUL2( a7, b0, b1 ); \
+  b4 = V_XOR( b4, a7 ); \
+  V_MUL2( a3, b0, b1 ); \
+  V_MUL2( a4, b0, b1 ); \
+  b0 = V_XOR( TEMP0, a3 ); \
+  b1 = V_XOR( TEMP1, a4 ); \
+} while (0)
+
+// SubBytes with aesenclast and a zero key (ShiftRows is undone by the
+// SUBSH masks), then MixBytes.
+#define GV_SUBMIX( a0, a1, a2, a3, a4, a5, a6, a7, \
+                   b0, b1, b2, b3, b4, b5, b6, b7 ) \
+do { \
+  b0 = V_ZERO; \
+  a0 = V_AESENCLAST( a0, b0 ); \
+  a1 = V_AESENCLAST( a1, b0 ); \
+  a2 = V_AESENCLAST( a2, b0 ); \
+  a3 = V_AESENCLAST( a3, b0 ); \
+  a4 = V_AESENCLAST( a4, b0 ); \
+  a5 = V_AESENCLAST( a5, b0 ); \
+  a6 = V_AESENCLAST( a6, b0 ); \
+  a7 = V_AESENCLAST( a7, b0 ); \
+  GV_MIXBYTES( a0, a1, a2, a3, a4, a5, a6, a7, \
+               b0, b1, b2, b3, b4, b5, b6, b7 ); \
+} while (0)
+
+#define GV_ROUNDS_P() \
+do { \
+  for ( int r = 0; r < 14; r += 2 ) \
+  { \
+    x8  = V_XOR( x8, V_XOR( rc_p, V_SET1_32( r * 0x01010101 ) ) ); \
+    x8  = V_SHUF8( x8,  subsh[0] ); \
+    x9  = V_SHUF8( x9,  subsh[1] ); \
+    x10 = V_SHUF8( x10, subsh[2] ); \
+    x11 = V_SHUF8( x11, subsh[3] ); \
+    x12 = V_SHUF8( x12, subsh[4] ); \
+    x13 = V_SHUF8( x13, subsh[5] ); \
+    x14 = V_SHUF8( x14, subsh[6] ); \
+    x15 = V_SHUF8( x15, subsh[7] ); \
+    GV_SUBMIX( x8, x9, x10, x11, x12, x13, x14, x15, \
+               x0, x1, x2, x3, x4, x5, x6, x7 ); \
+    x0 = V_XOR( x0, V_XOR( rc_p, V_SET1_32( (r+1) * 0x01010101 ) ) ); \
+    x0 = V_SHUF8( x0, subsh[0] ); \
+    x1 = V_SHUF8( x1, subsh[1] ); \
+    x2 = V_SHUF8( x2, subsh[2] ); \
+    x3 = V_SHUF8( x3, subsh[3] ); \
+    x4 = V_SHUF8( x4, subsh[4] ); \
+    x5 = V_SHUF8( x5, subsh[5] ); \
+    x6 = V_SHUF8( x6, subsh[6] ); \
+    x7 = V_SHUF8( x7, subsh[7] ); \
+    GV_SUBMIX( x0, x1, x2, x3, x4, x5, x6, x7, \
+               x8, x9, x10, x11, x12, x13, x14, x15 ); \
+  } \
+} while (0)
+
+#define GV_ROUNDS_Q() \
+do { \
+  for ( int r = 0; r < 14; r += 2 ) \
+  { \
+    x8  = V_XOR( x8,  all_ff ); \
+    x9  = V_XOR( x9,  all_ff ); \
+    x10 = V_XOR( x10, all_ff ); \
+    x11 = V_XOR( x11, all_ff ); \
+    x12 = V_XOR( x12, all_ff ); \
+    x13 = V_XOR( x13, all_ff ); \
+    x14 = V_XOR( x14, all_ff ); \
+    x15 = V_XOR( x15, V_XOR( rc_q, V_SET1_32( r * 0x01010101 ) ) ); \
+    x8  = V_SHUF8( x8,  subsh[1] ); \
+    x9  = V_SHUF8( x9,  subsh[3] ); \
+    x10 = V_SHUF8( x10, subsh[5] ); \
+    x11 = V_SHUF8( x11, subsh[7] ); \
+    x12 = V_SHUF8( x12, subsh[0] ); \
+    x13 = V_SHUF8( x13, subsh[2] ); \
+    x14 = V_SHUF8( x14, subsh[4] ); \
+    x15 = V_SHUF8( x15, subsh[6] ); \
+    GV_SUBMIX( x8, x9, x10, x11, x12, x13, x14, x15, \
+               x0, x1, x2, x3, x4, x5, x6, x7 ); \
+    x0 = V_XOR( x0, all_ff ); \
+    x1 = V_XOR( x1, all_ff ); \
+    x2 = V_XOR( x2, all_ff ); \
+    x3 = V_XOR( x3, all_ff ); \
+    x4 = V_XOR( x4, all_ff ); \
+    x5 = V_XOR( x5, all_ff ); \
+    x6 = V_XOR( x6, all_ff ); \
+    x7 = V_XOR( x7, V_XOR( rc_q, V_SET1_32( (r+1) * 0x01010101 ) ) ); \
+    x0 = V_SHUF8( x0, subsh[1] ); \
+    x1 = V_SHUF8( x1, subsh[3] ); \
+    x2 = V_SHUF8( x2, subsh[5] ); \
+    x3 = V_SHUF8( x3, subsh[7] ); \
+    x4 = V_SHUF8( x4, subsh[0] ); \
+    x5 = V_SHUF8( x5, subsh[2] ); \
+    x6 = V_SHUF8( x6, subsh[4] ); \
+    x7 = V_SHUF8( x7, subsh[6] ); \
+    GV_SUBMIX( x0, x1, x2, x3, x4, x5, x6, x7, \
+               x8, x9, x10, x11, x12, x13, x14, x15 ); \
+  } \
+} while (0)
+
+// Two columns per register to one row per register.
+#define GV_TRANSPOSE( i0, i1, i2, i3, i4, i5, i6, i7, \
+                      t0, t1, t2, t3, t4, t5, t6, t7 ) \
+do { \
+  t0 = transp; \
+  i6 = V_SHUF8( i6, t0 ); \
+  i0 = V_SHUF8( i0, t0 ); \
+  i1 = V_SHUF8( i1, t0 ); \
+  i2 = V_SHUF8( i2, t0 ); \
+  i3 = V_SHUF8( i3, t0 ); \
+  t1 = i2; \
+  i4 = V_SHUF8( i4, t0 ); \
+  i5 = V_SHUF8( i5, t0 ); \
+  t2 = i4; \
+  t3 = i6; \
+  i7 = V_SHUF8( i7, t0 ); \
+  t0 = i0; \
+  t2 = V_UNPACKHI16( t2, i5 ); \
+  i4 = V_UNPACKLO16( i4, i5 ); \
+  t3 = V_UNPACKHI16( t3, i7 ); \
+  i6 = V_UNPACKLO16( i6, i7 ); \
+  t0 = V_UNPACKHI16( t0, i1 ); \
+  t1 = V_UNPACKHI16( t1, i3 ); \
+  i2 = V_UNPACKLO16( i2, i3 ); \
+  i0 = V_UNPACKLO16( i0, i1 ); \
+  t0 = V_SHUF32( t0, 216 ); \
+  t1 = V_SHUF32( t1, 216 ); \
+  t2 = V_SHUF32( t2, 216 ); \
+  t3 = V_SHUF32( t3, 216 ); \
+  i0 = V_SHUF32( i0, 216 ); \
+  i2 = V_SHUF32( i2, 216 ); \
+  i4 = V_SHUF32( i4, 216 ); \
+  i6 = V_SHUF32( i6, 216 ); \
+  t4 = i0; \
+  i0 = V_UNPACKLO32( i0, i2 ); \
+  t4 = V_UNPACKHI32( t4, i2 ); \
+  t5 = t0; \
+  t0 = V_UNPACKLO32( t0, t1 ); \
+  t5 = V_UNPACKHI32( t5, t1 ); \
+  t6 = i4; \
+  i4 = V_UNPACKLO32( i4, i6 ); \
+  t7 = t2; \
+  t6 = V_UNPACKHI32( t6, i6 ); \
+  i2 = t0; \
+  t2 = V_UNPACKLO32( t2, t3 ); \
+  i3 = t0; \
+  t7 = V_UNPACKHI32( t7, t3 ); \
+  i1 = i0; \
+  i1 = V_UNPACKHI64( i1, i4 ); \
+  i0 = V_UNPACKLO64( i0, i4 ); \
+  i4 = t4; \
+  i3 = V_UNPACKHI64( i3, t2 ); \
+  i5 = t4; \
+  i2 = V_UNPACKLO64( i2, t2 ); \
+  i6 = t5; \
+  i5 = V_UNPACKHI64( i5, t6 ); \
+  i7 = t5; \
+  i4 = V_UNPACKLO64( i4, t6 ); \
+  i7 = V_UNPACKHI64( i7, t7 ); \
+  i6 = V_UNPACKLO64( i6, t7 ); \
+} while (0)
+
+// One row per register back to two columns per register, the output is
+// (i0, o0, i1, i3, o1, o2, i5, i7).
+#define GV_TRANSPOSE_INV( i0, i1, i2, i3, i4, i5, i6, i7, \
+                          o0, o1, o2, t0, t1, t2, t3, t4 ) \
+do { \
+  o1 = i0; \
+  i0 = V_UNPACKLO64( i0, i1 ); \
+  o1 = V_UNPACKHI64( o1, i1 ); \
+  t0 = i2; \
+  i2 = V_UNPACKLO64( i2, i3 ); \
+  t0 = V_UNPACKHI64( t0, i3 ); \
+  t1 = i4; \
+  i4 = V_UNPACKLO64( i4, i5 ); \
+  t1 = V_UNPACKHI64( t1, i5 ); \
+  t2 = i6; \
+  o0 = transp; \
+  i6 = V_UNPACKLO64( i6, i7 ); \
+  t2 = V_UNPACKHI64( t2, i7 ); \
+  i0 = V_SHUF8( i0, o0 ); \
+  i2 = V_SHUF8( i2, o0 ); \
+  i4 = V_SHUF8( i4, o0 ); \
+  i6 = V_SHUF8( i6, o0 ); \
+  o1 = V_SHUF8( o1, o0 ); \
+  t0 = V_SHUF8( t0, o0 ); \
+  t1 = V_SHUF8( t1, o0 ); \
+  t2 = V_SHUF8( t2, o0 ); \
+  t3 = i4; \
+  o2 = o1; \
+  o0 = i0; \
+  t4 = t1; \
+  t3 = V_UNPACKHI16( t3, i6 ); \
+  i4 = V_UNPACKLO16( i4, i6 ); \
+  o0 = V_UNPACKHI16( o0, i2 ); \
+  i0 = V_UNPACKLO16( i0, i2 ); \
+  o2 = V_UNPACKHI16( o2, t0 ); \
+  o1 = V_UNPACKLO16( o1, t0 ); \
+  t4 = V_UNPACKHI16( t4, t2 ); \
+  t1 = V_UNPACKLO16( t1, t2 ); \
+  i4 = V_SHUF32( i4, 216 ); \
+  t3 = V_SHUF32( t3, 216 ); \
+  o1 = V_SHUF32( o1, 216 ); \
+  o2 = V_SHUF32( o2, 216 ); \
+  i0 = V_SHUF32( i0, 216 ); \
+  o0 = V_SHUF32( o0, 216 ); \
+  t1 = V_SHUF32( t1, 216 ); \
+  t4 = V_SHUF32( t4, 216 ); \
+  i1 = i0; \
+  i3 = o0; \
+  i5 = o1; \
+  i7 = o2; \
+  i0 = V_UNPACKLO32( i0, i4 ); \
+  i1 = V_UNPACKHI32( i1, i4 ); \
+  o0 = V_UNPACKLO32( o0, t3 ); \
+  i3 = V_UNPACKHI32( i3, t3 ); \
+  o1 = V_UNPACKLO32( o1, t1 ); \
+  i5 = V_UNPACKHI32( i5, t1 ); \
+  o2 = V_UNPACKLO32( o2, t4 ); \
+  i7 = V_UNPACKHI32( i7, t4 ); \
+} while (0)
+
+#endif
+
+// hash[i] holds len bytes of lane i, at most 119, and gets the digest.
+KERNEL_TARGET
+static void KERNEL_NAME( void * const hash[], int len )
+{
+   __m128i blk[8][LANES] __attribute__ ((aligned (64)));
+   V x0, x1, x2, x3, x4, x5, x6, x7;
+   V x8, x9, x10, x11, x12, x13, x14, x15;
+   V cv[8], qt[8];
+   V TEMP0, TEMP1, TEMP2;
+   V subsh[8];
+   const V transp = V_BCAST( _mm_set_epi32( 0x0f070b03, 0x0e060a02,
+                                            0x0d050901, 0x0c040800 ) );
+   const V all_1b = V_SET1_32( 0x1b1b1b1b );
+   const V all_ff = V_SET1_32( 0xffffffff );
+   const V rc_p = V_BCAST( _mm_set_epi32( 0xf0e0d0c0, 0xb0a09080,
+                                          0x70605040, 0x30201000 ) );
+   const V rc_q = V_BCAST( _mm_set_epi32( 0x0f1f2f3f, 0x4f5f6f7f,
+                                          0x8f9fafbf, 0xcfdfefff ) );
+
+   subsh[0] = V_BCAST( _mm_set_epi32( 0x0306090c, 0x0f020508,
+                                      0x0b0e0104, 0x070a0d00 ) );
+   subsh[1] = V_BCAST( _mm_set_epi32( 0x04070a0d, 0x00030609,
+                                      0x0c0f0205, 0x080b0e01 ) );
+   subsh[2] = V_BCAST( _mm_set_epi32( 0x05080b0e, 0x0104070a,
+                                      0x0d000306, 0x090c0f02 ) );
+   subsh[3] = V_BCAST( _mm_set_epi32( 0x06090c0f, 0x0205080b,
+                                      0x0e010407, 0x0a0d0003 ) );
+   subsh[4] = V_BCAST( _mm_set_epi32( 0x070a0d00, 0x0306090c,
+                                      0x0f020508, 0x0b0e0104 ) );
+   subsh[5] = V_BCAST( _mm_set_epi32( 0x080b0e01, 0x04070a0d,
+                                      0x00030609, 0x0c0f0205 ) );
+   subsh[6] = V_BCAST( _mm_set_epi32( 0x090c0f02, 0x05080b0e,
+                                      0x0104070a, 0x0d000306 ) );
+   subsh[7] = V_BCAST( _mm_set_epi32( 0x0e010407, 0x0a0d0003,
+                                      0x06090c0f, 0x0205080b ) );
+
+   // padded message, one block per lane, the block count is 1
+   for ( int l = 0; l < LANES; l++ )
+   {
+      unsigned char b[128];
+      memcpy( b, hash[l], len );
+      b[len] = 0x80;
+      memset( b + len + 1, 0, 127 - len - 1 );
+      b[127] = 1;
+      for ( int j = 0; j < 8; j++ )
+         blk[j][l] = _mm_loadu_si128( (const __m128i*)b + j );
+   }
+
+   // IV, the output size in the last column, in row ordering
+   x8 = x9 = x10 = x11 = x12 = x13 = x14 = V_ZERO;
+   x15 = V_BCAST( _mm_set_epi32( 0x00020000, 0, 0, 0 ) );
+   GV_TRANSPOSE( x8, x9, x10, x11, x12, x13, x14, x15,
+                 x0, x1, x2, x3, x4, x5, x6, x7 );
+   cv[0] = x8;  cv[1] = x9;  cv[2] = x10; cv[3] = x11;
+   cv[4] = x12; cv[5] = x13; cv[6] = x14; cv[7] = x15;
+
+   // TF1024, P(CV+M)+CV+Q(M)
+   x8  = V_LOAD( blk[0] );
+   x9  = V_LOAD( blk[1] );
+   x10 = V_LOAD( blk[2] );
+   x11 = V_LOAD( blk[3] );
+   x12 = V_LOAD( blk[4] );
+   x13 = V_LOAD( blk[5] );
+   x14 = V_LOAD( blk[6] );
+   x15 = V_LOAD( blk[7] );
+   GV_TRANSPOSE( x8, x9, x10, x11, x12, x13, x14, x15,
+                 x0, x1, x2, x3, x4, x5, x6, x7 );
+   qt[0] = x8;  qt[1] = x9;  qt[2] = x10; qt[3] = x11;
+   qt[4] = x12; qt[5] = x13; qt[6] = x14; qt[7] = x15;
+
+   x8  = V_XOR( x8,  cv[0] );
+   x9  = V_XOR( x9,  cv[1] );
+   x10 = V_XOR( x10, cv[2] );
+   x11 = V_XOR( x11, cv[3] );
+   x12 = V_XOR( x12, cv[4] );
+   x13 = V_XOR( x13, cv[5] );
+   x14 = V_XOR( x14, cv[6] );
+   x15 = V_XOR( x15, cv[7] );
+   GV_ROUNDS_P();
+   cv[0] = V_XOR( x8,  cv[0] );
+   cv[1] = V_XOR( x9,  cv[1] );
+   cv[2] = V_XOR( x10, cv[2] );
+   cv[3] = V_XOR( x11, cv[3] );
+   cv[4] = V_XOR( x12, cv[4] );
+   cv[5] = V_XOR( x13, cv[5] );
+   cv[6] = V_XOR( x14, cv[6] );
+   cv[7] = V_XOR( x15, cv[7] );
+
+   x8  = qt[0]; x9  = qt[1]; x10 = qt[2]; x11 = qt[3];
+   x12 = qt[4]; x13 = qt[5]; x14 = qt[6]; x15 = qt[7];
+   GV_ROUNDS_Q();
+   cv[0] = x8  = V_XOR( x8,  cv[0] );
+   cv[1] = x9  = V_XOR( x9,  cv[1] );
+   cv[2] = x10 = V_XOR( x10, cv[2] );
+   cv[3] = x11 = V_XOR( x11, cv[3] );
+   cv[4] = x12 = V_XOR( x12, cv[4] );
+   cv[5] = x13 = V_XOR( x13, cv[5] );
+   cv[6] = x14 = V_XOR( x14, cv[6] );
+   cv[7] = x15 = V_XOR( x15, cv[7] );
+
+   // OF1024, P(CV)+CV truncated to the last 512 bits
+   GV_ROUNDS_P();
+   x8  = V_XOR( x8,  cv[0] );
+   x9  = V_XOR( x9,  cv[1] );
+   x10 = V_XOR( x10, cv[2] );
+   x11 = V_XOR( x11, cv[3] );
+   x12 = V_XOR( x12, cv[4] );
+   x13 = V_XOR( x13, cv[5] );
+   x14 = V_XOR( x14, cv[6] );
+   x15 = V_XOR( x15, cv[7] );
+   GV_TRANSPOSE_INV( x8, x9, x10, x11, x12, x13, x14, x15,
+                     x4, x0, x6, x1, x2, x3, x5, x7 );
+
+   V_STORE( blk[0], x0 );
+   V_STORE( blk[1], x6 );
+   V_STORE( blk[2], x13 );
+   V_STORE( blk[3], x15 );
+   for ( int l = 0; l < LANES; l++ )
+      for ( int j = 0; j < 4; j++ )
+         _mm_storeu_si128( (__m128i*)hash[l] + j, blk[j][l] );
+}
@@ -0,0 +1,160 @@
+#include <string.h>
+#include <immintrin.h>
+
+#include "miner.h"
+#include "groestl-hash-4way.h"
+
+#ifdef NO_AES_NI
+  #include "sph_groestl.h"
+#else
+  #include "aes_ni/hash-groestl.h"
+#endif
+
+// The kernels are built with target attributes rather than build flags so
+// one binary carries them and uses them only on cpus that have VAES.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) \
+    && ( __GNUC__ >= 8 )
+  #define GROESTL_VAES 1
+#endif
+
+#if defined(GROESTL_VAES)
+
+// 2 lanes, ymm
+
+#define V                   __m256i
+#define LANES               2
+#define KERNEL_TARGET       __attribute__ ((target("avx2,vaes")))
+#define KERNEL_NAME         groestl512_2way_vaes
+#define V_ZERO              _mm256_setzero_si256()
+#define V_LOAD( p )         _mm256_load_si256( (const __m256i*)(p) )
+#define V_STORE( p, x )     _mm256_store_si256( (__m256i*)(p), x )
+#define V_BCAST( x )        _mm256_broadcastsi128_si256( x )
+#define V_SET1_32( x )      _mm256_set1_epi32( x )
+#define V_XOR               _mm256_xor_si256
+#define V_SHUF8             _mm256_shuffle_epi8
+#define V_SHUF32            _mm256_shuffle_epi32
+#define V_UNPACKLO16        _mm256_unpacklo_epi16
+#define V_UNPACKHI16        _mm256_unpackhi_epi16
+#define V_UNPACKLO32        _mm256_unpacklo_epi32
+#define V_UNPACKHI32        _mm256_unpackhi_epi32
+#define V_UNPACKLO64        _mm256_unpacklo_epi64
+#define V_UNPACKHI64        _mm256_unpackhi_epi64
+#define V_AESENCLAST        _mm256_aesenclast_epi128
+// i *= 2 in GF(2^8) for every byte, j is scratch, k all 0x1b
+#define V_MUL2( i, j, k ) \
+do { \
+   j = _mm256_and_si256( _mm256_cmpgt_epi8( V_ZERO, i ), k ); \
+   i = _mm256_xor_si256( _mm256_add_epi8( i, i ), j ); \
+} while (0)
+
+#include "groestl-hash-4way-kernel.h"
+
+#undef V
+#undef LANES
+#undef KERNEL_TARGET
+#undef KERNEL_NAME
+#undef V_ZERO
+#undef V_LOAD
+#undef V_STORE
+#undef V_BCAST
+#undef V_SET1_32
+#undef V_XOR
+#undef V_SHUF8
+#undef V_SHUF32
+#undef V_UNPACKLO16
+#undef V_UNPACKHI16
+#undef V_UNPACKLO32
+#undef V_UNPACKHI32
+#undef V_UNPACKLO64
+#undef V_UNPACKHI64
+#undef V_AESENCLAST
+#undef V_MUL2
+
+// 4 lanes, zmm
+
+#define V                   __m512i
+#define LANES               4
+#define KERNEL_TARGET       __attribute__ ((target("avx512f,avx512bw,vaes")))
+#define KERNEL_NAME         groestl512_4way_vaes
+#define V_ZERO              _mm512_setzero_si512()
+#define V_LOAD( p )         _mm512_load_si512( (const void*)(p) )
+#define V_STORE( p, x )     _mm512_store_si512( (void*)(p), x )
+#define V_BCAST( x )        _mm512_broadcast_i32x4( x )
+#define V_SET1_32( x )      _mm512_set1_epi32( x )
+#define V_XOR               _mm512_xor_si512
+#define V_SHUF8             _mm512_shuffle_epi8
+#define V_SHUF32            _mm512_shuffle_epi32
+#define V_UNPACKLO16        _mm512_unpacklo_epi16
+#define V_UNPACKHI16        _mm512_unpackhi_epi16
+#define V_UNPACKLO32        _mm512_unpacklo_epi32
+#define V_UNPACKHI32        _mm512_unpackhi_epi32
+#define V_UNPACKLO64        _mm512_unpacklo_epi64
+#define V_UNPACKHI64        _mm512_unpackhi_epi64
+#define V_AESENCLAST        _mm512_aesenclast_epi128
+#define V_MUL2( i, j, k ) \
+do { \
+   j = _mm512_maskz_mov_epi8( _mm512_movepi8_mask( i ), k ); \
+   i = _mm512_xor_si512( _mm512_add_epi8( i, i ), j ); \
+} while (0)
+
+#include "groestl-hash-4way-kernel.h"
+
+#endif   // GROESTL_VAES
+
+static void groestl512_x4_aesni( void * const hash[4], int len )
+{
+   for ( int i = 0; i < 4; i++ )
+   {
+#ifdef NO_AES_NI
+      sph_groestl512_context ctx;
+      sph_groestl512_init( &ctx );
+      sph_groestl512( &ctx, hash[i], len );
+      sph_groestl512_close( &ctx, hash[i] );
+#else
+      if ( len == 64 )
+         groestl512_64( hash[i], hash[i] );
+      else
+      {
+         hashState_groestl ctx;
+         init_groestl( &ctx );
+         update_groestl( &ctx, (const BitSequence_gr*)hash[i],
+                         (DataLength_gr)len << 3 );
+         final_groestl( &ctx, (BitSequence_gr*)hash[i] );
+      }
+#endif
+   }
+}
+
+#if defined(GROESTL_VAES)
+
+static void groestl512_x4_2way( void * const hash[4], int len )
+{
+   groestl512_2way_vaes( hash, len );
+   groestl512_2way_vaes( hash + 2, len );
+}
+
+static void groestl512_x4_4way( void * const hash[4], int len )
+{
+   groestl512_4way_vaes( hash, len );
+}
+
+#endif
+
+static void ( *groestl512_x4_fn )( void * const*, int ) = NULL;
+
+void groestl512_x4( void * const hash[4], int len )
+{
+   // Every thread picks the same kernel, a racing first call is harmless.
+   if ( !groestl512_x4_fn )
+   {
+#if defined(GROESTL_VAES)
+      if ( has_vaes() && has_avx512() )
+         groestl512_x4_fn = groestl512_x4_4way;
+      else if ( has_vaes() )
+         groestl512_x4_fn = groestl512_x4_2way;
+      else
+#endif
+         groestl512_x4_fn = groestl512_x4_aesni;
+   }
+   groestl512_x4_fn( hash, len );
+}
@@ -0,0 +1,15 @@
+#ifndef GROESTL_HASH_4WAY_H__
+#define GROESTL_HASH_4WAY_H__
+
+// Groestl-512 of 4 independent short messages. With VAES the messages run
+// side by side, one per 128 bit lane of a zmm register (AVX512BW) or two
+// per ymm register (AVX2), otherwise one at a time with AES-NI. The kernel
+// is picked at run time on the first call.
+//
+// hash[i] holds len bytes of message i on entry and its 64 byte digest on
+// return. len is at most 119 so the padded message is a single block,
+// which covers the 64 byte chain stages and 80 byte block headers.
+
+void groestl512_x4( void * const hash[4], int len );
+
+#endif
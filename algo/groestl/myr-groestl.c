@@ -10,6 +10,7 @@
   #include "sph_groestl.h"
 #else
   #include "aes_ni/hash-groestl.h"
+  #include "groestl-hash-4way.h"
 #endif
 #include "algo/sha3/sph_sha2.h"
 
@@ -50,7 +51,7 @@ void myriadhash(void *output, const void *input)
 	sph_groestl512(&ctx.groestl, input, 80);
 	sph_groestl512_close(&ctx.groestl, hash);
 #else
-        update_groestl( &ctx.groestl, (char*)hash,512);
+        update_groestl( &ctx.groestl, (const char*)input, 640 );
         final_groestl( &ctx.groestl, (char*)hash);
 #endif
 
@@ -62,6 +63,29 @@ void myriadhash(void *output, const void *input)
 
 }
 
+#ifndef NO_AES_NI
+
+// input is 4 consecutive 80 byte headers, output 4 consecutive hashes.
+static void myriadhash_4way( void *output, const void *input )
+{
+     uint32_t _ALIGN(64) hash[4][32];
+     void * const lanes[4] = { hash[0], hash[1], hash[2], hash[3] };
+     sph_sha256_context ctx_sha;
+
+     for ( int i = 0; i < 4; i++ )
+        memcpy( hash[i], (const char*)input + 80*i, 80 );
+     groestl512_x4( lanes, 80 );
+
+     for ( int i = 0; i < 4; i++ )
+     {
+        memcpy( &ctx_sha, &myrgr_ctx.sha, sizeof(ctx_sha) );
+        sph_sha256( &ctx_sha, hash[i], 64 );
+        sph_sha256_close( &ctx_sha, (char*)output + 32*i );
+     }
+}
+
+#endif
+
 int scanhash_myriad(int thr_id, struct work *work,
 	uint32_t max_nonce, uint64_t *hashes_done)
 {
@@ -78,6 +102,34 @@ int scanhash_myriad(int thr_id, struct work *work,
 	for (int k=0; k < 20; k++)
 		be32enc(&endiandata[k], ((uint32_t*)pdata)[k]);
 
+#ifndef NO_AES_NI
+	// Groestl takes 4 nonces at a time, with VAES they run side by side.
+	// The odd nonces at the end go through the single lane loop below.
+	{
+		uint32_t _ALIGN(64) data4[4][20];
+		uint32_t _ALIGN(64) hash4[4][8];
+		const uint32_t Htarg = ptarget[7];
+
+		for ( int i = 0; i < 4; i++ )
+			memcpy( data4[i], endiandata, 80 );
+		while ( nonce < max_nonce && max_nonce - nonce > 4
+		        && !work_restart[thr_id].restart )
+		{
+			for ( int i = 0; i < 4; i++ )
+				be32enc( &data4[i][19], nonce + i );
+			myriadhash_4way( hash4, data4 );
+			for ( int i = 0; i < 4; i++ )
+			if ( hash4[i][7] <= Htarg && fulltest( hash4[i], ptarget ) )
+			{
+				pdata[19] = nonce + i;
+				*hashes_done = pdata[19] - first_nonce;
+				return 1;
+			}
+			nonce += 4;
+		}
+	}
+#endif
+
 	do {
 		const uint32_t Htarg = ptarget[7];
 		uint32_t hash[8];
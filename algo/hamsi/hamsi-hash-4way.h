@@ -0,0 +1,13 @@
+#ifndef HAMSI_HASH_4WAY_H__
+#define HAMSI_HASH_4WAY_H__
+
+// Hamsi-512 of 4 independent messages. With AVX2 they run side by side,
+// one per 64 bit element of a ymm register, otherwise one at a time with
+// sph_hamsi512.
+//
+// hash[i] holds len bytes of message i on entry and its 64 byte digest on
+// return, len is a multiple of 8.
+
+void hamsi512_x4( void * const hash[4], int len );
+
+#endif
@@ -0,0 +1,261 @@
+#include <string.h>
+
+#include "miner.h"
+#include "haval-hash-4way.h"
+
+#if defined(__SSE2__)
+
+#include "avxdefs.h"
+
+// The boolean functions and phi permutations of haval.c for 5 passes.
+
+#define F1( x6, x5, x4, x3, x2, x1, x0 ) \
+   _mm_xor_si128( _mm_xor_si128( \
+         _mm_and_si128( x1, _mm_xor_si128( x0, x4 ) ), \
+         _mm_and_si128( x2, x5 ) ), \
+      _mm_xor_si128( _mm_and_si128( x3, x6 ), x0 ) )
+
+#define F2( x6, x5, x4, x3, x2, x1, x0 ) \
+   _mm_xor_si128( _mm_xor_si128( \
+         _mm_and_si128( x2, _mm_xor_si128( _mm_xor_si128( \
+                  _mm_andnot_si128( x3, x1 ), _mm_and_si128( x4, x5 ) ), \
+               _mm_xor_si128( x6, x0 ) ) ), \
+         _mm_and_si128( x4, _mm_xor_si128( x1, x5 ) ) ), \
+      _mm_xor_si128( _mm_and_si128( x3, x5 ), x0 ) )
+
+#define F3( x6, x5, x4, x3, x2, x1, x0 ) \
+   _mm_xor_si128( _mm_xor_si128( \
+         _mm_and_si128( x3, _mm_xor_si128( _mm_and_si128( x1, x2 ), \
+                                           _mm_xor_si128( x6, x0 ) ) ), \
+         _mm_and_si128( x1, x4 ) ), \
+      _mm_xor_si128( _mm_and_si128( x2, x5 ), x0 ) )
+
+#define F4( x6, x5, x4, x3, x2, x1, x0 ) \
+   _mm_xor_si128( _mm_xor_si128( \
+         _mm_and_si128( x3, _mm_xor_si128( _mm_xor_si128( \
+                  _mm_and_si128( x1, x2 ), _mm_or_si128( x4, x6 ) ), x5 ) ), \
+         _mm_and_si128( x4, _mm_xor_si128( _mm_xor_si128( \
+                  _mm_andnot_si128( x2, x5 ), x1 ), \
+               _mm_xor_si128( x6, x0 ) ) ) ), \
+      _mm_xor_si128( _mm_and_si128( x2, x6 ), x0 ) )
+
+#define F5( x6, x5, x4, x3, x2, x1, x0 ) \
+   _mm_xor_si128( _mm_xor_si128( \
+         _mm_andnot_si128( _mm_xor_si128( \
+               _mm_and_si128( _mm_and_si128( x1, x2 ), x3 ), x5 ), x0 ), \
+         _mm_and_si128( x1, x4 ) ), \
+      _mm_xor_si128( _mm_and_si128( x2, x5 ), _mm_and_si128( x3, x6 ) ) )
+
+#define FP5_1( x6, x5, x4, x3, x2, x1, x0 )   F1( x3, x4, x1, x0, x5, x2, x6 )
+#define FP5_2( x6, x5, x4, x3, x2, x1, x0 )   F2( x6, x2, x1, x0, x3, x4, x5 )
+#define FP5_3( x6, x5, x4, x3, x2, x1, x0 )   F3( x2, x6, x0, x4, x3, x1, x5 )
+#define FP5_4( x6, x5, x4, x3, x2, x1, x0 )   F4( x1, x5, x3, x2, x0, x4, x6 )
+#define FP5_5( x6, x5, x4, x3, x2, x1, x0 )   F5( x2, x5, x0, x6, x4, x3, x1 )
+
+#define STEP( p, x7, x6, x5, x4, x3, x2, x1, x0, w ) \
+do { \
+   const __m128i t_ = FP5_ ## p( x6, x5, x4, x3, x2, x1, x0 ); \
+   x7 = _mm_add_epi32( _mm_add_epi32( mm_rotr_32( t_, 7 ), \
+                                      mm_rotr_32( x7, 11 ) ), w ); \
+} while (0)
+
+// One pass, in( i ) is message word i plus the step constant.
+#define PASS( p, in ) \
+   for ( int i = 0; i < 32; i += 8 ) \
+   { \
+      STEP( p, s7, s6, s5, s4, s3, s2, s1, s0, in( i     ) ); \
+      STEP( p, s6, s5, s4, s3, s2, s1, s0, s7, in( i + 1 ) ); \
+      STEP( p, s5, s4, s3, s2, s1, s0, s7, s6, in( i + 2 ) ); \
+      STEP( p, s4, s3, s2, s1, s0, s7, s6, s5, in( i + 3 ) ); \
+      STEP( p, s3, s2, s1, s0, s7, s6, s5, s4, in( i + 4 ) ); \
+      STEP( p, s2, s1, s0, s7, s6, s5, s4, s3, in( i + 5 ) ); \
+      STEP( p, s1, s0, s7, s6, s5, s4, s3, s2, in( i + 6 ) ); \
+      STEP( p, s0, s7, s6, s5, s4, s3, s2, s1, in( i + 7 ) ); \
+   }
+
+static const uint8_t haval_MP2[32] = {
+    5, 14, 26, 18, 11, 28,  7, 16,
+    0, 23, 20, 22,  1, 10,  4,  8,
+   30,  3, 21,  9, 17, 24, 29,  6,
+   19, 12, 15, 13,  2, 25, 31, 27
+};
+
+static const uint8_t haval_MP3[32] = {
+   19,  9,  4, 20, 28, 17,  8, 22,
+   29, 14, 25, 12, 24, 30, 16, 26,
+   31, 15,  7,  3,  1,  0, 18, 27,
+   13,  6, 21, 10, 23, 11,  5,  2
+};
+
+static const uint8_t haval_MP4[32] = {
+   24,  4,  0, 14,  2,  7, 28, 23,
+   26,  6, 30, 20, 18, 25, 19,  3,
+   22, 11, 31, 21,  8, 27, 12,  9,
+    1, 29,  5, 15, 17, 10, 16, 13
+};
+
+static const uint8_t haval_MP5[32] = {
+   27,  3, 21, 26, 17, 11, 20, 29,
+   19,  0, 12,  7, 13,  8, 31, 10,
+    5,  9, 14, 30, 18,  6, 28, 24,
+    2, 23, 16, 22,  4,  1, 25, 15
+};
+
+static const uint32_t haval_RK2[32] = {
+   0x452821E6, 0x38D01377, 0xBE5466CF, 0x34E90C6C,
+   0xC0AC29B7, 0xC97C50DD, 0x3F84D5B5, 0xB5470917,
+   0x9216D5D9, 0x8979FB1B, 0xD1310BA6, 0x98DFB5AC,
+   0x2FFD72DB, 0xD01ADFB7, 0xB8E1AFED, 0x6A267E96,
+   0xBA7C9045, 0xF12C7F99, 0x24A19947, 0xB3916CF7,
+   0x0801F2E2, 0x858EFC16, 0x636920D8, 0x71574E69,
+   0xA458FEA3, 0xF4933D7E, 0x0D95748F, 0x728EB658,
+   0x718BCD58, 0x82154AEE, 0x7B54A41D, 0xC25A59B5
+};
+
+static const uint32_t haval_RK3[32] = {
+   0x9C30D539, 0x2AF26013, 0xC5D1B023, 0x286085F0,
+   0xCA417918, 0xB8DB38EF, 0x8E79DCB0, 0x603A180E,
+   0x6C9E0E8B, 0xB01E8A3E, 0xD71577C1, 0xBD314B27,
+   0x78AF2FDA, 0x55605C60, 0xE65525F3, 0xAA55AB94,
+   0x57489862, 0x63E81440, 0x55CA396A, 0x2AAB10B6,
+   0xB4CC5C34, 0x1141E8CE, 0xA15486AF, 0x7C72E993,
+   0xB3EE1411, 0x636FBC2A, 0x2BA9C55D, 0x741831F6,
+   0xCE5C3E16, 0x9B87931E, 0xAFD6BA33, 0x6C24CF5C
+};
+
+static const uint32_t haval_RK4[32] = {
+   0x7A325381, 0x28958677, 0x3B8F4898, 0x6B4BB9AF,
+   0xC4BFE81B, 0x66282193, 0x61D809CC, 0xFB21A991,
+   0x487CAC60, 0x5DEC8032, 0xEF845D5D, 0xE98575B1,
+   0xDC262302, 0xEB651B88, 0x23893E81, 0xD396ACC5,
+   0x0F6D6FF3, 0x83F44239, 0x2E0B4482, 0xA4842004,
+   0x69C8F04A, 0x9E1F9B5E, 0x21C66842, 0xF6E96C9A,
+   0x670C9C61, 0xABD388F0, 0x6A51A0D2, 0xD8542F68,
+   0x960FA728, 0xAB5133A3, 0x6EEF0B6C, 0x137A3BE4
+};
+
+static const uint32_t haval_RK5[32] = {
+   0xBA3BF050, 0x7EFB2A98, 0xA1F1651D, 0x39AF0176,
+   0x66CA593E, 0x82430E88, 0x8CEE8619, 0x456F9FB4,
+   0x7D84A5C3, 0x3B8B5EBE, 0xE06F75D8, 0x85C12073,
+   0x401A449F, 0x56C16AA6, 0x4ED3AA62, 0x363F7706,
+   0x1BFEDF72, 0x429B023D, 0x37D0D724, 0xD00A1248,
+   0xDB0FEAD3, 0x49F1C09B, 0x075372C9, 0x80991B7B,
+   0x25D479D8, 0xF6E8DEF7, 0xE3FE501A, 0xB6794C3B,
+   0x976CE0BD, 0x04C006BA, 0xC1A94FB6, 0x409F60C4
+};
+
+static const uint32_t haval_IV[8] = {
+   0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344,
+   0xA4093822, 0x299F31D0, 0x082EFA98, 0xEC4E6C89
+};
+
+#define IN1( i )   w[i]
+#define IN2( i ) \
+   _mm_add_epi32( w[ haval_MP2[i] ], _mm_set1_epi32( haval_RK2[i] ) )
+#define IN3( i ) \
+   _mm_add_epi32( w[ haval_MP3[i] ], _mm_set1_epi32( haval_RK3[i] ) )
+#define IN4( i ) \
+   _mm_add_epi32( w[ haval_MP4[i] ], _mm_set1_epi32( haval_RK4[i] ) )
+#define IN5( i ) \
+   _mm_add_epi32( w[ haval_MP5[i] ], _mm_set1_epi32( haval_RK5[i] ) )
+
+// One 128 byte block of message words w into the state s.
+static void haval256_5_4way_core( __m128i *s, const __m128i *w )
+{
+   __m128i s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3],
+           s4 = s[4], s5 = s[5], s6 = s[6], s7 = s[7];
+
+   PASS( 1, IN1 );
+   PASS( 2, IN2 );
+   PASS( 3, IN3 );
+   PASS( 4, IN4 );
+   PASS( 5, IN5 );
+
+   s[0] = _mm_add_epi32( s[0], s0 );
+   s[1] = _mm_add_epi32( s[1], s1 );
+   s[2] = _mm_add_epi32( s[2], s2 );
+   s[3] = _mm_add_epi32( s[3], s3 );
+   s[4] = _mm_add_epi32( s[4], s4 );
+   s[5] = _mm_add_epi32( s[5], s5 );
+   s[6] = _mm_add_epi32( s[6], s6 );
+   s[7] = _mm_add_epi32( s[7], s7 );
+}
+
+// The interleaved 4x32 digests of the 4 messages in hash into s.
+static void haval256_5_4way_state( __m128i *s, void * const hash[4],
+                                   int len )
+{
+   uint32_t buf[4][64] __attribute__ ((aligned (64)));
+   __m128i w[32];
+   const int nblk = ( len + 138 ) / 128;
+
+   // a 1 bit, zeros, the pass count, the digest size and the 64 bit length
+   // little endian end the last block
+   for ( int l = 0; l < 4; l++ )
+   {
+      unsigned char *b = (unsigned char*)buf[l];
+      memcpy( b, hash[l], len );
+      b[len] = 0x01;
+      memset( b + len + 1, 0, nblk*128 - len - 1 );
+      b[ nblk*128 - 10 ] = 0x01 | ( 5 << 3 );
+      b[ nblk*128 -  9 ] = 8 << 3;
+      buf[l][ nblk*32 - 2 ] = len << 3;
+   }
+
+   for ( int i = 0; i < 8; i++ )
+      s[i] = _mm_set1_epi32( haval_IV[i] );
+   for ( int n = 0; n < nblk; n++ )
+   {
+      mm_interleave_4x32( w, buf[0] + 32*n, buf[1] + 32*n,
+                             buf[2] + 32*n, buf[3] + 32*n, 1024 );
+      haval256_5_4way_core( s, w );
+   }
+}
+
+#else
+
+#include "sph-haval.h"
+
+#endif
+
+void haval256_5_x4( void * const hash[4], int len )
+{
+#if defined(__SSE2__)
+   __m128i s[8];
+
+   haval256_5_4way_state( s, hash, len );
+   mm_deinterleave_4x32( hash[0], hash[1], hash[2], hash[3], s, 256 );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      sph_haval256_5_context ctx;
+      sph_haval256_5_init( &ctx );
+      sph_haval256_5( &ctx, hash[i], len );
+      sph_haval256_5_close( &ctx, hash[i] );
+   }
+#endif
+}
+
+int haval256_5_x4_target( void * const hash[4], int len,
+                          const uint32_t *target )
+{
+#if defined(__SSE2__)
+   __m128i s[8];
+   int mask;
+
+   haval256_5_4way_state( s, hash, len );
+   mask = fulltest_4x32( s, target );
+   if ( mask )
+      mm_deinterleave_4x32( hash[0], hash[1], hash[2], hash[3], s, 256 );
+   return mask;
+#else
+   int mask = 0;
+
+   haval256_5_x4( hash, len );
+   for ( int i = 0; i < 4; i++ )
+      if ( fulltest( hash[i], target ) )
+         mask |= 1 << i;
+   return mask;
+#endif
+}
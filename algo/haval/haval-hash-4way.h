@@ -0,0 +1,22 @@
+#ifndef HAVAL_HASH_4WAY_H__
+#define HAVAL_HASH_4WAY_H__
+
+#include <stdint.h>
+
+// HAVAL-256 with 5 passes of 4 independent short messages, one message per
+// 32 bit element of an xmm register. Without SSE2 the messages go through
+// sph_haval one at a time.
+//
+// hash[i] holds len bytes of message i on entry and its 32 byte digest on
+// return, len is up to 128.
+
+void haval256_5_x4( void * const hash[4], int len );
+
+// As haval256_5_x4 for the last stage of a chain, the digests are tested
+// against target while still interleaved. Returns the mask of lanes at or
+// below target, hash is only written when it is not 0.
+
+int haval256_5_x4_target( void * const hash[4], int len,
+                          const uint32_t *target );
+
+#endif
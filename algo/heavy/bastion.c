@@ -17,6 +17,14 @@
 #include "algo/hamsi/sph_hamsi.h"
 #include "algo-gate-api.h"
 
+#include "algo/luffa/luffa-hash-2way.h"
+#include "algo/fugue/fugue-hash-4way.h"
+#include "algo/skein/skein-hash-4way.h"
+#include "algo/whirlpool/whirlpool-hash-4way.h"
+#include "algo/shabal/shabal-hash-4way.h"
+#include "algo/echo/echo-hash-4way.h"
+#include "algo/hamsi/hamsi-hash-4way.h"
+
 void bastionhash(void *output, const void *input)
 {
 	unsigned char _ALIGN(128) hash[64] = { 0 };
@@ -102,6 +110,163 @@ void bastionhash(void *output, const void *input)
 	memcpy(output, hash, 32);
 }
 
+// Nonces hashed per batch. Half the stages pick one of two hashes from the
+// digest so far, lanes are grouped by the branch they take and each group
+// runs through the 4 lane kernels.
+#define BASTION_LANES 8
+
+enum { BA_LUFFA, BA_FUGUE, BA_SKEIN, BA_WHIRLPOOL, BA_ECHO, BA_SHABAL,
+       BA_HAMSI };
+
+static void ( * const bastion_x4[] )( void * const*, int ) =
+{
+	[BA_LUFFA]     = luffa512_x4,
+	[BA_FUGUE]     = fugue512_x4,
+	[BA_SKEIN]     = skein512_x4,
+	[BA_WHIRLPOOL] = whirlpool_x4,
+	[BA_ECHO]      = echo512_x4,
+	[BA_SHABAL]    = shabal512_x4,
+	[BA_HAMSI]     = hamsi512_x4
+};
+
+// One lane through one stage.
+static void bastion_stage( unsigned char *hash, int stage )
+{
+	union {
+		sph_luffa512_context luffa;
+		sph_fugue512_context fugue;
+		sph_skein512_context skein;
+		sph_whirlpool_context whirlpool;
+		sph_echo512_context echo;
+		sph_shabal512_context shabal;
+		sph_hamsi512_context hamsi;
+	} ctx;
+
+	switch ( stage )
+	{
+	case BA_LUFFA:
+		sph_luffa512_init( &ctx.luffa );
+		sph_luffa512( &ctx.luffa, hash, 64 );
+		sph_luffa512_close( &ctx.luffa, hash );
+		break;
+	case BA_FUGUE:
+		sph_fugue512_init( &ctx.fugue );
+		sph_fugue512( &ctx.fugue, hash, 64 );
+		sph_fugue512_close( &ctx.fugue, hash );
+		break;
+	case BA_SKEIN:
+		sph_skein512_init( &ctx.skein );
+		sph_skein512( &ctx.skein, hash, 64 );
+		sph_skein512_close( &ctx.skein, hash );
+		break;
+	case BA_WHIRLPOOL:
+		sph_whirlpool_init( &ctx.whirlpool );
+		sph_whirlpool( &ctx.whirlpool, hash, 64 );
+		sph_whirlpool_close( &ctx.whirlpool, hash );
+		break;
+	case BA_ECHO:
+		sph_echo512_init( &ctx.echo );
+		sph_echo512( &ctx.echo, hash, 64 );
+		sph_echo512_close( &ctx.echo, hash );
+		break;
+	case BA_SHABAL:
+		sph_shabal512_init( &ctx.shabal );
+		sph_shabal512( &ctx.shabal, hash, 64 );
+		sph_shabal512_close( &ctx.shabal, hash );
+		break;
+	case BA_HAMSI:
+		sph_hamsi512_init( &ctx.hamsi );
+		sph_hamsi512( &ctx.hamsi, hash, 64 );
+		sph_hamsi512_close( &ctx.hamsi, hash );
+		break;
+	}
+}
+
+// Runs stage on the 64 byte hashes of the n lanes in hash, 4 at a time. A
+// short group is padded with spare lanes, a lone lane goes through sph.
+static void bastion_stage_lanes( unsigned char **hash, int n, int stage )
+{
+	unsigned char spare[4][64] __attribute__ ((aligned (64)));
+
+	for ( int i = 0; i < n; i += 4 )
+	{
+		const int m = n - i < 4 ? n - i : 4;
+		void *lanes[4];
+
+		if ( m == 1 )
+		{
+			bastion_stage( hash[i], stage );
+			continue;
+		}
+		for ( int j = 0; j < 4; j++ )
+			lanes[j] = j < m ? hash[i+j] : spare[j];
+		memset( spare, 0, sizeof spare );
+		bastion_x4[stage]( lanes, 64 );
+	}
+}
+
+// Every lane through the same stage.
+static void bastion_all_lanes( unsigned char hash[][64], int stage )
+{
+	unsigned char *all[BASTION_LANES];
+
+	for ( int l = 0; l < BASTION_LANES; l++ )
+		all[l] = hash[l];
+	bastion_stage_lanes( all, BASTION_LANES, stage );
+}
+
+// Lanes with bit 3 of the first digest byte set run stage1, the others
+// stage0.
+static void bastion_branch_lanes( unsigned char hash[][64], int stage1,
+                                  int stage0 )
+{
+	unsigned char *group[2][BASTION_LANES];
+	int m[2] = { 0, 0 };
+
+	for ( int l = 0; l < BASTION_LANES; l++ )
+	{
+		const int b = !!( hash[l][0] & 0x8 );
+		group[b][ m[b]++ ] = hash[l];
+	}
+	bastion_stage_lanes( group[1], m[1], stage1 );
+	bastion_stage_lanes( group[0], m[0], stage0 );
+}
+
+// bastionhash of data with nonces n to n+7, hefty1 resumes from the state
+// after the first 64 bytes of data.
+static void bastionhash_lanes( uint32_t hash[][8], const HEFTY1_CTX *hefty1,
+                               const uint32_t *data, uint32_t n )
+{
+	unsigned char h[BASTION_LANES][64] __attribute__ ((aligned (64)));
+
+	for ( int l = 0; l < BASTION_LANES; l++ )
+	{
+		HEFTY1_CTX ctx;
+		uint32_t tail[4];
+
+		memcpy( tail, data + 16, 12 );
+		be32enc( &tail[3], n + l );
+		memcpy( &ctx, hefty1, sizeof ctx );
+		HEFTY1_Update( &ctx, tail, 16 );
+		HEFTY1_Final( h[l], &ctx );
+		memset( h[l] + 32, 0, 32 );
+	}
+
+	bastion_all_lanes( h, BA_LUFFA );
+	bastion_branch_lanes( h, BA_FUGUE, BA_SKEIN );
+	bastion_all_lanes( h, BA_WHIRLPOOL );
+	bastion_all_lanes( h, BA_FUGUE );
+	bastion_branch_lanes( h, BA_ECHO, BA_LUFFA );
+	bastion_all_lanes( h, BA_SHABAL );
+	bastion_all_lanes( h, BA_SKEIN );
+	bastion_branch_lanes( h, BA_SHABAL, BA_WHIRLPOOL );
+	bastion_all_lanes( h, BA_SHABAL );
+	bastion_branch_lanes( h, BA_HAMSI, BA_LUFFA );
+
+	for ( int l = 0; l < BASTION_LANES; l++ )
+		memcpy( hash[l], h[l], 32 );
+}
+
 int scanhash_bastion(int thr_id, struct work *work, uint32_t max_nonce, uint64_t *hashes_done)
 {
 	uint32_t _ALIGN(64) hash32[8];
@@ -118,6 +283,28 @@ int scanhash_bastion(int thr_id, struct work *work, uint32_t max_nonce, uint64_t
 		be32enc(&endiandata[i], pdata[i]);
 	}
 
+	{
+		uint32_t _ALIGN(64) hash8[BASTION_LANES][8];
+		HEFTY1_CTX hefty1;
+
+		HEFTY1_Init( &hefty1 );
+		HEFTY1_Update( &hefty1, endiandata, 64 );
+		while ( n < max_nonce && max_nonce - n > BASTION_LANES
+		        && !work_restart[thr_id].restart )
+		{
+			bastionhash_lanes( hash8, &hefty1, endiandata, n );
+			for ( int l = 0; l < BASTION_LANES; l++ )
+			if ( hash8[l][7] < Htarg && fulltest( hash8[l], ptarget ) )
+			{
+				work_set_target_ratio( work, hash8[l] );
+				*hashes_done = n + l - first_nonce + 1;
+				pdata[19] = n + l;
+				return true;
+			}
+			n += BASTION_LANES;
+		}
+	}
+
 	do {
 		be32enc(&endiandata[19], n);
 		bastionhash(hash32, endiandata);
@@ -1,5 +1,4 @@
 #include <string.h>
-#include <openssl/sha.h>
 #include <stdint.h>
 
 #include "miner.h"
@@ -8,6 +7,9 @@
 #include "algo/keccak/sph_keccak.h"
 #include "algo/blake/sph_blake.h"
 #include "algo/groestl/sph_groestl.h"
+#include "algo/sha3/sph_sha2.h"
+#include "algo/keccak/keccak-hash-4way.h"
+#include "algo/groestl/groestl-hash-4way.h"
 
 /* Combines top 64-bits from each hash into a single hash */
 static void combine_hashes(uint32_t *out, uint32_t *hash1, uint32_t *hash2, uint32_t *hash3, uint32_t *hash4)
@@ -29,30 +31,30 @@ static void combine_hashes(uint32_t *out, uint32_t *hash1, uint32_t *hash2, uint
     }
 }
 
+/*
+ * HEFTY1 is new, so take an extra security measure to eliminate
+ * the possiblity of collisions:
+ *
+ *     Hash(x) = SHA256(x + HEFTY1(x))
+ *
+ * N.B. '+' is concatenation.
+ *
+ * Additional security: Do not rely on a single cryptographic hash
+ * function.  Instead, combine the outputs of 4 of the most secure
+ * cryptographic hash functions-- SHA256, KECCAK512, GROESTL512
+ * and BLAKE512.
+ */
 extern void heavyhash(unsigned char* output, const unsigned char* input, int len)
 {
-/*    unsigned char hash1[32];
+    unsigned char hash1[32];
     HEFTY1(input, len, hash1);
 
-// HEFTY1 is new, so take an extra security measure to eliminate
-//     * the possiblity of collisions:
-//     *
-//     *     Hash(x) = SHA256(x + HEFTY1(x))
-//     *
-//     * N.B. '+' is concatenation.
-//
-    unsigned char hash2[32];;
-    SHA256_CTX ctx;
-    SHA256_Init(&ctx);
-    SHA256_Update(&ctx, input, len);
-    SHA256_Update(&ctx, hash1, sizeof(hash1));
-    SHA256_Final(hash2, &ctx);
-
-//   * Additional security: Do not rely on a single cryptographic hash
-//     * function.  Instead, combine the outputs of 4 of the most secure
-//     * cryptographic hash functions-- SHA256, KECCAK512, GROESTL512
-//     * and BLAKE512.
-
+    uint32_t hash2[8];
+    sph_sha256_context shaCtx;
+    sph_sha256_init(&shaCtx);
+    sph_sha256(&shaCtx, input, len);
+    sph_sha256(&shaCtx, hash1, sizeof(hash1));
+    sph_sha256_close(&shaCtx, (void *)&hash2);
 
     uint32_t hash3[16];
     sph_keccak512_context keccakCtx;
@@ -76,16 +78,133 @@ extern void heavyhash(unsigned char* output, const unsigned char* input, int len
     sph_blake512_close(&blakeCtx, (void *)&hash5);
 
     uint32_t *final = (uint32_t *)output;
-    combine_hashes(final, (uint32_t *)hash2, hash3, hash4, hash5);
-*/
+    combine_hashes(final, hash2, hash3, hash4, hash5);
+}
+
+// Every stage of a block header hashes the same 112 bytes, the 80 byte
+// header and its HEFTY1 digest, so each runs as a fixed length kernel.
+#define HEAVY_MSG_LEN 112
+
+// HEFTY1 and SHA-256 state after the first 64 header bytes, they don't
+// depend on the nonce.
+typedef struct {
+    HEFTY1_CTX hefty1;
+    uint32_t sha256[8];
+    bool sha256_4way;   // sha256_transform_4way is set up and usable
+} heavy_midstate;
+
+static void heavy_midstate_init(heavy_midstate *mid, const uint32_t *data)
+{
+    HEFTY1_Init(&mid->hefty1);
+    HEFTY1_Update(&mid->hefty1, data, 64);
+    sha256_init(mid->sha256);
+    sha256_transform(mid->sha256, data, 1);
+#if defined(HAVE_SHA256_4WAY)
+    mid->sha256_4way = sha256_use_4way();
+#else
+    mid->sha256_4way = false;
+#endif
+}
+
+// The second SHA-256 block of the 112 byte message: its last 48 bytes, the
+// 0x80 pad byte and the 896 bit length, as little endian words swapped by
+// sha256_transform.
+static void heavy_sha256_block(uint32_t *W, const unsigned char *msg)
+{
+    memcpy(W, msg + 64, 48);
+    W[12] = 0x00000080;
+    W[13] = W[14] = 0;
+    W[15] = 0x80030000;
+}
+
+// heavyhash of the header data with nonces n to n+3 into hash[0..3].
+static void heavyhash_4way(uint32_t hash[4][8], const heavy_midstate *mid,
+                           const uint32_t *data, uint32_t n)
+{
+    unsigned char _ALIGN(64) msg[4][128];
+    unsigned char _ALIGN(64) kmsg[4][128];
+    unsigned char _ALIGN(64) gmsg[4][128];
+    void * const klanes[4] = { kmsg[0], kmsg[1], kmsg[2], kmsg[3] };
+    void * const glanes[4] = { gmsg[0], gmsg[1], gmsg[2], gmsg[3] };
+    uint32_t sha[4][8];
+
+    for (int l = 0; l < 4; l++) {
+        HEFTY1_CTX hefty1;
+        memcpy(msg[l], data, 76);
+        ((uint32_t *)msg[l])[19] = n + l;
+        memcpy(&hefty1, &mid->hefty1, sizeof hefty1);
+        HEFTY1_Update(&hefty1, msg[l] + 64, 16);
+        HEFTY1_Final(msg[l] + 80, &hefty1);
+        memcpy(kmsg[l], msg[l], HEAVY_MSG_LEN);
+        memcpy(gmsg[l], msg[l], HEAVY_MSG_LEN);
+    }
+
+#if defined(HAVE_SHA256_4WAY)
+    if (mid->sha256_4way) {
+        uint32_t _ALIGN(64) S[8*4];
+        uint32_t _ALIGN(64) W[16*4];
+        for (int l = 0; l < 4; l++) {
+            uint32_t w[16];
+            heavy_sha256_block(w, msg[l]);
+            for (int i = 0; i < 8; i++)
+                S[4*i + l] = mid->sha256[i];
+            for (int i = 0; i < 16; i++)
+                W[4*i + l] = w[i];
+        }
+        sha256_transform_4way(S, W, 1);
+        for (int l = 0; l < 4; l++)
+            for (int i = 0; i < 8; i++)
+                sha[l][i] = S[4*i + l];
+    } else
+#endif
+    for (int l = 0; l < 4; l++) {
+        uint32_t w[16];
+        heavy_sha256_block(w, msg[l]);
+        memcpy(sha[l], mid->sha256, 32);
+        sha256_transform(sha[l], w, 1);
+    }
+
+    keccak512_x4(klanes, HEAVY_MSG_LEN);
+    groestl512_x4(glanes, HEAVY_MSG_LEN);
+
+    for (int l = 0; l < 4; l++) {
+        uint32_t hash2[8], hash5[16];
+        sph_blake512_context blakeCtx;
+        sph_blake512_init(&blakeCtx);
+        sph_blake512(&blakeCtx, msg[l], HEAVY_MSG_LEN);
+        sph_blake512_close(&blakeCtx, (void *)&hash5);
+
+        // the SHA-256 digest as bytes, read as host words
+        for (int i = 0; i < 8; i++)
+            be32enc(&hash2[i], sha[l][i]);
+        combine_hashes(hash[l], hash2, (uint32_t *)kmsg[l],
+                       (uint32_t *)gmsg[l], hash5);
+    }
 }
 
-int scanhash_heavy(int thr_id, uint32_t *pdata, const uint32_t *ptarget,
-                    uint32_t max_nonce, uint64_t *hashes_done)
+int scanhash_heavy(int thr_id, struct work *work, uint32_t max_nonce,
+                   uint64_t *hashes_done)
 {
+    uint32_t *pdata = work->data;
+    const uint32_t *ptarget = work->target;
     uint32_t hash[8];
     uint32_t start_nonce = pdata[19];
-    
+    heavy_midstate mid;
+
+    heavy_midstate_init(&mid, pdata);
+    while (pdata[19] < max_nonce && max_nonce - pdata[19] > 4
+           && !work_restart[thr_id].restart) {
+        uint32_t hash4[4][8];
+        heavyhash_4way(hash4, &mid, pdata, pdata[19]);
+        for (int l = 0; l < 4; l++)
+            if (hash4[l][7] <= ptarget[7] && fulltest(hash4[l], ptarget)) {
+                pdata[19] += l;
+                *hashes_done = pdata[19] - start_nonce;
+                return 1;
+            }
+        pdata[19] += 4;
+    }
+
     do {
         heavyhash((unsigned char *)hash, (unsigned char *)pdata, 80);
     
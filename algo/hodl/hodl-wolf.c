@@ -5,6 +5,7 @@
 
 #include "hodl-wolf.h"
 #include "miner.h"
+#include "algo/sha2/sha512-hash-4way.h"
 //#include "wolf-aes.h"
 
 void GenerateGarbageCore(CacheEntry *Garbage, int ThreadID, int ThreadCount, void *MidHash)
@@ -13,7 +14,23 @@ void GenerateGarbageCore(CacheEntry *Garbage, int ThreadID, int ThreadCount, voi
 	memcpy(TempBuf, MidHash, 32);
 		
 	uint32_t StartChunk = ThreadID * (TOTAL_CHUNKS / ThreadCount);
-	for(uint32_t i = StartChunk; i < StartChunk + (TOTAL_CHUNKS / ThreadCount); ++i)
+	uint32_t EndChunk = StartChunk + (TOTAL_CHUNKS / ThreadCount);
+	uint32_t i = StartChunk;
+
+	// 8 chunks at a time, each message is built in its own chunk and
+	// hashed in place.
+	for(; i + 8 <= EndChunk; i += 8)
+	{
+		void *lanes[8];
+		for(int l = 0; l < 8; ++l)
+		{
+			lanes[l] = ((uint8_t *)Garbage) + ((i + l) * GARBAGE_CHUNK_SIZE);
+			memcpy(lanes[l], TempBuf, 32);
+			((uint32_t *)lanes[l])[0] = i + l;
+		}
+		sha512_x8(lanes, 32);
+	}
+	for(; i < EndChunk; ++i)
 	{
 		TempBuf[0] = i;
 		SHA512((uint8_t *)TempBuf, 32, ((uint8_t *)Garbage) + (i * GARBAGE_CHUNK_SIZE));
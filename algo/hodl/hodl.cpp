@@ -11,6 +11,7 @@
 #include <openssl/aes.h>
 #include <openssl/evp.h>
 #include <openssl/sha.h>
+#include "algo/sha2/sha512-hash-4way.h"
 
 #define BEGIN(a)            ((char*)&(a))
 #define END(a)              ((char*)&((&(a))[1]))
@@ -29,7 +30,22 @@ void SHA512Filler(char *mainMemoryPsuedoRandomData, int threadNumber, uint256 mi
 //        uint32_t chunksToProcess=chunks/totalThreads;
         uint32_t chunksToProcess = chunks / opt_n_threads;
         uint32_t startChunk=threadNumber*chunksToProcess;
-        for( uint32_t i = startChunk; i < startChunk+chunksToProcess;  i++){
+        uint32_t endChunk = startChunk + chunksToProcess;
+        uint32_t i = startChunk;
+        // 8 chunks at a time, each message is built in its own chunk and
+        // hashed in place.
+        for ( ; i + 8 <= endChunk; i += 8 )
+        {
+                void *lanes[8];
+                for ( int l = 0; l < 8; l++ )
+                {
+                        lanes[l] = &mainMemoryPsuedoRandomData[(i+l)*chunkSize];
+                        memcpy( lanes[l], hash_tmp, sizeof(hash_tmp) );
+                        *(uint32_t*)lanes[l] = i + l;
+                }
+                sha512_x8( lanes, sizeof(hash_tmp) );
+        }
+        for( ; i < endChunk;  i++){
         	//This changes the first character of hash_tmp
                 *index = i;
                 SHA512((unsigned char*)hash_tmp, sizeof(hash_tmp), (unsigned char*)&(mainMemoryPsuedoRandomData[i*chunkSize]));
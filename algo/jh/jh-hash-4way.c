@@ -0,0 +1,192 @@
+#include <string.h>
+#include <stdbool.h>
+
+#include "jh-hash-4way.h"
+
+#if defined(__AVX2__)
+
+#include "avxdefs.h"
+#include "sse2/jh_sse2_opt64.h"
+
+// The macros of jh_sse2_opt64.h on ymm, same names with jh2 for jh.
+
+#define jh2CONSTANT(b)   _mm256_set1_epi8((b))
+#define jh2XOR(x,y)      _mm256_xor_si256((x),(y))
+#define jh2AND(x,y)      _mm256_and_si256((x),(y))
+#define jh2ANDNOT(x,y)   _mm256_andnot_si256((x),(y))
+#define jh2OR(x,y)       _mm256_or_si256((x),(y))
+
+#define jh2SWAP1(x) \
+   jh2OR( _mm256_srli_epi16( jh2AND( (x), jh2CONSTANT(0xaa) ), 1 ), \
+          _mm256_slli_epi16( jh2AND( (x), jh2CONSTANT(0x55) ), 1 ) )
+#define jh2SWAP2(x) \
+   jh2OR( _mm256_srli_epi16( jh2AND( (x), jh2CONSTANT(0xcc) ), 2 ), \
+          _mm256_slli_epi16( jh2AND( (x), jh2CONSTANT(0x33) ), 2 ) )
+#define jh2SWAP4(x) \
+   jh2OR( _mm256_srli_epi16( jh2AND( (x), jh2CONSTANT(0xf0) ), 4 ), \
+          _mm256_slli_epi16( jh2AND( (x), jh2CONSTANT(0x0f) ), 4 ) )
+#define jh2SWAP8(x) \
+   _mm256_shuffle_epi8( (x), _mm256_set_epi8( \
+                          14,15,12,13, 10,11, 8, 9,  6, 7, 4, 5,  2, 3, 0, 1, \
+                          14,15,12,13, 10,11, 8, 9,  6, 7, 4, 5,  2, 3, 0, 1 ) )
+#define jh2SWAP16(x) \
+   _mm256_shuffle_epi8( (x), _mm256_set_epi8( \
+                          13,12,15,14,  9, 8,11,10,  5, 4, 7, 6,  1, 0, 3, 2, \
+                          13,12,15,14,  9, 8,11,10,  5, 4, 7, 6,  1, 0, 3, 2 ) )
+#define jh2SWAP32(x)     _mm256_shuffle_epi32((x),_MM_SHUFFLE(2,3,0,1))
+#define jh2SWAP64(x)     _mm256_shuffle_epi32((x),_MM_SHUFFLE(1,0,3,2))
+
+#define jh2L(m0,m1,m2,m3,m4,m5,m6,m7)     \
+      (m4) = jh2XOR((m4),(m1));           \
+      (m5) = jh2XOR((m5),(m2));           \
+      (m6) = jh2XOR(jh2XOR((m6),(m3)),(m0)); \
+      (m7) = jh2XOR((m7),(m0));           \
+      (m0) = jh2XOR((m0),(m5));           \
+      (m1) = jh2XOR((m1),(m6));           \
+      (m2) = jh2XOR(jh2XOR((m2),(m7)),(m4)); \
+      (m3) = jh2XOR((m3),(m4));
+
+#define jh2SS(m0,m1,m2,m3,m4,m5,m6,m7,constant0,constant1)  \
+      m3 = jh2XOR(m3,jh2CONSTANT(0xff));       \
+      m7 = jh2XOR(m7,jh2CONSTANT(0xff));       \
+      m0 = jh2XOR(m0,jh2ANDNOT(m2,constant0)); \
+      m4 = jh2XOR(m4,jh2ANDNOT(m6,constant1)); \
+      a0 = jh2XOR(constant0,jh2AND(m0,m1));    \
+      a1 = jh2XOR(constant1,jh2AND(m4,m5));    \
+      m0 = jh2XOR(m0,jh2AND(m3,m2));           \
+      m4 = jh2XOR(m4,jh2AND(m7,m6));           \
+      m3 = jh2XOR(m3,jh2ANDNOT(m1,m2));        \
+      m7 = jh2XOR(m7,jh2ANDNOT(m5,m6));        \
+      m1 = jh2XOR(m1,jh2AND(m0,m2));           \
+      m5 = jh2XOR(m5,jh2AND(m4,m6));           \
+      m2 = jh2XOR(m2,jh2ANDNOT(m3,m0));        \
+      m6 = jh2XOR(m6,jh2ANDNOT(m7,m4));        \
+      m0 = jh2XOR(m0,jh2OR(m1,m3));            \
+      m4 = jh2XOR(m4,jh2OR(m5,m7));            \
+      m3 = jh2XOR(m3,jh2AND(m1,m2));           \
+      m7 = jh2XOR(m7,jh2AND(m5,m6));           \
+      m2 = jh2XOR(m2,a0);                      \
+      m6 = jh2XOR(m6,a1);                      \
+      m1 = jh2XOR(m1,jh2AND(a0,m0));           \
+      m5 = jh2XOR(m5,jh2AND(a1,m4));
+
+// the swap of round 7*i+nn, on the odd words
+#define jh2SWAP_R00(x)   jh2SWAP1(x)
+#define jh2SWAP_R01(x)   jh2SWAP2(x)
+#define jh2SWAP_R02(x)   jh2SWAP4(x)
+#define jh2SWAP_R03(x)   jh2SWAP8(x)
+#define jh2SWAP_R04(x)   jh2SWAP16(x)
+#define jh2SWAP_R05(x)   jh2SWAP32(x)
+#define jh2SWAP_R06(x)   jh2SWAP64(x)
+
+// round constant r for both lanes
+#define jh2RC( r, h ) \
+   _mm256_broadcastsi128_si256( \
+          _mm_load_si128( (const __m128i*)( jhE8_bitslice_roundconstant[r] + (h) ) ) )
+
+#define jh2round_function(nn,r) \
+      jh2SS(y0,y2,y4,y6,y1,y3,y5,y7, jh2RC( r, 0 ), jh2RC( r, 16 ) ); \
+      jh2L(y0,y2,y4,y6,y1,y3,y5,y7); \
+      y1 = jh2SWAP_R##nn(y1); y3 = jh2SWAP_R##nn(y3); \
+      y5 = jh2SWAP_R##nn(y5); y7 = jh2SWAP_R##nn(y7);
+
+// F8 on two states, x and m hold one lane per 128 bit half.
+static void jh512_2way_f8( __m256i *x, const __m256i *m )
+{
+      __m256i y0,y1,y2,y3,y4,y5,y6,y7;
+      __m256i a0,a1;
+
+      y0 = jh2XOR(x[0], m[0]);
+      y1 = jh2XOR(x[1], m[1]);
+      y2 = jh2XOR(x[2], m[2]);
+      y3 = jh2XOR(x[3], m[3]);
+      y4 = x[4];
+      y5 = x[5];
+      y6 = x[6];
+      y7 = x[7];
+
+      for ( int i = 0; i < 42; i = i+7 )
+      {
+            jh2round_function(00,i);
+            jh2round_function(01,i+1);
+            jh2round_function(02,i+2);
+            jh2round_function(03,i+3);
+            jh2round_function(04,i+4);
+            jh2round_function(05,i+5);
+            jh2round_function(06,i+6);
+      }
+
+      x[0] = y0;
+      x[1] = y1;
+      x[2] = y2;
+      x[3] = y3;
+      x[4] = jh2XOR(y4, m[0]);
+      x[5] = jh2XOR(y5, m[1]);
+      x[6] = jh2XOR(y6, m[2]);
+      x[7] = jh2XOR(y7, m[3]);
+}
+
+// Pads len bytes at msg as sph_jh does and returns the padded length:
+// a 0x80 byte, zeros, the 128 bit big endian bit count, whole blocks.
+static int jh512_pad( unsigned char *buf, const void *msg, int len )
+{
+   const int ptr = len & 63;
+   const int plen = len + 1 + ( ptr == 0 ? 47 : 111 - ptr ) + 16;
+   const uint64_t bits = (uint64_t)len << 3;
+
+   memcpy( buf, msg, len );
+   memset( buf + len, 0, plen - len );
+   buf[len] = 0x80;
+   for ( int i = 0; i < 8; i++ )
+      buf[ plen - 1 - i ] = (unsigned char)( bits >> ( 8*i ) );
+   return plen;
+}
+
+#else
+
+#include "sph_jh.h"
+
+#endif
+
+void jh512_x4( void * const hash[4], int len )
+{
+#if defined(__AVX2__)
+   unsigned char buf[4][192] __attribute__ ((aligned (64)));
+   int plen = 0;
+
+   for ( int i = 0; i < 4; i++ )
+      plen = jh512_pad( buf[i], hash[i], len );
+
+   for ( int i = 0; i < 4; i += 2 )
+   {
+      __m256i x[8], m[4];
+
+      for ( int j = 0; j < 8; j++ )
+         x[j] = _mm256_broadcastsi128_si256(
+                         _mm_load_si128( (const __m128i*)JH512_H0 + j ) );
+      for ( int b = 0; b < plen; b += 64 )
+      {
+         for ( int j = 0; j < 4; j++ )
+            m[j] = _mm256_inserti128_si256( _mm256_castsi128_si256(
+                  _mm_load_si128( (const __m128i*)( buf[i] + b ) + j ) ),
+                  _mm_load_si128( (const __m128i*)( buf[i+1] + b ) + j ), 1 );
+         jh512_2way_f8( x, m );
+      }
+      for ( int j = 0; j < 4; j++ )
+      {
+         _mm_storeu_si128( (__m128i*)hash[i] + j,
+                           _mm256_castsi256_si128( x[ 4+j ] ) );
+         _mm_storeu_si128( (__m128i*)hash[i+1] + j,
+                           _mm256_extracti128_si256( x[ 4+j ], 1 ) );
+      }
+   }
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      sph_jh512_context ctx;
+      sph_jh512_init( &ctx );
+      sph_jh512( &ctx, hash[i], len );
+      sph_jh512_close( &ctx, hash[i] );
+   }
+#endif
+}
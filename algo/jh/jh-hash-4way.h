@@ -0,0 +1,14 @@
+#ifndef JH_HASH_4WAY_H__
+#define JH_HASH_4WAY_H__
+
+// JH-512 of 4 independent short messages. The bitsliced code of
+// sse2/jh_sse2_opt64.h never moves bits across a 128 bit word, so with AVX2
+// two messages share each ymm register, one per 128 bit lane. Without AVX2
+// the messages go through sph_jh one at a time.
+//
+// hash[i] holds len bytes of message i on entry and its 64 byte digest on
+// return, len is a multiple of 8 up to 128.
+
+void jh512_x4( void * const hash[4], int len );
+
+#endif
@@ -102,7 +102,8 @@ static DATA_ALIGN16(const unsigned char jhE8_bitslice_roundconstant[42][32])={
 {0x35,0xb4,0x98,0x31,0xdb,0x41,0x15,0x70,0xea,0x1e,0xf,0xbb,0xed,0xcd,0x54,0x9b,0x9a,0xd0,0x63,0xa1,0x51,0x97,0x40,0x72,0xf6,0x75,0x9d,0xbf,0x91,0x47,0x6f,0xe2}};
 
 
-static void jhF8(jhState *state);    /* the compression function F8 */
+/* unused where the header is included for the round constants only */
+static void jhF8(jhState *state) __attribute__ ((unused));    /* the compression function F8 */
 
 /*The API functions*/
 
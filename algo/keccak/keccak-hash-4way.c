@@ -0,0 +1,260 @@
+#include <string.h>
+
+#include "keccak-hash-4way.h"
+#include "sph_keccak.h"
+
+#if defined(__AVX2__)
+
+static const uint64_t RC[24] = {
+   0x0000000000000001, 0x0000000000008082,
+   0x800000000000808A, 0x8000000080008000,
+   0x000000000000808B, 0x0000000080000001,
+   0x8000000080008081, 0x8000000000008009,
+   0x000000000000008A, 0x0000000000000088,
+   0x0000000080008009, 0x000000008000000A,
+   0x000000008000808B, 0x800000000000008B,
+   0x8000000000008089, 0x8000000000008003,
+   0x8000000000008002, 0x8000000000000080,
+   0x000000000000800A, 0x800000008000000A,
+   0x8000000080008081, 0x8000000000008080,
+   0x0000000080000001, 0x8000000080008008
+};
+
+// rho and pi in one pass, walking the pi cycle starting from lane 1
+#define RHO_PI( j, r ) \
+do { \
+   B = A[j]; \
+   A[j] = mm256_rotl_64( T, r ); \
+   T = B; \
+} while (0)
+
+#define CHI( y ) \
+do { \
+   C0 = A[y+0]; \
+   C1 = A[y+1]; \
+   C2 = A[y+2]; \
+   C3 = A[y+3]; \
+   C4 = A[y+4]; \
+   A[y+0] = _mm256_xor_si256( C0, _mm256_andnot_si256( C1, C2 ) ); \
+   A[y+1] = _mm256_xor_si256( C1, _mm256_andnot_si256( C2, C3 ) ); \
+   A[y+2] = _mm256_xor_si256( C2, _mm256_andnot_si256( C3, C4 ) ); \
+   A[y+3] = _mm256_xor_si256( C3, _mm256_andnot_si256( C4, C0 ) ); \
+   A[y+4] = _mm256_xor_si256( C4, _mm256_andnot_si256( C0, C1 ) ); \
+} while (0)
+
+static void keccak_f1600_4way( __m256i *A )
+{
+   __m256i C0, C1, C2, C3, C4, D, B, T;
+
+   for ( int r = 0; r < 24; r++ )
+   {
+      // theta
+      C0 = _mm256_xor_si256( _mm256_xor_si256( A[0], A[5] ),
+           _mm256_xor_si256( _mm256_xor_si256( A[10], A[15] ), A[20] ) );
+      C1 = _mm256_xor_si256( _mm256_xor_si256( A[1], A[6] ),
+           _mm256_xor_si256( _mm256_xor_si256( A[11], A[16] ), A[21] ) );
+      C2 = _mm256_xor_si256( _mm256_xor_si256( A[2], A[7] ),
+           _mm256_xor_si256( _mm256_xor_si256( A[12], A[17] ), A[22] ) );
+      C3 = _mm256_xor_si256( _mm256_xor_si256( A[3], A[8] ),
+           _mm256_xor_si256( _mm256_xor_si256( A[13], A[18] ), A[23] ) );
+      C4 = _mm256_xor_si256( _mm256_xor_si256( A[4], A[9] ),
+           _mm256_xor_si256( _mm256_xor_si256( A[14], A[19] ), A[24] ) );
+
+      D = _mm256_xor_si256( C4, mm256_rotl_64( C1, 1 ) );
+      A[ 0] = _mm256_xor_si256( A[ 0], D );
+      A[ 5] = _mm256_xor_si256( A[ 5], D );
+      A[10] = _mm256_xor_si256( A[10], D );
+      A[15] = _mm256_xor_si256( A[15], D );
+      A[20] = _mm256_xor_si256( A[20], D );
+      D = _mm256_xor_si256( C0, mm256_rotl_64( C2, 1 ) );
+      A[ 1] = _mm256_xor_si256( A[ 1], D );
+      A[ 6] = _mm256_xor_si256( A[ 6], D );
+      A[11] = _mm256_xor_si256( A[11], D );
+      A[16] = _mm256_xor_si256( A[16], D );
+      A[21] = _mm256_xor_si256( A[21], D );
+      D = _mm256_xor_si256( C1, mm256_rotl_64( C3, 1 ) );
+      A[ 2] = _mm256_xor_si256( A[ 2], D );
+      A[ 7] = _mm256_xor_si256( A[ 7], D );
+      A[12] = _mm256_xor_si256( A[12], D );
+      A[17] = _mm256_xor_si256( A[17], D );
+      A[22] = _mm256_xor_si256( A[22], D );
+      D = _mm256_xor_si256( C2, mm256_rotl_64( C4, 1 ) );
+      A[ 3] = _mm256_xor_si256( A[ 3], D );
+      A[ 8] = _mm256_xor_si256( A[ 8], D );
+      A[13] = _mm256_xor_si256( A[13], D );
+      A[18] = _mm256_xor_si256( A[18], D );
+      A[23] = _mm256_xor_si256( A[23], D );
+      D = _mm256_xor_si256( C3, mm256_rotl_64( C0, 1 ) );
+      A[ 4] = _mm256_xor_si256( A[ 4], D );
+      A[ 9] = _mm256_xor_si256( A[ 9], D );
+      A[14] = _mm256_xor_si256( A[14], D );
+      A[19] = _mm256_xor_si256( A[19], D );
+      A[24] = _mm256_xor_si256( A[24], D );
+
+      // rho, pi
+      T = A[1];
+      RHO_PI( 10,  1 );
+      RHO_PI(  7,  3 );
+      RHO_PI( 11,  6 );
+      RHO_PI( 17, 10 );
+      RHO_PI( 18, 15 );
+      RHO_PI(  3, 21 );
+      RHO_PI(  5, 28 );
+      RHO_PI( 16, 36 );
+      RHO_PI(  8, 45 );
+      RHO_PI( 21, 55 );
+      RHO_PI( 24,  2 );
+      RHO_PI(  4, 14 );
+      RHO_PI( 15, 27 );
+      RHO_PI( 23, 41 );
+      RHO_PI( 19, 56 );
+      RHO_PI( 13,  8 );
+      RHO_PI( 12, 25 );
+      RHO_PI(  2, 43 );
+      RHO_PI( 20, 62 );
+      RHO_PI( 14, 18 );
+      RHO_PI( 22, 39 );
+      RHO_PI(  9, 61 );
+      RHO_PI(  6, 20 );
+      RHO_PI(  1, 44 );
+
+      // chi
+      CHI(  0 );
+      CHI(  5 );
+      CHI( 10 );
+      CHI( 15 );
+      CHI( 20 );
+
+      // iota
+      A[0] = _mm256_xor_si256( A[0], _mm256_set1_epi64x( RC[r] ) );
+   }
+}
+
+static void keccak_4way_init( keccak_4way_context *ctx, size_t lim )
+{
+   for ( int i = 0; i < 25; i++ )
+      ctx->w[i] = _mm256_setzero_si256();
+   ctx->ptr = 0;
+   ctx->lim = lim;
+}
+
+static void keccak_4way_core( keccak_4way_context *ctx, const void *data,
+                              size_t len )
+{
+   const __m256i *vdata = (const __m256i*)data;
+   size_t ptr = ctx->ptr;
+
+   while ( len > 0 )
+   {
+      size_t clen = ctx->lim - ptr;
+      if ( clen > len )
+         clen = len;
+      for ( size_t i = 0; i < clen >> 3; i++ )
+         ctx->w[ ( ptr >> 3 ) + i ] = _mm256_xor_si256(
+                     ctx->w[ ( ptr >> 3 ) + i ], _mm256_loadu_si256( vdata + i ) );
+      vdata += clen >> 3;
+      len -= clen;
+      ptr += clen;
+      if ( ptr == ctx->lim )
+      {
+         keccak_f1600_4way( ctx->w );
+         ptr = 0;
+      }
+   }
+   ctx->ptr = ptr;
+}
+
+static void keccak_4way_close( keccak_4way_context *ctx, void *dst,
+                               int out_w64 )
+{
+   __m256i *out = (__m256i*)dst;
+
+   // pad10*1 starting with 0x01, the 0x80 closes the block
+   ctx->w[ ctx->ptr >> 3 ] = _mm256_xor_si256( ctx->w[ ctx->ptr >> 3 ],
+                                      _mm256_set1_epi64x( 0x01 ) );
+   ctx->w[ ( ctx->lim >> 3 ) - 1 ] = _mm256_xor_si256(
+                                      ctx->w[ ( ctx->lim >> 3 ) - 1 ],
+                                      _mm256_set1_epi64x( 0x8000000000000000 ) );
+   keccak_f1600_4way( ctx->w );
+
+   for ( int i = 0; i < out_w64; i++ )
+      _mm256_storeu_si256( out + i, ctx->w[i] );
+}
+
+void keccak256_4way_init( keccak256_4way_context *ctx )
+{
+   keccak_4way_init( ctx, 136 );
+}
+
+void keccak256_4way( keccak256_4way_context *ctx, const void *data,
+                     size_t len )
+{
+   keccak_4way_core( ctx, data, len );
+}
+
+void keccak256_4way_close( keccak256_4way_context *ctx, void *dst )
+{
+   keccak_4way_close( ctx, dst, 4 );
+}
+
+void keccak512_4way_init( keccak512_4way_context *ctx )
+{
+   keccak_4way_init( ctx, 72 );
+}
+
+void keccak512_4way( keccak512_4way_context *ctx, const void *data,
+                     size_t len )
+{
+   keccak_4way_core( ctx, data, len );
+}
+
+void keccak512_4way_close( keccak512_4way_context *ctx, void *dst )
+{
+   keccak_4way_close( ctx, dst, 8 );
+}
+
+// 64 bytes and the padding fill the first block exactly, the state is
+// loaded from the message rather than absorbed into a zero state.
+static void keccak512_4way_64( __m256i *vhash, const __m256i *vdata )
+{
+   __m256i A[25];
+
+   for ( int i = 0; i < 8; i++ )
+      A[i] = vdata[i];
+   A[8] = _mm256_set1_epi64x( 0x8000000000000001 );
+   for ( int i = 9; i < 25; i++ )
+      A[i] = _mm256_setzero_si256();
+   keccak_f1600_4way( A );
+   for ( int i = 0; i < 8; i++ )
+      vhash[i] = A[i];
+}
+
+#endif
+
+void keccak512_x4( void * const hash[4], int len )
+{
+#if defined(__AVX2__)
+   __m256i vdata[16] __attribute__ ((aligned (64)));
+
+   mm256_interleave_4x64( vdata, hash[0], hash[1], hash[2], hash[3],
+                          len << 3 );
+   if ( len == 64 )
+      keccak512_4way_64( vdata, vdata );
+   else
+   {
+      keccak512_4way_context ctx;
+      keccak512_4way_init( &ctx );
+      keccak512_4way( &ctx, vdata, len );
+      keccak512_4way_close( &ctx, vdata );
+   }
+   mm256_deinterleave_4x64( hash[0], hash[1], hash[2], hash[3], vdata, 512 );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      sph_keccak512_context ctx;
+      sph_keccak512_init( &ctx );
+      sph_keccak512( &ctx, hash[i], len );
+      sph_keccak512_close( &ctx, hash[i] );
+   }
+#endif
+}
@@ -0,0 +1,42 @@
+#ifndef KECCAK_HASH_4WAY_H__
+#define KECCAK_HASH_4WAY_H__
+
+// Keccak-256 and Keccak-512 (original Keccak padding, as sph_keccak) for
+// 4 lanes in parallel, one lane per 64 bit element of a ymm register.
+// Input and output are interleaved 4x64, lengths are bytes per lane and
+// must be a multiple of 8.
+//
+// keccak512_x4 is the fixed length form for the chains: hash[i] holds len
+// bytes of message i on entry and its 64 byte digest on return, len is a
+// multiple of 8 up to 128. Without AVX2 the messages go through sph_keccak
+// one at a time.
+
+void keccak512_x4( void * const hash[4], int len );
+
+#if defined(__AVX2__)
+
+#include <stddef.h>
+#include "avxdefs.h"
+
+typedef struct {
+   __m256i w[25] __attribute__ ((aligned (64)));
+   size_t ptr;          // bytes per lane absorbed into the current block
+   size_t lim;          // rate in bytes
+} keccak_4way_context;
+
+typedef keccak_4way_context keccak256_4way_context;
+typedef keccak_4way_context keccak512_4way_context;
+
+void keccak256_4way_init( keccak256_4way_context *ctx );
+void keccak256_4way( keccak256_4way_context *ctx, const void *data,
+                     size_t len );
+void keccak256_4way_close( keccak256_4way_context *ctx, void *dst );
+
+void keccak512_4way_init( keccak512_4way_context *ctx );
+void keccak512_4way( keccak512_4way_context *ctx, const void *data,
+                     size_t len );
+void keccak512_4way_close( keccak512_4way_context *ctx, void *dst );
+
+#endif
+
+#endif
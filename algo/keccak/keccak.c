@@ -6,6 +6,7 @@
 #include <stdint.h>
 
 #include "sph_keccak.h"
+#include "keccak-hash-4way.h"
 
 void keccakhash(void *state, const void *input)
 {
@@ -36,6 +37,42 @@ int scanhash_keccak(int thr_id, struct work *work,
 	{
 		be32enc(&endiandata[kk], ((uint32_t*)pdata)[kk]);
 	};	
+
+#if defined(__AVX2__)
+	// The header is a single Keccak-256 block so there is no midstate,
+	// 4 nonces are hashed at a time and the odd ones at the end go
+	// through the single lane loop below.
+	{
+		uint32_t _ALIGN(64) hash[4][8];
+		uint32_t _ALIGN(64) vhash[4*8];
+		uint32_t _ALIGN(64) vdata[4*20];
+		keccak256_4way_context ctx;
+
+		mm256_interleave_4x64( vdata, endiandata, endiandata, endiandata,
+		                       endiandata, 640 );
+		while ( n + 1 < max_nonce && max_nonce - n > 4
+		        && !work_restart[thr_id].restart )
+		{
+			// word 19 is the high half of the last 64 bit element
+			for (int i = 0; i < 4; i++)
+				be32enc(&vdata[ 4*18 + 2*i + 1 ], n + 1 + i);
+			keccak256_4way_init( &ctx );
+			keccak256_4way( &ctx, vdata, 80 );
+			keccak256_4way_close( &ctx, vhash );
+			mm256_deinterleave_4x64( hash[0], hash[1], hash[2], hash[3],
+			                         vhash, 256 );
+
+			for (int i = 0; i < 4; i++)
+			if (((hash[i][7]&0xFFFFFF00)==0) &&
+					fulltest(hash[i], ptarget)) {
+				pdata[19] = n + 1 + i;
+				*hashes_done = pdata[19] - first_nonce + 1;
+				return true;
+			}
+			n += 4;
+		}
+	}
+#endif
 	
 	do {
 	
@@ -0,0 +1,223 @@
+// Luffa-512 kernel, included by luffa-hash-2way.c for one vector width.
+// The includer defines V, LANES, the V_* operations and KERNEL_SUFFIX.
+// Every operation works within 128 bit lanes, so each lane runs the SSE2
+// code of sse2/luffa_for_sse2.c (rnd512 and finalization512) on its own
+// message.
+
+#ifndef LUFFA_HASH_2WAY_KERNEL_H__
+#define LUFFA_HASH_2WAY_KERNEL_H__
+
+#define LUFFA_CAT_( a, b )  a##b
+#define LUFFA_CAT( a, b )   LUFFA_CAT_( a, b )
+#define KN( f )             LUFFA_CAT( f, KERNEL_SUFFIX )
+
+// Multiply the 256 bit word a1:a0 by 2 in the Luffa field.
+#define LF_MULT2( a0, a1 ) \
+do { \
+   const V t_ = V_SHUF32( V_AND( a1, LF_MASK ), 16 ); \
+   const V u_ = V_XOR( a0, t_ ); \
+   a0 = V_OR( V_BSRLI( u_, 4 ), V_BSLLI( a1, 12 ) ); \
+   a1 = V_OR( V_BSRLI( a1, 4 ), V_BSLLI( u_, 12 ) ); \
+} while (0)
+
+#define LF_SUBCRUMB( a0, a1, a2, a3 ) \
+do { \
+   V t_ = a0; \
+   a0 = V_OR( a0, a1 ); \
+   a2 = V_XOR( a2, a3 ); \
+   a1 = V_ANDNOT( a1, LF_ALLONE ); \
+   a0 = V_XOR( a0, a3 ); \
+   a3 = V_AND( a3, t_ ); \
+   a1 = V_XOR( a1, a3 ); \
+   a3 = V_XOR( a3, a2 ); \
+   a2 = V_AND( a2, a0 ); \
+   a0 = V_ANDNOT( a0, LF_ALLONE ); \
+   a2 = V_XOR( a2, a1 ); \
+   a1 = V_OR( a1, a3 ); \
+   t_ = V_XOR( t_, a1 ); \
+   a3 = V_XOR( a3, a2 ); \
+   a2 = V_AND( a2, a1 ); \
+   a1 = V_XOR( a1, a0 ); \
+   a0 = t_; \
+} while (0)
+
+#define LF_MIXWORD( a, b ) \
+do { \
+   b = V_XOR( a, b ); \
+   a = V_XOR( V_ROTL32( a,  2 ), b ); \
+   b = V_XOR( V_ROTL32( b, 14 ), a ); \
+   a = V_XOR( V_ROTL32( a, 10 ), b ); \
+   b = V_ROTL32( b, 1 ); \
+} while (0)
+
+#define LF_STEP_PART( x, c0, c1 ) \
+do { \
+   LF_SUBCRUMB( x[0], x[1], x[2], x[3] ); \
+   LF_SUBCRUMB( x[5], x[6], x[7], x[4] ); \
+   LF_MIXWORD( x[0], x[4] ); \
+   LF_MIXWORD( x[1], x[5] ); \
+   LF_MIXWORD( x[2], x[6] ); \
+   LF_MIXWORD( x[3], x[7] ); \
+   x[0] = V_XOR( x[0], c0 ); \
+   x[4] = V_XOR( x[4], c1 ); \
+} while (0)
+
+#define LF_STEP_PART2( a0, a1, c0, c1 ) \
+do { \
+   V t0_, t1_; \
+   a1 = V_SHUF32( a1, 147 ); \
+   t0_ = V_UNPACKHI32( a1, a0 ); \
+   a1 = V_UNPACKLO32( a1, a0 ); \
+   t1_ = V_SHUF32( t0_, 78 ); \
+   a0 = V_SHUF32( a1, 78 ); \
+   LF_SUBCRUMB( t1_, t0_, a0, a1 ); \
+   t0_ = V_UNPACKLO32( t0_, t1_ ); \
+   a1 = V_UNPACKLO32( a1, a0 ); \
+   a0 = V_UNPACKHI64( a1, t0_ ); \
+   a1 = V_SHUF32( V_UNPACKLO64( a1, t0_ ), 57 ); \
+   LF_MIXWORD( a0, a1 ); \
+   a0 = V_XOR( a0, c0 ); \
+   a1 = V_XOR( a1, c1 ); \
+} while (0)
+
+// NMLTOM1024 of sse2/luffa_for_sse2.c, MIXTON1024 is the same shuffle.
+#define LF_NMLTOM1024( r0, r1, r2, r3, s0, s1, s2, s3, \
+                       p0, p1, p2, p3, q0, q1, q2, q3 ) \
+do { \
+   s1 = V_UNPACKHI32( r3, r2 ); \
+   q1 = V_UNPACKHI32( p3, p2 ); \
+   s3 = V_UNPACKLO32( r3, r2 ); \
+   q3 = V_UNPACKLO32( p3, p2 ); \
+   r3 = V_UNPACKHI32( r1, r0 ); \
+   p3 = V_UNPACKHI32( p1, p0 ); \
+   r1 = V_UNPACKLO32( r1, r0 ); \
+   p1 = V_UNPACKLO32( p1, p0 ); \
+   s0 = V_UNPACKHI64( s1, r3 ); \
+   q0 = V_UNPACKHI64( q1, p3 ); \
+   s1 = V_UNPACKLO64( s1, r3 ); \
+   q1 = V_UNPACKLO64( q1, p3 ); \
+   s2 = V_UNPACKHI64( s3, r1 ); \
+   q2 = V_UNPACKHI64( q3, p1 ); \
+   s3 = V_UNPACKLO64( s3, r1 ); \
+   q3 = V_UNPACKLO64( q3, p1 ); \
+} while (0)
+
+#endif
+
+static void KN( luffa512_rnd )( V *chainv, V msg0, V msg1 )
+{
+   V t0, t1, x[8];
+   int i;
+
+   t0 = V_XOR( V_XOR( V_XOR( chainv[0], chainv[2] ),
+                      V_XOR( chainv[4], chainv[6] ) ), chainv[8] );
+   t1 = V_XOR( V_XOR( V_XOR( chainv[1], chainv[3] ),
+                      V_XOR( chainv[5], chainv[7] ) ), chainv[9] );
+   LF_MULT2( t0, t1 );
+   for ( i = 0; i < 5; i++ )
+   {
+      chainv[ 2*i   ] = V_XOR( chainv[ 2*i   ], t0 );
+      chainv[ 2*i+1 ] = V_XOR( chainv[ 2*i+1 ], t1 );
+   }
+
+   t0 = chainv[0];
+   t1 = chainv[1];
+   for ( i = 0; i < 8; i += 2 )
+   {
+      LF_MULT2( chainv[i], chainv[i+1] );
+      chainv[i  ] = V_XOR( chainv[i  ], chainv[i+2] );
+      chainv[i+1] = V_XOR( chainv[i+1], chainv[i+3] );
+   }
+   LF_MULT2( chainv[8], chainv[9] );
+   chainv[8] = V_XOR( chainv[8], t0 );
+   chainv[9] = V_XOR( chainv[9], t1 );
+
+   t0 = chainv[8];
+   t1 = chainv[9];
+   for ( i = 8; i > 0; i -= 2 )
+   {
+      LF_MULT2( chainv[i], chainv[i+1] );
+      chainv[i  ] = V_XOR( chainv[i  ], chainv[i-2] );
+      chainv[i+1] = V_XOR( chainv[i+1], chainv[i-1] );
+   }
+   LF_MULT2( chainv[0], chainv[1] );
+   chainv[0] = V_XOR( chainv[0], t0 );
+   chainv[1] = V_XOR( chainv[1], t1 );
+
+   for ( i = 0; i < 5; i++ )
+   {
+      chainv[ 2*i   ] = V_XOR( chainv[ 2*i   ], msg0 );
+      chainv[ 2*i+1 ] = V_XOR( chainv[ 2*i+1 ], msg1 );
+      LF_MULT2( msg0, msg1 );
+   }
+
+   // Tweak
+   chainv[3] = V_ROTL32( chainv[3], 1 );
+   chainv[5] = V_ROTL32( chainv[5], 2 );
+   chainv[7] = V_ROTL32( chainv[7], 3 );
+   chainv[9] = V_ROTL32( chainv[9], 4 );
+
+   LF_NMLTOM1024( chainv[0], chainv[2], chainv[4], chainv[6],
+                  x[0], x[1], x[2], x[3],
+                  chainv[1], chainv[3], chainv[5], chainv[7],
+                  x[4], x[5], x[6], x[7] );
+
+   for ( i = 0; i < 8; i++ )
+      LF_STEP_PART( x, LF_CNS( 2*i ), LF_CNS( 2*i + 1 ) );
+
+   LF_NMLTOM1024( x[0], x[1], x[2], x[3],
+                  chainv[0], chainv[2], chainv[4], chainv[6],
+                  x[4], x[5], x[6], x[7],
+                  chainv[1], chainv[3], chainv[5], chainv[7] );
+
+   // the last 256 bit block
+   for ( i = 0; i < 8; i++ )
+      LF_STEP_PART2( chainv[8], chainv[9],
+                     LF_CNS( 16 + 2*i ), LF_CNS( 17 + 2*i ) );
+}
+
+// hash[i] holds len bytes of lane i, 0 to 128, and gets the digest.
+static void KN( luffa512 )( void * const hash[], int len )
+{
+   // 5 blocks of 32 bytes, two 128 bit words each
+   __m128i blk[10][LANES] __attribute__ ((aligned (64)));
+   const int nblk = len / 32 + 1;
+   V chainv[10], t0, t1;
+   int i;
+
+   for ( i = 0; i < 10; i++ )
+      chainv[i] = V_BCAST( _mm_load_si128( (const __m128i*)luffa_iv + i ) );
+
+   // the message padded with a 1 bit to a whole number of blocks
+   for ( int l = 0; l < LANES; l++ )
+   {
+      unsigned char b[160];
+      memcpy( b, hash[l], len );
+      b[len] = 0x80;
+      memset( b + len + 1, 0, nblk*32 - len - 1 );
+      for ( int j = 0; j < 2*nblk; j++ )
+         blk[j][l] = _mm_loadu_si128( (const __m128i*)b + j );
+   }
+
+   // The SSE2 code byte swaps each word and reverses the word order, that
+   // is a reversal of all 16 bytes.
+   for ( i = 0; i < nblk; i++ )
+      KN( luffa512_rnd )( chainv, V_BREV128( V_LOAD( blk[2*i] ) ),
+                                  V_BREV128( V_LOAD( blk[2*i+1] ) ) );
+
+   // two blank rounds, each gives 256 bits of the digest
+   for ( i = 0; i < 2; i++ )
+   {
+      KN( luffa512_rnd )( chainv, V_ZERO, V_ZERO );
+      t0 = V_XOR( V_XOR( V_XOR( chainv[0], chainv[2] ),
+                         V_XOR( chainv[4], chainv[6] ) ), chainv[8] );
+      t1 = V_XOR( V_XOR( V_XOR( chainv[1], chainv[3] ),
+                         V_XOR( chainv[5], chainv[7] ) ), chainv[9] );
+      V_STORE( blk[2*i],   V_BREV128( t0 ) );
+      V_STORE( blk[2*i+1], V_BREV128( t1 ) );
+   }
+
+   for ( int l = 0; l < LANES; l++ )
+      for ( int j = 0; j < 4; j++ )
+         _mm_storeu_si128( (__m128i*)hash[l] + j, blk[j][l] );
+}
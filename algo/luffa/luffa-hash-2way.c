@@ -0,0 +1,152 @@
+#include <string.h>
+#include <immintrin.h>
+
+#include "luffa-hash-2way.h"
+#include "avxdefs.h"
+
+#if defined(__AVX2__)
+
+static const uint32_t luffa_iv[40] __attribute__ ((aligned (16))) =
+{
+   0xdbf78465, 0x4eaa6fb4, 0x44b051e0, 0x6d251e69,
+   0xdef610bb, 0xee058139, 0x90152df4, 0x6e292011,
+   0xde099fa3, 0x70eee9a0, 0xd9d2f256, 0xc3b44b95,
+   0x746cd581, 0xcf1ccf0e, 0x8fc944b3, 0x5d9b0557,
+   0xad659c05, 0x04016ce5, 0x5dba5781, 0xf7efc89d,
+   0x8b264ae7, 0x24aa230a, 0x666d1836, 0x0306194f,
+   0x204b1f67, 0xe571f7d7, 0x36d79cce, 0x858075d5,
+   0x7cde72ce, 0x14bcb808, 0x57e9e923, 0x35870c6a,
+   0xaffb4363, 0xc825b7c7, 0x5ec41e22, 0x6c68e9be,
+   0x03e86cea, 0xb07224cc, 0x0fc688f1, 0xf5df3999
+};
+
+static const uint32_t luffa_cns[128] __attribute__ ((aligned (16))) =
+{
+   0xb213afa5, 0xfc20d9d2, 0xb6de10ed, 0x303994a6,
+   0xe028c9bf, 0xe25e72c1, 0x01685f3d, 0xe0337818,
+   0xc84ebe95, 0x34552e25, 0x70f47aae, 0xc0e65299,
+   0x44756f91, 0xe623bb72, 0x05a17cf4, 0x441ba90d,
+   0x4e608a22, 0x7ad8818f, 0x0707a3d4, 0x6cc33a12,
+   0x7e8fce32, 0x5c58a4a4, 0xbd09caca, 0x7f34d442,
+   0x56d858fe, 0x8438764a, 0x1c1e8f51, 0xdc56983e,
+   0x956548be, 0x1e38e2e7, 0xf4272b28, 0x9389217f,
+   0x343b138f, 0xbb6de032, 0x707a3d45, 0x1e00108f,
+   0xfe191be2, 0x78e38b9d, 0x144ae5cc, 0xe5a8bce6,
+   0xd0ec4e3d, 0xedb780c8, 0xaeb28562, 0x7800423d,
+   0x3cb226e5, 0x27586719, 0xfaa7ae2b, 0x5274baf4,
+   0x2ceb4882, 0xd9847356, 0xbaca1589, 0x8f5b7882,
+   0x5944a28e, 0x36eda57f, 0x2e48f1c1, 0x26889ba7,
+   0xb3ad2208, 0xa2c78434, 0x40a46f3e, 0x96e1db12,
+   0xa1c4c355, 0x703aace7, 0xb923c704, 0x9a226e9d,
+   0x00000000, 0x00000000, 0x00000000, 0xf0d2e9e3,
+   0x00000000, 0x00000000, 0x00000000, 0x5090d577,
+   0x00000000, 0x00000000, 0x00000000, 0xac11d7fa,
+   0x00000000, 0x00000000, 0x00000000, 0x2d1925ab,
+   0x00000000, 0x00000000, 0x00000000, 0x1bcb66f2,
+   0x00000000, 0x00000000, 0x00000000, 0xb46496ac,
+   0x00000000, 0x00000000, 0x00000000, 0x6f2d9bc9,
+   0x00000000, 0x00000000, 0x00000000, 0xd1925ab0,
+   0x00000000, 0x00000000, 0x00000000, 0x78602649,
+   0x00000000, 0x00000000, 0x00000000, 0x29131ab6,
+   0x00000000, 0x00000000, 0x00000000, 0x8edae952,
+   0x00000000, 0x00000000, 0x00000000, 0x0fc053c3,
+   0x00000000, 0x00000000, 0x00000000, 0x3b6ba548,
+   0x00000000, 0x00000000, 0x00000000, 0x3f014f0c,
+   0x00000000, 0x00000000, 0x00000000, 0xedae9520,
+   0x00000000, 0x00000000, 0x00000000, 0xfc053c31
+};
+
+// lower 32 bits of each 128 bit lane set
+#define LF_MASK     V_BCAST( _mm_set_epi32( 0, 0, 0, 0xffffffff ) )
+#define LF_ALLONE   V_BCAST( _mm_set1_epi32( 0xffffffff ) )
+#define LF_CNS( i ) V_BCAST( _mm_load_si128( (const __m128i*)luffa_cns + (i) ) )
+
+#endif
+
+#if defined(__AVX512BW__)
+
+// 4 lanes, zmm
+
+#define V                   __m512i
+#define LANES               4
+#define KERNEL_SUFFIX       _4way
+#define V_ZERO              _mm512_setzero_si512()
+#define V_LOAD( p )         _mm512_load_si512( (const void*)(p) )
+#define V_STORE( p, x )     _mm512_store_si512( (void*)(p), x )
+#define V_BCAST( x )        _mm512_broadcast_i32x4( x )
+#define V_XOR               _mm512_xor_si512
+#define V_AND               _mm512_and_si512
+#define V_OR                _mm512_or_si512
+#define V_ANDNOT            _mm512_andnot_si512
+#define V_ROTL32            _mm512_rol_epi32
+#define V_SHUF32            _mm512_shuffle_epi32
+#define V_BSRLI             _mm512_bsrli_epi128
+#define V_BSLLI             _mm512_bslli_epi128
+#define V_UNPACKLO32        _mm512_unpacklo_epi32
+#define V_UNPACKHI32        _mm512_unpackhi_epi32
+#define V_UNPACKLO64        _mm512_unpacklo_epi64
+#define V_UNPACKHI64        _mm512_unpackhi_epi64
+#define V_BREV128( x ) \
+   _mm512_shuffle_epi8( x, V_BCAST( _mm_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7, \
+                                          8, 9, 10, 11, 12, 13, 14, 15 ) ) )
+
+#include "luffa-hash-2way-kernel.h"
+
+#elif defined(__AVX2__)
+
+// 2 lanes, ymm
+
+#define V                   __m256i
+#define LANES               2
+#define KERNEL_SUFFIX       _2way
+#define V_ZERO              _mm256_setzero_si256()
+#define V_LOAD( p )         _mm256_load_si256( (const __m256i*)(p) )
+#define V_STORE( p, x )     _mm256_store_si256( (__m256i*)(p), x )
+#define V_BCAST( x )        _mm256_broadcastsi128_si256( x )
+#define V_XOR               _mm256_xor_si256
+#define V_AND               _mm256_and_si256
+#define V_OR                _mm256_or_si256
+#define V_ANDNOT            _mm256_andnot_si256
+#define V_ROTL32            mm256_rotl_32
+#define V_SHUF32            _mm256_shuffle_epi32
+#define V_BSRLI             _mm256_srli_si256
+#define V_BSLLI             _mm256_slli_si256
+#define V_UNPACKLO32        _mm256_unpacklo_epi32
+#define V_UNPACKHI32        _mm256_unpackhi_epi32
+#define V_UNPACKLO64        _mm256_unpacklo_epi64
+#define V_UNPACKHI64        _mm256_unpackhi_epi64
+#define V_BREV128( x ) \
+   _mm256_shuffle_epi8( x, V_BCAST( _mm_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7, \
+                                          8, 9, 10, 11, 12, 13, 14, 15 ) ) )
+
+#include "luffa-hash-2way-kernel.h"
+
+#else
+
+#include "sse2/luffa_for_sse2.h"
+#include "sph_luffa.h"
+
+#endif
+
+void luffa512_x4( void * const hash[4], int len )
+{
+#if defined(__AVX512BW__)
+   luffa512_4way( hash, len );
+#elif defined(__AVX2__)
+   luffa512_2way( hash, len );
+   luffa512_2way( hash + 2, len );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      if ( len == 64 )
+         luffa512_64( hash[i], hash[i] );
+      else
+      {
+         sph_luffa512_context ctx;
+         sph_luffa512_init( &ctx );
+         sph_luffa512( &ctx, hash[i], len );
+         sph_luffa512_close( &ctx, hash[i] );
+      }
+   }
+#endif
+}
@@ -0,0 +1,15 @@
+#ifndef LUFFA_HASH_2WAY_H__
+#define LUFFA_HASH_2WAY_H__
+
+// Luffa-512 of 4 independent short messages. The rounds of
+// sse2/luffa_for_sse2.c run on wider vectors with one message per 128 bit
+// lane: four per zmm register with AVX512BW, two per ymm register with
+// AVX2. Without either the messages are hashed one at a time.
+//
+// hash[i] holds len bytes of message i on entry and its 64 byte digest on
+// return, len is 0 to 128. Unlike update_luffa any length is padded the
+// way sph_luffa512 does it.
+
+void luffa512_x4( void * const hash[4], int len );
+
+#endif
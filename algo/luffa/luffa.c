@@ -7,6 +7,7 @@
 #include <stdio.h>
 
 #include "sph_luffa.h"
+#include "luffa-hash-2way.h"
 
 void luffahash(void *output, const void *input)
 {
@@ -38,6 +39,32 @@ int scanhash_luffa(int thr_id, struct work *work,
 		be32enc(&endiandata[i], pdata[i]);
 	}
 
+	// 4 nonces at a time, the odd ones at the end go through the single
+	// lane loop below.
+	{
+		uint32_t _ALIGN(64) hash4[4][32];
+		void * const lanes[4] = { hash4[0], hash4[1], hash4[2], hash4[3] };
+
+		while ( n < max_nonce && max_nonce - n > 4
+		        && !work_restart[thr_id].restart )
+		{
+			for ( int i = 0; i < 4; i++ )
+			{
+				memcpy( hash4[i], endiandata, 76 );
+				be32enc( &hash4[i][19], n + i );
+			}
+			luffa512_x4( lanes, 80 );
+			for ( int i = 0; i < 4; i++ )
+			if ( hash4[i][7] < Htarg && fulltest( hash4[i], ptarget ) )
+			{
+				*hashes_done = n + i - first_nonce + 1;
+				pdata[19] = n + i;
+				return true;
+			}
+			n += 4;
+		}
+	}
+
 	do {
 		be32enc(&endiandata[19], n);
 		luffahash(hash64, endiandata);
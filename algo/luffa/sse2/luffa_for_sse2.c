@@ -213,7 +213,7 @@ static void finalization512(hashState_luffa *state, uint32 *b);
 
 
 /* initial values of chaining variables */
-static const uint32 IV[40] = {
+static const uint32 IV[40] __attribute__ ((aligned (16))) = {
     0xdbf78465,0x4eaa6fb4,0x44b051e0,0x6d251e69,
     0xdef610bb,0xee058139,0x90152df4,0x6e292011,
     0xde099fa3,0x70eee9a0,0xd9d2f256,0xc3b44b95,
@@ -227,7 +227,7 @@ static const uint32 IV[40] = {
 };
 
 /* Round Constants */
-static const uint32 CNS_INIT[128] = {
+static const uint32 CNS_INIT[128] __attribute__ ((aligned (16))) = {
     0xb213afa5,0xfc20d9d2,0xb6de10ed,0x303994a6,
     0xe028c9bf,0xe25e72c1,0x01685f3d,0xe0337818,
     0xc84ebe95,0x34552e25,0x70f47aae,0xc0e65299,
@@ -262,9 +262,13 @@ static const uint32 CNS_INIT[128] = {
     0x00000000,0x00000000,0x00000000,0xfc053c31
 };
 
-__m128i CNS128[32];
-__m128i ALLONE;
-__m128i MASK;
+/* Constants used straight from read only memory rather than globals set
+ * up by init_luffa, so the fixed length version doesn't need a context. */
+#define CNS128 ((const __m128i*)CNS_INIT)
+/* lower 32 bits set to '1' */
+#define MASK   _mm_set_epi32(0x00000000, 0x00000000, 0x00000000, 0xffffffff)
+/* all bits set to '1' */
+#define ALLONE _mm_set_epi32(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff)
 
 
 
@@ -273,18 +277,6 @@ HashReturn init_luffa(hashState_luffa *state, int hashbitlen)
     int i;
     state->hashbitlen = hashbitlen;
 
-    /* set the lower 32 bits to '1' */
-    MASK= _mm_set_epi32(0x00000000, 0x00000000, 0x00000000, 0xffffffff);
-
-    /* set all bits to '1' */
-    ALLONE = _mm_set_epi32(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff);
-
-    /* set the 32-bit round constant values to the 128-bit data field */
-    for (i=0;i<32;i++) {
-        CNS128[i] = _mm_loadu_si128((__m128i*)&CNS_INIT[i*4]);
-    }
-
-
 	for (i=0;i<10;i++) 
 		state->chainv[i] = _mm_loadu_si128((__m128i*)&IV[i*4]);
       
@@ -326,6 +318,22 @@ HashReturn final_luffa(hashState_luffa *state, BitSequence *hashval)
     return SUCCESS;
 }
 
+/* Luffa-512 of exactly 64 bytes. update_luffa already only handles 64
+ * bytes, this skips init and any copy of a pre-initialised context. */
+HashReturn luffa512_64(void *hashval, const void *data)
+{
+    hashState_luffa state;
+    int i;
+
+    for (i=0;i<10;i++)
+        state.chainv[i] = _mm_load_si128((const __m128i*)&IV[i*4]);
+
+    update_luffa(&state, (const BitSequence*) data, 512);
+    finalization512(&state, (uint32*) hashval);
+
+    return SUCCESS;
+}
+
 /***************************************************/
 /* Round function         */
 /* state: hash context    */
@@ -48,3 +48,4 @@
 HashReturn init_luffa(hashState_luffa *state, int hashbitlen);
 HashReturn update_luffa(hashState_luffa *state, const BitSequence *data, DataLength databitlen);
 HashReturn final_luffa(hashState_luffa *state, BitSequence *hashval);
+HashReturn luffa512_64(void *hashval, const void *data);
@@ -32,6 +32,8 @@
  * integer parameters (treated as type "unsigned int") in the order they are provided, plus the value
  * of nCols, (i.e., basil = kLen || pwdlen || saltlen || timeCost || nRows || nCols).
  *
+ * @param wholeMatrix Caller owned memory matrix of at least LYRA2_MATRIX_SIZE(nRows, nCols) bytes,
+ *                    64 byte aligned. It is fully rewritten on every call so it can be reused across hashes.
  * @param K The derived key to be output by the algorithm
  * @param kLen Desired key length
  * @param pwd User password
@@ -42,9 +44,9 @@
  * @param nRows Number or rows of the memory matrix (R)
  * @param nCols Number of columns of the memory matrix (C)
  *
- * @return 0 if the key is generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
+ * @return 0 if the key is generated correctly; -1 if there is an error (no memory matrix)
  */
-int LYRA2(void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *salt, int32_t saltlen, int64_t timeCost, const int16_t nRows, const int16_t nCols)
+int LYRA2(uint64_t *wholeMatrix, void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *salt, int32_t saltlen, int64_t timeCost, const int16_t nRows, const int16_t nCols)
 {
 	//============================= Basic variables ============================//
 	int64_t row = 2; //index of row to be processed
@@ -59,31 +61,20 @@ int LYRA2(void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *sa
 	//==========================================================================/
 
 	//========== Initializing the Memory Matrix and pointers to it =============//
-	//Tries to allocate enough space for the whole memory matrix
+	//The matrix is preallocated by the caller, rows are addressed arithmetically
 
 	const int64_t ROW_LEN_INT64 = BLOCK_LEN_INT64 * nCols;
-	const int64_t ROW_LEN_BYTES = ROW_LEN_INT64 * 8;
 	// for Lyra2REv2, nCols = 4, v1 was using 8
 	const int64_t BLOCK_LEN = (nCols == 4) ? BLOCK_LEN_BLAKE2_SAFE_INT64 : BLOCK_LEN_BLAKE2_SAFE_BYTES;
 
-	i = (int64_t)ROW_LEN_BYTES * nRows;
-	uint64_t *wholeMatrix = malloc(i);
 	if (wholeMatrix == NULL) {
 		return -1;
 	}
-	memset(wholeMatrix, 0, i);
 
-	//Allocates pointers to each row of the matrix
-	uint64_t **memMatrix = malloc(sizeof(uint64_t*) * nRows);
-	if (memMatrix == NULL) {
-		return -1;
-	}
-	//Places the pointers in the correct positions
-	uint64_t *ptrWord = wholeMatrix;
-	for (i = 0; i < nRows; i++) {
-		memMatrix[i] = ptrWord;
-		ptrWord += ROW_LEN_INT64;
-	}
+	//Every row is written by the setup phase before it is read so the
+	//matrix doesn't need to be cleared between hashes.
+#define MEM_ROW(r) (wholeMatrix + (r) * ROW_LEN_INT64)
+	uint64_t *ptrWord;
 	//==========================================================================/
 
 	//============= Getting the password + salt + basil padded with 10*1 ===============//
@@ -93,6 +84,10 @@ int LYRA2(void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *sa
 	//First, we clean enough blocks for the password, salt, basil and padding
 	int64_t nBlocksInput = ((saltlen + pwdlen + 6 * sizeof(uint64_t)) / BLOCK_LEN_BLAKE2_SAFE_BYTES) + 1;
 
+	//The absorbed blocks are BLOCK_LEN words apart, which for nCols == 8 leaves
+	//them spread beyond the padded input, so clear everything absorbed below.
+	memset(wholeMatrix, 0, ((nBlocksInput - 1) * BLOCK_LEN + BLOCK_LEN_BLAKE2_SAFE_INT64) * sizeof(uint64_t));
+
 	byte *ptrByte = (byte*) wholeMatrix;
 
 	//Prepends the password
@@ -133,7 +128,7 @@ int LYRA2(void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *sa
 
 	//======================= Initializing the Sponge State ====================//
 	//Sponge state: 16 uint64_t, BLOCK_LEN_INT64 words of them for the bitrate (b) and the remainder for the capacity (c)
-	uint64_t state[16];
+	uint64_t state[16] __attribute__ ((aligned (64)));
 	initState(state);
 	//==========================================================================/
 
@@ -146,14 +141,14 @@ int LYRA2(void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *sa
 	}
 
 	//Initializes M[0] and M[1]
-	reducedSqueezeRow0(state, memMatrix[0], nCols); //The locally copied password is most likely overwritten here
+	reducedSqueezeRow0(state, MEM_ROW(0), nCols); //The locally copied password is most likely overwritten here
 
-	reducedDuplexRow1(state, memMatrix[0], memMatrix[1], nCols);
+	reducedDuplexRow1(state, MEM_ROW(0), MEM_ROW(1), nCols);
 
 	do {
 		//M[row] = rand; //M[row*] = M[row*] XOR rotW(rand)
 
-		reducedDuplexRowSetup(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+		reducedDuplexRowSetup(state, MEM_ROW(prev), MEM_ROW(rowa), MEM_ROW(row), nCols);
 
 		//updates the value of row* (deterministically picked during Setup))
 		rowa = (rowa + step) & (window - 1);
@@ -185,7 +180,7 @@ int LYRA2(void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *sa
 			//------------------------------------------------------------------------------------------
 
 			//Performs a reduced-round duplexing operation over M[row*] XOR M[prev], updating both M[row*] and M[row]
-			reducedDuplexRow(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+			reducedDuplexRow(state, MEM_ROW(prev), MEM_ROW(rowa), MEM_ROW(row), nCols);
 
 			//update prev: it now points to the last row ever computed
 			prev = row;
@@ -201,14 +196,145 @@ int LYRA2(void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *sa
 
 	//============================ Wrap-up Phase ===============================//
 	//Absorbs the last block of the memory matrix
-	absorbBlock(state, memMatrix[rowa]);
+	absorbBlock(state, MEM_ROW(rowa));
 
 	//Squeezes the key
 	squeeze(state, K, (unsigned int) kLen);
 
-	//========================= Freeing the memory =============================//
-	free(memMatrix);
-	free(wholeMatrix);
+#undef MEM_ROW
 
 	return 0;
 }
+
+#if defined(LYRA2_2WAY)
+
+/**
+ * Executes Lyra2 for two independent inputs at once using the two lane sponge.
+ * Parameters are as for LYRA2, with a key, password and salt per lane.
+ *
+ * @param wholeMatrix Caller owned memory matrix of at least 2 * LYRA2_MATRIX_SIZE(nRows, nCols)
+ *                    bytes, 64 byte aligned. The rows of both lanes are interleaved.
+ *
+ * @return 0 if the keys are generated correctly; -1 if there is an error (no memory matrix)
+ */
+int LYRA2_2way(uint64_t *wholeMatrix, void *K0, void *K1, int64_t kLen, const void *pwd0, const void *pwd1, int32_t pwdlen, const void *salt0, const void *salt1, int32_t saltlen, int64_t timeCost, const int16_t nRows, const int16_t nCols)
+{
+	int64_t row = 2;
+	int64_t prev = 1;
+	int64_t rowa = 0;
+	int64_t rowa0, rowa1;
+	int64_t tau;
+	int64_t step = 1;
+	int64_t window = 2;
+	int64_t gap = 1;
+	int64_t i;
+	int64_t v64;
+	int lane;
+
+	const int64_t ROW_LEN_INT64 = BLOCK_LEN_INT64 * nCols;
+	const int64_t BLOCK_LEN = (nCols == 4) ? BLOCK_LEN_BLAKE2_SAFE_INT64 : BLOCK_LEN_BLAKE2_SAFE_BYTES;
+
+	if (wholeMatrix == NULL) {
+		return -1;
+	}
+
+#define MEM_ROW2(r) (wholeMatrix + (r) * 2 * ROW_LEN_INT64)
+
+	//The padded input of each lane is built in a local buffer laid out as
+	//LYRA2 lays it out at the start of its matrix.
+	int64_t nBlocksInput = ((saltlen + pwdlen + 6 * sizeof(uint64_t)) / BLOCK_LEN_BLAKE2_SAFE_BYTES) + 1;
+	const int64_t IN_LEN_INT64 = (nBlocksInput - 1) * BLOCK_LEN + BLOCK_LEN_BLAKE2_SAFE_INT64;
+	uint64_t in[2][IN_LEN_INT64];
+	const void *pwd[2] = { pwd0, pwd1 };
+	const void *salt[2] = { salt0, salt1 };
+
+	for (lane = 0; lane < 2; lane++) {
+		memset(in[lane], 0, IN_LEN_INT64 * sizeof(uint64_t));
+		byte *ptrByte = (byte*) in[lane];
+		memcpy(ptrByte, pwd[lane], pwdlen);
+		ptrByte += pwdlen;
+		memcpy(ptrByte, salt[lane], saltlen);
+		ptrByte += saltlen;
+		memcpy(ptrByte, &kLen, sizeof(int64_t));
+		ptrByte += sizeof(uint64_t);
+		v64 = pwdlen;
+		memcpy(ptrByte, &v64, sizeof(int64_t));
+		ptrByte += sizeof(uint64_t);
+		v64 = saltlen;
+		memcpy(ptrByte, &v64, sizeof(int64_t));
+		ptrByte += sizeof(uint64_t);
+		v64 = timeCost;
+		memcpy(ptrByte, &v64, sizeof(int64_t));
+		ptrByte += sizeof(uint64_t);
+		v64 = nRows;
+		memcpy(ptrByte, &v64, sizeof(int64_t));
+		ptrByte += sizeof(uint64_t);
+		v64 = nCols;
+		memcpy(ptrByte, &v64, sizeof(int64_t));
+		ptrByte += sizeof(uint64_t);
+		*ptrByte = 0x80;
+		ptrByte = (byte*) in[lane] + nBlocksInput * BLOCK_LEN_BLAKE2_SAFE_BYTES - 1;
+		*ptrByte ^= 0x01;
+	}
+
+	__m512i state[4];
+	initState_2way(state);
+
+	//================================ Setup Phase =============================//
+	for (i = 0; i < nBlocksInput; i++)
+		absorbBlockBlake2Safe_2way(state, in[0] + i * BLOCK_LEN, in[1] + i * BLOCK_LEN);
+
+	reducedSqueezeRow0_2way(state, MEM_ROW2(0), nCols);
+
+	reducedDuplexRow1_2way(state, MEM_ROW2(0), MEM_ROW2(1), nCols);
+
+	do {
+		reducedDuplexRowSetup_2way(state, MEM_ROW2(prev), MEM_ROW2(rowa), MEM_ROW2(row), nCols);
+
+		rowa = (rowa + step) & (window - 1);
+		prev = row;
+		row++;
+
+		if (rowa == 0) {
+			step = window + gap;
+			window *= 2;
+			gap = -gap;
+		}
+
+	} while (row < nRows);
+
+	//============================ Wandering Phase =============================//
+	//Only row* depends on the state so it is the only index that differs per lane.
+	row = 0;
+	rowa0 = rowa1 = rowa;
+	for (tau = 1; tau <= timeCost; tau++) {
+		step = (tau % 2 == 0) ? -1 : nRows / 2 - 1;
+		do {
+			rowa0 = _mm_cvtsi128_si64(_mm512_castsi512_si128(state[0])) & (unsigned int)(nRows-1);
+			rowa1 = _mm_cvtsi128_si64(_mm512_extracti32x4_epi32(state[0], 2)) & (unsigned int)(nRows-1);
+
+			reducedDuplexRow_2way(state, MEM_ROW2(prev), MEM_ROW2(rowa0), MEM_ROW2(rowa1), MEM_ROW2(row), nCols);
+
+			prev = row;
+			row = (row + step) & (unsigned int)(nRows-1);
+
+		} while (row != 0);
+	}
+
+	//============================ Wrap-up Phase ===============================//
+	absorbBlock_2way(state, MEM_ROW2(rowa0), MEM_ROW2(rowa1));
+
+	uint64_t lane_state[2][16] __attribute__ ((aligned (64)));
+	for (i = 0; i < 4; i++) {
+		_mm256_store_si256((__m256i*)lane_state[0] + i, _mm512_castsi512_si256(state[i]));
+		_mm256_store_si256((__m256i*)lane_state[1] + i, _mm512_extracti64x4_epi64(state[i], 1));
+	}
+	squeeze(lane_state[0], K0, (unsigned int) kLen);
+	squeeze(lane_state[1], K1, (unsigned int) kLen);
+
+#undef MEM_ROW2
+
+	return 0;
+}
+
+#endif /* LYRA2_2WAY */
@@ -37,6 +37,15 @@ typedef unsigned char byte;
         #define BLOCK_LEN_BYTES (BLOCK_LEN_INT64 * 8)    //Block length, in bytes
 #endif
 
-int LYRA2(void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *salt, int32_t saltlen, int64_t timeCost, const int16_t nRows, const int16_t nCols);
+//Size in bytes of the memory matrix for a given geometry, callers preallocate
+//it once and pass it to every LYRA2 call.
+#define LYRA2_MATRIX_SIZE(nRows, nCols) ((int64_t)BLOCK_LEN_BYTES * (nCols) * (nRows))
+
+int LYRA2(uint64_t *wholeMatrix, void *K, int64_t kLen, const void *pwd, int32_t pwdlen, const void *salt, int32_t saltlen, int64_t timeCost, const int16_t nRows, const int16_t nCols);
+
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+//Two lanes at once, the matrix is 2 * LYRA2_MATRIX_SIZE(nRows, nCols) bytes.
+int LYRA2_2way(uint64_t *wholeMatrix, void *K0, void *K1, int64_t kLen, const void *pwd0, const void *pwd1, int32_t pwdlen, const void *salt0, const void *salt1, int32_t saltlen, int64_t timeCost, const int16_t nRows, const int16_t nCols);
+#endif
 
 #endif /* LYRA2_H_ */
@@ -17,6 +17,11 @@ typedef struct {
 
 lyra2re_ctx_holder lyra2re_ctx;
 
+// Lyra2 memory matrix, one per miner thread, allocated by the gate and reused
+// for every hash.
+#define L2RE_MATRIX_SIZE LYRA2_MATRIX_SIZE( 8, 8 )
+static __thread uint64_t *l2re_wholeMatrix = NULL;
+
 void init_lyra2re_ctx()
 {
         sph_blake256_init(&lyra2re_ctx.blake);
@@ -25,30 +30,58 @@ void init_lyra2re_ctx()
         sph_groestl256_init(&lyra2re_ctx.groestl);
 }
 
-void lyra2re_hash(void *state, const void *input)
-{
-        lyra2re_ctx_holder ctx;
-        memcpy(&ctx, &lyra2re_ctx, sizeof(lyra2re_ctx));
+// Blake-256 state after the 76 nonce invariant bytes of the header, set by
+// lyra2re_prehash before each scan.
+static __thread sph_blake256_context l2re_blake_mid;
 
+static void lyra2re_hash_ctx( lyra2re_ctx_holder *ctx, void *state,
+                              const void *input, size_t len )
+{
 	uint32_t hashA[8], hashB[8];
 
-	sph_blake256(&ctx.blake, input, 80);
-	sph_blake256_close(&ctx.blake, hashA);
+	sph_blake256(&ctx->blake, input, len);
+	sph_blake256_close(&ctx->blake, hashA);
 
-	sph_keccak256(&ctx.keccak, hashA, 32);
-	sph_keccak256_close(&ctx.keccak, hashB);
+	sph_keccak256(&ctx->keccak, hashA, 32);
+	sph_keccak256_close(&ctx->keccak, hashB);
 
-	LYRA2(hashA, 32, hashB, 32, hashB, 32, 1, 8, 8);
+	LYRA2(l2re_wholeMatrix, hashA, 32, hashB, 32, hashB, 32, 1, 8, 8);
 
-	sph_skein256(&ctx.skein, hashA, 32);
-	sph_skein256_close(&ctx.skein, hashB);
+	sph_skein256(&ctx->skein, hashA, 32);
+	sph_skein256_close(&ctx->skein, hashB);
 
-	sph_groestl256(&ctx.groestl, hashB, 32);
-	sph_groestl256_close(&ctx.groestl, hashA);
+	sph_groestl256(&ctx->groestl, hashB, 32);
+	sph_groestl256_close(&ctx->groestl, hashA);
 
 	memcpy(state, hashA, 32);
 }
 
+void lyra2re_hash(void *state, const void *input)
+{
+        lyra2re_ctx_holder ctx;
+        memcpy(&ctx, &lyra2re_ctx, sizeof(lyra2re_ctx));
+        lyra2re_hash_ctx( &ctx, state, input, 80 );
+}
+
+// input is the full big endian header, only the nonce is read.
+static void lyra2re_hash_mid( void *state, const void *input )
+{
+        lyra2re_ctx_holder ctx;
+        memcpy(&ctx, &lyra2re_ctx, sizeof(lyra2re_ctx));
+        memcpy(&ctx.blake, &l2re_blake_mid, sizeof ctx.blake);
+        lyra2re_hash_ctx( &ctx, state, (const uint32_t*)input + 19, 4 );
+}
+
+void lyra2re_prehash( struct work *work )
+{
+	uint32_t _ALIGN(64) endiandata[19];
+
+	for (int k=0; k < 19; k++)
+		be32enc(&endiandata[k], work->data[k]);
+	memcpy(&l2re_blake_mid, &lyra2re_ctx.blake, sizeof l2re_blake_mid);
+	sph_blake256(&l2re_blake_mid, endiandata, 76);
+}
+
 int scanhash_lyra2re(int thr_id, struct work *work,
 	uint32_t max_nonce,	uint64_t *hashes_done)
 {
@@ -70,7 +103,7 @@ int scanhash_lyra2re(int thr_id, struct work *work,
 		const uint32_t Htarg = ptarget[7];
 		uint32_t hash[8];
 		be32enc(&endiandata[19], nonce);
-		lyra2re_hash(hash, endiandata);
+		lyra2re_hash_mid(hash, endiandata);
 
 		if (hash[7] <= Htarg )
                 {
@@ -100,6 +133,17 @@ void lyra2re_set_target ( struct work* work, double job_diff )
    work_set_target(work, job_diff / (128.0 * opt_diff_factor) );
 }
 
+bool lyra2re_get_scratchbuf( unsigned char** scratchbuf )
+{
+   // 64 byte align the matrix, same as scrypt.
+   unsigned char *buf = (unsigned char*) malloc( L2RE_MATRIX_SIZE + 63 );
+   if ( buf == NULL )
+      return false;
+   l2re_wholeMatrix = (uint64_t*)( ( (uintptr_t)buf + 63 ) & ~(uintptr_t)63 );
+   *scratchbuf = buf;
+   return true;
+}
+
 bool register_lyra2re_algo( algo_gate_t* gate )
 {
   gate->init_ctx   = (void*)&init_lyra2re_ctx;
@@ -108,6 +152,8 @@ bool register_lyra2re_algo( algo_gate_t* gate )
   gate->hash_alt   = (void*)&lyra2re_hash;
   gate->get_max64  = (void*)&lyra2re_get_max64;
   gate->set_target = (void*)&lyra2re_set_target;
+  gate->get_scratchbuf = (void*)&lyra2re_get_scratchbuf;
+  gate->prehash    = (void*)&lyra2re_prehash;
   return true;
 };
 
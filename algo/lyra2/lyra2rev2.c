@@ -11,8 +11,18 @@
 
 #include "algo/cubehash/sse2/cubehash_sse2.h" 
 
+#include "algo/blake/blake-hash-4way.h"
+#include "algo/keccak/keccak-hash-4way.h"
+#include "algo/cubehash/cube-hash-2way.h"
+#include "algo/skein/skein-hash-4way.h"
+#include "algo/bmw/bmw-hash-4way.h"
+
 #include "lyra2.h"
 
+#if defined(__AVX2__)
+  #define LYRA2REV2_4WAY
+#endif
+
 typedef struct {
 //        cubehashParam           cube1;
 //        cubehashParam           cube2;
@@ -27,6 +37,15 @@ typedef struct {
 
 lyra2v2_ctx_holder lyra2v2_ctx;
 
+// Lyra2 memory matrix, one per miner thread, allocated by the gate and reused
+// for every hash. The two lane sponge needs room for both lanes.
+#if defined(LYRA2_2WAY)
+  #define L2V2_MATRIX_SIZE ( 2 * LYRA2_MATRIX_SIZE( 4, 4 ) )
+#else
+  #define L2V2_MATRIX_SIZE LYRA2_MATRIX_SIZE( 4, 4 )
+#endif
+static __thread uint64_t *l2v2_wholeMatrix = NULL;
+
 void init_lyra2rev2_ctx()
 {
 //        cubehashInit(&lyra2v2_ctx.cube1,512,16,32);
@@ -39,11 +58,13 @@ void init_lyra2rev2_ctx()
         sph_bmw256_init(&lyra2v2_ctx.bmw);
 }
 
-void lyra2rev2_hash(void *state, const void *input)
-{
-        lyra2v2_ctx_holder ctx;
-        memcpy(&ctx, &lyra2v2_ctx, sizeof(lyra2v2_ctx));
+// Blake-256 state after the 76 nonce invariant bytes of the header, set by
+// lyra2rev2_prehash before each scan.
+static __thread sph_blake256_context l2v2_sph_blake_mid;
 
+static void lyra2rev2_hash_ctx( lyra2v2_ctx_holder *ctx, void *state,
+                                const void *input, size_t len )
+{
 	uint32_t _ALIGN(128) hashA[8], hashB[8];
 
 //	sph_blake256_context     ctx_blake;
@@ -53,41 +74,131 @@ void lyra2rev2_hash(void *state, const void *input)
 //	sph_bmw256_context       ctx_bmw;
 
 //	sph_blake256_init(&ctx.blake);
-	sph_blake256(&ctx.blake, input, 80);
-	sph_blake256_close(&ctx.blake, hashA);
+	sph_blake256(&ctx->blake, input, len);
+	sph_blake256_close(&ctx->blake, hashA);
 
 //	sph_keccak256_init(&ctx.keccak);
-	sph_keccak256(&ctx.keccak, hashA, 32);
-	sph_keccak256_close(&ctx.keccak, hashB);
+	sph_keccak256(&ctx->keccak, hashA, 32);
+	sph_keccak256_close(&ctx->keccak, hashB);
 
 
 //        cubehashUpdate( &ctx.cube1, (const byte*) hashB,32);
 //        cubehashDigest( &ctx.cube1, (byte*)hashA);
 
 //	sph_cubehash256_init(&ctx.cube);
-	sph_cubehash256(&ctx.cube1, hashB, 32);
-	sph_cubehash256_close(&ctx.cube1, hashA);
+	sph_cubehash256(&ctx->cube1, hashB, 32);
+	sph_cubehash256_close(&ctx->cube1, hashA);
 
-	LYRA2(hashA, 32, hashA, 32, hashA, 32, 1, 4, 4);
+	LYRA2(l2v2_wholeMatrix, hashA, 32, hashA, 32, hashA, 32, 1, 4, 4);
 
 //	sph_skein256_init(&ctx.skein);
-	sph_skein256(&ctx.skein, hashA, 32);
-	sph_skein256_close(&ctx.skein, hashB);
+	sph_skein256(&ctx->skein, hashA, 32);
+	sph_skein256_close(&ctx->skein, hashB);
 
 //        cubehashUpdate( &ctx.cube2, (const byte*) hashB,32);
 //        cubehashDigest( &ctx.cube2, (byte*)hashA);
 
 //	sph_cubehash256_init(&ctx.cube);
-	sph_cubehash256(&ctx.cube2, hashB, 32);
-	sph_cubehash256_close(&ctx.cube2, hashA);
+	sph_cubehash256(&ctx->cube2, hashB, 32);
+	sph_cubehash256_close(&ctx->cube2, hashA);
 
 //	sph_bmw256_init(&ctx.bmw);
-	sph_bmw256(&ctx.bmw, hashA, 32);
-	sph_bmw256_close(&ctx.bmw, hashB);
+	sph_bmw256(&ctx->bmw, hashA, 32);
+	sph_bmw256_close(&ctx->bmw, hashB);
 
 	memcpy(state, hashB, 32);
 }
 
+void lyra2rev2_hash(void *state, const void *input)
+{
+        lyra2v2_ctx_holder ctx;
+        memcpy(&ctx, &lyra2v2_ctx, sizeof(lyra2v2_ctx));
+        lyra2rev2_hash_ctx( &ctx, state, input, 80 );
+}
+
+// input is the full big endian header, only the nonce is read.
+static void lyra2rev2_hash_mid( void *state, const void *input )
+{
+	lyra2v2_ctx_holder ctx;
+	memcpy(&ctx, &lyra2v2_ctx, sizeof(lyra2v2_ctx));
+	memcpy(&ctx.blake, &l2v2_sph_blake_mid, sizeof ctx.blake);
+	lyra2rev2_hash_ctx( &ctx, state, (const uint32_t*)input + 19, 4 );
+}
+
+#if defined(LYRA2REV2_4WAY)
+
+// Four nonces at once. Blake, keccak, skein and bmw run 4 lanes wide,
+// cubehash 4 or 2 lanes wide and Lyra2 either 2 lanes wide twice or one
+// lane at a time. Data is reinterleaved between the stages as each kernel
+// wants its own word size.
+
+// One stage runs at a time, the contexts share the space. Blake starts from
+// the header midstate, the others are initialized right before use.
+typedef union {
+	blake256_4way_context   blake;
+	keccak256_4way_context  keccak;
+	skein256_4way_context   skein;
+	bmw256_4way_context     bmw;
+} lyra2v2_4way_ctx_overlay;
+
+// Blake-256 state after the first 64 bytes of the header, set by
+// lyra2rev2_prehash.
+static __thread blake256_4way_context l2v2_blake_mid;
+
+// input is 4 interleaved 80 byte headers, output 4 consecutive hashes.
+void lyra2rev2_4way_hash( void *state, const void *input )
+{
+	uint32_t *out = (uint32_t*)state;
+	uint32_t hash0[8] __attribute__ ((aligned (64)));
+	uint32_t hash1[8] __attribute__ ((aligned (64)));
+	uint32_t hash2[8] __attribute__ ((aligned (64)));
+	uint32_t hash3[8] __attribute__ ((aligned (64)));
+	uint32_t vhash[8*4] __attribute__ ((aligned (64)));
+	void * const lanes[4] = { hash0, hash1, hash2, hash3 };
+	lyra2v2_4way_ctx_overlay ctx;
+
+	memcpy( &ctx.blake, &l2v2_blake_mid, sizeof ctx.blake );
+	blake256_4way( &ctx.blake, (const uint32_t*)input + 16*4, 16 );
+	blake256_4way_close( &ctx.blake, vhash );
+	mm_deinterleave_4x32( hash0, hash1, hash2, hash3, vhash, 256 );
+
+	mm256_interleave_4x64( vhash, hash0, hash1, hash2, hash3, 256 );
+	keccak256_4way_init( &ctx.keccak );
+	keccak256_4way( &ctx.keccak, vhash, 32 );
+	keccak256_4way_close( &ctx.keccak, vhash );
+	mm256_deinterleave_4x64( hash0, hash1, hash2, hash3, vhash, 256 );
+
+	cube256_x4( lanes, 32 );
+
+#if defined(LYRA2_2WAY)
+	LYRA2_2way( l2v2_wholeMatrix, hash0, hash1, 32, hash0, hash1, 32,
+	            hash0, hash1, 32, 1, 4, 4 );
+	LYRA2_2way( l2v2_wholeMatrix, hash2, hash3, 32, hash2, hash3, 32,
+	            hash2, hash3, 32, 1, 4, 4 );
+#else
+	LYRA2( l2v2_wholeMatrix, hash0, 32, hash0, 32, hash0, 32, 1, 4, 4 );
+	LYRA2( l2v2_wholeMatrix, hash1, 32, hash1, 32, hash1, 32, 1, 4, 4 );
+	LYRA2( l2v2_wholeMatrix, hash2, 32, hash2, 32, hash2, 32, 1, 4, 4 );
+	LYRA2( l2v2_wholeMatrix, hash3, 32, hash3, 32, hash3, 32, 1, 4, 4 );
+#endif
+
+	mm256_interleave_4x64( vhash, hash0, hash1, hash2, hash3, 256 );
+	skein256_4way_init( &ctx.skein );
+	skein256_4way( &ctx.skein, vhash, 32 );
+	skein256_4way_close( &ctx.skein, vhash );
+	mm256_deinterleave_4x64( hash0, hash1, hash2, hash3, vhash, 256 );
+
+	cube256_x4( lanes, 32 );
+
+	mm_interleave_4x32( vhash, hash0, hash1, hash2, hash3, 256 );
+	bmw256_4way_init( &ctx.bmw );
+	bmw256_4way( &ctx.bmw, vhash, 32 );
+	bmw256_4way_close( &ctx.bmw, vhash );
+	mm_deinterleave_4x32( out, out+8, out+16, out+24, vhash, 256 );
+}
+
+#endif
+
 int scanhash_lyra2rev2(int thr_id, struct work *work,
 	uint32_t max_nonce, uint64_t *hashes_done)
 {
@@ -105,11 +216,47 @@ int scanhash_lyra2rev2(int thr_id, struct work *work,
 	for (int k=0; k < 20; k++)
 		be32enc(&endiandata[k], ((uint32_t*)pdata)[k]);
 
+#if defined(LYRA2REV2_4WAY)
+	uint32_t _ALIGN(64) vdata[20*4];
+	uint32_t _ALIGN(64) hash4[8*4];
+	uint32_t *noncep = vdata + 19*4;
+
+	mm_interleave_4x32( vdata, endiandata, endiandata, endiandata,
+	                    endiandata, 640 );
+
+	while ( nonce < max_nonce && max_nonce - nonce >= 4
+	        && !work_restart[thr_id].restart )
+	{
+		const uint32_t Htarg = ptarget[7];
+		be32enc( noncep,   nonce   );
+		be32enc( noncep+1, nonce+1 );
+		be32enc( noncep+2, nonce+2 );
+		be32enc( noncep+3, nonce+3 );
+		lyra2rev2_4way_hash( hash4, vdata );
+
+		for ( int i = 0; i < 4; i++ )
+		if ( hash4[i*8+7] <= Htarg && fulltest( hash4 + i*8, ptarget ) )
+		{
+			pdata[19] = nonce + i;
+			*hashes_done = pdata[19] - first_nonce;
+			return 1;
+		}
+		nonce += 4;
+	}
+	// up to 3 nonces left over go through the single lane loop below
+	if ( nonce >= max_nonce || work_restart[thr_id].restart )
+	{
+		pdata[19] = nonce;
+		*hashes_done = pdata[19] - first_nonce + 1;
+		return 0;
+	}
+#endif
+
 	do {
 		const uint32_t Htarg = ptarget[7];
 		uint32_t hash[8];
 		be32enc(&endiandata[19], nonce);
-		lyra2rev2_hash(hash, endiandata);
+		lyra2rev2_hash_mid(hash, endiandata);
 
 		if (hash[7] <= Htarg )
                 {
@@ -129,11 +276,42 @@ int scanhash_lyra2rev2(int thr_id, struct work *work,
 	return 0;
 }
 
+void lyra2rev2_prehash( struct work *work )
+{
+	uint32_t _ALIGN(64) endiandata[20];
+
+	for (int k=0; k < 19; k++)
+		be32enc(&endiandata[k], work->data[k]);
+	memcpy(&l2v2_sph_blake_mid, &lyra2v2_ctx.blake,
+	       sizeof l2v2_sph_blake_mid);
+	sph_blake256(&l2v2_sph_blake_mid, endiandata, 76);
+
+#if defined(LYRA2REV2_4WAY)
+	uint32_t _ALIGN(64) vdata[16*4];
+
+	mm_interleave_4x32( vdata, endiandata, endiandata, endiandata,
+	                    endiandata, 512 );
+	blake256_4way_init( &l2v2_blake_mid );
+	blake256_4way( &l2v2_blake_mid, vdata, 64 );
+#endif
+}
+
 void lyra2rev2_set_target( struct work* work, double job_diff )
 {
  work_set_target( work, job_diff / (256.0 * opt_diff_factor) );
 }
 
+bool lyra2rev2_get_scratchbuf( unsigned char** scratchbuf )
+{
+   // 64 byte align the matrix, same as scrypt.
+   unsigned char *buf = (unsigned char*) malloc( L2V2_MATRIX_SIZE + 63 );
+   if ( buf == NULL )
+      return false;
+   l2v2_wholeMatrix = (uint64_t*)( ( (uintptr_t)buf + 63 ) & ~(uintptr_t)63 );
+   *scratchbuf = buf;
+   return true;
+}
+
 bool register_lyra2rev2_algo( algo_gate_t* gate )
 {
   gate->init_ctx   = (void*)&init_lyra2rev2_ctx;
@@ -141,6 +319,8 @@ bool register_lyra2rev2_algo( algo_gate_t* gate )
   gate->hash       = (void*)&lyra2rev2_hash;
   gate->hash_alt   = (void*)&lyra2rev2_hash;
   gate->set_target = (void*)&lyra2rev2_set_target;
+  gate->get_scratchbuf = (void*)&lyra2rev2_get_scratchbuf;
+  gate->prehash    = (void*)&lyra2rev2_prehash;
   return true;
 };
 
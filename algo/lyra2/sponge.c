@@ -24,6 +24,24 @@
 #include "sponge.h"
 #include "lyra2.h"
 
+#if defined(__AVX2__)
+
+// M[row*][col] ^= rotW(rand), rotW rotates the 12 word block by one word:
+// { s[11], s[0], ... s[10] }.
+#define LYRA2_ROTW_XOR( p, io0, io1, io2, s0, s1, s2 ) do { \
+	__m256i r0 = _mm256_permute4x64_epi64( s0, 0x93 ); \
+	__m256i r1 = _mm256_permute4x64_epi64( s1, 0x93 ); \
+	__m256i r2 = _mm256_permute4x64_epi64( s2, 0x93 ); \
+	_mm256_storeu_si256( (p),   _mm256_xor_si256( io0, \
+	                            _mm256_blend_epi32( r0, r2, 0x03 ) ) ); \
+	_mm256_storeu_si256( (p)+1, _mm256_xor_si256( io1, \
+	                            _mm256_blend_epi32( r1, r0, 0x03 ) ) ); \
+	_mm256_storeu_si256( (p)+2, _mm256_xor_si256( io2, \
+	                            _mm256_blend_epi32( r2, r1, 0x03 ) ) ); \
+  } while(0)
+
+#endif
+
 
 /**
  * Initializes the Sponge State. The first 512 bits are set to zeros and the remainder
@@ -56,6 +74,19 @@ void initState(uint64_t state[/*16*/]) {
  * @param v     A 1024-bit (16 uint64_t) array to be processed by Blake2b's G function
  */
 __inline static void blake2bLyra(uint64_t *v) {
+#if defined(__AVX2__)
+	__m256i *s = (__m256i*)v;
+	__m256i s0 = _mm256_load_si256( s );
+	__m256i s1 = _mm256_load_si256( s+1 );
+	__m256i s2 = _mm256_load_si256( s+2 );
+	__m256i s3 = _mm256_load_si256( s+3 );
+	for ( int r = 0; r < 12; r++ )
+		ROUND_LYRA_AVX2( s0, s1, s2, s3 );
+	_mm256_store_si256( s,   s0 );
+	_mm256_store_si256( s+1, s1 );
+	_mm256_store_si256( s+2, s2 );
+	_mm256_store_si256( s+3, s3 );
+#else
 	ROUND_LYRA(0);
 	ROUND_LYRA(1);
 	ROUND_LYRA(2);
@@ -68,6 +99,7 @@ __inline static void blake2bLyra(uint64_t *v) {
 	ROUND_LYRA(9);
 	ROUND_LYRA(10);
 	ROUND_LYRA(11);
+#endif
 }
 
 /**
@@ -115,6 +147,24 @@ void squeeze(uint64_t *state, byte *out, unsigned int len)
  */
 void absorbBlock(uint64_t *state, const uint64_t *in)
 {
+#if defined(__AVX2__)
+	__m256i *s = (__m256i*)state;
+	__m256i s0 = _mm256_xor_si256( _mm256_load_si256( s ),
+	                               _mm256_loadu_si256( (__m256i*)in ) );
+	__m256i s1 = _mm256_xor_si256( _mm256_load_si256( s+1 ),
+	                               _mm256_loadu_si256( (__m256i*)in + 1 ) );
+	__m256i s2 = _mm256_xor_si256( _mm256_load_si256( s+2 ),
+	                               _mm256_loadu_si256( (__m256i*)in + 2 ) );
+	__m256i s3 = _mm256_load_si256( s+3 );
+
+	for ( int r = 0; r < 12; r++ )
+		ROUND_LYRA_AVX2( s0, s1, s2, s3 );
+
+	_mm256_store_si256( s,   s0 );
+	_mm256_store_si256( s+1, s1 );
+	_mm256_store_si256( s+2, s2 );
+	_mm256_store_si256( s+3, s3 );
+#else
 	//XORs the first BLOCK_LEN_INT64 words of "in" with the current state
 	state[0] ^= in[0];
 	state[1] ^= in[1];
@@ -131,6 +181,7 @@ void absorbBlock(uint64_t *state, const uint64_t *in)
 
 	//Applies the transformation f to the sponge's state
 	blake2bLyra(state);
+#endif
 }
 
 /**
@@ -142,6 +193,23 @@ void absorbBlock(uint64_t *state, const uint64_t *in)
  */
 void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in)
 {
+#if defined(__AVX2__)
+	__m256i *s = (__m256i*)state;
+	__m256i s0 = _mm256_xor_si256( _mm256_load_si256( s ),
+	                               _mm256_loadu_si256( (__m256i*)in ) );
+	__m256i s1 = _mm256_xor_si256( _mm256_load_si256( s+1 ),
+	                               _mm256_loadu_si256( (__m256i*)in + 1 ) );
+	__m256i s2 = _mm256_load_si256( s+2 );
+	__m256i s3 = _mm256_load_si256( s+3 );
+
+	for ( int r = 0; r < 12; r++ )
+		ROUND_LYRA_AVX2( s0, s1, s2, s3 );
+
+	_mm256_store_si256( s,   s0 );
+	_mm256_store_si256( s+1, s1 );
+	_mm256_store_si256( s+2, s2 );
+	_mm256_store_si256( s+3, s3 );
+#else
 	//XORs the first BLOCK_LEN_BLAKE2_SAFE_INT64 words of "in" with the current state
 
 	state[0] ^= in[0];
@@ -155,6 +223,7 @@ void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in)
 
 	//Applies the transformation f to the sponge's state
 	blake2bLyra(state);
+#endif
 }
 
 /**
@@ -167,6 +236,33 @@ void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in)
  */
 void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, const uint32_t nCols)
 {
+#if defined(__AVX2__)
+	__m256i *s = (__m256i*)state;
+	__m256i* ptrWord = (__m256i*)( rowOut + (nCols-1)*BLOCK_LEN_INT64 ); //In Lyra2: pointer to M[0][C-1]
+	__m256i s0 = _mm256_load_si256( s );
+	__m256i s1 = _mm256_load_si256( s+1 );
+	__m256i s2 = _mm256_load_si256( s+2 );
+	__m256i s3 = _mm256_load_si256( s+3 );
+	unsigned int i;
+
+	//M[row][C-1-col] = H.reduced_squeeze()
+	for (i = 0; i < nCols; i++) {
+		_mm256_storeu_si256( ptrWord,   s0 );
+		_mm256_storeu_si256( ptrWord+1, s1 );
+		_mm256_storeu_si256( ptrWord+2, s2 );
+
+		//Goes to next block (column) that will receive the squeezed data
+		ptrWord -= BLOCK_LEN_INT64 / 4;
+
+		//Applies the reduced-round transformation f to the sponge's state
+		ROUND_LYRA_AVX2( s0, s1, s2, s3 );
+	}
+
+	_mm256_store_si256( s,   s0 );
+	_mm256_store_si256( s+1, s1 );
+	_mm256_store_si256( s+2, s2 );
+	_mm256_store_si256( s+3, s3 );
+#else
 	uint64_t* ptrWord = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to M[0][C-1]
 	unsigned int i;
 	//M[row][C-1-col] = H.reduced_squeeze()
@@ -190,6 +286,7 @@ void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, const uint32_t nCols)
 		//Applies the reduced-round transformation f to the sponge's state
 		reducedBlake2bLyra(state);
 	}
+#endif
 }
 
 /**
@@ -203,6 +300,46 @@ void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, const uint32_t nCols)
  */
 void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, const uint32_t nCols)
 {
+#if defined(__AVX2__)
+	__m256i *s = (__m256i*)state;
+	__m256i* ptrWordIn = (__m256i*)rowIn;				//In Lyra2: pointer to prev
+	__m256i* ptrWordOut = (__m256i*)( rowOut + (nCols-1)*BLOCK_LEN_INT64 ); //In Lyra2: pointer to row
+	__m256i s0 = _mm256_load_si256( s );
+	__m256i s1 = _mm256_load_si256( s+1 );
+	__m256i s2 = _mm256_load_si256( s+2 );
+	__m256i s3 = _mm256_load_si256( s+3 );
+	__m256i in0, in1, in2;
+	unsigned int i;
+
+	for (i = 0; i < nCols; i++) {
+
+		//Absorbing "M[prev][col]"
+		in0 = _mm256_loadu_si256( ptrWordIn );
+		in1 = _mm256_loadu_si256( ptrWordIn+1 );
+		in2 = _mm256_loadu_si256( ptrWordIn+2 );
+		s0 = _mm256_xor_si256( s0, in0 );
+		s1 = _mm256_xor_si256( s1, in1 );
+		s2 = _mm256_xor_si256( s2, in2 );
+
+		//Applies the reduced-round transformation f to the sponge's state
+		ROUND_LYRA_AVX2( s0, s1, s2, s3 );
+
+		//M[row][C-1-col] = M[prev][col] XOR rand
+		_mm256_storeu_si256( ptrWordOut,   _mm256_xor_si256( in0, s0 ) );
+		_mm256_storeu_si256( ptrWordOut+1, _mm256_xor_si256( in1, s1 ) );
+		_mm256_storeu_si256( ptrWordOut+2, _mm256_xor_si256( in2, s2 ) );
+
+		//Input: next column (i.e., next block in sequence)
+		ptrWordIn += BLOCK_LEN_INT64 / 4;
+		//Output: goes to previous column
+		ptrWordOut -= BLOCK_LEN_INT64 / 4;
+	}
+
+	_mm256_store_si256( s,   s0 );
+	_mm256_store_si256( s+1, s1 );
+	_mm256_store_si256( s+2, s2 );
+	_mm256_store_si256( s+3, s3 );
+#else
 	uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
 	uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
 	unsigned int i;
@@ -245,6 +382,7 @@ void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, const
 		//Output: goes to previous column
 		ptrWordOut -= BLOCK_LEN_INT64;
 	}
+#endif
 }
 
 /**
@@ -263,6 +401,54 @@ void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, const
  */
 void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, const uint32_t nCols)
 {
+#if defined(__AVX2__)
+	__m256i *s = (__m256i*)state;
+	__m256i* ptrWordIn = (__m256i*)rowIn;				//In Lyra2: pointer to prev
+	__m256i* ptrWordInOut = (__m256i*)rowInOut;				//In Lyra2: pointer to row*
+	__m256i* ptrWordOut = (__m256i*)( rowOut + (nCols-1)*BLOCK_LEN_INT64 ); //In Lyra2: pointer to row
+	__m256i s0 = _mm256_load_si256( s );
+	__m256i s1 = _mm256_load_si256( s+1 );
+	__m256i s2 = _mm256_load_si256( s+2 );
+	__m256i s3 = _mm256_load_si256( s+3 );
+	__m256i in0, in1, in2, io0, io1, io2;
+	unsigned int i;
+
+	for (i = 0; i < nCols; i++) {
+
+		//Absorbing "M[prev] [+] M[row*]"
+		in0 = _mm256_loadu_si256( ptrWordIn );
+		in1 = _mm256_loadu_si256( ptrWordIn+1 );
+		in2 = _mm256_loadu_si256( ptrWordIn+2 );
+		io0 = _mm256_loadu_si256( ptrWordInOut );
+		io1 = _mm256_loadu_si256( ptrWordInOut+1 );
+		io2 = _mm256_loadu_si256( ptrWordInOut+2 );
+		s0 = _mm256_xor_si256( s0, _mm256_add_epi64( in0, io0 ) );
+		s1 = _mm256_xor_si256( s1, _mm256_add_epi64( in1, io1 ) );
+		s2 = _mm256_xor_si256( s2, _mm256_add_epi64( in2, io2 ) );
+
+		//Applies the reduced-round transformation f to the sponge's state
+		ROUND_LYRA_AVX2( s0, s1, s2, s3 );
+
+		//M[row][col] = M[prev][col] XOR rand
+		_mm256_storeu_si256( ptrWordOut,   _mm256_xor_si256( in0, s0 ) );
+		_mm256_storeu_si256( ptrWordOut+1, _mm256_xor_si256( in1, s1 ) );
+		_mm256_storeu_si256( ptrWordOut+2, _mm256_xor_si256( in2, s2 ) );
+
+		//M[row*][col] = M[row*][col] XOR rotW(rand)
+		LYRA2_ROTW_XOR( ptrWordInOut, io0, io1, io2, s0, s1, s2 );
+
+		//Inputs: next column (i.e., next block in sequence)
+		ptrWordInOut += BLOCK_LEN_INT64 / 4;
+		ptrWordIn += BLOCK_LEN_INT64 / 4;
+		//Output: goes to previous column
+		ptrWordOut -= BLOCK_LEN_INT64 / 4;
+	}
+
+	_mm256_store_si256( s,   s0 );
+	_mm256_store_si256( s+1, s1 );
+	_mm256_store_si256( s+2, s2 );
+	_mm256_store_si256( s+3, s3 );
+#else
 	uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
 	uint64_t* ptrWordInOut = rowInOut;				//In Lyra2: pointer to row*
 	uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
@@ -321,6 +507,7 @@ void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut,
 		//Output: goes to previous column
 		ptrWordOut -= BLOCK_LEN_INT64;
 	}
+#endif
 }
 
 /**
@@ -339,6 +526,60 @@ void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut,
  */
 void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, const uint32_t nCols)
 {
+#if defined(__AVX2__)
+	__m256i *s = (__m256i*)state;
+	__m256i* ptrWordInOut = (__m256i*)rowInOut; //In Lyra2: pointer to row*
+	__m256i* ptrWordIn = (__m256i*)rowIn; //In Lyra2: pointer to prev
+	__m256i* ptrWordOut = (__m256i*)rowOut; //In Lyra2: pointer to row
+	__m256i s0 = _mm256_load_si256( s );
+	__m256i s1 = _mm256_load_si256( s+1 );
+	__m256i s2 = _mm256_load_si256( s+2 );
+	__m256i s3 = _mm256_load_si256( s+3 );
+	__m256i io0, io1, io2;
+	unsigned int i;
+
+	for (i = 0; i < nCols; i++) {
+
+		//Absorbing "M[prev] [+] M[row*]"
+		s0 = _mm256_xor_si256( s0, _mm256_add_epi64(
+		                             _mm256_loadu_si256( ptrWordIn ),
+		                             _mm256_loadu_si256( ptrWordInOut ) ) );
+		s1 = _mm256_xor_si256( s1, _mm256_add_epi64(
+		                             _mm256_loadu_si256( ptrWordIn+1 ),
+		                             _mm256_loadu_si256( ptrWordInOut+1 ) ) );
+		s2 = _mm256_xor_si256( s2, _mm256_add_epi64(
+		                             _mm256_loadu_si256( ptrWordIn+2 ),
+		                             _mm256_loadu_si256( ptrWordInOut+2 ) ) );
+
+		//Applies the reduced-round transformation f to the sponge's state
+		ROUND_LYRA_AVX2( s0, s1, s2, s3 );
+
+		//M[rowOut][col] = M[rowOut][col] XOR rand
+		_mm256_storeu_si256( ptrWordOut, _mm256_xor_si256(
+		                          _mm256_loadu_si256( ptrWordOut ), s0 ) );
+		_mm256_storeu_si256( ptrWordOut+1, _mm256_xor_si256(
+		                          _mm256_loadu_si256( ptrWordOut+1 ), s1 ) );
+		_mm256_storeu_si256( ptrWordOut+2, _mm256_xor_si256(
+		                          _mm256_loadu_si256( ptrWordOut+2 ), s2 ) );
+
+		//M[rowInOut][col] = M[rowInOut][col] XOR rotW(rand)
+		//rowOut and rowInOut may be the same row, reload after the store.
+		io0 = _mm256_loadu_si256( ptrWordInOut );
+		io1 = _mm256_loadu_si256( ptrWordInOut+1 );
+		io2 = _mm256_loadu_si256( ptrWordInOut+2 );
+		LYRA2_ROTW_XOR( ptrWordInOut, io0, io1, io2, s0, s1, s2 );
+
+		//Goes to next block
+		ptrWordOut += BLOCK_LEN_INT64 / 4;
+		ptrWordInOut += BLOCK_LEN_INT64 / 4;
+		ptrWordIn += BLOCK_LEN_INT64 / 4;
+	}
+
+	_mm256_store_si256( s,   s0 );
+	_mm256_store_si256( s+1, s1 );
+	_mm256_store_si256( s+2, s2 );
+	_mm256_store_si256( s+3, s3 );
+#else
 	uint64_t* ptrWordInOut = rowInOut; //In Lyra2: pointer to row*
 	uint64_t* ptrWordIn = rowIn; //In Lyra2: pointer to prev
 	uint64_t* ptrWordOut = rowOut; //In Lyra2: pointer to row
@@ -396,8 +637,264 @@ void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint
 		ptrWordInOut += BLOCK_LEN_INT64;
 		ptrWordIn += BLOCK_LEN_INT64;
 	}
+#endif
+}
+
+#if defined(LYRA2_2WAY)
+
+/* Two lane sponge, see sponge.h. Block words 4*i to 4*i+3 of both lanes
+   are one __m512i, a 12 word block of both lanes is 3 registers and the
+   interleaved rows are 2 * BLOCK_LEN_INT64 words per column. */
+
+#define BLOCK_LEN_M512 (BLOCK_LEN_INT64 / 4)
+
+// Lane 0 from row p0 and lane 1 from row p1, both interleaved.
+#define LOAD_2ROWS( p0, p1 ) \
+	_mm512_mask_loadu_epi64( _mm512_loadu_si512( p0 ), 0xf0, p1 )
+
+#define STORE_2ROWS( p0, p1, v ) do { \
+	_mm512_mask_storeu_epi64( p0, 0x0f, v ); \
+	_mm512_mask_storeu_epi64( p1, 0xf0, v ); \
+  } while(0)
+
+// Two plain (not interleaved) 4 word chunks, one per lane.
+#define LOAD_2LANES( p0, p1 ) \
+	_mm512_inserti64x4( _mm512_castsi256_si512( \
+	                    _mm256_loadu_si256( (__m256i*)(p0) ) ), \
+	                    _mm256_loadu_si256( (__m256i*)(p1) ), 1 )
+
+// rotW as in LYRA2_ROTW_XOR, the permute works on each lane separately.
+#define LYRA2_ROTW_2WAY( r0, r1, r2, s0, s1, s2 ) do { \
+	__m512i t0 = _mm512_permutex_epi64( s0, 0x93 ); \
+	__m512i t1 = _mm512_permutex_epi64( s1, 0x93 ); \
+	__m512i t2 = _mm512_permutex_epi64( s2, 0x93 ); \
+	r0 = _mm512_mask_blend_epi64( 0x11, t0, t2 ); \
+	r1 = _mm512_mask_blend_epi64( 0x11, t1, t0 ); \
+	r2 = _mm512_mask_blend_epi64( 0x11, t2, t1 ); \
+  } while(0)
+
+void initState_2way(__m512i state[/*4*/])
+{
+	state[0] = _mm512_setzero_si512();
+	state[1] = _mm512_setzero_si512();
+	state[2] = _mm512_set_epi64( blake2b_IV[3], blake2b_IV[2],
+	                             blake2b_IV[1], blake2b_IV[0],
+	                             blake2b_IV[3], blake2b_IV[2],
+	                             blake2b_IV[1], blake2b_IV[0] );
+	state[3] = _mm512_set_epi64( blake2b_IV[7], blake2b_IV[6],
+	                             blake2b_IV[5], blake2b_IV[4],
+	                             blake2b_IV[7], blake2b_IV[6],
+	                             blake2b_IV[5], blake2b_IV[4] );
+}
+
+/**
+ * absorbBlockBlake2Safe for two lanes, in0 and in1 are plain 8 word blocks.
+ */
+void absorbBlockBlake2Safe_2way(__m512i *state, const uint64_t *in0, const uint64_t *in1)
+{
+	__m512i s0 = _mm512_xor_si512( state[0], LOAD_2LANES( in0, in1 ) );
+	__m512i s1 = _mm512_xor_si512( state[1], LOAD_2LANES( in0+4, in1+4 ) );
+	__m512i s2 = state[2];
+	__m512i s3 = state[3];
+
+	for ( int r = 0; r < 12; r++ )
+		ROUND_LYRA_2WAY( s0, s1, s2, s3 );
+
+	state[0] = s0;
+	state[1] = s1;
+	state[2] = s2;
+	state[3] = s3;
+}
+
+/**
+ * absorbBlock for two lanes, lane 0 from interleaved row in0 and
+ * lane 1 from interleaved row in1.
+ */
+void absorbBlock_2way(__m512i *state, const uint64_t *in0, const uint64_t *in1)
+{
+	const __m512i *p0 = (const __m512i*)in0;
+	const __m512i *p1 = (const __m512i*)in1;
+	__m512i s0 = _mm512_xor_si512( state[0], LOAD_2ROWS( p0,   p1   ) );
+	__m512i s1 = _mm512_xor_si512( state[1], LOAD_2ROWS( p0+1, p1+1 ) );
+	__m512i s2 = _mm512_xor_si512( state[2], LOAD_2ROWS( p0+2, p1+2 ) );
+	__m512i s3 = state[3];
+
+	for ( int r = 0; r < 12; r++ )
+		ROUND_LYRA_2WAY( s0, s1, s2, s3 );
+
+	state[0] = s0;
+	state[1] = s1;
+	state[2] = s2;
+	state[3] = s3;
+}
+
+void reducedSqueezeRow0_2way(__m512i *state, uint64_t *rowOut, const uint32_t nCols)
+{
+	__m512i* ptrWord = (__m512i*)rowOut + (nCols-1)*BLOCK_LEN_M512;
+	__m512i s0 = state[0];
+	__m512i s1 = state[1];
+	__m512i s2 = state[2];
+	__m512i s3 = state[3];
+	unsigned int i;
+
+	for (i = 0; i < nCols; i++) {
+		_mm512_storeu_si512( ptrWord,   s0 );
+		_mm512_storeu_si512( ptrWord+1, s1 );
+		_mm512_storeu_si512( ptrWord+2, s2 );
+		ptrWord -= BLOCK_LEN_M512;
+		ROUND_LYRA_2WAY( s0, s1, s2, s3 );
+	}
+
+	state[0] = s0;
+	state[1] = s1;
+	state[2] = s2;
+	state[3] = s3;
 }
 
+void reducedDuplexRow1_2way(__m512i *state, uint64_t *rowIn, uint64_t *rowOut, const uint32_t nCols)
+{
+	__m512i* ptrWordIn = (__m512i*)rowIn;
+	__m512i* ptrWordOut = (__m512i*)rowOut + (nCols-1)*BLOCK_LEN_M512;
+	__m512i s0 = state[0];
+	__m512i s1 = state[1];
+	__m512i s2 = state[2];
+	__m512i s3 = state[3];
+	__m512i in0, in1, in2;
+	unsigned int i;
+
+	for (i = 0; i < nCols; i++) {
+		in0 = _mm512_loadu_si512( ptrWordIn );
+		in1 = _mm512_loadu_si512( ptrWordIn+1 );
+		in2 = _mm512_loadu_si512( ptrWordIn+2 );
+		s0 = _mm512_xor_si512( s0, in0 );
+		s1 = _mm512_xor_si512( s1, in1 );
+		s2 = _mm512_xor_si512( s2, in2 );
+
+		ROUND_LYRA_2WAY( s0, s1, s2, s3 );
+
+		_mm512_storeu_si512( ptrWordOut,   _mm512_xor_si512( in0, s0 ) );
+		_mm512_storeu_si512( ptrWordOut+1, _mm512_xor_si512( in1, s1 ) );
+		_mm512_storeu_si512( ptrWordOut+2, _mm512_xor_si512( in2, s2 ) );
+
+		ptrWordIn += BLOCK_LEN_M512;
+		ptrWordOut -= BLOCK_LEN_M512;
+	}
+
+	state[0] = s0;
+	state[1] = s1;
+	state[2] = s2;
+	state[3] = s3;
+}
+
+/**
+ * Setup duplexing for two lanes, every row index is the same for both lanes
+ * during setup.
+ */
+void reducedDuplexRowSetup_2way(__m512i *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, const uint32_t nCols)
+{
+	__m512i* ptrWordIn = (__m512i*)rowIn;
+	__m512i* ptrWordInOut = (__m512i*)rowInOut;
+	__m512i* ptrWordOut = (__m512i*)rowOut + (nCols-1)*BLOCK_LEN_M512;
+	__m512i s0 = state[0];
+	__m512i s1 = state[1];
+	__m512i s2 = state[2];
+	__m512i s3 = state[3];
+	__m512i in0, in1, in2, io0, io1, io2, r0, r1, r2;
+	unsigned int i;
+
+	for (i = 0; i < nCols; i++) {
+		in0 = _mm512_loadu_si512( ptrWordIn );
+		in1 = _mm512_loadu_si512( ptrWordIn+1 );
+		in2 = _mm512_loadu_si512( ptrWordIn+2 );
+		io0 = _mm512_loadu_si512( ptrWordInOut );
+		io1 = _mm512_loadu_si512( ptrWordInOut+1 );
+		io2 = _mm512_loadu_si512( ptrWordInOut+2 );
+		s0 = _mm512_xor_si512( s0, _mm512_add_epi64( in0, io0 ) );
+		s1 = _mm512_xor_si512( s1, _mm512_add_epi64( in1, io1 ) );
+		s2 = _mm512_xor_si512( s2, _mm512_add_epi64( in2, io2 ) );
+
+		ROUND_LYRA_2WAY( s0, s1, s2, s3 );
+
+		_mm512_storeu_si512( ptrWordOut,   _mm512_xor_si512( in0, s0 ) );
+		_mm512_storeu_si512( ptrWordOut+1, _mm512_xor_si512( in1, s1 ) );
+		_mm512_storeu_si512( ptrWordOut+2, _mm512_xor_si512( in2, s2 ) );
+
+		LYRA2_ROTW_2WAY( r0, r1, r2, s0, s1, s2 );
+		_mm512_storeu_si512( ptrWordInOut,   _mm512_xor_si512( io0, r0 ) );
+		_mm512_storeu_si512( ptrWordInOut+1, _mm512_xor_si512( io1, r1 ) );
+		_mm512_storeu_si512( ptrWordInOut+2, _mm512_xor_si512( io2, r2 ) );
+
+		ptrWordInOut += BLOCK_LEN_M512;
+		ptrWordIn += BLOCK_LEN_M512;
+		ptrWordOut -= BLOCK_LEN_M512;
+	}
+
+	state[0] = s0;
+	state[1] = s1;
+	state[2] = s2;
+	state[3] = s3;
+}
+
+/**
+ * Wandering duplexing for two lanes. The pseudorandom row* differs per lane,
+ * lane 0 uses rowInOut0 and lane 1 uses rowInOut1.
+ */
+void reducedDuplexRow_2way(__m512i *state, uint64_t *rowIn, uint64_t *rowInOut0, uint64_t *rowInOut1, uint64_t *rowOut, const uint32_t nCols)
+{
+	__m512i* ptrWordIn = (__m512i*)rowIn;
+	__m512i* ptrWordInOut0 = (__m512i*)rowInOut0;
+	__m512i* ptrWordInOut1 = (__m512i*)rowInOut1;
+	__m512i* ptrWordOut = (__m512i*)rowOut;
+	__m512i s0 = state[0];
+	__m512i s1 = state[1];
+	__m512i s2 = state[2];
+	__m512i s3 = state[3];
+	__m512i r0, r1, r2;
+	unsigned int i;
+
+	for (i = 0; i < nCols; i++) {
+		s0 = _mm512_xor_si512( s0, _mm512_add_epi64(
+		                 _mm512_loadu_si512( ptrWordIn ),
+		                 LOAD_2ROWS( ptrWordInOut0, ptrWordInOut1 ) ) );
+		s1 = _mm512_xor_si512( s1, _mm512_add_epi64(
+		                 _mm512_loadu_si512( ptrWordIn+1 ),
+		                 LOAD_2ROWS( ptrWordInOut0+1, ptrWordInOut1+1 ) ) );
+		s2 = _mm512_xor_si512( s2, _mm512_add_epi64(
+		                 _mm512_loadu_si512( ptrWordIn+2 ),
+		                 LOAD_2ROWS( ptrWordInOut0+2, ptrWordInOut1+2 ) ) );
+
+		ROUND_LYRA_2WAY( s0, s1, s2, s3 );
+
+		_mm512_storeu_si512( ptrWordOut, _mm512_xor_si512(
+		                        _mm512_loadu_si512( ptrWordOut ), s0 ) );
+		_mm512_storeu_si512( ptrWordOut+1, _mm512_xor_si512(
+		                        _mm512_loadu_si512( ptrWordOut+1 ), s1 ) );
+		_mm512_storeu_si512( ptrWordOut+2, _mm512_xor_si512(
+		                        _mm512_loadu_si512( ptrWordOut+2 ), s2 ) );
+
+		//rowOut may be the row* of either lane, reload after the store.
+		LYRA2_ROTW_2WAY( r0, r1, r2, s0, s1, s2 );
+		r0 = _mm512_xor_si512( r0, LOAD_2ROWS( ptrWordInOut0, ptrWordInOut1 ) );
+		r1 = _mm512_xor_si512( r1, LOAD_2ROWS( ptrWordInOut0+1, ptrWordInOut1+1 ) );
+		r2 = _mm512_xor_si512( r2, LOAD_2ROWS( ptrWordInOut0+2, ptrWordInOut1+2 ) );
+		STORE_2ROWS( ptrWordInOut0,   ptrWordInOut1,   r0 );
+		STORE_2ROWS( ptrWordInOut0+1, ptrWordInOut1+1, r1 );
+		STORE_2ROWS( ptrWordInOut0+2, ptrWordInOut1+2, r2 );
+
+		ptrWordOut += BLOCK_LEN_M512;
+		ptrWordInOut0 += BLOCK_LEN_M512;
+		ptrWordInOut1 += BLOCK_LEN_M512;
+		ptrWordIn += BLOCK_LEN_M512;
+	}
+
+	state[0] = s0;
+	state[1] = s1;
+	state[2] = s2;
+	state[3] = s3;
+}
+
+#endif /* LYRA2_2WAY */
+
 /**
  * Prints an array of unsigned chars
  */
@@ -66,6 +66,100 @@ static __inline uint64_t rotr64(const uint64_t w, const unsigned c) {
 	G(r,6,v[ 2],v[ 7],v[ 8],v[13]); \
 	G(r,7,v[ 3],v[ 4],v[ 9],v[14]);
 
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+/* Blake2b's rotations on each 64 bit word of a vector */
+#if defined(__AVX512VL__)
+
+#define mm256_rotr64_32(x) _mm256_ror_epi64( x, 32 )
+#define mm256_rotr64_24(x) _mm256_ror_epi64( x, 24 )
+#define mm256_rotr64_16(x) _mm256_ror_epi64( x, 16 )
+#define mm256_rotr64_63(x) _mm256_ror_epi64( x, 63 )
+
+#else
+
+#define mm256_rotr64_32(x) _mm256_shuffle_epi32( x, 0xb1 )
+#define mm256_rotr64_24(x) _mm256_shuffle_epi8( x, _mm256_set_epi8( \
+                    10, 9, 8,15,14,13,12,11, 2, 1, 0, 7, 6, 5, 4, 3, \
+                    10, 9, 8,15,14,13,12,11, 2, 1, 0, 7, 6, 5, 4, 3 ) )
+#define mm256_rotr64_16(x) _mm256_shuffle_epi8( x, _mm256_set_epi8( \
+                     9, 8,15,14,13,12,11,10, 1, 0, 7, 6, 5, 4, 3, 2, \
+                     9, 8,15,14,13,12,11,10, 1, 0, 7, 6, 5, 4, 3, 2 ) )
+#define mm256_rotr64_63(x) _mm256_or_si256( _mm256_srli_epi64( x, 63 ), \
+                                            _mm256_add_epi64( x, x ) )
+
+#endif
+
+/* Blake2b's G function applied to the four columns of a state held
+   as four rows of four words */
+#define G_4X64(a,b,c,d) do { \
+	a = _mm256_add_epi64( a, b ); \
+	d = mm256_rotr64_32( _mm256_xor_si256( d, a ) ); \
+	c = _mm256_add_epi64( c, d ); \
+	b = mm256_rotr64_24( _mm256_xor_si256( b, c ) ); \
+	a = _mm256_add_epi64( a, b ); \
+	d = mm256_rotr64_16( _mm256_xor_si256( d, a ) ); \
+	c = _mm256_add_epi64( c, d ); \
+	b = mm256_rotr64_63( _mm256_xor_si256( b, c ) ); \
+  } while(0)
+
+/*One Round of the Blake2b's compression function, the diagonals are
+  processed by rotating rows 1 to 3 into columns and back*/
+#define ROUND_LYRA_AVX2(s0,s1,s2,s3) do { \
+	G_4X64( s0, s1, s2, s3 ); \
+	s1 = _mm256_permute4x64_epi64( s1, 0x39 ); \
+	s2 = _mm256_permute4x64_epi64( s2, 0x4e ); \
+	s3 = _mm256_permute4x64_epi64( s3, 0x93 ); \
+	G_4X64( s0, s1, s2, s3 ); \
+	s1 = _mm256_permute4x64_epi64( s1, 0x93 ); \
+	s2 = _mm256_permute4x64_epi64( s2, 0x4e ); \
+	s3 = _mm256_permute4x64_epi64( s3, 0x39 ); \
+  } while(0)
+
+#endif /* __AVX2__ */
+
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+
+/* Two independent sponges side by side, lane 0 in the low 256 bits of
+   each register and lane 1 in the high 256 bits. Rows of the 2 way memory
+   matrix are interleaved in 256 bit chunks so a register loads the same
+   four words of both lanes. */
+#define LYRA2_2WAY
+
+#define G_2X4X64(a,b,c,d) do { \
+	a = _mm512_add_epi64( a, b ); \
+	d = _mm512_ror_epi64( _mm512_xor_si512( d, a ), 32 ); \
+	c = _mm512_add_epi64( c, d ); \
+	b = _mm512_ror_epi64( _mm512_xor_si512( b, c ), 24 ); \
+	a = _mm512_add_epi64( a, b ); \
+	d = _mm512_ror_epi64( _mm512_xor_si512( d, a ), 16 ); \
+	c = _mm512_add_epi64( c, d ); \
+	b = _mm512_ror_epi64( _mm512_xor_si512( b, c ), 63 ); \
+  } while(0)
+
+#define ROUND_LYRA_2WAY(s0,s1,s2,s3) do { \
+	G_2X4X64( s0, s1, s2, s3 ); \
+	s1 = _mm512_permutex_epi64( s1, 0x39 ); \
+	s2 = _mm512_permutex_epi64( s2, 0x4e ); \
+	s3 = _mm512_permutex_epi64( s3, 0x93 ); \
+	G_2X4X64( s0, s1, s2, s3 ); \
+	s1 = _mm512_permutex_epi64( s1, 0x93 ); \
+	s2 = _mm512_permutex_epi64( s2, 0x4e ); \
+	s3 = _mm512_permutex_epi64( s3, 0x39 ); \
+  } while(0)
+
+void initState_2way(__m512i state[/*4*/]);
+void absorbBlockBlake2Safe_2way(__m512i *state, const uint64_t *in0, const uint64_t *in1);
+void absorbBlock_2way(__m512i *state, const uint64_t *in0, const uint64_t *in1);
+void reducedSqueezeRow0_2way(__m512i *state, uint64_t *rowOut, const uint32_t nCols);
+void reducedDuplexRow1_2way(__m512i *state, uint64_t *rowIn, uint64_t *rowOut, const uint32_t nCols);
+void reducedDuplexRowSetup_2way(__m512i *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, const uint32_t nCols);
+void reducedDuplexRow_2way(__m512i *state, uint64_t *rowIn, uint64_t *rowInOut0, uint64_t *rowInOut1, uint64_t *rowOut, const uint32_t nCols);
+
+#endif /* __AVX512F__ && __AVX512VL__ */
+
 //---- Housekeeping
 void initState(uint64_t state[/*16*/]);
 
@@ -17,6 +17,14 @@
 
 #include "crypto/magimath.h"
 
+#if defined(__AVX2__) && defined(HAVE_SHA256_4WAY)
+  #define M7M_4WAY
+  #include "algo/keccak/keccak-hash-4way.h"
+  #include "algo/whirlpool/whirlpool-hash-4way.h"
+  #include "algo/haval/haval-hash-4way.h"
+  #include "algo/sha2/sha512-hash-4way.h"
+#endif
+
 
 static bool cputest = false;
 static uint32_t* hashtest = NULL;
@@ -67,7 +75,20 @@ static __thread int s_digits = -1;
 #define SW_DIVS 5
 #define M7_MIDSTATE_LEN 76
 
+// Midstates of the header for the families whose block fills before the
+// nonce. SHA-512 and HAVAL have 128 byte blocks, the midstate would only
+// buffer the data, so they hash the whole header.
 typedef struct {
+    sph_sha256_context       sha256;
+    sph_keccak512_context    keccak;
+    sph_whirlpool_context    whirlpool;
+    sph_tiger_context        tiger;
+    sph_ripemd160_context    ripemd;
+} m7m_ctx_holder;
+
+// One family runs at a time per nonce, each takes its midstate or is
+// initialized right before use.
+typedef union {
     sph_sha256_context       sha256;
     sph_sha512_context       sha512;
     sph_keccak512_context    keccak;
@@ -75,23 +96,299 @@ typedef struct {
     sph_haval256_5_context   haval;
     sph_tiger_context        tiger;
     sph_ripemd160_context    ripemd;
-} m7m_ctx_holder;
+} m7m_ctx_overlay;
 
-sph_sha256_context m7m_ctx_final_sha256;
-m7m_ctx_holder m7m_ctx1, m7m_ctx2;
+// GMP state for one miner thread. Initialized on the thread's first scan
+// and kept, so neither the mpz/mpf limbs nor bdata are reallocated per scan
+// unless a number outgrows them.
+typedef struct {
+    mpz_t bns[8];
+    mpz_t product;
+    mpz_t magipi;
+    mpz_t magisw;
+    mpf_t mpa1, mpb1, mpt1;
+    mpf_t mpa2, mpb2, mpt2;
+    mpf_t magifpi;
+    mpf_t mpsft;
+    uint8_t *bdata;
+    size_t bdata_size;
+    int prec;                 // precision of the mpf above, -1 until set
+} m7m_gmp_ctx;
+
+static __thread m7m_gmp_ctx m7m_gmp;
+static __thread bool m7m_gmp_ready = false;
+
+// Squared product of eight 512 bit numbers, plus some growth in the pi loop.
+#define M7M_PRODUCT_BITS 10240
+
+static void m7m_gmp_init( m7m_gmp_ctx *g )
+{
+    for ( int i = 0; i < 8; i++ )
+        mpz_init2( g->bns[i], 576 );
+    mpz_init2( g->product, M7M_PRODUCT_BITS );
+    mpz_init( g->magipi );
+    mpz_init( g->magisw );
+    mpf_init( g->mpa1 );
+    mpf_init( g->mpb1 );
+    mpf_init( g->mpt1 );
+    mpf_init( g->mpa2 );
+    mpf_init( g->mpb2 );
+    mpf_init( g->mpt2 );
+    mpf_init( g->magifpi );
+    mpf_init( g->mpsft );
+    g->bdata_size = M7M_PRODUCT_BITS / 8;
+    g->bdata = (uint8_t *)malloc( g->bdata_size );
+    g->prec = -1;
+}
+
+static inline uint8_t *m7m_bdata( m7m_gmp_ctx *g, size_t bytes )
+{
+    if ( bytes > g->bdata_size )
+    {
+        g->bdata = (uint8_t *)realloc( g->bdata, bytes );
+        g->bdata_size = bytes;
+    }
+    return g->bdata;
+}
 
-void init_m7m_ctx()
+static void m7m_gmp_set_prec( m7m_gmp_ctx *g, int prec )
 {
-    sph_sha256_init(&m7m_ctx_final_sha256);
-    sph_sha256_init(&m7m_ctx1.sha256);
-    sph_sha512_init(&m7m_ctx1.sha512);
-    sph_keccak512_init(&m7m_ctx1.keccak);
-    sph_whirlpool_init(&m7m_ctx1.whirlpool);
-    sph_haval256_5_init(&m7m_ctx1.haval);
-    sph_tiger_init(&m7m_ctx1.tiger);
-    sph_ripemd160_init(&m7m_ctx1.ripemd);
+    if ( prec == g->prec )
+        return;
+    mpf_set_prec( g->mpa1, prec );
+    mpf_set_prec( g->mpb1, prec );
+    mpf_set_prec( g->mpt1, prec );
+    mpf_set_prec( g->mpa2, prec );
+    mpf_set_prec( g->mpb2, prec );
+    mpf_set_prec( g->mpt2, prec );
+    mpf_set_prec( g->magifpi, prec );
+    mpf_set_prec( g->mpsft, prec );
+    g->prec = prec;
+}
+
+// Everything after the seven hashes, for one nonce.
+static void m7m_hash_tail( m7m_gmp_ctx *g, uint8_t bhash[7][64],
+                           uint32_t nonce, uint32_t *hash )
+{
+	mpz_t *bns = g->bns;
+	uint8_t *bdata;
+	int bytes;
+	int nnNonce2 = (int)(nonce/2);
+	sph_sha256_context ctxf_sha256;
+
+	for(int i=0; i < 7; i++){
+		set_one_if_zero(bhash[i]);
+		mpz_set_uint512(bns[i], bhash[i]);
+	}
+
+	mpz_set_ui(bns[7],0);
+
+	for(int i=0; i < 7; i++){
+		mpz_add(bns[7], bns[7], bns[i]);
+	}
+
+	mpz_set_ui(g->product,1);
+
+	for(int i=0; i < 8; i++){
+		mpz_mul(g->product,g->product,bns[i]);
+	}
+
+	mpz_pow_ui(g->product, g->product, 2);
+
+	bytes = mpz_sizeinbase(g->product, 256);
+	bdata = m7m_bdata(g, bytes);
+	mpz_export((void *)bdata, NULL, -1, 1, 0, 0, g->product);
+
+	sph_sha256_init(&ctxf_sha256);
+	sph_sha256 (&ctxf_sha256, bdata, bytes);
+	sph_sha256_close(&ctxf_sha256, (void*)(hash));
+
+	const int digits=(int)((sqrt((double)(nnNonce2))*(1.+EPS))/9000+75);
+	if (digits != s_digits) {
+		int prec = (int)(digits*BITS_PER_DIGIT+16);
+		mpf_set_default_prec(prec);
+		if (s_digits == -1) mpf_init(mpsqrt);
+		s_digits = digits;
+		mpf_set_ui(mpsqrt, 2);
+		mpf_sqrt(mpsqrt, mpsqrt);
+		mpf_ui_div(mpsqrt, 1, mpsqrt); // 1 / √2
+	}
+	m7m_gmp_set_prec(g, (int)(digits*BITS_PER_DIGIT+16));
+
+	uint32_t usw_ = sw_(nnNonce2, SW_DIVS);
+	if (usw_ < 1) usw_ = 1;
+	mpz_set_ui(g->magisw, usw_);
+	uint32_t mpzscale = (uint32_t) mpz_size(g->magisw);
+
+	for(int i=0; i < NM7M; i++)
+	{
+		const int iterations = 20;
+
+		if (mpzscale > 1000) mpzscale = 1000;
+		else if (mpzscale < 1) mpzscale = 1;
+
+		mpf_set_d(g->mpt1, 0.25*mpzscale);
+
+		mpf_set(g->mpb1, mpsqrt); // B' = 1 / √2 => pow(2, -0.5)
+
+		mpf_set_ui(g->mpa1, 1); // A' = 1
+		uint32_t p = 1;
+
+		for(int j=0; j <= iterations; j++){
+			// A = AVG(A',B')
+			mpf_add(g->mpa2, g->mpa1, g->mpb1); // A = A' + B'
+			mpf_div_ui(g->mpa2, g->mpa2, 2); // A /= 2
+
+			// B = √(A'B')
+			mpf_mul(g->mpb2, g->mpa1, g->mpb1); // B = A' * B'
+			mpf_abs(g->mpb2, g->mpb2);       // B = ABS(B)
+			mpf_sqrt(g->mpb2, g->mpb2);      // B = √B
+			mpf_swap(g->mpb1, g->mpb2);
+
+			// T = √(A'-A)
+			mpf_sub(g->mpt2, g->mpa1, g->mpa2); // T = A' - A
+			mpf_abs(g->mpt2, g->mpt2);       // T = ABS(T)
+			mpf_sqrt(g->mpt2, g->mpt2);      // T = √T
+			mpf_swap(g->mpa1, g->mpa2);
+
+			// T = T' - T*P
+			mpf_mul_ui(g->mpt2, g->mpt2, p); // T *= P
+			mpf_sub(g->mpt1, g->mpt1, g->mpt2); // T = T' - T
+
+			p <<= 1;
+		}
+
+		// PI = (A + B)²/4
+		mpf_add(g->magifpi, g->mpa1, g->mpb1);
+		mpf_pow_ui(g->magifpi, g->magifpi, 2);
+		mpf_div_ui(g->magifpi, g->magifpi, 4);
+
+		// PI = PI / |T|
+		mpf_abs(g->mpt1, g->mpt1);
+		mpf_div(g->magifpi, g->magifpi, g->mpt1);
+
+		// PI = Extract float part digits
+		mpf_set_ui(g->mpsft, 10);
+		mpf_pow_ui(g->mpsft, g->mpsft, digits/2);
+		mpf_mul(g->magifpi, g->magifpi, g->mpsft);
+		mpz_set_f(g->magipi, g->magifpi);
+
+		mpz_add(g->product,g->product,g->magipi);
+		mpz_add(g->product,g->product,g->magisw);
+
+		mpz_set_uint256(bns[0], (void*)(hash));
+		mpz_add(bns[7], bns[7], bns[0]);
+
+		mpz_mul(g->product,g->product,bns[7]);
+		mpz_cdiv_q (g->product, g->product, bns[0]);
+		if (mpz_sgn(g->product) <= 0) mpz_set_ui(g->product,1);
+
+		bytes = mpz_sizeinbase(g->product, 256);
+		mpzscale = bytes;
+		bdata = m7m_bdata(g, bytes);
+		mpz_export(bdata, NULL, -1, 1, 0, 0, g->product);
+
+		sph_sha256_init(&ctxf_sha256);
+		sph_sha256 (&ctxf_sha256, bdata, bytes);
+		sph_sha256_close(&ctxf_sha256, (void*)(hash));
+	}
+}
+
+#if defined(M7M_4WAY)
+
+// Second SHA-256 block of an 80 byte message, 4 lanes interleaved, with
+// the last 16 header bytes filled in per scan.
+static void m7m_sha256_4way( uint8_t bhash[][7][64], const uint32_t *midstate,
+                             const uint32_t *data, uint32_t n )
+{
+	uint32_t _ALIGN(64) S[8*4];
+	uint32_t _ALIGN(64) W[16*4];
+
+	memset( W, 0, sizeof W );
+	for ( int l = 0; l < 4; l++ )
+	{
+		for ( int i = 0; i < 8; i++ )
+			S[ 4*i + l ] = midstate[i];
+		for ( int i = 0; i < 3; i++ )
+			W[ 4*i + l ] = data[ 16 + i ];
+		W[ 4*3 + l ] = n + l;
+		W[ 4*4 + l ] = 0x00000080;      // 0x80 pad byte, swapped below
+		W[ 4*15 + l ] = 0x80020000;     // 640 bits, swapped below
+	}
+	sha256_transform_4way( S, W, 1 );
+	for ( int l = 0; l < 4; l++ )
+		for ( int i = 0; i < 8; i++ )
+			be32enc( (uint32_t*)bhash[l][0] + i, S[ 4*i + l ] );
+}
+
+// The seven hashes of 4 consecutive nonces. Keccak-512, SHA-256, SHA-512,
+// Whirlpool and HAVAL run 4 lanes wide, the other families stay scalar off
+// the shared midstate. SHA-512, Whirlpool and HAVAL hash the whole header:
+// the midstate saves SHA-512 and HAVAL nothing, their 128 byte block never
+// fills, and Whirlpool's first block is cheap on 4 lanes with the zero
+// chaining value.
+static void m7m_hash_head_4way( uint8_t bhash[][7][64],
+                                const m7m_ctx_holder *ctx,
+                                const uint32_t *midstate,
+                                uint32_t *data, uint32_t n )
+{
+	uint32_t *data_p64 = data + (M7_MIDSTATE_LEN / sizeof(data[0]));
+	uint64_t _ALIGN(64) vdata[10*4];
+	uint64_t _ALIGN(64) vhash[8*4];
+	uint8_t _ALIGN(64) whash[4][80];
+	uint8_t _ALIGN(64) hhash[4][80];
+	uint8_t _ALIGN(64) shash[4][80];
+	void * const slanes[4] = { shash[0], shash[1], shash[2], shash[3] };
+	void * const wlanes[4] = { whash[0], whash[1], whash[2], whash[3] };
+	void * const hlanes[4] = { hhash[0], hhash[1], hhash[2], hhash[3] };
+	keccak512_4way_context keccak;
+	m7m_ctx_overlay ctx2;
+
+	for ( int l = 0; l < 4; l++ )
+	{
+		memset( &bhash[l][0][32], 0, 32 ); // sha256
+		memset( &bhash[l][4][32], 0, 32 + 64*2 ); // haval/tiger/ripemd
+
+		data[19] = n + l;
+
+		memcpy( shash[l], data, 80 );
+		memcpy( whash[l], data, 80 );
+		memcpy( hhash[l], data, 80 );
+
+		memcpy( &ctx2.tiger, &ctx->tiger, sizeof ctx->tiger );
+		sph_tiger (&ctx2.tiger, data_p64, 80 - M7_MIDSTATE_LEN);
+		sph_tiger_close(&ctx2.tiger, (void*)(bhash[l][5]));
+
+		memcpy( &ctx2.ripemd, &ctx->ripemd, sizeof ctx->ripemd );
+		sph_ripemd160 (&ctx2.ripemd, data_p64, 80 - M7_MIDSTATE_LEN);
+		sph_ripemd160_close(&ctx2.ripemd, (void*)(bhash[l][6]));
+
+		for ( int i = 0; i < 10; i++ )
+			vdata[ 4*i + l ] = ((uint64_t*)data)[i];
+	}
+
+	m7m_sha256_4way( bhash, midstate, data, n );
+
+	sha512_x4( slanes, 80 );
+	whirlpool_x4( wlanes, 80 );
+	haval256_5_x4( hlanes, 80 );
+	for ( int l = 0; l < 4; l++ )
+	{
+		memcpy( bhash[l][1], shash[l], 64 );
+		memcpy( bhash[l][3], whash[l], 64 );
+		memcpy( bhash[l][4], hhash[l], 32 );
+	}
+
+	keccak512_4way_init( &keccak );
+	keccak512_4way( &keccak, vdata, 80 );
+	keccak512_4way_close( &keccak, vhash );
+	for ( int l = 0; l < 4; l++ )
+		for ( int i = 0; i < 8; i++ )
+			((uint64_t*)bhash[l][2])[i] = vhash[ 4*i + l ];
 }
 
+#endif
+
 int scanhash_m7m(int thr_id, struct work *work, uint64_t max_nonce, uint64_t *hashes_done)
 {
 	uint32_t _ALIGN(128) data[32];
@@ -103,42 +400,64 @@ int scanhash_m7m(int thr_id, struct work *work, uint64_t max_nonce, uint64_t *ha
 	uint32_t n = pdata[19];
 	const uint32_t first_nonce = pdata[19];
 	char data_str[161], hash_str[65], target_str[65];
-	uint8_t *bdata = 0;
-	mpz_t bns[8];
 	int rc = 0;
-	int bytes, nnNonce2;
-
-        m7m_ctx_holder ctx, ctx2;
-        memcpy( &ctx, &m7m_ctx1, sizeof(m7m_ctx1) );
-        sph_sha256_context ctxf_sha256;
-    memcpy( &ctxf_sha256, &m7m_ctx_final_sha256, sizeof(sph_sha256_context) );
-
-	mpz_t product;
-	mpz_init(product);
 
-	for(int i=0; i < 8; i++){
-		mpz_init(bns[i]);
+	if ( !m7m_gmp_ready )
+	{
+		m7m_gmp_init( &m7m_gmp );
+		m7m_gmp_ready = true;
 	}
 
+	m7m_ctx_holder ctx;
+	m7m_ctx_overlay ctx2;
+
 	memcpy(data, pdata, 80);
 
+	sph_sha256_init(&ctx.sha256);
 	sph_sha256 (&ctx.sha256, data, M7_MIDSTATE_LEN);
-	sph_sha512 (&ctx.sha512, data, M7_MIDSTATE_LEN);
+	sph_keccak512_init(&ctx.keccak);
 	sph_keccak512 (&ctx.keccak, data, M7_MIDSTATE_LEN);
+	sph_whirlpool_init(&ctx.whirlpool);
 	sph_whirlpool (&ctx.whirlpool, data, M7_MIDSTATE_LEN);
-	sph_haval256_5 (&ctx.haval, data, M7_MIDSTATE_LEN);
+	sph_tiger_init(&ctx.tiger);
 	sph_tiger (&ctx.tiger, data, M7_MIDSTATE_LEN);
+	sph_ripemd160_init(&ctx.ripemd);
 	sph_ripemd160 (&ctx.ripemd, data, M7_MIDSTATE_LEN);
 
-	mpf_t mpa1, mpb1, mpt1;
-	mpf_t mpa2, mpb2, mpt2;
-	mpf_t magifpi;
-	mpf_t mpsft;
+#if defined(M7M_4WAY)
+	if ( !cputest && sha256_use_4way() )
+	{
+		uint8_t _ALIGN(128) bhash4[4][7][64];
+		uint32_t midstate[8];
 
-	mpz_t magipi;
-	mpz_t magisw;
-	mpz_init(magipi);
-	mpz_init(magisw);
+		sha256_init( midstate );
+		sha256_transform( midstate, data, 1 );
+
+		while ( n < max_nonce && max_nonce - n >= 4
+		        && !work_restart[thr_id].restart )
+		{
+			m7m_hash_head_4way( bhash4, &ctx, midstate, data, n );
+			for ( int l = 0; l < 4; l++ )
+			{
+				m7m_hash_tail( &m7m_gmp, bhash4[l], n + l, hash );
+				if ( fulltest_m7hash( hash, ptarget ) )
+				{
+					data[19] = n + l;
+					n += l + 1;
+					rc = 1;
+					goto found;
+				}
+			}
+			n += 4;
+		}
+		if ( n >= max_nonce || work_restart[thr_id].restart )
+		{
+			pdata[19] = n;
+			*hashes_done = n - first_nonce + 1;
+			return 0;
+		}
+	}
+#endif
 
 	do {
 
@@ -147,200 +466,62 @@ int scanhash_m7m(int thr_id, struct work *work, uint64_t max_nonce, uint64_t *ha
 		else
 			hashtest = hash;
 
-		nnNonce2 = (int)(data[19]/2);
 		//memset(bhash, 0, 7 * 64);
 		memset(&bhash[0][32], 0, 32); // sha256
 		memset(&bhash[4][32], 0, 32 + 64*2); // haval/tiger/ripemd
 
-                memcpy( &ctx2, &ctx, sizeof(m7m_ctx1) );
-
+		memcpy( &ctx2.sha256, &ctx.sha256, sizeof ctx.sha256 );
 		sph_sha256 (&ctx2.sha256, data_p64, 80 - M7_MIDSTATE_LEN);
 		sph_sha256_close(&ctx2.sha256, (void*)(bhash[0]));
 
-		sph_sha512 (&ctx2.sha512, data_p64, 80 - M7_MIDSTATE_LEN);
+		sph_sha512_init(&ctx2.sha512);
+		sph_sha512 (&ctx2.sha512, data, 80);
 		sph_sha512_close(&ctx2.sha512, (void*)(bhash[1]));
 
+		memcpy( &ctx2.keccak, &ctx.keccak, sizeof ctx.keccak );
 		sph_keccak512 (&ctx2.keccak, data_p64, 80 - M7_MIDSTATE_LEN);
 		sph_keccak512_close(&ctx2.keccak, (void*)(bhash[2]));
 
+		memcpy( &ctx2.whirlpool, &ctx.whirlpool, sizeof ctx.whirlpool );
 		sph_whirlpool (&ctx2.whirlpool, data_p64, 80 - M7_MIDSTATE_LEN);
 		sph_whirlpool_close(&ctx2.whirlpool, (void*)(bhash[3]));
 
-		sph_haval256_5 (&ctx2.haval, data_p64, 80 - M7_MIDSTATE_LEN);
+		sph_haval256_5_init(&ctx2.haval);
+		sph_haval256_5 (&ctx2.haval, data, 80);
 		sph_haval256_5_close(&ctx2.haval, (void*)(bhash[4]));
 
+		memcpy( &ctx2.tiger, &ctx.tiger, sizeof ctx.tiger );
 		sph_tiger (&ctx2.tiger, data_p64, 80 - M7_MIDSTATE_LEN);
 		sph_tiger_close(&ctx2.tiger, (void*)(bhash[5]));
 
+		memcpy( &ctx2.ripemd, &ctx.ripemd, sizeof ctx.ripemd );
 		sph_ripemd160 (&ctx2.ripemd, data_p64, 80 - M7_MIDSTATE_LEN);
 		sph_ripemd160_close(&ctx2.ripemd, (void*)(bhash[6]));
 
-		for(int i=0; i < 7; i++){
-			set_one_if_zero(bhash[i]);
-			mpz_set_uint512(bns[i], bhash[i]);
-		}
-
-		mpz_set_ui(bns[7],0);
-
-		for(int i=0; i < 7; i++){
-			mpz_add(bns[7], bns[7], bns[i]);
-		}
-
-		mpz_set_ui(product,1);
-
-		for(int i=0; i < 8; i++){
-			mpz_mul(product,product,bns[i]);
-		}
-
-		mpz_pow_ui(product, product, 2);
-
-		bytes = mpz_sizeinbase(product, 256);
-		bdata = (uint8_t *)realloc(bdata, bytes);
-		mpz_export((void *)bdata, NULL, -1, 1, 0, 0, product);
-
-		sph_sha256 (&ctxf_sha256, bdata, bytes);
-		sph_sha256_close(&ctxf_sha256, (void*)(hash));
-
-		const int digits=(int)((sqrt((double)(nnNonce2))*(1.+EPS))/9000+75);
-		if (digits != s_digits) {
-			int prec = (int)(digits*BITS_PER_DIGIT+16);
-			mpf_set_default_prec(prec);
-			if (s_digits == -1) mpf_init(mpsqrt);
-			s_digits = digits;
-			mpf_set_ui(mpsqrt, 2);
-			mpf_sqrt(mpsqrt, mpsqrt);
-			mpf_ui_div(mpsqrt, 1, mpsqrt); // 1 / √2
-		}
-
-		mpf_init(magifpi);
-		mpf_init(mpsft);
-		mpf_init(mpa1);
-		mpf_init(mpb1);
-		mpf_init(mpt1);
-
-		mpf_init(mpa2);
-		mpf_init(mpb2);
-		mpf_init(mpt2);
-
-		uint32_t usw_ = sw_(nnNonce2, SW_DIVS);
-		if (usw_ < 1) usw_ = 1;
-		mpz_set_ui(magisw, usw_);
-		uint32_t mpzscale = (uint32_t) mpz_size(magisw);
-
-		for(int i=0; i < NM7M; i++)
-		{
-			const int iterations = 20;
-
-			if (mpzscale > 1000) mpzscale = 1000;
-			else if (mpzscale < 1) mpzscale = 1;
-
-			mpf_set_d(mpt1, 0.25*mpzscale);
-
-			mpf_set(mpb1, mpsqrt); // B' = 1 / √2 => pow(2, -0.5)
-
-			mpf_set_ui(mpa1, 1); // A' = 1
-			uint32_t p = 1;
-
-			for(int j=0; j <= iterations; j++){
-				// A = AVG(A',B')
-				mpf_add(mpa2, mpa1, mpb1); // A = A' + B'
-				mpf_div_ui(mpa2, mpa2, 2); // A /= 2
-
-				// B = √(A'B')
-				mpf_mul(mpb2, mpa1, mpb1); // B = A' * B'
-				mpf_abs(mpb2, mpb2);       // B = ABS(B)
-				mpf_sqrt(mpb2, mpb2);      // B = √B
-				mpf_swap(mpb1, mpb2);
-
-				// T = √(A'-A)
-				mpf_sub(mpt2, mpa1, mpa2); // T = A' - A
-				mpf_abs(mpt2, mpt2);       // T = ABS(T)
-				mpf_sqrt(mpt2, mpt2);      // T = √T
-				mpf_swap(mpa1, mpa2);
-
-				// T = T' - T*P
-				mpf_mul_ui(mpt2, mpt2, p); // T *= P
-				mpf_sub(mpt1, mpt1, mpt2); // T = T' - T
-
-				p <<= 1;
-			}
-
-			// PI = (A + B)²/4
-			mpf_add(magifpi, mpa1, mpb1);
-			mpf_pow_ui(magifpi, magifpi, 2);
-			mpf_div_ui(magifpi, magifpi, 4);
-
-			// PI = PI / |T|
-			mpf_abs(mpt1, mpt1);
-			mpf_div(magifpi, magifpi, mpt1);
-
-			// PI = Extract float part digits
-			mpf_set_ui(mpsft, 10);
-			mpf_pow_ui(mpsft, mpsft, digits/2);
-			mpf_mul(magifpi, magifpi, mpsft);
-			mpz_set_f(magipi, magifpi);
-
-			mpz_add(product,product,magipi);
-			mpz_add(product,product,magisw);
-
-			mpz_set_uint256(bns[0], (void*)(hash));
-			mpz_add(bns[7], bns[7], bns[0]);
-
-			mpz_mul(product,product,bns[7]);
-			mpz_cdiv_q (product, product, bns[0]);
-			if (mpz_sgn(product) <= 0) mpz_set_ui(product,1);
-
-			bytes = mpz_sizeinbase(product, 256);
-			mpzscale = bytes;
-			bdata = (uint8_t *)realloc(bdata, bytes);
-			mpz_export(bdata, NULL, -1, 1, 0, 0, product);
-
-          memcpy( &ctxf_sha256, &m7m_ctx_final_sha256,
-                                  sizeof(sph_sha256_context) );
-			sph_sha256 (&ctxf_sha256, bdata, bytes);
-			sph_sha256_close(&ctxf_sha256, (void*)(hash));
-		}
-
-		mpf_clear(magifpi);
-		mpf_clear(mpsft);
-		mpf_clear(mpa1);
-		mpf_clear(mpb1);
-		mpf_clear(mpt1);
-
-		mpf_clear(mpa2);
-		mpf_clear(mpb2);
-		mpf_clear(mpt2);
+		m7m_hash_tail( &m7m_gmp, bhash, data[19], hash );
 
 		rc = fulltest_m7hash(hash, ptarget);
-		if (rc) {
-			work_set_target_ratio(work, hash);
-			if (opt_debug) {
-				bin2hex(hash_str, (unsigned char *)hash, 32);
-				bin2hex(target_str, (unsigned char *)ptarget, 32);
-				bin2hex(data_str, (unsigned char *)data, 80);
-				applog(LOG_DEBUG, "DEBUG: [%d thread] Found share!\ndata   %s\nhash   %s\ntarget %s", thr_id,
-					data_str,
-					hash_str,
-					target_str);
-			}
-
-			pdata[19] = data[19];
-
-			goto out;
-		}
+		if (rc)
+			goto found;
 	} while (n < max_nonce && !work_restart[thr_id].restart);
 
 	pdata[19] = n;
+	*hashes_done = n - first_nonce + 1;
+	return rc;
 
-out:
-	mpz_clear(magipi);
-	mpz_clear(magisw);
-	for(int i=0; i < 8; i++) {
-		mpz_clear(bns[i]);
+found:
+	work_set_target_ratio(work, hash);
+	if (opt_debug) {
+		bin2hex(hash_str, (unsigned char *)hash, 32);
+		bin2hex(target_str, (unsigned char *)ptarget, 32);
+		bin2hex(data_str, (unsigned char *)data, 80);
+		applog(LOG_DEBUG, "DEBUG: [%d thread] Found share!\ndata   %s\nhash   %s\ntarget %s", thr_id,
+			data_str,
+			hash_str,
+			target_str);
 	}
-	mpz_clear(product);
-	free(bdata);
 
+	pdata[19] = data[19];
 	*hashes_done = n - first_nonce + 1;
 	return rc;
 }
@@ -391,7 +572,6 @@ void m7m_reverse_endian( struct work *work )
 
 bool register_m7m_algo( algo_gate_t *gate )
 {
-  gate->init_ctx            = (void*)&init_m7m_ctx;
   gate->scanhash            = (void*)&scanhash_m7m;
   gate->hash                = (void*)&m7mhash;
   gate->hash_alt            = (void*)&m7mhash;
@@ -40,6 +40,14 @@
 
 #define STACK_ALIGN 0x40
 
+// Four nonces run interleaved, one lane per 32 bit element of an xmm
+// register, through FastKDF's blake2s and both the Salsa and ChaCha SMix.
+#if defined(__SSE2__)
+  #define NEOSCRYPT_4WAY
+  #include "avxdefs.h"
+  #include "algo/blake/blake2s-hash-4way.h"
+#endif
+
 #ifdef _MSC_VER // todo: msvc
 #define ASM 0
 #elif defined(__arm__)
@@ -898,6 +906,19 @@ static void neoscrypt_blkmix(uint *X, uint *Y, uint r, uint mixmode) {
  *     .....
  *     11110 = N of 2147483648;
  *   profile bits 30 to 13 are reserved */
+/* X, Z, Y and V for the fixed profile, (N + 3) * r * 2 * SCRYPT_BLOCK_SIZE
+ * bytes per lane. Allocated once per miner thread by the gate. */
+#define NEOSCRYPT_N 128
+#define NEOSCRYPT_R 2
+#define NEOSCRYPT_LANE_SIZE \
+        ((NEOSCRYPT_N + 3) * NEOSCRYPT_R * 2 * SCRYPT_BLOCK_SIZE)
+#if defined(NEOSCRYPT_4WAY)
+  #define NEOSCRYPT_SCRATCH_SIZE (4 * NEOSCRYPT_LANE_SIZE)
+#else
+  #define NEOSCRYPT_SCRATCH_SIZE NEOSCRYPT_LANE_SIZE
+#endif
+static __thread uchar *neoscrypt_stack = NULL;
+
 void neoscrypt(uchar *output, const uchar *password)
 {
     uint N = 128, r = 2, dblmix = 1, mixmode = 0x14;
@@ -919,9 +940,8 @@ void neoscrypt(uchar *output, const uchar *password)
         r = (1 << ((profile >> 5) & 0x7));
     }
 
-    uchar *stack = (uchar*) malloc((N + 3) * r * 2 * SCRYPT_BLOCK_SIZE + STACK_ALIGN);
-    /* X = r * 2 * SCRYPT_BLOCK_SIZE */
-    X = (uint *) &stack[STACK_ALIGN & ~(STACK_ALIGN - 1)];
+    /* X = r * 2 * SCRYPT_BLOCK_SIZE, in the per thread scratch buffer */
+    X = (uint *) neoscrypt_stack;
     /* Z is a copy of X for ChaCha */
     Z = &X[32 * r];
     /* Y is an X sized temporal space */
@@ -1008,10 +1028,313 @@ void neoscrypt(uchar *output, const uchar *password)
             neoscrypt_pbkdf2_sha256(password, 80, (uchar *) X, r * 2 * SCRYPT_BLOCK_SIZE, 1, output, 32);
             break;
     }
+}
+
+#if defined(NEOSCRYPT_4WAY)
+
+/* 4x4 transpose of 32 bit words, converts between 4 consecutive words of
+ * 4 lanes and 4 interleaved vectors, its own inverse */
+#define TRANSPOSE_4X4(d0, d1, d2, d3, s0, s1, s2, s3) \
+do { \
+    __m128i t0 = _mm_unpacklo_epi32(s0, s1); \
+    __m128i t1 = _mm_unpackhi_epi32(s0, s1); \
+    __m128i t2 = _mm_unpacklo_epi32(s2, s3); \
+    __m128i t3 = _mm_unpackhi_epi32(s2, s3); \
+    d0 = _mm_unpacklo_epi64(t0, t2); \
+    d1 = _mm_unpackhi_epi64(t0, t2); \
+    d2 = _mm_unpacklo_epi64(t1, t3); \
+    d3 = _mm_unpackhi_epi64(t1, t3); \
+} while(0)
+
+/* Load 4 words at each lane pointer plus ofs as interleaved vectors */
+#define LOAD_4X4(d, p, ofs) \
+    TRANSPOSE_4X4((d)[0], (d)[1], (d)[2], (d)[3], \
+      _mm_loadu_si128((const __m128i *) &(p)[0][ofs]), \
+      _mm_loadu_si128((const __m128i *) &(p)[1][ofs]), \
+      _mm_loadu_si128((const __m128i *) &(p)[2][ofs]), \
+      _mm_loadu_si128((const __m128i *) &(p)[3][ofs]))
+
+/* neoscrypt_blake2s() for 4 lanes with the FastKDF sizes hardwired:
+ * a 32 byte key block followed by a single 64 byte input block */
+static void neoscrypt_blake2s_4way(__m128i *output, const __m128i *key, const __m128i *input) {
+    __m128i block[16];
+    uint i;
+
+    for(i = 0; i < 8; i++)
+      output[i] = _mm_set1_epi32(blake2s_IV[i]);
+    /* digest_length = 32, key_length = 32, fanout = depth = 1 */
+    output[0] = _mm_xor_si128(output[0], _mm_set1_epi32(0x01012020));
+
+    for(i = 0; i < 8; i++) {
+        block[i]     = key[i];
+        block[i + 8] = _mm_setzero_si128();
+    }
+    blake2s_4way_compress(output, block, BLAKE2S_BLOCK_SIZE, 0);
+    blake2s_4way_compress(output, input, 2 * BLAKE2S_BLOCK_SIZE, ~0U);
+}
+
+/* neoscrypt_fastkdf() for 4 lanes: the password is 80 bytes, N is 32 and
+ * each lane has its own buffer pointer, only the PRF runs interleaved */
+static void neoscrypt_fastkdf_4way(const uchar **password, const uchar **salt, uint salt_len,
+  uchar **output, uint output_len) {
+    uchar _ALIGN(64) A[4][kdf_buf_size + prf_input_size];
+    uchar _ALIGN(64) B[4][kdf_buf_size + prf_key_size];
+    uchar _ALIGN(64) prf_output[4][prf_output_size];
+    const uchar *prf_input[4], *prf_key[4];
+    __m128i input[16], key[8], hash[8];
+    uint bufptr[4] = { 0, 0, 0, 0 };
+    uint a, b, i, j, k;
+
+    for(k = 0; k < 4; k++) {
+        a = kdf_buf_size / 80;
+        for(i = 0; i < a; i++)
+          neoscrypt_copy(&A[k][i * 80], &password[k][0], 80);
+        b = kdf_buf_size - a * 80;
+        neoscrypt_copy(&A[k][a * 80], &password[k][0], b);
+        neoscrypt_copy(&A[k][kdf_buf_size], &password[k][0], prf_input_size);
+
+        a = kdf_buf_size / salt_len;
+        for(i = 0; i < a; i++)
+          neoscrypt_copy(&B[k][i * salt_len], &salt[k][0], salt_len);
+        b = kdf_buf_size - a * salt_len;
+        if(b)
+          neoscrypt_copy(&B[k][a * salt_len], &salt[k][0], b);
+        neoscrypt_copy(&B[k][kdf_buf_size], &salt[k][0], prf_key_size);
+    }
+
+    for(i = 0; i < 32; i++) {
+
+        for(k = 0; k < 4; k++) {
+            prf_input[k] = &A[k][bufptr[k]];
+            prf_key[k]   = &B[k][bufptr[k]];
+        }
+        for(j = 0; j < 4; j++)
+          LOAD_4X4(&input[4 * j], prf_input, 16 * j);
+        LOAD_4X4(&key[0], prf_key, 0);
+        LOAD_4X4(&key[4], prf_key, 16);
+
+        neoscrypt_blake2s_4way(hash, key, input);
+
+        for(j = 0; j < 2; j++)
+          TRANSPOSE_4X4(hash[4 * j], hash[4 * j + 1], hash[4 * j + 2], hash[4 * j + 3],
+            hash[4 * j], hash[4 * j + 1], hash[4 * j + 2], hash[4 * j + 3]);
+        for(k = 0; k < 4; k++) {
+            _mm_store_si128((__m128i *) &prf_output[k][0],  hash[k]);
+            _mm_store_si128((__m128i *) &prf_output[k][16], hash[k + 4]);
+        }
+
+        for(k = 0; k < 4; k++) {
+            uint p;
+
+            /* The next buffer pointer is the byte sum of the PRF output */
+            __m128i s = _mm_add_epi64(
+              _mm_sad_epu8(_mm_load_si128((__m128i *) &prf_output[k][0]), _mm_setzero_si128()),
+              _mm_sad_epu8(_mm_load_si128((__m128i *) &prf_output[k][16]), _mm_setzero_si128()));
+            p = (_mm_cvtsi128_si32(s) + _mm_extract_epi16(s, 4)) & (kdf_buf_size - 1);
+            bufptr[k] = p;
+
+            neoscrypt_xor(&B[k][p], &prf_output[k][0], prf_output_size);
+
+            if(p < prf_key_size)
+              neoscrypt_copy(&B[k][kdf_buf_size + p], &B[k][p], MIN(prf_output_size, prf_key_size - p));
+
+            if((kdf_buf_size - p) < prf_output_size)
+              neoscrypt_copy(&B[k][0], &B[k][kdf_buf_size], prf_output_size - (kdf_buf_size - p));
+        }
+    }
+
+    for(k = 0; k < 4; k++) {
+        uint p = bufptr[k];
+
+        a = kdf_buf_size - p;
+        if(a >= output_len) {
+            neoscrypt_xor(&B[k][p], &A[k][0], output_len);
+            neoscrypt_copy(&output[k][0], &B[k][p], output_len);
+        } else {
+            neoscrypt_xor(&B[k][p], &A[k][0], a);
+            neoscrypt_xor(&B[k][0], &A[k][a], output_len - a);
+            neoscrypt_copy(&output[k][0], &B[k][p], a);
+            neoscrypt_copy(&output[k][a], &B[k][0], output_len - a);
+        }
+    }
+}
+
+/* Salsa20 and ChaCha20 for 4 lanes with the block XOR folded in:
+ * X = Y = A ^ B; X = Y + mix(Y) */
+static inline void neoscrypt_salsa_4way(__m128i *X, const __m128i *A, const __m128i *B, uint rounds) {
+    __m128i x[16], y[16];
+    uint i;
+
+    for(i = 0; i < 16; i++)
+      x[i] = y[i] = _mm_xor_si128(A[i], B[i]);
+
+#define quarter(a, b, c, d) \
+    b = _mm_xor_si128(b, mm_rotl_32(_mm_add_epi32(a, d),  7)); \
+    c = _mm_xor_si128(c, mm_rotl_32(_mm_add_epi32(b, a),  9)); \
+    d = _mm_xor_si128(d, mm_rotl_32(_mm_add_epi32(c, b), 13)); \
+    a = _mm_xor_si128(a, mm_rotl_32(_mm_add_epi32(d, c), 18));
+
+    for(; rounds; rounds -= 2) {
+        quarter(x[ 0], x[ 4], x[ 8], x[12]);
+        quarter(x[ 5], x[ 9], x[13], x[ 1]);
+        quarter(x[10], x[14], x[ 2], x[ 6]);
+        quarter(x[15], x[ 3], x[ 7], x[11]);
+        quarter(x[ 0], x[ 1], x[ 2], x[ 3]);
+        quarter(x[ 5], x[ 6], x[ 7], x[ 4]);
+        quarter(x[10], x[11], x[ 8], x[ 9]);
+        quarter(x[15], x[12], x[13], x[14]);
+    }
+
+    for(i = 0; i < 16; i++)
+      X[i] = _mm_add_epi32(x[i], y[i]);
+
+#undef quarter
+}
+
+static inline void neoscrypt_chacha_4way(__m128i *X, const __m128i *A, const __m128i *B, uint rounds) {
+    __m128i x[16], y[16];
+    uint i;
+
+    for(i = 0; i < 16; i++)
+      x[i] = y[i] = _mm_xor_si128(A[i], B[i]);
+
+#define quarter(a, b, c, d) \
+    a = _mm_add_epi32(a, b); d = mm_rotl_32(_mm_xor_si128(d, a), 16); \
+    c = _mm_add_epi32(c, d); b = mm_rotl_32(_mm_xor_si128(b, c), 12); \
+    a = _mm_add_epi32(a, b); d = mm_rotl_32(_mm_xor_si128(d, a),  8); \
+    c = _mm_add_epi32(c, d); b = mm_rotl_32(_mm_xor_si128(b, c),  7);
+
+    for(; rounds; rounds -= 2) {
+        quarter(x[ 0], x[ 4], x[ 8], x[12]);
+        quarter(x[ 1], x[ 5], x[ 9], x[13]);
+        quarter(x[ 2], x[ 6], x[10], x[14]);
+        quarter(x[ 3], x[ 7], x[11], x[15]);
+        quarter(x[ 0], x[ 5], x[10], x[15]);
+        quarter(x[ 1], x[ 6], x[11], x[12]);
+        quarter(x[ 2], x[ 7], x[ 8], x[13]);
+        quarter(x[ 3], x[ 4], x[ 9], x[14]);
+    }
+
+    for(i = 0; i < 16; i++)
+      X[i] = _mm_add_epi32(x[i], y[i]);
+
+#undef quarter
+}
+
+/* neoscrypt_blkmix() for r = 2 and 4 lanes, 16 vectors per block;
+ * the Xb" / Xc" swap is done by storing Xb" straight into Xc */
+static void neoscrypt_blkmix_4way(__m128i *X, uint mixer) {
+    __m128i T[16];
+    uint i;
+
+    if(mixer) {
+        neoscrypt_chacha_4way(&X[0],  &X[0],  &X[48], 20);
+        neoscrypt_chacha_4way(&T[0],  &X[16], &X[0],  20);
+        neoscrypt_chacha_4way(&X[16], &X[32], &T[0],  20);
+        for(i = 0; i < 16; i++)
+          X[32 + i] = T[i];
+        neoscrypt_chacha_4way(&X[48], &X[48], &X[16], 20);
+    } else {
+        neoscrypt_salsa_4way(&X[0],  &X[0],  &X[48], 20);
+        neoscrypt_salsa_4way(&T[0],  &X[16], &X[0],  20);
+        neoscrypt_salsa_4way(&X[16], &X[32], &T[0],  20);
+        for(i = 0; i < 16; i++)
+          X[32 + i] = T[i];
+        neoscrypt_salsa_4way(&X[48], &X[48], &X[16], 20);
+    }
+}
+
+/* SMix of 4 interleaved lanes. V is kept per lane so the random reads
+ * become 4 contiguous rows and a transpose instead of a gather. */
+static void neoscrypt_smix_4way(__m128i *X, uint *V, uint mixer) {
+    const uint row = NEOSCRYPT_R * 2 * SCRYPT_BLOCK_SIZE / 4;
+    uint *Vl[4];
+    uint _ALIGN(16) j[4];
+    uint i, k;
+
+    for(i = 0; i < NEOSCRYPT_N; i++) {
+        for(k = 0; k < 4; k++)
+          Vl[k] = &V[(k * NEOSCRYPT_N + i) * row];
+        for(k = 0; k < 16; k++) {
+            __m128i d0, d1, d2, d3;
+            TRANSPOSE_4X4(d0, d1, d2, d3, X[4 * k], X[4 * k + 1], X[4 * k + 2], X[4 * k + 3]);
+            _mm_store_si128((__m128i *) &Vl[0][4 * k], d0);
+            _mm_store_si128((__m128i *) &Vl[1][4 * k], d1);
+            _mm_store_si128((__m128i *) &Vl[2][4 * k], d2);
+            _mm_store_si128((__m128i *) &Vl[3][4 * k], d3);
+        }
+        neoscrypt_blkmix_4way(X, mixer);
+    }
+    for(i = 0; i < NEOSCRYPT_N; i++) {
+        /* integerify(X) mod N, per lane */
+        _mm_store_si128((__m128i *) j, X[16 * (2 * NEOSCRYPT_R - 1)]);
+        for(k = 0; k < 4; k++)
+          Vl[k] = &V[(k * NEOSCRYPT_N + (j[k] & (NEOSCRYPT_N - 1))) * row];
+        for(k = 0; k < 16; k++) {
+            __m128i d[4];
+            LOAD_4X4(d, Vl, 4 * k);
+            X[4 * k]     = _mm_xor_si128(X[4 * k],     d[0]);
+            X[4 * k + 1] = _mm_xor_si128(X[4 * k + 1], d[1]);
+            X[4 * k + 2] = _mm_xor_si128(X[4 * k + 2], d[2]);
+            X[4 * k + 3] = _mm_xor_si128(X[4 * k + 3], d[3]);
+        }
+        neoscrypt_blkmix_4way(X, mixer);
+    }
+}
+
+/* neoscrypt() with the default profile for 4 consecutive 80 byte
+ * headers, output is 4 consecutive 32 byte hashes */
+void neoscrypt_4way(uchar *output, const uchar *password) {
+    const uint len = NEOSCRYPT_R * 2 * SCRYPT_BLOCK_SIZE;
+    uchar _ALIGN(64) kdf[4][NEOSCRYPT_R * 2 * SCRYPT_BLOCK_SIZE];
+    const uchar *pass[4], *salt[4];
+    uchar *out[4];
+    __m128i *X, *Z;
+    uint *V;
+    uint i, k;
+
+    X = (__m128i *) neoscrypt_stack;
+    Z = &X[len / 4];
+    V = (uint *) &Z[len / 4];
+
+    for(k = 0; k < 4; k++) {
+        pass[k] = salt[k] = &password[k * 80];
+        out[k] = kdf[k];
+    }
+
+    /* X = KDF(password, salt) */
+    neoscrypt_fastkdf_4way(pass, salt, 80, out, len);
+    for(k = 0; k < len / 16; k++)
+      LOAD_4X4(&X[4 * k], out, 16 * k);
+
+    /* Z = SMix(X) with ChaCha, X = SMix(X) with Salsa, X ^= Z */
+    for(i = 0; i < len / 4; i++)
+      Z[i] = X[i];
+    neoscrypt_smix_4way(Z, V, 1);
+    neoscrypt_smix_4way(X, V, 0);
+    for(i = 0; i < len / 4; i++)
+      X[i] = _mm_xor_si128(X[i], Z[i]);
+
+    for(k = 0; k < len / 16; k++) {
+        TRANSPOSE_4X4(X[4 * k], X[4 * k + 1], X[4 * k + 2], X[4 * k + 3],
+          X[4 * k], X[4 * k + 1], X[4 * k + 2], X[4 * k + 3]);
+        for(i = 0; i < 4; i++)
+          _mm_store_si128((__m128i *) &kdf[i][16 * k], X[4 * k + i]);
+    }
 
-    free(stack);
+    /* output = KDF(password, X) */
+    for(k = 0; k < 4; k++) {
+        salt[k] = kdf[k];
+        out[k] = &output[k * 32];
+    }
+    neoscrypt_fastkdf_4way(pass, salt, len, out, 32);
 }
 
+#undef TRANSPOSE_4X4
+#undef LOAD_4X4
+
+#endif
+
 static bool fulltest_le(const uint *hash, const uint *target)
 {
     bool rc = false;
@@ -1052,6 +1375,32 @@ int scanhash_neoscrypt( int thr_id, struct work *work,
     const uint32_t Htarg = ptarget[7];
     const uint32_t first_nonce = pdata[19];
 
+#if defined(NEOSCRYPT_4WAY)
+    uint32_t _ALIGN(64) data4[20 * 4];
+    uint32_t _ALIGN(64) hash4[8 * 4];
+
+    for (int i = 0; i < 4; i++)
+        memcpy(&data4[i * 20], pdata, 80);
+
+    while (pdata[19] < max_nonce && max_nonce - pdata[19] >= 4
+           && !work_restart[thr_id].restart)
+    {
+        for (int i = 0; i < 4; i++)
+            data4[i * 20 + 19] = pdata[19] + i;
+        neoscrypt_4way((uint8_t *) hash4, (uint8_t *) data4);
+
+        for (int i = 0; i < 4; i++)
+        if (hash4[i * 8 + 7] <= Htarg && fulltest_le(&hash4[i * 8], ptarget)) {
+            pdata[19] += i;
+            *hashes_done = pdata[19] - first_nonce + 1;
+            return 1;
+        }
+
+        pdata[19] += 4;
+    }
+    // leftover nonces go through the single lane loop below
+#endif
+
     while (pdata[19] < max_nonce && !work_restart[thr_id].restart)
     {
         neoscrypt((uint8_t *) hash, (uint8_t *) pdata );
@@ -1128,6 +1477,18 @@ void neoscrypt_set_data_and_target_size( int *data_size, int *target_size,
    *atarget_sz  = *target_size /  sizeof(uint32_t);
 }
 
+bool neoscrypt_get_scratchbuf( unsigned char** scratchbuf )
+{
+   unsigned char *buf = (unsigned char*) malloc( NEOSCRYPT_SCRATCH_SIZE
+                                                 + STACK_ALIGN - 1 );
+   if ( buf == NULL )
+      return false;
+   neoscrypt_stack = (uchar*)( ( (uintptr_t)buf + STACK_ALIGN - 1 )
+                               & ~(uintptr_t)( STACK_ALIGN - 1 ) );
+   *scratchbuf = buf;
+   return true;
+}
+
 bool register_neoscrypt_algo( algo_gate_t* gate )
 {
   gate->scanhash             = (void*)&scanhash_neoscrypt;
@@ -1142,6 +1503,7 @@ bool register_neoscrypt_algo( algo_gate_t* gate )
   gate->set_data_and_target_size = (void*)&neoscrypt_set_data_and_target_size;
   gate->set_work_data_endian = (void*)&swab_work_data;
   gate->encode_endian_17_19  = (void*)&encode_big_endian_17_19;
+  gate->get_scratchbuf       = (void*)&neoscrypt_get_scratchbuf;
   return true;
 };
 
@@ -23,21 +23,6 @@
   #include "algo/groestl/aes_ni/hash-groestl.h"
 #endif
 
-typedef struct {
-#ifndef NO_AES_NI
-    hashState_groestl      groestl;
-#endif
-} nist5_ctx_holder;
-
-nist5_ctx_holder nist5_ctx;
-
-void init_nist5_ctx()
-{
-#ifndef NO_AES_NI
-     init_groestl( &nist5_ctx.groestl );
-#endif
-}
-
 void nist5hash(void *output, const void *input)
 {
 #ifdef NO_AES_NI
@@ -51,10 +36,6 @@ void nist5hash(void *output, const void *input)
      #define hashA hash
      #define hashB hash+64
 
-     nist5_ctx_holder ctx;
-     memcpy( &ctx, &nist5_ctx, sizeof(nist5_ctx) );
-
-
      DECL_BLK;
      BLK_I;
      BLK_W;
@@ -65,8 +46,7 @@ void nist5hash(void *output, const void *input)
        GRS_U;
        GRS_C;
      #else
-       update_groestl( &ctx.groestl, (char*)hash,512);
-       final_groestl( &ctx.groestl, (char*)hash);
+       groestl512_64( hash, hash );
      #endif
 
      DECL_JH;
@@ -159,7 +139,6 @@ int scanhash_nist5(int thr_id, struct work *work,
 bool register_nist5_algo( algo_gate_t* gate )
 {
     gate->aes_ni_optimized = (void*)&return_true;
-    gate->init_ctx = (void*)&init_nist5_ctx;
     gate->scanhash = (void*)&scanhash_nist5;
     gate->hash     = (void*)&nist5hash;
     gate->hash_alt = (void*)&nist5hash;
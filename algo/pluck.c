@@ -443,6 +443,120 @@ void pluck_hash(uint32_t *hash, const uint32_t *data, uchar *hashbuffer, const i
 	memcpy(hash, hashbuffer, 32);
 }
 
+#if defined(HAVE_SHA256_4WAY) && defined(__SSE2__)
+
+#define PLUCK_4WAY
+#define PLUCK_LANES 4
+
+// Second block of a 64 byte message, 4 lanes interleaved.
+static const uint32_t sha256_pad512_4way[16 * 4] __attribute__ ((aligned (64))) = {
+	0x80000000, 0x80000000, 0x80000000, 0x80000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000200, 0x00000200, 0x00000200, 0x00000200
+};
+
+// sha256_hash512 of one 64 byte block per lane, using the 4 way transform
+// which also does the big endian load.
+static void sha256_hash512_4way(uchar **hash, uint32_t joint[][16])
+{
+	uint32_t _ALIGN(64) S[8 * 4];
+	uint32_t _ALIGN(64) T[16 * 4];
+	int i, l;
+
+	for (i = 0; i < 16; i++)
+		for (l = 0; l < PLUCK_LANES; l++)
+			T[4 * i + l] = joint[l][i];
+
+	sha256_init_4way(S);
+	sha256_transform_4way(S, T, 1);
+	sha256_transform_4way(S, sha256_pad512_4way, 0);
+
+	for (l = 0; l < PLUCK_LANES; l++)
+		for (i = 0; i < 8; i++)
+			be32enc((uint32_t *)hash[l] + i, S[4 * i + l]);
+}
+
+/*
+ * pluck_hash for 4 consecutive 80 byte headers, each with its own
+ * N * 1024 byte hashbuffer.  The lanes run in lockstep so the random
+ * indexes of all 4 are known before any of them is read, they are
+ * prefetched together and the misses overlap instead of serializing.
+ */
+void pluck_hash_4way(uint32_t *hash, const uint32_t *data, uchar *hashbuffer,
+                     const int N)
+{
+	int size = N * 1024;
+	uchar *hb[PLUCK_LANES];
+	uchar *out[PLUCK_LANES];
+	uint32_t _ALIGN(64) randbuffer[PLUCK_LANES][16];
+	uint32_t _ALIGN(64) joint[PLUCK_LANES][16];
+	int l;
+
+	for (l = 0; l < PLUCK_LANES; l++) {
+		hb[l] = hashbuffer + l * size;
+		sha256_hash(hb[l], (void*)(data + l * 20), BLOCK_HEADER_SIZE);
+		memset(&hb[l][32], 0, 32);
+	}
+
+	for (int i = 64; i < size - 32; i += 32)
+	{
+		uint32_t _ALIGN(64) randseed[16];
+		int randmax = i - 4;
+
+		for (l = 0; l < PLUCK_LANES; l++) {
+			memcpy(randseed, &hb[l][i - 64], 64);
+			if (i > 128) memcpy(randbuffer[l], &hb[l][i - 128], 64);
+			xor_salsa8(randbuffer[l], randseed, i);
+			for (int j = 0; j < 8; j++) {
+				randbuffer[l][j] %= (randmax - 32);
+				_mm_prefetch(&hb[l][randbuffer[l][j]], _MM_HINT_T0);
+			}
+		}
+
+		for (l = 0; l < PLUCK_LANES; l++) {
+			memcpy(joint[l], &hb[l][i - 32], 32);
+			for (int j = 0; j < 8; j++)
+				joint[l][8 + j] = *((uint32_t *)&hb[l][randbuffer[l][j]]);
+			out[l] = &hb[l][i];
+		}
+
+		sha256_hash512_4way(out, joint);
+
+		for (l = 0; l < PLUCK_LANES; l++) {
+			memcpy(randseed, &hb[l][i - 32], 64);
+			if (i > 128) memcpy(randbuffer[l], &hb[l][i - 128], 64);
+			xor_salsa8(randbuffer[l], randseed, i);
+			for (int j = 0; j < 16; j++) {
+				randbuffer[l][j] %= randmax;
+				_mm_prefetch(&hb[l][randbuffer[l][j]], _MM_HINT_T0);
+			}
+		}
+
+		for (l = 0; l < PLUCK_LANES; l++)
+			for (int j = 0; j < 32; j += 2)
+				*((uint32_t *)(hb[l] + randbuffer[l][j >> 1])) =
+				          *((uint32_t *)(hb[l] + j + randmax));
+	}
+
+	for (l = 0; l < PLUCK_LANES; l++)
+		memcpy(hash + l * 8, hb[l], 32);
+}
+
+#endif
+
 int scanhash_pluck(int thr_id, struct work *work, uint32_t max_nonce,
         uint64_t *hashes_done, unsigned char *scratchbuf  )
 {
@@ -461,6 +575,43 @@ int scanhash_pluck(int thr_id, struct work *work, uint32_t max_nonce,
 		be32enc(&endiandata[k], pdata[k]);
 
 	const uint32_t Htarg = ptarget[7];
+
+#ifdef PLUCK_4WAY
+	if (sha256_use_4way())
+	{
+	uint32_t _ALIGN(64) data4[20 * PLUCK_LANES];
+	uint32_t _ALIGN(64) hash4[8 * PLUCK_LANES];
+
+	for (int l = 0; l < PLUCK_LANES; l++)
+		memcpy(&data4[20 * l], endiandata, 76);
+
+	while (n < max_nonce && max_nonce - n >= PLUCK_LANES && !(*restart))
+	{
+		for (int l = 0; l < PLUCK_LANES; l++)
+			data4[20 * l + 19] = n + l;
+		pluck_hash_4way(hash4, data4, scratchbuf, opt_pluck_n);
+
+		for (int l = 0; l < PLUCK_LANES; l++)
+		{
+			uint32_t *h = &hash4[8 * l];
+			if (h[7] <= Htarg && fulltest(h, ptarget))
+			{
+				*hashes_done = n + l - first_nonce + 1;
+				pdata[19] = htobe32(n + l);
+				return 1;
+			}
+		}
+		n += PLUCK_LANES;
+	}
+	if (n >= max_nonce || *restart)
+	{
+		*hashes_done = n - first_nonce + 1;
+		pdata[19] = n;
+		return 0;
+	}
+	}
+#endif
+
 	do {
 		//be32enc(&endiandata[19], n);
 		endiandata[19] = n;
@@ -493,7 +644,12 @@ void pluck_set_target( struct work* work, double job_diff )
 bool get_pluck_scratchbuf( char** scratchbuf )
 { 
 //  scratchbuf = malloc( opt_pluck_n * 1024 );  
+#ifdef PLUCK_4WAY
+  // one hashbuffer per lane
+  *scratchbuf = malloc( 128 * 1024 * PLUCK_LANES );
+#else
   *scratchbuf = malloc( 128 * 1024 ); 
+#endif
   return NULL == *scratchbuf ? false : true;
 }
 
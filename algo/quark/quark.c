@@ -24,6 +24,11 @@
   #include "algo/groestl/sse2/grso-macro.c"
 #else
  #include "algo/groestl/aes_ni/hash-groestl.h"
+ #include "algo/groestl/groestl-hash-4way.h"
+ #include "algo/bmw/bmw-hash-4way.h"
+ #include "algo/skein/skein-hash-4way.h"
+ #include "algo/jh/jh-hash-4way.h"
+ #include "algo/keccak/keccak-hash-4way.h"
 #endif
 
 /*define data alignment for different C compilers*/
@@ -36,24 +41,14 @@
       #define DATA_ALIGNXY(x,y) __declspec(align(y)) x
 #endif
 
-#ifndef NO_AES_NI
-hashState_groestl quark_groestl_ctx;
-#endif
-
-void init_quark_ctx()
-{
-#ifndef NO_AES_NI
- init_groestl( &quark_groestl_ctx );
-#endif
-}
-
-inline static void quarkhash(void *state, const void *input)
+// Runs steps first to last-1 of the chain on the 64 bytes at hash, step 0
+// starts from the 80 byte header at input. The steps are split so
+// quarkhash_4way can run each of them on 4 lanes at once.
+static inline void quarkhash_steps( unsigned char *hash, const void *input,
+                                    int first, int last )
 {
 #ifdef NO_AES_NI
   grsoState sts_grs;
-#else
-  hashState_groestl ctx;
-  memcpy(&ctx, &quark_groestl_ctx, sizeof(quark_groestl_ctx));
 #endif
 
     /* shared  temp space */
@@ -66,13 +61,14 @@ inline static void quarkhash(void *state, const void *input)
 
     int i;
 
-    unsigned char hash[128];
-
     // Blake
     DECL_BLK;
-    BLK_I;
-    BLK_W;
-    for(i=0; i<9; i++)
+    if ( first == 0 )
+    {
+       BLK_I;
+       BLK_W;
+    }
+    for(i=first; i<last; i++)
     {
     /* blake is split between 64byte hashes and the 80byte initial block */
     //DECL_BLK;
@@ -121,9 +117,7 @@ inline static void quarkhash(void *state, const void *input)
            GRS_U;
            GRS_C;
 #else
-           reinit_groestl( &ctx );
-           update_groestl(&ctx, (char*)hash,512);
-           final_groestl(&ctx, (char*)hash);
+           groestl512_64( hash, hash );
 #endif
 
           } while(0); continue;
@@ -170,12 +164,75 @@ inline static void quarkhash(void *state, const void *input)
     /* blake finishs from top split */
     //BLK_C;
  }
- 
+}
+
+inline static void quarkhash(void *state, const void *input)
+{
+  unsigned char hash[128];
+
+  quarkhash_steps( hash, input, 0, 9 );
 
 //    asm volatile ("emms");
   memcpy(state, hash, 32);
 }
 
+#ifndef NO_AES_NI
+
+typedef void (*quark_x4_func)( void * const hash[4], int len );
+
+// Runs step, which depends on bit 3 of each lane, on the 4 lanes. set and
+// clear are the 4 lane kernels for either side or NULL. A side with a
+// kernel and at least 2 lanes runs batched, padded with a spare lane, the
+// others go through quarkhash_steps one at a time.
+static void quarkhash_branch_4way( unsigned char hash[4][128], int step,
+                                   quark_x4_func set, quark_x4_func clear )
+{
+  unsigned char spare[64] __attribute__ ((aligned (64)));
+  const quark_x4_func func[2] = { set, clear };
+  void *side[2][4];
+  int n[2] = { 0, 0 };
+
+  for ( int i = 0; i < 4; i++ )
+  {
+     const int s = !( hash[i][0] & 8 );
+     side[s][ n[s]++ ] = hash[i];
+  }
+  for ( int s = 0; s < 2; s++ )
+     if ( func[s] && n[s] >= 2 )
+     {
+        for ( int i = n[s]; i < 4; i++ )
+           side[s][i] = spare;
+        memset( spare, 0, 64 );
+        func[s]( side[s], 64 );
+     }
+     else
+        for ( int i = 0; i < n[s]; i++ )
+           quarkhash_steps( side[s][i], NULL, step, step + 1 );
+}
+
+// input is 4 consecutive 80 byte headers, output 4 consecutive hashes.
+static void quarkhash_4way( void *state, const void *input )
+{
+  unsigned char hash[4][128] __attribute__ ((aligned (64)));
+  void * const lanes[4] = { hash[0], hash[1], hash[2], hash[3] };
+
+  for ( int i = 0; i < 4; i++ )
+     quarkhash_steps( hash[i], (const unsigned char*)input + 80*i, 0, 1 );
+  bmw512_x4( lanes, 64 );
+  quarkhash_branch_4way( hash, 2, groestl512_x4, skein512_x4 );
+  groestl512_x4( lanes, 64 );
+  jh512_x4( lanes, 64 );
+  quarkhash_branch_4way( hash, 5, NULL, bmw512_x4 );
+  keccak512_x4( lanes, 64 );
+  skein512_x4( lanes, 64 );
+  quarkhash_branch_4way( hash, 8, keccak512_x4, jh512_x4 );
+
+  for ( int i = 0; i < 4; i++ )
+     memcpy( (unsigned char*)state + 32*i, hash[i], 32 );
+}
+
+#endif
+
 void quarkhash_alt(void *state, const void *input)
 {
         sph_blake512_context    ctx_blake1,
@@ -269,10 +326,6 @@ static  uint64_t nonce_err = 0;
 static  uint64_t rate;
 static  uint64_t restart;
 
-//         #ifndef NO_AES_NI
-//         init_groestl( &quark_groestl_ctx ); 
-//         #endif
-
 	//we need bigendian data...
 	//lessons learned: do NOT endianchange directly in pdata, this will all proof-of-works be considered as stale from minerd.... 
 
@@ -287,6 +340,39 @@ static  uint64_t restart;
 //		applog(LOG_DEBUG, "Thr: %02d, firstN: %08x, maxN: %08x, ToDo: %d", thr_id, first_nonce, max_nonce, max_nonce-first_nonce);
 //	}
 	
+#ifndef NO_AES_NI
+	// Every step but Blake takes 4 nonces at a time, n + 1 < max_nonce
+	// as n wraps to ~0 when first_nonce is 0. The odd nonces at the end
+	// go through the single lane loop below.
+	{
+		uint32_t data4[4][20] __attribute__((aligned(64)));
+		uint32_t hash4[4][8] __attribute__((aligned(64)));
+
+		for ( int i = 0; i < 4; i++ )
+			memcpy( data4[i], endiandata, 80 );
+		while ( n + 1 < max_nonce && max_nonce - n > 4
+		        && !work_restart[thr_id].restart )
+		{
+			for ( int i = 0; i < 4; i++ )
+				be32enc( &data4[i][19], n + 1 + i );
+			quarkhash_4way( hash4, data4 );
+			for ( int i = 0; i < 4; i++ )
+			if ( ( hash4[i][7] & 0xFFFFFF00 ) == 0 )
+			{
+				if ( fulltest( hash4[i], ptarget ) )
+				{
+					pdata[19] = n + 1 + i;
+					*hashes_done = pdata[19] - first_nonce + 1;
+					return true;
+				}
+				else
+					nonce_err++;
+			}
+			n += 4;
+		}
+	}
+#endif
+
 	do {
 		pdata[19] = ++n;
 		be32enc(&endiandata[19], n); 
@@ -317,10 +403,6 @@ static  uint64_t restart;
 
 bool register_quark_algo( algo_gate_t* gate )
 {
-#ifndef NO_AES_NI
-  gate->aes_ni_optimized = (void*)&return_false;
-  gate->init_ctx = &init_quark_ctx;
-#endif
   gate->aes_ni_optimized = (void*)&return_true;
   gate->scanhash = (void*)&scanhash_quark;
   gate->hash     = (void*)&quarkhash;
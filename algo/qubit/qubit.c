@@ -18,87 +18,124 @@
 #include "algo/luffa/sse2/luffa_for_sse2.h" 
 #include "algo/cubehash/sse2/cubehash_sse2.h" 
 #include "algo/simd/sse2/nist.h"
-#include "algo/shavite/sph_shavite.h"
+#include "algo/shavite/shavite-hash-4way.h"
+#include "algo/luffa/luffa-hash-2way.h"
+#include "algo/cubehash/cube-hash-2way.h"
+#include "algo/simd/simd-hash-4way.h"
 
 #ifndef NO_AES_NI
 #include "algo/echo/aes_ni/hash_api.h"
+#include "algo/echo/echo-hash-4way.h"
 #endif
 
-typedef struct
+// One stage runs at a time, the contexts share the space and each is
+// initialized right before use rather than copied from a global.
+typedef union
 {
 #ifdef LUFFA_SSE2_BROKEN
         sph_luffa512_context    luffa;
 #else
          hashState_luffa         luffa;
 #endif
-        cubehashParam           cubehash;
-        sph_shavite512_context  shavite;
-        hashState_sd            simd;
 #ifdef NO_AES_NI
         sph_echo512_context echo;
-#else
-        hashState_echo          echo;
 #endif
-} qubit_ctx_holder;
-
-qubit_ctx_holder qubit_ctx;
+} qubit_ctx_overlay;
 
-void init_qubit_ctx()
+// ctx->luffa has already absorbed everything before input. len is only used
+// by sph luffa, which may resume from a midstate.
+static void qubithash_ctx( qubit_ctx_overlay *ctx, void *output,
+                           const void *input, size_t len )
 {
+        unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
+        #define hashB hash+64
+
 #ifdef LUFFA_SSE2_BROKEN
-        sph_luffa512_init(&qubit_ctx.luffa);
+        sph_luffa512 (&ctx->luffa, input, len);
+        sph_luffa512_close(&ctx->luffa, (void*) hash);
 #else
-        init_luffa(&qubit_ctx.luffa,512);
+        init_luffa(&ctx->luffa,512);
+        update_luffa( &ctx->luffa, (const BitSequence*)input,512);
+        final_luffa( &ctx->luffa, (BitSequence*)hash);
 #endif
-        cubehashInit(&qubit_ctx.cubehash,512,16,32);
-        sph_shavite512_init(&qubit_ctx.shavite);
-        init_sd(&qubit_ctx.simd,512);
+
+        cubehash512_64( hash, hash );
+
+        shavite512_64( hash, hash );
+
+        simd512_64( hash, hash );
+
 #ifdef NO_AES_NI
-        sph_echo512_init(&qubit_ctx.echo);
+        sph_echo512_init( &ctx->echo );
+        sph_echo512 (&ctx->echo, (const void*) hash, 64);
+        sph_echo512_close(&ctx->echo, (void*) hash);
 #else
-        init_echo(&qubit_ctx.echo, 512);
+        echo512_64( hash, hash );
 #endif
-};
 
-void qubithash(void *output, const void *input)
-{
-        unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
-        #define hashB hash+64
 
-        qubit_ctx_holder ctx;
-        memcpy( &ctx, &qubit_ctx, sizeof(qubit_ctx) );
+        asm volatile ("emms");
+        memcpy(output, hash, 32);
+}
 
+void qubithash(void *output, const void *input)
+{
+        qubit_ctx_overlay ctx;
 #ifdef LUFFA_SSE2_BROKEN
-        sph_luffa512 (&ctx.luffa, input, 80);
-        sph_luffa512_close(&ctx.luffa, (void*) hash);
-#else
-        init_luffa(&qubit_ctx.luffa,512);
-        update_luffa( &ctx.luffa, (const BitSequence*)input,512);
-        final_luffa( &ctx.luffa, (BitSequence*)hash);
+        sph_luffa512_init( &ctx.luffa );
 #endif
+        qubithash_ctx( &ctx, output, input, 80 );
+}
+
+#ifdef LUFFA_SSE2_BROKEN
 
-        cubehashUpdate( &ctx.cubehash, (const byte*) hash,64);
-        cubehashDigest( &ctx.cubehash, (byte*)hash);
+// Luffa state after the 76 nonce invariant bytes of the header, set by
+// qubit_prehash before each scan. Luffa eats 32 byte blocks so only the
+// last block and the finalization are left for each nonce.
+static __thread sph_luffa512_context qubit_luffa_mid;
 
-        sph_shavite512( &ctx.shavite, hash, 64);
-        sph_shavite512_close( &ctx.shavite, hash);
+// input is the full big endian header, only the nonce is read.
+static void qubithash_mid( void *output, const void *input )
+{
+        qubit_ctx_overlay ctx;
+        memcpy( &ctx.luffa, &qubit_luffa_mid, sizeof ctx.luffa );
+        qubithash_ctx( &ctx, output, (const uint32_t*)input + 19, 4 );
+}
 
-        update_sd( &ctx.simd, (const BitSequence *)hash,512);
-        final_sd( &ctx.simd, (BitSequence *)hash);
+void qubit_prehash( struct work *work )
+{
+        uint32_t _ALIGN(64) endiandata[19];
+
+        for ( int i = 0; i < 19; i++ )
+            be32enc( &endiandata[i], work->data[i] );
+        sph_luffa512_init( &qubit_luffa_mid );
+        sph_luffa512( &qubit_luffa_mid, endiandata, 76 );
+}
 
-#ifdef NO_AES_NI
-        sph_echo512 (&ctx.echo, (const void*) hash, 64);
-        sph_echo512_close(&ctx.echo, (void*) hash);
-#else
-        update_echo ( &ctx.echo, (const BitSequence *) hash, 512);
-        final_echo( &ctx.echo, (BitSequence *) hash);
 #endif
 
+#ifndef NO_AES_NI
 
-        asm volatile ("emms");
-        memcpy(output, hash, 32);
+// input is 4 consecutive 80 byte headers, output 4 consecutive hashes.
+// luffa512_x4 pads any length like sph, so all 80 bytes go through it.
+static void qubithash_4way( void *state, const void *input )
+{
+        unsigned char hash[4][128] __attribute__ ((aligned (64)));
+        void * const lanes[4] = { hash[0], hash[1], hash[2], hash[3] };
+
+        for ( int i = 0; i < 4; i++ )
+            memcpy( hash[i], (const unsigned char*)input + 80*i, 80 );
+        luffa512_x4( lanes, 80 );
+        cube512_x4( lanes, 64 );
+        shavite512_x4( lanes, 64 );
+        simd512_x4( lanes, 64 );
+        echo512_x4( lanes, 64 );
+        for ( int i = 0; i < 4; i++ )
+            memcpy( (unsigned char*)state + 32*i, hash[i], 32 );
 }
 
+#endif
+
 void qubithash_alt(void *output, const void *input)
 {
         sph_luffa512_context ctx_luffa;
@@ -160,6 +197,32 @@ int scanhash_qubit(int thr_id, struct work *work,
 	};
 #ifdef DEBUG_ALGO
 	printf("[%d] Htarg=%X\n", thr_id, Htarg);
+#endif
+#ifndef NO_AES_NI
+        // Every stage takes 4 nonces at a time. The odd nonces at the end
+        // go through the single lane loops below.
+        {
+           uint32_t data4[4][20] __attribute__((aligned(64)));
+           uint32_t hash4[4][8] __attribute__((aligned(64)));
+
+           for ( int i = 0; i < 4; i++ )
+              memcpy( data4[i], endiandata, 80 );
+           while ( n + 1 < max_nonce && max_nonce - n > 4
+                   && !work_restart[thr_id].restart )
+           {
+              for ( int i = 0; i < 4; i++ )
+                 be32enc( &data4[i][19], n + 1 + i );
+              qubithash_4way( hash4, data4 );
+              for ( int i = 0; i < 4; i++ )
+              if ( hash4[i][7] <= Htarg && fulltest( hash4[i], ptarget ) )
+              {
+                 pdata[19] = n + 1 + i;
+                 *hashes_done = pdata[19] - first_nonce + 1;
+                 return true;
+              }
+              n += 4;
+           }
+        }
 #endif
 	for ( int m=0; m < 6; m++ )
         {
@@ -170,7 +233,11 @@ int scanhash_qubit(int thr_id, struct work *work,
                 {
 	            pdata[19] = ++n;
 		    be32enc(&endiandata[19], n);
+#ifdef LUFFA_SSE2_BROKEN
+		    qubithash_mid(hash64, endiandata);
+#else
 		    qubithash(hash64, endiandata);
+#endif
 #ifndef DEBUG_ALGO
 		    if (!(hash64[7] & mask))
                     {
@@ -208,10 +275,12 @@ int scanhash_qubit(int thr_id, struct work *work,
 bool register_qubit_algo( algo_gate_t* gate )
 {
   gate->aes_ni_optimized = (void*)&return_true;
-  gate->init_ctx = (void*)&init_qubit_ctx;
   gate->scanhash = (void*)&scanhash_qubit;
   gate->hash     = (void*)&qubithash;
   gate->hash_alt = (void*)&qubithash_alt;
+#ifdef LUFFA_SSE2_BROKEN
+  gate->prehash  = (void*)&qubit_prehash;
+#endif
   return true;
 };
 
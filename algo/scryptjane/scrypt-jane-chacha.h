@@ -11,10 +11,13 @@ typedef uint32_t scrypt_mix_word_t;
 /* must have these here in case block bytes is ever != 64 */
 #include "scrypt-jane-romix-basic.h"
 
+/* each variant and its ROMix are compiled for their own instruction set */
+#if defined(SCRYPT_TARGET_PRAGMAS)
+	#pragma GCC push_options
+	#pragma GCC target("avx")
+#endif
+
 #include "scrypt-jane-mix_chacha-avx.h"
-#include "scrypt-jane-mix_chacha-ssse3.h"
-#include "scrypt-jane-mix_chacha-sse2.h"
-#include "scrypt-jane-mix_chacha.h"
 
 #if defined(SCRYPT_CHACHA_AVX)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_avx
@@ -22,33 +25,48 @@ typedef uint32_t scrypt_mix_word_t;
 		#define SCRYPT_CHUNKMIX_1_FN scrypt_ChunkMix_avx_1
 		#define SCRYPT_CHUNKMIX_1_XOR_FN scrypt_ChunkMix_avx_1_xor
 	#endif
-	#define SCRYPT_ROMIX_FN scrypt_ROMix_avx
+	#define SCRYPT_ROMIX_1_FN scrypt_ROMix_avx_1
 	#define SCRYPT_MIX_FN chacha_core_avx
 	#define SCRYPT_ROMIX_TANGLE_FN scrypt_romix_nop
 	#define SCRYPT_ROMIX_UNTANGLE_FN scrypt_romix_nop
 	#include "scrypt-jane-romix-template.h"
 #endif
 
+#if defined(SCRYPT_TARGET_PRAGMAS)
+	#pragma GCC pop_options
+	#pragma GCC push_options
+	#pragma GCC target("ssse3")
+#endif
+
+#include "scrypt-jane-mix_chacha-ssse3.h"
+
 #if defined(SCRYPT_CHACHA_SSSE3)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_ssse3
 	#if defined(X86_INTRINSIC_SSSE3)
 		#define SCRYPT_CHUNKMIX_1_FN scrypt_ChunkMix_ssse3_1
 		#define SCRYPT_CHUNKMIX_1_XOR_FN scrypt_ChunkMix_ssse3_1_xor
 	#endif
-	#define SCRYPT_ROMIX_FN scrypt_ROMix_ssse3
+	#define SCRYPT_ROMIX_1_FN scrypt_ROMix_ssse3_1
 	#define SCRYPT_MIX_FN chacha_core_ssse3
 	#define SCRYPT_ROMIX_TANGLE_FN scrypt_romix_nop
 	#define SCRYPT_ROMIX_UNTANGLE_FN scrypt_romix_nop
 	#include "scrypt-jane-romix-template.h"
 #endif
 
+#if defined(SCRYPT_TARGET_PRAGMAS)
+	#pragma GCC pop_options
+#endif
+
+#include "scrypt-jane-mix_chacha-sse2.h"
+#include "scrypt-jane-mix_chacha.h"
+
 #if defined(SCRYPT_CHACHA_SSE2)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_sse2
 	#if defined(X86_INTRINSIC_SSE2)
 		#define SCRYPT_CHUNKMIX_1_FN scrypt_ChunkMix_sse2_1
 		#define SCRYPT_CHUNKMIX_1_XOR_FN scrypt_ChunkMix_sse2_1_xor
 	#endif
-	#define SCRYPT_ROMIX_FN scrypt_ROMix_sse2
+	#define SCRYPT_ROMIX_1_FN scrypt_ROMix_sse2_1
 	#define SCRYPT_MIX_FN chacha_core_sse2
 	#define SCRYPT_ROMIX_TANGLE_FN scrypt_romix_nop
 	#define SCRYPT_ROMIX_UNTANGLE_FN scrypt_romix_nop
@@ -56,36 +74,37 @@ typedef uint32_t scrypt_mix_word_t;
 #endif
 
 /* cpu agnostic */
-#define SCRYPT_ROMIX_FN scrypt_ROMix_basic
+#define SCRYPT_ROMIX_1_FN scrypt_ROMix_basic_1
 #define SCRYPT_MIX_FN chacha_core_basic
 #define SCRYPT_ROMIX_TANGLE_FN scrypt_romix_convert_endian
 #define SCRYPT_ROMIX_UNTANGLE_FN scrypt_romix_convert_endian
 #include "scrypt-jane-romix-template.h"
 
 #if !defined(SCRYPT_CHOOSE_COMPILETIME)
-static scrypt_ROMixfn
-scrypt_getROMix() {
+/* the best ROMix for the hard-coded r = 1 */
+static scrypt_ROMix_1fn
+scrypt_getROMix_1() {
 	size_t cpuflags = detect_cpu();
 
 #if defined(SCRYPT_CHACHA_AVX)
 	if (cpuflags & cpu_avx)
-		return scrypt_ROMix_avx;
+		return scrypt_ROMix_avx_1;
 	else
 #endif
 
 #if defined(SCRYPT_CHACHA_SSSE3)
 	if (cpuflags & cpu_ssse3)
-		return scrypt_ROMix_ssse3;
+		return scrypt_ROMix_ssse3_1;
 	else
 #endif
 
 #if defined(SCRYPT_CHACHA_SSE2)
 	if (cpuflags & cpu_sse2)
-		return scrypt_ROMix_sse2;
+		return scrypt_ROMix_sse2_1;
 	else
 #endif
 
-	return scrypt_ROMix_basic;
+	return scrypt_ROMix_basic_1;
 }
 #endif
 
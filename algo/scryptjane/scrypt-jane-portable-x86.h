@@ -63,6 +63,13 @@
 	#if defined(__AVX__)
 		#define X86_INTRINSIC_AVX
 	#endif
+	/* choosing at runtime: build every variant, each one inside a gcc
+	   target pragma (see scrypt-jane-chacha.h), and let detect_cpu pick */
+	#if !defined(SCRYPT_CHOOSE_COMPILETIME) && defined(CPU_X86_64) && (COMPILER_GCC >= 40900)
+		#define X86_INTRINSIC_SSSE3
+		#define X86_INTRINSIC_AVX
+		#define SCRYPT_TARGET_PRAGMAS
+	#endif
 
 	/* HACK - I want to use CPU_X86_FORCE_INTRINSICS with mingw64 so these need to be undefined - mikaelh */
 	#undef X86_64ASM_SSSE3
@@ -257,26 +264,16 @@ get_cpuid(x86_regs *regs, uint32_t flags) {
 #if defined(COMPILER_MSVC)
 	__cpuid((int *)regs, (int)flags);
 #else
-	#if defined(CPU_X86_64)
-		#define cpuid_bx rbx
-	#else
-		#define cpuid_bx ebx
-	#endif
-
+	/* the registers are outputs so the compiler sees regs written, ecx is
+	   the subleaf and must be 0 for leaf 7 */
 	asm_gcc()
-		a1(push cpuid_bx)
 		a1(cpuid)
-		a2(mov [%1 + 0], eax)
-		a2(mov [%1 + 4], ebx)
-		a2(mov [%1 + 8], ecx)
-		a2(mov [%1 + 12], edx)
-		a1(pop cpuid_bx)
-		asm_gcc_parms() : "+a"(flags) : "S"(regs)  : "%ecx", "%edx", "cc"
+		asm_gcc_parms() : "=a"(regs->eax), "=b"(regs->ebx), "=c"(regs->ecx), "=d"(regs->edx) : "a"(flags), "c"(0)
 	asm_gcc_end()
 #endif
 }
 
-#if defined(X86ASM_AVX) || defined(X86_64ASM_AVX)
+#if defined(X86ASM_AVX) || defined(X86_64ASM_AVX) || defined(X86_INTRINSIC_AVX)
 static uint64_t NOINLINE
 get_xgetbv(uint32_t flags) {
 #if defined(COMPILER_MSVC)
@@ -303,7 +300,7 @@ detect_cpu(void) {
 	x86_regs regs;
 	uint32_t max_level;
 	size_t cpu_flags = 0;
-#if defined(X86ASM_AVX) || defined(X86_64ASM_AVX)
+#if defined(X86ASM_AVX) || defined(X86_64ASM_AVX) || defined(X86_INTRINSIC_AVX)
 	uint64_t xgetbv_flags;
 #endif
 
@@ -333,7 +330,7 @@ detect_cpu(void) {
 		return cpu_flags;
 
 	get_cpuid(&regs, 1);
-#if defined(X86ASM_AVX) || defined(X86_64ASM_AVX)
+#if defined(X86ASM_AVX) || defined(X86_64ASM_AVX) || defined(X86_INTRINSIC_AVX)
 	/* xsave/xrestore */
 	if (regs.ecx & (1 << 27)) {
 		xgetbv_flags = get_xgetbv(0);
@@ -18,6 +18,7 @@ typedef uint32_t scrypt_mix_word_t;
 #if defined(SCRYPT_SALSA_AVX)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_avx
 	#define SCRYPT_ROMIX_FN scrypt_ROMix_avx
+	#define SCRYPT_ROMIX_1_FN scrypt_ROMix_avx_1
 	#define SCRYPT_ROMIX_TANGLE_FN salsa_core_tangle_sse2
 	#define SCRYPT_ROMIX_UNTANGLE_FN salsa_core_tangle_sse2
 	#include "scrypt-jane-romix-template.h"
@@ -26,6 +27,7 @@ typedef uint32_t scrypt_mix_word_t;
 #if defined(SCRYPT_SALSA_SSE2)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_sse2
 	#define SCRYPT_ROMIX_FN scrypt_ROMix_sse2
+	#define SCRYPT_ROMIX_1_FN scrypt_ROMix_sse2_1
 	#define SCRYPT_MIX_FN salsa_core_sse2
 	#define SCRYPT_ROMIX_TANGLE_FN salsa_core_tangle_sse2
 	#define SCRYPT_ROMIX_UNTANGLE_FN salsa_core_tangle_sse2
@@ -34,6 +36,7 @@ typedef uint32_t scrypt_mix_word_t;
 
 /* cpu agnostic */
 #define SCRYPT_ROMIX_FN scrypt_ROMix_basic
+#define SCRYPT_ROMIX_1_FN scrypt_ROMix_basic_1
 #define SCRYPT_MIX_FN salsa_core_basic
 #define SCRYPT_ROMIX_TANGLE_FN scrypt_romix_convert_endian
 #define SCRYPT_ROMIX_UNTANGLE_FN scrypt_romix_convert_endian
@@ -19,6 +19,7 @@ typedef uint64_t scrypt_mix_word_t;
 #if defined(SCRYPT_SALSA64_AVX)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_avx
 	#define SCRYPT_ROMIX_FN scrypt_ROMix_avx
+	#define SCRYPT_ROMIX_1_FN scrypt_ROMix_avx_1
 	#define SCRYPT_ROMIX_TANGLE_FN salsa64_core_tangle_sse2
 	#define SCRYPT_ROMIX_UNTANGLE_FN salsa64_core_tangle_sse2
 	#include "scrypt-jane-romix-template.h"
@@ -27,6 +28,7 @@ typedef uint64_t scrypt_mix_word_t;
 #if defined(SCRYPT_SALSA64_SSSE3)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_ssse3
 	#define SCRYPT_ROMIX_FN scrypt_ROMix_ssse3
+	#define SCRYPT_ROMIX_1_FN scrypt_ROMix_ssse3_1
 	#define SCRYPT_ROMIX_TANGLE_FN salsa64_core_tangle_sse2
 	#define SCRYPT_ROMIX_UNTANGLE_FN salsa64_core_tangle_sse2
 	#include "scrypt-jane-romix-template.h"
@@ -35,6 +37,7 @@ typedef uint64_t scrypt_mix_word_t;
 #if defined(SCRYPT_SALSA64_SSE2)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_sse2
 	#define SCRYPT_ROMIX_FN scrypt_ROMix_sse2
+	#define SCRYPT_ROMIX_1_FN scrypt_ROMix_sse2_1
 	#define SCRYPT_ROMIX_TANGLE_FN salsa64_core_tangle_sse2
 	#define SCRYPT_ROMIX_UNTANGLE_FN salsa64_core_tangle_sse2
 	#include "scrypt-jane-romix-template.h"
@@ -42,6 +45,7 @@ typedef uint64_t scrypt_mix_word_t;
 
 /* cpu agnostic */
 #define SCRYPT_ROMIX_FN scrypt_ROMix_basic
+#define SCRYPT_ROMIX_1_FN scrypt_ROMix_basic_1
 #define SCRYPT_MIX_FN salsa64_core_basic
 #define SCRYPT_ROMIX_TANGLE_FN scrypt_romix_convert_endian
 #define SCRYPT_ROMIX_UNTANGLE_FN scrypt_romix_convert_endian
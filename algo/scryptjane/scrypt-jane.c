@@ -12,12 +12,13 @@
 /* Only the instrinsics versions are optimized for hard-coded values - mikaelh */
 #define CPU_X86_FORCE_INTRINSICS
 
+/* The AVX, SSSE3 and SSE2 ChaCha mixes are all built and the best one the
+   cpu supports is picked once at registration. */
 #undef SCRYPT_KECCAK512
 #undef SCRYPT_CHACHA
 #undef SCRYPT_CHOOSE_COMPILETIME
 #define SCRYPT_KECCAK512
 #define SCRYPT_CHACHA
-#define SCRYPT_CHOOSE_COMPILETIME
 
 //#include "scrypt-jane.h"
 #include "../scryptjane/scrypt-jane-portable.h"
@@ -39,38 +40,74 @@
 #define scrypt_maxr scrypt_r_32kb /* 32kb */
 #define scrypt_maxp 25  /* (1 << 25) = ~33 million */
 
-typedef struct scrypt_aligned_alloc_t {
-	uint8_t *mem, *ptr;
-} scrypt_aligned_alloc;
-
-static int
-scrypt_alloc(uint64_t size, scrypt_aligned_alloc *aa) {
-	static const size_t max_alloc = (size_t)-1;
-	size += (SCRYPT_BLOCK_BYTES - 1);
-	if (size > max_alloc)
-		return 0; // scrypt_fatal_error("scrypt: not enough address space on this CPU to allocate required memory");
-	aa->mem = (uint8_t *)malloc((size_t)size);
-	aa->ptr = (uint8_t *)(((size_t)aa->mem + (SCRYPT_BLOCK_BYTES - 1)) & ~(SCRYPT_BLOCK_BYTES - 1));
-	if (!aa->mem)
-		return 0; // scrypt_fatal_error("scrypt: out of memory");
-	return 1;
-}
+/*
+	Per thread V followed by Y and X. It is kept between scans and only
+	reallocated when a larger Nfactor needs more room. Buffers of 2 MiB or
+	more ask for huge pages, explicit ones first, then transparent ones.
+*/
+#define SCRYPTJANE_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+static __thread uint8_t *scryptjane_buf = NULL;
+static __thread size_t scryptjane_buf_size = 0;
+
+static uint8_t *
+scryptjane_buffer(size_t size) {
+	uint8_t *base;
+
+	if (size <= scryptjane_buf_size)
+		return scryptjane_buf;
+
+#if defined(MAP_ANON)
+	if (scryptjane_buf)
+		munmap(scryptjane_buf, scryptjane_buf_size);
+	scryptjane_buf = NULL;
+	scryptjane_buf_size = 0;
+
+	if (size >= SCRYPTJANE_HUGEPAGE_SIZE) {
+		size = (size + SCRYPTJANE_HUGEPAGE_SIZE - 1) & ~(size_t)(SCRYPTJANE_HUGEPAGE_SIZE - 1);
+		base = (uint8_t *)MAP_FAILED;
+#if defined(MAP_HUGETLB)
+		base = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+#endif
+		if (base == MAP_FAILED) {
+			base = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+#if defined(MADV_HUGEPAGE)
+			if (base != MAP_FAILED)
+				madvise(base, size, MADV_HUGEPAGE);
+#endif
+		}
+	} else
+		base = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+#else
+	/* without mmap keep the raw pointer in front of the aligned block */
+	if (scryptjane_buf)
+		free(((void **)scryptjane_buf)[-1]);
+	scryptjane_buf = NULL;
+	scryptjane_buf_size = 0;
+	{
+		uint8_t *mem = (uint8_t *)malloc(size + 64 + sizeof(void *));
+		if (!mem)
+			return NULL;
+		base = (uint8_t *)(((size_t)mem + sizeof(void *) + 63) & ~(size_t)63);
+		((void **)base)[-1] = mem;
+	}
+#endif
 
-static void
-scrypt_free(scrypt_aligned_alloc *aa) {
-	free(aa->mem);
+	scryptjane_buf = base;
+	scryptjane_buf_size = size;
+	return base;
 }
 
+static scrypt_ROMix_1fn scrypt_ROMix_1_best = NULL;
+
 void
 scrypt_N_1_1(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len, uint32_t N, uint8_t *out, size_t bytes, uint8_t *X, uint8_t *Y, uint8_t *V) {
 	uint32_t chunk_bytes, i;
 	const uint32_t r = SCRYPT_R;
 	const uint32_t p = SCRYPT_P;
 
-#if !defined(SCRYPT_CHOOSE_COMPILETIME)
-	scrypt_ROMixfn scrypt_ROMix = scrypt_getROMix();
-#endif
-
 	chunk_bytes = SCRYPT_BLOCK_BYTES * r * 2;
 
 	/* 1: X = PBKDF2(password, salt) */
@@ -78,7 +115,7 @@ scrypt_N_1_1(const uint8_t *password, size_t password_len, const uint8_t *salt,
 
 	/* 2: X = ROMix(X) */
 	for (i = 0; i < p; i++)
-		scrypt_ROMix_1((scrypt_mix_word_t *)(X + (chunk_bytes * i)), (scrypt_mix_word_t *)Y, (scrypt_mix_word_t *)V, N);
+		scrypt_ROMix_1_best((scrypt_mix_word_t *)(X + (chunk_bytes * i)), (scrypt_mix_word_t *)Y, (scrypt_mix_word_t *)V, N);
 
 	/* 3: Out = PBKDF2(password, X) */
 	scrypt_pbkdf2_1(password, password_len, X, chunk_bytes * p, out, bytes);
@@ -132,8 +169,7 @@ unsigned char GetNfactor(unsigned int nTimestamp, unsigned int ntime) {
 int scanhash_scryptjane( int thr_id, struct work *work, uint32_t max_nonce,
                          uint64_t *hashes_done)
 {
-	scrypt_aligned_alloc YX, V;
-	uint8_t *X, *Y;
+	uint8_t *X, *Y, *V;
 	uint32_t N, chunk_bytes;
 	const uint32_t r = SCRYPT_R;
 	const uint32_t p = SCRYPT_P;
@@ -159,13 +195,10 @@ int scanhash_scryptjane( int thr_id, struct work *work, uint32_t max_nonce,
 	N = (1 << ( opt_scrypt_n + 1));
 
 	chunk_bytes = SCRYPT_BLOCK_BYTES * r * 2;
-	if (!scrypt_alloc((uint64_t)N * chunk_bytes, &V)) return 1;
-	if (!scrypt_alloc((p + 1) * chunk_bytes, &YX)) {
-		scrypt_free(&V);
-		return 1;
-	}
+	V = scryptjane_buffer((size_t)(N + p + 1) * chunk_bytes);
+	if (!V) return 1;
 
-	Y = YX.ptr;
+	Y = V + (size_t)N * chunk_bytes;
 	X = Y + chunk_bytes;
 
 	do {
@@ -175,13 +208,11 @@ int scanhash_scryptjane( int thr_id, struct work *work, uint32_t max_nonce,
 
 		scrypt_N_1_1((unsigned char *)endiandata, 80,
 			(unsigned char *)endiandata, 80,
-			N, (unsigned char *)hash, 32, X, Y, V.ptr);
+			N, (unsigned char *)hash, 32, X, Y, V);
 
 		if (hash[7] <= Htarg && fulltest(hash, ptarget)) {
 			pdata[19] = nonce;
 			*hashes_done = pdata[19] - first_nonce;
-			scrypt_free(&V);
-			scrypt_free(&YX);
 			return 1;
 		}
 		nonce++;
@@ -191,16 +222,13 @@ int scanhash_scryptjane( int thr_id, struct work *work, uint32_t max_nonce,
 	pdata[19] = nonce;
 	*hashes_done = pdata[19] - first_nonce + 1;
 
-	scrypt_free(&V);
-	scrypt_free(&YX);
 	return 0;
 }
 
 /* simple cpu test (util.c) */
 void scryptjanehash(void *output, const void *input )
 {
-	scrypt_aligned_alloc YX, V;
-	uint8_t *X, *Y;
+	uint8_t *X, *Y, *V;
 	uint32_t chunk_bytes;
 	uint32_t N = (1 << ( opt_scrypt_n + 1));
 	const uint32_t r = SCRYPT_R;
@@ -209,20 +237,14 @@ void scryptjanehash(void *output, const void *input )
 	memset(output, 0, 32);
 
 	chunk_bytes = SCRYPT_BLOCK_BYTES * r * 2;
-	if (!scrypt_alloc((uint64_t)N * chunk_bytes, &V)) return;
-	if (!scrypt_alloc((p + 1) * chunk_bytes, &YX)) {
-		scrypt_free(&V);
-		return;
-	}
+	V = scryptjane_buffer((size_t)(N + p + 1) * chunk_bytes);
+	if (!V) return;
 
-	Y = YX.ptr;
+	Y = V + (size_t)N * chunk_bytes;
 	X = Y + chunk_bytes;
 
 	scrypt_N_1_1((unsigned char*)input, 80, (unsigned char*)input, 80,
-		N, (unsigned char*)output, 32, X, Y, V.ptr);
-
-	scrypt_free(&V);
-	scrypt_free(&YX);
+		N, (unsigned char*)output, 32, X, Y, V);
 }
 
 void scryptjane_set_target( struct work* work, double job_diff )
@@ -236,6 +258,15 @@ int64_t scryptjane_get_max64()
 }
 */
 
+bool scryptjane_get_scratchbuf( unsigned char** scratchbuf )
+{
+  // Sized for the current Nfactor, scanhash grows it if that goes up.
+  uint32_t N = (1 << ( opt_scrypt_n + 1));
+  *scratchbuf = scryptjane_buffer( (size_t)(N + SCRYPT_P + 1)
+                                   * SCRYPT_BLOCK_BYTES * SCRYPT_R * 2 );
+  return NULL == *scratchbuf ? false : true;
+}
+
 bool register_scryptjane_algo( algo_gate_t* gate )
 {
 //  gate->init_ctx = &init_axiom_ctx;
@@ -246,6 +277,8 @@ bool register_scryptjane_algo( algo_gate_t* gate )
     gate->set_target = (void*)&scrypt_set_target;
     gate->get_max64  = (void*)&get_max64_0x40LL;
 //    gate->get_max64  = (void*)&scryptjane_get_max64;
+    gate->get_scratchbuf = (void*)&scryptjane_get_scratchbuf;
+    scrypt_ROMix_1_best = scrypt_getROMix_1();
     if ( opt_nfactor == 0 )
        opt_nfactor = 16;
     return true;
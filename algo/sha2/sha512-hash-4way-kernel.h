@@ -0,0 +1,155 @@
+// SHA-512 kernel, included by sha512-hash-4way.c once per vector width.
+// The includer defines V, LANES, the V_* operations, KERNEL_TARGET and
+// KERNEL_SUFFIX. Lane l of every vector is a 64 bit word of message l.
+
+#ifndef SHA512_HASH_4WAY_KERNEL_H__
+#define SHA512_HASH_4WAY_KERNEL_H__
+
+#define SHA512_CAT_( a, b )  a##b
+#define SHA512_CAT( a, b )   SHA512_CAT_( a, b )
+#define KN( f )              SHA512_CAT( f, KERNEL_SUFFIX )
+
+#define S512_BSG0( x ) \
+   V_XOR( V_XOR( V_ROR64( x, 28 ), V_ROR64( x, 34 ) ), V_ROR64( x, 39 ) )
+#define S512_BSG1( x ) \
+   V_XOR( V_XOR( V_ROR64( x, 14 ), V_ROR64( x, 18 ) ), V_ROR64( x, 41 ) )
+#define S512_SSG0( x ) \
+   V_XOR( V_XOR( V_ROR64( x,  1 ), V_ROR64( x,  8 ) ), V_SRL64( x, 7 ) )
+#define S512_SSG1( x ) \
+   V_XOR( V_XOR( V_ROR64( x, 19 ), V_ROR64( x, 61 ) ), V_SRL64( x, 6 ) )
+
+#define S512_CH( e, f, g )    V_XOR( V_AND( V_XOR( f, g ), e ), g )
+#define S512_MAJ( a, b, c ) \
+   V_OR( V_AND( a, b ), V_AND( c, V_OR( a, b ) ) )
+
+// Round j + i, d and h take the new values.
+#define S512_ROUND( a, b, c, d, e, f, g, h, i, j ) \
+do { \
+   const V t1_ = V_ADD( V_ADD( V_ADD( h, S512_BSG1( e ) ), \
+                               S512_CH( e, f, g ) ), \
+                        V_ADD( V_SET1_64( sha512_K[ (j) + (i) ] ), W[i] ) ); \
+   d = V_ADD( d, t1_ ); \
+   h = V_ADD( V_ADD( t1_, S512_BSG0( a ) ), S512_MAJ( a, b, c ) ); \
+} while (0)
+
+// Next schedule word in place of W[i], W holds the last 16.
+#define S512_W( i ) \
+   W[i] = V_ADD( V_ADD( W[i], S512_SSG1( W[ ( (i) + 14 ) & 15 ] ) ), \
+                 V_ADD( W[ ( (i) + 9 ) & 15 ], \
+                        S512_SSG0( W[ ( (i) + 1 ) & 15 ] ) ) )
+
+#endif
+
+KERNEL_TARGET
+static inline void KN( sha512_compress )( V *s, V *W )
+{
+   V A = s[0], B = s[1], C = s[2], D = s[3],
+     E = s[4], F = s[5], G = s[6], H = s[7];
+
+   for ( int j = 0; j < 80; j += 16 )
+   {
+      if ( j )
+      {
+         S512_W(  0 ); S512_W(  1 ); S512_W(  2 ); S512_W(  3 );
+         S512_W(  4 ); S512_W(  5 ); S512_W(  6 ); S512_W(  7 );
+         S512_W(  8 ); S512_W(  9 ); S512_W( 10 ); S512_W( 11 );
+         S512_W( 12 ); S512_W( 13 ); S512_W( 14 ); S512_W( 15 );
+      }
+      S512_ROUND( A, B, C, D, E, F, G, H,  0, j );
+      S512_ROUND( H, A, B, C, D, E, F, G,  1, j );
+      S512_ROUND( G, H, A, B, C, D, E, F,  2, j );
+      S512_ROUND( F, G, H, A, B, C, D, E,  3, j );
+      S512_ROUND( E, F, G, H, A, B, C, D,  4, j );
+      S512_ROUND( D, E, F, G, H, A, B, C,  5, j );
+      S512_ROUND( C, D, E, F, G, H, A, B,  6, j );
+      S512_ROUND( B, C, D, E, F, G, H, A,  7, j );
+      S512_ROUND( A, B, C, D, E, F, G, H,  8, j );
+      S512_ROUND( H, A, B, C, D, E, F, G,  9, j );
+      S512_ROUND( G, H, A, B, C, D, E, F, 10, j );
+      S512_ROUND( F, G, H, A, B, C, D, E, 11, j );
+      S512_ROUND( E, F, G, H, A, B, C, D, 12, j );
+      S512_ROUND( D, E, F, G, H, A, B, C, 13, j );
+      S512_ROUND( C, D, E, F, G, H, A, B, 14, j );
+      S512_ROUND( B, C, D, E, F, G, H, A, 15, j );
+   }
+
+   s[0] = V_ADD( s[0], A );
+   s[1] = V_ADD( s[1], B );
+   s[2] = V_ADD( s[2], C );
+   s[3] = V_ADD( s[3], D );
+   s[4] = V_ADD( s[4], E );
+   s[5] = V_ADD( s[5], F );
+   s[6] = V_ADD( s[6], G );
+   s[7] = V_ADD( s[7], H );
+}
+
+// hash[l] holds len bytes of message l, the digest replaces it. A 64 byte
+// message is one block whose second half is the constant padding, it is
+// read in place. Other lengths go block by block, the tail through a
+// padded copy.
+KERNEL_TARGET
+static void KN( sha512 )( void * const hash[], int len )
+{
+   uint64_t wb[16][LANES] __attribute__ ((aligned (64)));
+   V s[8], W[16];
+
+   for ( int i = 0; i < 8; i++ )
+      s[i] = V_SET1_64( sha512_IV[i] );
+
+   if ( len == 64 )
+   {
+      for ( int l = 0; l < LANES; l++ )
+         for ( int i = 0; i < 8; i++ )
+            wb[i][l] = __builtin_bswap64( ( (const uint64_t*)hash[l] )[i] );
+      for ( int i = 0; i < 8; i++ )
+         W[i] = V_LOAD( wb[i] );
+      W[8] = V_SET1_64( 0x8000000000000000 );
+      for ( int i = 9; i < 15; i++ )
+         W[i] = V_SET1_64( 0 );
+      W[15] = V_SET1_64( 64 << 3 );
+      KN( sha512_compress )( s, W );
+   }
+   else
+   {
+      unsigned char pad[LANES][256] __attribute__ ((aligned (64)));
+      const int full = len / 128;
+      const int rem = len % 128;
+      const int nblk = full + ( rem < 112 ? 1 : 2 );
+
+      // a 1 bit, zeros and the 128 bit length big endian end the last block
+      for ( int l = 0; l < LANES; l++ )
+      {
+         unsigned char *p = pad[l];
+         memcpy( p, (const unsigned char*)hash[l] + 128*full, rem );
+         p[rem] = 0x80;
+         memset( p + rem + 1, 0, ( nblk - full ) * 128 - rem - 1 );
+         ( (uint64_t*)p )[ ( nblk - full ) * 16 - 1 ] =
+                               __builtin_bswap64( (uint64_t)len << 3 );
+      }
+
+      for ( int n = 0; n < nblk; n++ )
+      {
+         for ( int l = 0; l < LANES; l++ )
+         {
+            const unsigned char *p = n < full
+                                ? (const unsigned char*)hash[l] + 128*n
+                                : pad[l] + 128*( n - full );
+            for ( int i = 0; i < 16; i++ )
+            {
+               uint64_t w;
+               memcpy( &w, p + 8*i, 8 );
+               wb[i][l] = __builtin_bswap64( w );
+            }
+         }
+         for ( int i = 0; i < 16; i++ )
+            W[i] = V_LOAD( wb[i] );
+         KN( sha512_compress )( s, W );
+      }
+   }
+
+   for ( int i = 0; i < 8; i++ )
+      V_STORE( wb[i], s[i] );
+   for ( int l = 0; l < LANES; l++ )
+      for ( int i = 0; i < 8; i++ )
+         ( (uint64_t*)hash[l] )[i] = __builtin_bswap64( wb[i][l] );
+}
@@ -0,0 +1,208 @@
+#include <string.h>
+
+#include "miner.h"
+#include "sha512-hash-4way.h"
+#include "algo/sha3/sph_sha2.h"
+
+// The kernels are built with target attributes rather than build flags so
+// one binary carries them all and picks one for the cpu it runs on.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) \
+    && ( __GNUC__ >= 8 )
+  #define SHA512_MULTI_LANE 1
+#endif
+
+#if defined(SHA512_MULTI_LANE)
+
+#include <immintrin.h>
+
+static const uint64_t sha512_IV[8] = {
+   0x6A09E667F3BCC908, 0xBB67AE8584CAA73B,
+   0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+   0x510E527FADE682D1, 0x9B05688C2B3E6C1F,
+   0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179
+};
+
+static const uint64_t sha512_K[80] = {
+   0x428A2F98D728AE22, 0x7137449123EF65CD,
+   0xB5C0FBCFEC4D3B2F, 0xE9B5DBA58189DBBC,
+   0x3956C25BF348B538, 0x59F111F1B605D019,
+   0x923F82A4AF194F9B, 0xAB1C5ED5DA6D8118,
+   0xD807AA98A3030242, 0x12835B0145706FBE,
+   0x243185BE4EE4B28C, 0x550C7DC3D5FFB4E2,
+   0x72BE5D74F27B896F, 0x80DEB1FE3B1696B1,
+   0x9BDC06A725C71235, 0xC19BF174CF692694,
+   0xE49B69C19EF14AD2, 0xEFBE4786384F25E3,
+   0x0FC19DC68B8CD5B5, 0x240CA1CC77AC9C65,
+   0x2DE92C6F592B0275, 0x4A7484AA6EA6E483,
+   0x5CB0A9DCBD41FBD4, 0x76F988DA831153B5,
+   0x983E5152EE66DFAB, 0xA831C66D2DB43210,
+   0xB00327C898FB213F, 0xBF597FC7BEEF0EE4,
+   0xC6E00BF33DA88FC2, 0xD5A79147930AA725,
+   0x06CA6351E003826F, 0x142929670A0E6E70,
+   0x27B70A8546D22FFC, 0x2E1B21385C26C926,
+   0x4D2C6DFC5AC42AED, 0x53380D139D95B3DF,
+   0x650A73548BAF63DE, 0x766A0ABB3C77B2A8,
+   0x81C2C92E47EDAEE6, 0x92722C851482353B,
+   0xA2BFE8A14CF10364, 0xA81A664BBC423001,
+   0xC24B8B70D0F89791, 0xC76C51A30654BE30,
+   0xD192E819D6EF5218, 0xD69906245565A910,
+   0xF40E35855771202A, 0x106AA07032BBD1B8,
+   0x19A4C116B8D2D0C8, 0x1E376C085141AB53,
+   0x2748774CDF8EEB99, 0x34B0BCB5E19B48A8,
+   0x391C0CB3C5C95A63, 0x4ED8AA4AE3418ACB,
+   0x5B9CCA4F7763E373, 0x682E6FF3D6B2B8A3,
+   0x748F82EE5DEFB2FC, 0x78A5636F43172F60,
+   0x84C87814A1F0AB72, 0x8CC702081A6439EC,
+   0x90BEFFFA23631E28, 0xA4506CEBDE82BDE9,
+   0xBEF9A3F7B2C67915, 0xC67178F2E372532B,
+   0xCA273ECEEA26619C, 0xD186B8C721C0C207,
+   0xEADA7DD6CDE0EB1E, 0xF57D4F7FEE6ED178,
+   0x06F067AA72176FBA, 0x0A637DC5A2C898A6,
+   0x113F9804BEF90DAE, 0x1B710B35131C471B,
+   0x28DB77F523047D84, 0x32CAAB7B40C72493,
+   0x3C9EBE0A15C9BEBC, 0x431D67C49C100D4C,
+   0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A,
+   0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817
+};
+
+// 4 lanes, ymm
+
+#define V                   __m256i
+#define LANES               4
+#define KERNEL_TARGET       __attribute__ ((target("avx2")))
+#define KERNEL_SUFFIX       _4way_avx2
+#define V_LOAD( p )         _mm256_load_si256( (const __m256i*)(p) )
+#define V_STORE( p, x )     _mm256_store_si256( (__m256i*)(p), x )
+#define V_SET1_64( x )      _mm256_set1_epi64x( x )
+#define V_ADD               _mm256_add_epi64
+#define V_XOR               _mm256_xor_si256
+#define V_AND               _mm256_and_si256
+#define V_OR                _mm256_or_si256
+#define V_SRL64             _mm256_srli_epi64
+#define V_ROR64( x, c ) \
+   _mm256_or_si256( _mm256_srli_epi64( x, c ), _mm256_slli_epi64( x, 64-(c) ) )
+#include "sha512-hash-4way-kernel.h"
+#undef KERNEL_TARGET
+#undef KERNEL_SUFFIX
+#undef V_ROR64
+
+// 4 lanes, ymm with the AVX-512 rotate
+
+#define KERNEL_TARGET       __attribute__ ((target("avx512f,avx512vl")))
+#define KERNEL_SUFFIX       _4way_avx512
+#define V_ROR64             _mm256_ror_epi64
+#include "sha512-hash-4way-kernel.h"
+
+#undef V
+#undef LANES
+#undef KERNEL_TARGET
+#undef KERNEL_SUFFIX
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1_64
+#undef V_ADD
+#undef V_XOR
+#undef V_AND
+#undef V_OR
+#undef V_SRL64
+#undef V_ROR64
+
+// 8 lanes, zmm
+
+#define V                   __m512i
+#define LANES               8
+#define KERNEL_TARGET       __attribute__ ((target("avx512f")))
+#define KERNEL_SUFFIX       _8way_avx512
+#define V_LOAD( p )         _mm512_load_si512( (const void*)(p) )
+#define V_STORE( p, x )     _mm512_store_si512( (void*)(p), x )
+#define V_SET1_64( x )      _mm512_set1_epi64( x )
+#define V_ADD               _mm512_add_epi64
+#define V_XOR               _mm512_xor_si512
+#define V_AND               _mm512_and_si512
+#define V_OR                _mm512_or_si512
+#define V_SRL64             _mm512_srli_epi64
+#define V_ROR64             _mm512_ror_epi64
+#include "sha512-hash-4way-kernel.h"
+
+#undef V
+#undef LANES
+#undef KERNEL_TARGET
+#undef KERNEL_SUFFIX
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1_64
+#undef V_ADD
+#undef V_XOR
+#undef V_AND
+#undef V_OR
+#undef V_SRL64
+#undef V_ROR64
+
+static void sha512_x8_4way_avx2( void * const hash[8], int len )
+{
+   sha512_4way_avx2( hash, len );
+   sha512_4way_avx2( hash + 4, len );
+}
+
+static void sha512_x8_4way_avx512( void * const hash[8], int len )
+{
+   sha512_8way_avx512( hash, len );
+}
+
+#endif   // SHA512_MULTI_LANE
+
+static void sha512_x4_sph( void * const hash[4], int len )
+{
+   sph_sha512_context ctx;
+   for ( int i = 0; i < 4; i++ )
+   {
+      sph_sha512_init( &ctx );
+      sph_sha512( &ctx, hash[i], len );
+      sph_sha512_close( &ctx, hash[i] );
+   }
+}
+
+static void sha512_x8_sph( void * const hash[8], int len )
+{
+   sha512_x4_sph( hash, len );
+   sha512_x4_sph( hash + 4, len );
+}
+
+static void ( *sha512_x4_fn )( void * const*, int ) = NULL;
+static void ( *sha512_x8_fn )( void * const*, int ) = NULL;
+
+// Every thread picks the same kernels, a racing first call is harmless.
+static void sha512_select( void )
+{
+#if defined(SHA512_MULTI_LANE)
+   // every cpu with AVX512BW also has AVX512VL
+   if ( has_avx512() )
+   {
+      sha512_x8_fn = sha512_x8_4way_avx512;
+      sha512_x4_fn = sha512_4way_avx512;
+      return;
+   }
+   if ( has_avx2() )
+   {
+      sha512_x8_fn = sha512_x8_4way_avx2;
+      sha512_x4_fn = sha512_4way_avx2;
+      return;
+   }
+#endif
+   sha512_x8_fn = sha512_x8_sph;
+   sha512_x4_fn = sha512_x4_sph;
+}
+
+void sha512_x4( void * const hash[4], int len )
+{
+   if ( !sha512_x4_fn )
+      sha512_select();
+   sha512_x4_fn( hash, len );
+}
+
+void sha512_x8( void * const hash[8], int len )
+{
+   if ( !sha512_x8_fn )
+      sha512_select();
+   sha512_x8_fn( hash, len );
+}
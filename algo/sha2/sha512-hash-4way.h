@@ -0,0 +1,25 @@
+#ifndef SHA512_HASH_4WAY_H__
+#define SHA512_HASH_4WAY_H__
+
+// SHA-512 of 4 or 8 independent messages, one message per 64 bit element of
+// a vector. The kernel is picked at the first call: 8 lanes on zmm registers
+// with AVX-512, 4 lanes on ymm registers with AVX2 (sha512_x8 runs it twice),
+// otherwise sph_sha512 one message at a time. x17, m7m and hodl all hash
+// through here.
+//
+// hash[i] holds len bytes of message i on entry and its 64 byte digest on
+// return. A 64 byte message is one block and takes a shorter path, any
+// other len is padded block by block.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sha512_x4( void * const hash[4], int len );
+void sha512_x8( void * const hash[8], int len );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
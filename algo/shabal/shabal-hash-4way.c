@@ -0,0 +1,297 @@
+#include <string.h>
+
+#include "miner.h"
+#include "shabal-hash-4way.h"
+
+#if defined(__SSE2__)
+
+// Same permutation as sph_shabal.c with the state words held in arrays,
+// every index below is a constant so the arrays live in registers.
+
+static const uint32_t A_init_256[] = {
+   0x52F84552, 0xE54B7999, 0x2D8EE3EC, 0xB9645191,
+   0xE0078B86, 0xBB7C44C9, 0xD2B5C1CA, 0xB0D2EB8C,
+   0x14CE5A45, 0x22AF50DC, 0xEFFDBC6B, 0xEB21B74A
+};
+
+static const uint32_t B_init_256[] = {
+   0xB555C6EE, 0x3E710596, 0xA72A652F, 0x9301515F,
+   0xDA28C1FA, 0x696FD868, 0x9CB6BF72, 0x0AFE4002,
+   0xA6E03615, 0x5138C1D4, 0xBE216306, 0xB38B8890,
+   0x3EA8B96B, 0x3299ACE4, 0x30924DD4, 0x55CB34A5
+};
+
+static const uint32_t C_init_256[] = {
+   0xB405F031, 0xC4233EBA, 0xB3733979, 0xC0DD9D55,
+   0xC51C28AE, 0xA327B8E1, 0x56C56167, 0xED614433,
+   0x88B59D60, 0x60E2CEBA, 0x758B4B8B, 0x83E82A7F,
+   0xBC968828, 0xE6E00BF7, 0xBA839E55, 0x9B491C60
+};
+
+static const uint32_t A_init_512[] = {
+   0x20728DFD, 0x46C0BD53, 0xE782B699, 0x55304632,
+   0x71B4EF90, 0x0EA9E82C, 0xDBB930F1, 0xFAD06B8B,
+   0xBE0CAE40, 0x8BD14410, 0x76D2ADAC, 0x28ACAB7F
+};
+
+static const uint32_t B_init_512[] = {
+   0xC1099CB7, 0x07B385F3, 0xE7442C26, 0xCC8AD640,
+   0xEB6F56C7, 0x1EA81AA9, 0x73B9D314, 0x1DE85D08,
+   0x48910A5A, 0x893B22DB, 0xC5A0DF44, 0xBBC4324E,
+   0x72D2F240, 0x75941D99, 0x6D8BDE82, 0xA1A7502B
+};
+
+static const uint32_t C_init_512[] = {
+   0xD9BF68D1, 0x58BAD750, 0x56028CB2, 0x8134F359,
+   0xB5D469D8, 0x941A8CC2, 0x418B2A6E, 0x04052780,
+   0x7F07D787, 0x5194358F, 0x3C60D665, 0xBE97D79A,
+   0x950C3434, 0xAED9A06D, 0x2537DC8D, 0x7CDB5969
+};
+
+#define PERM_ELT( xa0, xa1, xb0, xb1, xb2, xb3, xc, xm ) \
+do { \
+   __m128i t = mm_rotl_32( xa1, 15 ); \
+   t = _mm_add_epi32( _mm_slli_epi32( t, 2 ), t );        /* * 5 */ \
+   t = _mm_xor_si128( _mm_xor_si128( xa0, t ), xc ); \
+   t = _mm_add_epi32( _mm_slli_epi32( t, 1 ), t );        /* * 3 */ \
+   xa0 = _mm_xor_si128( _mm_xor_si128( t, xb1 ), \
+                 _mm_xor_si128( _mm_andnot_si128( xb3, xb2 ), xm ) ); \
+   xb0 = _mm_xor_si128( _mm_xor_si128( mm_rotl_32( xb0, 1 ), xa0 ), \
+                        _mm_set1_epi32( 0xFFFFFFFF ) ); \
+} while (0)
+
+#define PERM_ELT_I( s, i ) \
+   PERM_ELT( A[ ( 16*(s) + (i)      ) % 12 ], \
+             A[ ( 16*(s) + (i) + 11 ) % 12 ], \
+             B[ (i) ], B[ ( (i) + 13 ) & 15 ], B[ ( (i) + 9 ) & 15 ], \
+             B[ ( (i) + 6 ) & 15 ], C[ ( 24 - (i) ) & 15 ], M[ (i) ] )
+
+#define PERM_STEP( s ) \
+do { \
+   PERM_ELT_I( s,  0 ); PERM_ELT_I( s,  1 ); \
+   PERM_ELT_I( s,  2 ); PERM_ELT_I( s,  3 ); \
+   PERM_ELT_I( s,  4 ); PERM_ELT_I( s,  5 ); \
+   PERM_ELT_I( s,  6 ); PERM_ELT_I( s,  7 ); \
+   PERM_ELT_I( s,  8 ); PERM_ELT_I( s,  9 ); \
+   PERM_ELT_I( s, 10 ); PERM_ELT_I( s, 11 ); \
+   PERM_ELT_I( s, 12 ); PERM_ELT_I( s, 13 ); \
+   PERM_ELT_I( s, 14 ); PERM_ELT_I( s, 15 ); \
+} while (0)
+
+// A[11 - k] += C[6 - k] for k = 0 .. 35, indices taken modulo 12 and 16.
+#define ADD_C3( k ) \
+do { \
+   A[ ( 11 + 36 - (k) ) % 12 ] = _mm_add_epi32( A[ ( 11 + 36 - (k) ) % 12 ], \
+                                           C[ ( 6 + 48 - (k) ) & 15 ] ); \
+   A[ ( 10 + 36 - (k) ) % 12 ] = _mm_add_epi32( A[ ( 10 + 36 - (k) ) % 12 ], \
+                                           C[ ( 5 + 48 - (k) ) & 15 ] ); \
+   A[ (  9 + 36 - (k) ) % 12 ] = _mm_add_epi32( A[ (  9 + 36 - (k) ) % 12 ], \
+                                           C[ ( 4 + 48 - (k) ) & 15 ] ); \
+} while (0)
+
+static inline void apply_p_4way( __m128i *A, __m128i *B, const __m128i *C,
+                                 const __m128i *M )
+{
+   for ( int i = 0; i < 16; i++ )
+      B[i] = mm_rotl_32( B[i], 17 );
+   PERM_STEP( 0 );
+   PERM_STEP( 1 );
+   PERM_STEP( 2 );
+   ADD_C3(  0 ); ADD_C3(  3 ); ADD_C3(  6 ); ADD_C3(  9 );
+   ADD_C3( 12 ); ADD_C3( 15 ); ADD_C3( 18 ); ADD_C3( 21 );
+   ADD_C3( 24 ); ADD_C3( 27 ); ADD_C3( 30 ); ADD_C3( 33 );
+}
+
+static void shabal_4way_init( shabal_4way_context *ctx, unsigned size )
+{
+   const uint32_t *A_init, *B_init, *C_init;
+
+   if ( size == 512 )
+   {
+      A_init = A_init_512;
+      B_init = B_init_512;
+      C_init = C_init_512;
+   }
+   else
+   {
+      A_init = A_init_256;
+      B_init = B_init_256;
+      C_init = C_init_256;
+   }
+   for ( int i = 0; i < 12; i++ )
+      ctx->A[i] = _mm_set1_epi32( A_init[i] );
+   for ( int i = 0; i < 16; i++ )
+   {
+      ctx->B[i] = _mm_set1_epi32( B_init[i] );
+      ctx->C[i] = _mm_set1_epi32( C_init[i] );
+   }
+   ctx->Wlow = 1;
+   ctx->Whigh = 0;
+   ctx->ptr = 0;
+   ctx->out_size = size;
+}
+
+static void shabal_4way_core( shabal_4way_context *ctx, const void *data,
+                              size_t len )
+{
+   const __m128i *vdata = (const __m128i*)data;
+   __m128i *A = ctx->A, *B = ctx->B, *C = ctx->C;
+   const __m128i *M = ctx->buf;
+   size_t ptr = ctx->ptr;
+
+   while ( len > 0 )
+   {
+      size_t clen = 64 - ptr;
+      if ( clen > len )
+         clen = len;
+      for ( size_t i = 0; i < clen >> 2; i++ )
+         ctx->buf[ ( ptr >> 2 ) + i ] = _mm_loadu_si128( vdata + i );
+      vdata += clen >> 2;
+      len -= clen;
+      ptr += clen;
+      if ( ptr == 64 )
+      {
+         __m128i T[16];
+         for ( int i = 0; i < 16; i++ )
+            B[i] = _mm_add_epi32( B[i], M[i] );
+         A[0] = _mm_xor_si128( A[0], _mm_set1_epi32( ctx->Wlow ) );
+         A[1] = _mm_xor_si128( A[1], _mm_set1_epi32( ctx->Whigh ) );
+         apply_p_4way( A, B, C, M );
+         // C -= M, then swap B and C
+         for ( int i = 0; i < 16; i++ )
+         {
+            T[i] = _mm_sub_epi32( C[i], M[i] );
+            C[i] = B[i];
+            B[i] = T[i];
+         }
+         if ( ++ctx->Wlow == 0 )
+            ctx->Whigh++;
+         ptr = 0;
+      }
+   }
+   ctx->ptr = ptr;
+}
+
+static void shabal_4way_close( shabal_4way_context *ctx, void *dst )
+{
+   __m128i *out = (__m128i*)dst;
+   __m128i *A = ctx->A, *B = ctx->B, *C = ctx->C;
+   const __m128i *M = ctx->buf;
+   const __m128i W0 = _mm_set1_epi32( ctx->Wlow );
+   const __m128i W1 = _mm_set1_epi32( ctx->Whigh );
+   const unsigned size_words = ctx->out_size >> 5;
+
+   ctx->buf[ ctx->ptr >> 2 ] = _mm_set1_epi32( 0x80 );
+   for ( size_t i = ( ctx->ptr >> 2 ) + 1; i < 16; i++ )
+      ctx->buf[i] = _mm_setzero_si128();
+
+   for ( int i = 0; i < 16; i++ )
+      B[i] = _mm_add_epi32( B[i], M[i] );
+   A[0] = _mm_xor_si128( A[0], W0 );
+   A[1] = _mm_xor_si128( A[1], W1 );
+   apply_p_4way( A, B, C, M );
+   for ( int r = 0; r < 3; r++ )
+   {
+      for ( int i = 0; i < 16; i++ )
+      {
+         __m128i t = B[i];
+         B[i] = C[i];
+         C[i] = t;
+      }
+      A[0] = _mm_xor_si128( A[0], W0 );
+      A[1] = _mm_xor_si128( A[1], W1 );
+      apply_p_4way( A, B, C, M );
+   }
+
+   for ( unsigned i = 0; i < size_words; i++ )
+      _mm_storeu_si128( out + i, B[ 16 - size_words + i ] );
+
+   shabal_4way_init( ctx, ctx->out_size );
+}
+
+void shabal256_4way_init( shabal256_4way_context *ctx )
+{
+   shabal_4way_init( ctx, 256 );
+}
+
+void shabal256_4way( shabal256_4way_context *ctx, const void *data,
+                     size_t len )
+{
+   shabal_4way_core( ctx, data, len );
+}
+
+void shabal256_4way_close( shabal256_4way_context *ctx, void *dst )
+{
+   shabal_4way_close( ctx, dst );
+}
+
+void shabal512_4way_init( shabal512_4way_context *ctx )
+{
+   shabal_4way_init( ctx, 512 );
+}
+
+void shabal512_4way( shabal512_4way_context *ctx, const void *data,
+                     size_t len )
+{
+   shabal_4way_core( ctx, data, len );
+}
+
+void shabal512_4way_close( shabal512_4way_context *ctx, void *dst )
+{
+   shabal_4way_close( ctx, dst );
+}
+
+#else
+
+#include "sph_shabal.h"
+
+#endif
+
+void shabal512_x4( void * const hash[4], int len )
+{
+#if defined(__SSE2__)
+   __m128i vhash[32] __attribute__ ((aligned (64)));
+   shabal512_4way_context ctx;
+
+   mm_interleave_4x32( vhash, hash[0], hash[1], hash[2], hash[3], len << 3 );
+   shabal512_4way_init( &ctx );
+   shabal512_4way( &ctx, vhash, len );
+   shabal512_4way_close( &ctx, vhash );
+   mm_deinterleave_4x32( hash[0], hash[1], hash[2], hash[3], vhash, 512 );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      sph_shabal512_context ctx;
+      sph_shabal512_init( &ctx );
+      sph_shabal512( &ctx, hash[i], len );
+      sph_shabal512_close( &ctx, hash[i] );
+   }
+#endif
+}
+
+int shabal512_x4_target( void * const hash[4], int len,
+                         const uint32_t *target )
+{
+#if defined(__SSE2__)
+   __m128i vhash[32] __attribute__ ((aligned (64)));
+   shabal512_4way_context ctx;
+   int mask;
+
+   mm_interleave_4x32( vhash, hash[0], hash[1], hash[2], hash[3], len << 3 );
+   shabal512_4way_init( &ctx );
+   shabal512_4way( &ctx, vhash, len );
+   shabal512_4way_close( &ctx, vhash );
+   mask = fulltest_4x32( vhash, target );
+   if ( mask )
+      mm_deinterleave_4x32( hash[0], hash[1], hash[2], hash[3], vhash, 512 );
+   return mask;
+#else
+   int mask = 0;
+
+   shabal512_x4( hash, len );
+   for ( int i = 0; i < 4; i++ )
+      if ( fulltest( hash[i], target ) )
+         mask |= 1 << i;
+   return mask;
+#endif
+}
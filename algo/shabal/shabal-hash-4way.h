@@ -0,0 +1,52 @@
+#ifndef SHABAL_HASH_4WAY_H__
+#define SHABAL_HASH_4WAY_H__
+
+#include <stdint.h>
+
+// Shabal for 4 lanes in parallel, one lane per 32 bit element of an xmm
+// register. Input and output are interleaved 4x32, lengths are bytes per
+// lane and must be a multiple of 4. Like sph_shabal, close reinitializes
+// the context so it can be reused for the next message straight away.
+
+#if defined(__SSE2__)
+
+#include <stddef.h>
+#include "avxdefs.h"
+
+typedef struct {
+   __m128i buf[16] __attribute__ ((aligned (64)));
+   __m128i A[12], B[16], C[16];
+   uint32_t Wlow, Whigh;
+   size_t ptr;          // bytes per lane in buf
+   unsigned out_size;   // digest bits, 256 or 512
+} shabal_4way_context;
+
+typedef shabal_4way_context shabal256_4way_context;
+typedef shabal_4way_context shabal512_4way_context;
+
+void shabal256_4way_init( shabal256_4way_context *ctx );
+void shabal256_4way( shabal256_4way_context *ctx, const void *data,
+                     size_t len );
+void shabal256_4way_close( shabal256_4way_context *ctx, void *dst );
+
+void shabal512_4way_init( shabal512_4way_context *ctx );
+void shabal512_4way( shabal512_4way_context *ctx, const void *data,
+                     size_t len );
+void shabal512_4way_close( shabal512_4way_context *ctx, void *dst );
+
+#endif
+
+// Shabal-512 of 4 ordinary, not interleaved, lane buffers: hash[i] holds len
+// bytes of lane i, a multiple of 4 up to 128, and gets its 64 byte digest.
+// Without SSE2 the lanes go through sph_shabal one at a time.
+
+void shabal512_x4( void * const hash[4], int len );
+
+// As shabal512_x4 for the last stage of a chain, the first 256 bits of the
+// digests are tested against target while still interleaved. Returns the
+// mask of lanes at or below target, hash is only written when it is not 0.
+
+int shabal512_x4_target( void * const hash[4], int len,
+                         const uint32_t *target );
+
+#endif
@@ -0,0 +1,114 @@
+// Shavite-512 kernel, included by shavite-hash-4way.c once per vector
+// width. The includer defines V, LANES, the V_* operations, KERNEL_TARGET
+// and KERNEL_NAME. Every operation works within 128 bit lanes, so each lane
+// runs the compression function of sph_shavite.c on its own message, with
+// the table based AES rounds replaced by aesenc.
+
+#ifndef SHAVITE_HASH_4WAY_KERNEL_H__
+#define SHAVITE_HASH_4WAY_KERNEL_H__
+
+// Half a round: 4 AES rounds on r keyed by the next 4 subkeys, into l.
+#define SV_ELT( l, r, k0, k1, k2, k3 ) \
+do { \
+   V x = V_AESENC( V_XOR( r, k0 ), k1 ); \
+   x = V_AESENC( x, k2 ); \
+   x = V_AESENC( x, k3 ); \
+   x = V_AESENC( x, V_ZERO ); \
+   l = V_XOR( l, x ); \
+} while (0)
+
+// Next 8 subkeys, nonlinear step. k[i] is replaced by the AES round of
+// itself rotated by one word, xored with the subkey before it. Subkey ci
+// then takes the counter words c, before the subkeys after it use it.
+#define SV_EXPAND_NL( k, ci, c ) \
+do { \
+   k[0] = V_XOR( V_AESENC( V_SHUF32( k[0], 0x39 ), V_ZERO ), k[7] ); \
+   if ( (ci) == 0 ) k[0] = V_XOR( k[0], c ); \
+   for ( int i = 1; i < 8; i++ ) \
+   { \
+      k[i] = V_XOR( V_AESENC( V_SHUF32( k[i], 0x39 ), V_ZERO ), k[i-1] ); \
+      if ( (ci) == i ) k[i] = V_XOR( k[i], c ); \
+   } \
+} while (0)
+
+// Next 8 subkeys, linear step: k[i] ^= the 4 words 7 back from it.
+#define SV_EXPAND_L( k ) \
+do { \
+   k[0] = V_XOR( k[0], V_ALIGNR( k[7], k[6], 4 ) ); \
+   k[1] = V_XOR( k[1], V_ALIGNR( k[0], k[7], 4 ) ); \
+   for ( int i = 2; i < 8; i++ ) \
+      k[i] = V_XOR( k[i], V_ALIGNR( k[i-1], k[i-2], 4 ) ); \
+} while (0)
+
+#define SV_ROUND( p, k ) \
+do { \
+   V t; \
+   SV_ELT( p[0], p[1], k[0], k[1], k[2], k[3] ); \
+   SV_ELT( p[2], p[3], k[4], k[5], k[6], k[7] ); \
+   t = p[3]; p[3] = p[2]; p[2] = p[1]; p[1] = p[0]; p[0] = t; \
+} while (0)
+
+#endif
+
+// hash[i] holds len bytes of lane i, at most 109, and gets the digest.
+KERNEL_TARGET
+static void KERNEL_NAME( void * const hash[], int len )
+{
+   __m128i blk[8][LANES] __attribute__ ((aligned (64)));
+   V k[8], p[4], h[4];
+   const uint32_t bits = len << 3;
+
+   // padded message, one block per lane: 0x80, the message size in bits
+   // at byte 110 and the digest size in bits at byte 126
+   for ( int l = 0; l < LANES; l++ )
+   {
+      unsigned char b[128];
+      memcpy( b, hash[l], len );
+      b[len] = 0x80;
+      memset( b + len + 1, 0, 126 - len - 1 );
+      memcpy( b + 110, &bits, 4 );
+      b[126] = 0;
+      b[127] = 2;
+      for ( int j = 0; j < 8; j++ )
+         blk[j][l] = _mm_loadu_si128( (const __m128i*)b + j );
+   }
+
+   for ( int i = 0; i < 4; i++ )
+      h[i] = p[i] = V_BCAST( _mm_load_si128( (const __m128i*)IV512 + i ) );
+   for ( int j = 0; j < 8; j++ )
+      k[j] = V_LOAD( blk[j] );
+
+   // The counter words are mixed into subkeys 8, 41, 79 and 110, the
+   // high 96 bits of the counter are zero for a single block.
+   SV_ROUND( p, k );
+   for ( int r = 1; r < 14; r++ )
+   {
+      switch ( r )
+      {
+         case 1:
+            SV_EXPAND_NL( k, 0, V_BCAST( _mm_set_epi32( -1, 0, 0, bits ) ) );
+            break;
+         case 5:
+            SV_EXPAND_NL( k, 1, V_BCAST( _mm_set_epi32( ~bits, 0, 0, 0 ) ) );
+            break;
+         case 9:
+            SV_EXPAND_NL( k, 7, V_BCAST( _mm_set_epi32( -1, bits, 0, 0 ) ) );
+            break;
+         case 13:
+            SV_EXPAND_NL( k, 6, V_BCAST( _mm_set_epi32( -1, 0, bits, 0 ) ) );
+            break;
+         default:
+            if ( r & 1 )
+               SV_EXPAND_NL( k, -1, V_ZERO );
+            else
+               SV_EXPAND_L( k );
+      }
+      SV_ROUND( p, k );
+   }
+
+   for ( int i = 0; i < 4; i++ )
+      V_STORE( blk[i], V_XOR( h[i], p[i] ) );
+   for ( int l = 0; l < LANES; l++ )
+      for ( int j = 0; j < 4; j++ )
+         _mm_storeu_si128( (__m128i*)hash[l] + j, blk[j][l] );
+}
@@ -0,0 +1,170 @@
+#include <string.h>
+#include <immintrin.h>
+
+#include "miner.h"
+#include "shavite-hash-4way.h"
+#include "sph_shavite.h"
+
+#ifndef NO_AES_NI
+
+static const uint32_t IV512[16] __attribute__ ((aligned (16))) =
+{
+   0x72FCCDD8, 0x79CA4727, 0x128A077B, 0x40D55AEC,
+   0xD1901A06, 0x430AE307, 0xB29F5CD1, 0xDF07FBFC,
+   0x8E45D73D, 0x681AB538, 0xBDE86578, 0xDD577E47,
+   0xE275EADE, 0x502D9FCD, 0xB9357178, 0x022A4B9A
+};
+
+// 1 lane, xmm
+
+#define V                   __m128i
+#define LANES               1
+#define KERNEL_TARGET
+#define KERNEL_NAME         shavite512_aesni
+#define V_ZERO              _mm_setzero_si128()
+#define V_LOAD( p )         _mm_load_si128( (const __m128i*)(p) )
+#define V_STORE( p, x )     _mm_store_si128( (__m128i*)(p), x )
+#define V_BCAST( x )        (x)
+#define V_XOR               _mm_xor_si128
+#define V_SHUF32            _mm_shuffle_epi32
+#define V_ALIGNR            _mm_alignr_epi8
+#define V_AESENC            _mm_aesenc_si128
+
+#include "shavite-hash-4way-kernel.h"
+
+#undef V
+#undef LANES
+#undef KERNEL_TARGET
+#undef KERNEL_NAME
+#undef V_ZERO
+#undef V_LOAD
+#undef V_STORE
+#undef V_BCAST
+#undef V_XOR
+#undef V_SHUF32
+#undef V_ALIGNR
+#undef V_AESENC
+
+// The VAES kernels are built with target attributes rather than build
+// flags so one binary carries them and uses them only on cpus that have it.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) \
+    && ( __GNUC__ >= 8 )
+  #define SHAVITE_VAES 1
+#endif
+
+#endif   // !NO_AES_NI
+
+#if defined(SHAVITE_VAES)
+
+// 2 lanes, ymm
+
+#define V                   __m256i
+#define LANES               2
+#define KERNEL_TARGET       __attribute__ ((target("avx2,vaes")))
+#define KERNEL_NAME         shavite512_2way_vaes
+#define V_ZERO              _mm256_setzero_si256()
+#define V_LOAD( p )         _mm256_load_si256( (const __m256i*)(p) )
+#define V_STORE( p, x )     _mm256_store_si256( (__m256i*)(p), x )
+#define V_BCAST( x )        _mm256_broadcastsi128_si256( x )
+#define V_XOR               _mm256_xor_si256
+#define V_SHUF32            _mm256_shuffle_epi32
+#define V_ALIGNR            _mm256_alignr_epi8
+#define V_AESENC            _mm256_aesenc_epi128
+
+#include "shavite-hash-4way-kernel.h"
+
+#undef V
+#undef LANES
+#undef KERNEL_TARGET
+#undef KERNEL_NAME
+#undef V_ZERO
+#undef V_LOAD
+#undef V_STORE
+#undef V_BCAST
+#undef V_XOR
+#undef V_SHUF32
+#undef V_ALIGNR
+#undef V_AESENC
+
+// 4 lanes, zmm
+
+#define V                   __m512i
+#define LANES               4
+#define KERNEL_TARGET       __attribute__ ((target("avx512f,avx512bw,vaes")))
+#define KERNEL_NAME         shavite512_4way_vaes
+#define V_ZERO              _mm512_setzero_si512()
+#define V_LOAD( p )         _mm512_load_si512( (const void*)(p) )
+#define V_STORE( p, x )     _mm512_store_si512( (void*)(p), x )
+#define V_BCAST( x )        _mm512_broadcast_i32x4( x )
+#define V_XOR               _mm512_xor_si512
+#define V_SHUF32            _mm512_shuffle_epi32
+#define V_ALIGNR            _mm512_alignr_epi8
+#define V_AESENC            _mm512_aesenc_epi128
+
+#include "shavite-hash-4way-kernel.h"
+
+#endif   // SHAVITE_VAES
+
+void shavite512_64( void *out, const void *in )
+{
+#ifdef NO_AES_NI
+   sph_shavite512_context ctx;
+   sph_shavite512_init( &ctx );
+   sph_shavite512( &ctx, in, 64 );
+   sph_shavite512_close( &ctx, out );
+#else
+   void * const hash[1] = { out };
+   if ( out != in )
+      memcpy( out, in, 64 );
+   shavite512_aesni( hash, 64 );
+#endif
+}
+
+static void shavite512_x4_1way( void * const hash[4], int len )
+{
+   for ( int i = 0; i < 4; i++ )
+   {
+#ifdef NO_AES_NI
+      sph_shavite512_context ctx;
+      sph_shavite512_init( &ctx );
+      sph_shavite512( &ctx, hash[i], len );
+      sph_shavite512_close( &ctx, hash[i] );
+#else
+      shavite512_aesni( hash + i, len );
+#endif
+   }
+}
+
+#if defined(SHAVITE_VAES)
+
+static void shavite512_x4_2way( void * const hash[4], int len )
+{
+   shavite512_2way_vaes( hash, len );
+   shavite512_2way_vaes( hash + 2, len );
+}
+
+static void shavite512_x4_4way( void * const hash[4], int len )
+{
+   shavite512_4way_vaes( hash, len );
+}
+
+#endif
+
+static void ( *shavite512_x4_fn )( void * const*, int ) = NULL;
+
+void shavite512_x4( void * const hash[4], int len )
+{
+   // Every thread picks the same kernel, a racing first call is harmless.
+   if ( !shavite512_x4_fn )
+   {
+#if defined(SHAVITE_VAES)
+      if ( has_vaes() && has_avx512() )
+         shavite512_x4_fn = shavite512_x4_4way;
+      else if ( has_vaes() )
+         shavite512_x4_fn = shavite512_x4_2way;
+      else
+#endif
+         shavite512_x4_fn = shavite512_x4_1way;
+   }
+   shavite512_x4_fn( hash, len );
+}
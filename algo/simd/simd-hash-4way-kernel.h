@@ -0,0 +1,337 @@
+// SIMD-512 kernel, included by simd-hash-4way.c once per vector width.
+// The includer defines V, LANES, the V_* operations and KERNEL_SUFFIX.
+// Every operation works within 128 bit lanes, so each lane runs the SSE2
+// code of sse2/vector.c (fft256_msg and rounds512) on its own message.
+
+#ifndef SIMD_HASH_4WAY_KERNEL_H__
+#define SIMD_HASH_4WAY_KERNEL_H__
+
+#define SIMD_CAT_( a, b )   a##b
+#define SIMD_CAT( a, b )    SIMD_CAT_( a, b )
+#define KN( f )             SIMD_CAT( f, KERNEL_SUFFIX )
+
+// Reduce modulo 257, the result is in [-127, 383].
+#define SD_REDUCE( x ) \
+   V_SUB16( V_AND( x, V_SET1_16( 255 ) ), V_SRAI16( x, 8 ) )
+
+// Reduce modulo 257, the result is in [-128, 128].
+#define SD_REDUCE_FULL( x )   V_EXTRA_REDUCE( SD_REDUCE( x ) )
+
+// Butterflies of the 8 point transforms, w = 4 is the 8th root of unity.
+#define SD_BUTTERFLY_DIF( X, i, j, n ) \
+do { \
+   const V v_ = X[j]; \
+   X[j] = V_ADD16( X[i], X[j] ); \
+   X[i] = (n) ? V_SLLI16( V_SUB16( X[i], v_ ), 2*(n) ) \
+              : V_SUB16( X[i], v_ ); \
+} while (0)
+
+#define SD_BUTTERFLY_DIT( X, i, j, n ) \
+do { \
+   const V u_ = X[j]; \
+   if ( n ) X[i] = V_SLLI16( X[i], 2*(n) ); \
+   X[j] = V_SUB16( X[j], X[i] ); \
+   X[i] = V_ADD16( u_, X[i] ); \
+} while (0)
+
+#define SD_INTERLEAVE( X, i, j ) \
+do { \
+   const V t1_ = X[i]; \
+   const V t2_ = X[j]; \
+   X[i] = V_UNPACKLO16( t1_, t2_ ); \
+   X[j] = V_UNPACKHI16( t1_, t2_ ); \
+} while (0)
+
+#define SD_F0( b, c, d )   V_XOR( V_AND( V_XOR( c, d ), b ), d )
+#define SD_F1( b, c, d )   V_OR( V_AND( d, c ), V_AND( V_OR( d, c ), b ) )
+
+// d = one of the 7 word permutations of a, p is ( z + start ) % 7.
+#define SD_PERM( p, dl, dh, al, ah ) \
+do { \
+   switch ( p ) \
+   { \
+      case 0: dl = V_SHUF32( al, 0xb1 ); dh = V_SHUF32( ah, 0xb1 ); break; \
+      case 1: dl = V_SHUF32( ah, 0x4e ); dh = V_SHUF32( al, 0x4e ); break; \
+      case 2: dl = V_SHUF32( al, 0x4e ); dh = V_SHUF32( ah, 0x4e ); break; \
+      case 3: dl = V_SHUF32( al, 0x1b ); dh = V_SHUF32( ah, 0x1b ); break; \
+      case 4: dl = V_SHUF32( ah, 0xb1 ); dh = V_SHUF32( al, 0xb1 ); break; \
+      case 5: dl = V_SHUF32( ah, 0x1b ); dh = V_SHUF32( al, 0x1b ); break; \
+      default: dl = ah; dh = al; \
+   } \
+} while (0)
+
+// One step on the 8 state words in al,ah to dl,dh, the caller rotates
+// the roles of the 4 word groups between steps.
+#define SD_STEP( a, b, c, d, wl, wh, f, r, s, p ) \
+do { \
+   V ttl_ = V_ADD32( SD_F##f( a##l, b##l, c##l ), V_ADD32( wl, d##l ) ); \
+   V tth_ = V_ADD32( SD_F##f( a##h, b##h, c##h ), V_ADD32( wh, d##h ) ); \
+   a##l = V_ROTL32( a##l, r ); \
+   a##h = V_ROTL32( a##h, r ); \
+   ttl_ = V_ROTL32( ttl_, s ); \
+   tth_ = V_ROTL32( tth_, s ); \
+   SD_PERM( p, d##l, d##h, a##l, a##h ); \
+   d##l = V_ADD32( d##l, ttl_ ); \
+   d##h = V_ADD32( d##h, tth_ ); \
+} while (0)
+
+// Message words from the FFT output, u selects the low or high half.
+#define SD_MSG( wl, wh, hh, ll, u, code ) \
+do { \
+   const V a_ = W[ 2*(hh) + (u) ]; \
+   const V b_ = W[ 2*(ll) + (u) ]; \
+   wl = V_MUL16( V_UNPACKLO16( a_, b_ ), code ); \
+   wh = V_MUL16( V_UNPACKHI16( a_, b_ ), code ); \
+} while (0)
+
+#define SD_ROUND( h0, l0, u0, h1, l1, u1, h2, l2, u2, h3, l3, u3, \
+                  f, r, s, t, u, code, ps ) \
+do { \
+   V wl_, wh_; \
+   SD_MSG( wl_, wh_, h0, l0, u0, code ); \
+   SD_STEP( S0, S1, S2, S3, wl_, wh_, f, r, s, ( 0 + (ps) ) % 7 ); \
+   SD_MSG( wl_, wh_, h1, l1, u1, code ); \
+   SD_STEP( S3, S0, S1, S2, wl_, wh_, f, s, t, ( 1 + (ps) ) % 7 ); \
+   SD_MSG( wl_, wh_, h2, l2, u2, code ); \
+   SD_STEP( S2, S3, S0, S1, wl_, wh_, f, t, u, ( 2 + (ps) ) % 7 ); \
+   SD_MSG( wl_, wh_, h3, l3, u3, code ); \
+   SD_STEP( S1, S2, S3, S0, wl_, wh_, f, u, r, ( 3 + (ps) ) % 7 ); \
+} while (0)
+
+static const short simd_fft64_twiddle[7][8] __attribute__ ((aligned (16))) =
+{
+   {   1,    2,    4,    8,   16,   32,   64,  128 },
+   {   1,   60,    2,  120,    4,  -17,    8,  -34 },
+   {   1,  120,    8,  -68,   64,  -30,   -2,   17 },
+   {   1,   46,   60,  -67,    2,   92,  120,  123 },
+   {   1,   92,  -17,  -22,   32,  117,  -30,   67 },
+   {   1,  -67,  120,  -73,    8,  -22,  -68,  -70 },
+   {   1,  123,  -34,  -70,  128,   67,   17,   35 }
+};
+
+static const short simd_fft128_twiddle[8][8] __attribute__ ((aligned (16))) =
+{
+   {   1, -118,   46,  -31,   60,  116,  -67,  -61 },
+   {   2,   21,   92,  -62,  120,  -25,  123, -122 },
+   {   4,   42,  -73, -124,  -17,  -50,  -11,   13 },
+   {   8,   84,  111,    9,  -34, -100,  -22,   26 },
+   {  16,  -89,  -35,   18,  -68,   57,  -44,   52 },
+   {  32,   79,  -70,   36,  121,  114,  -88,  104 },
+   {  64,  -99,  117,   72,  -15,  -29,   81,  -49 },
+   { 128,   59,  -23, -113,  -30,  -58,  -95,  -98 }
+};
+
+static const short simd_fft256_twiddle[16][8] __attribute__ ((aligned (16))) =
+{
+   {   1,   41, -118,   45,   46,   87,  -31,   14 },
+   {  60, -110,  116, -127,  -67,   80,  -61,   69 },
+   {   2,   82,   21,   90,   92,  -83,  -62,   28 },
+   { 120,   37,  -25,    3,  123,  -97, -122, -119 },
+   {   4,  -93,   42,  -77,  -73,   91, -124,   56 },
+   { -17,   74,  -50,    6,  -11,   63,   13,   19 },
+   {   8,   71,   84,  103,  111,  -75,    9,  112 },
+   { -34, -109, -100,   12,  -22,  126,   26,   38 },
+   {  16, -115,  -89,  -51,  -35,  107,   18,  -33 },
+   { -68,   39,   57,   24,  -44,   -5,   52,   76 },
+   {  32,   27,   79, -102,  -70,  -43,   36,  -66 },
+   { 121,   78,  114,   48,  -88,  -10,  104, -105 },
+   {  64,   54,  -99,   53,  117,  -86,   72,  125 },
+   { -15, -101,  -29,   96,   81,  -20,  -49,   47 },
+   { 128,  108,   59,  106,  -23,   85, -113,   -7 },
+   { -30,   55,  -58,  -65,  -95,  -40,  -98,   94 }
+};
+
+#define SD_TWIDDLE( t, i )   V_BCAST( _mm_load_si128( (const __m128i*)t[i] ) )
+
+#endif
+
+static inline void KN( simd512_fft64 )( V *A )
+{
+   V X[8];
+
+   for ( int i = 0; i < 8; i++ )
+      X[i] = A[i];
+
+   // 8 parallel DIF FFT_8, the output is in revbin order
+   SD_BUTTERFLY_DIF( X, 0, 4, 0 );
+   SD_BUTTERFLY_DIF( X, 1, 5, 1 );
+   SD_BUTTERFLY_DIF( X, 2, 6, 2 );
+   SD_BUTTERFLY_DIF( X, 3, 7, 3 );
+   X[2] = SD_REDUCE( X[2] );
+   X[3] = SD_REDUCE( X[3] );
+   SD_BUTTERFLY_DIF( X, 0, 2, 0 );
+   SD_BUTTERFLY_DIF( X, 4, 6, 0 );
+   SD_BUTTERFLY_DIF( X, 1, 3, 2 );
+   SD_BUTTERFLY_DIF( X, 5, 7, 2 );
+   X[1] = SD_REDUCE( X[1] );
+   SD_BUTTERFLY_DIF( X, 0, 1, 0 );
+   SD_BUTTERFLY_DIF( X, 2, 3, 0 );
+   SD_BUTTERFLY_DIF( X, 4, 5, 0 );
+   SD_BUTTERFLY_DIF( X, 6, 7, 0 );
+   // X[7] doesn't need reducing
+   for ( int i = 0; i < 7; i++ )
+      X[i] = SD_REDUCE_FULL( X[i] );
+
+   for ( int i = 0; i < 7; i++ )
+      X[6-i] = V_MUL16( X[6-i], SD_TWIDDLE( simd_fft64_twiddle, i ) );
+
+   // transpose with a revbin permutation of the rows and columns
+   SD_INTERLEAVE( X, 1, 0 );
+   SD_INTERLEAVE( X, 3, 2 );
+   SD_INTERLEAVE( X, 5, 4 );
+   SD_INTERLEAVE( X, 7, 6 );
+   SD_INTERLEAVE( X, 2, 0 );
+   SD_INTERLEAVE( X, 3, 1 );
+   SD_INTERLEAVE( X, 6, 4 );
+   SD_INTERLEAVE( X, 7, 5 );
+   SD_INTERLEAVE( X, 4, 0 );
+   SD_INTERLEAVE( X, 5, 1 );
+   SD_INTERLEAVE( X, 6, 2 );
+   SD_INTERLEAVE( X, 7, 3 );
+
+   // 8 parallel DIT FFT_8, the input is in revbin order
+   for ( int i = 0; i < 8; i++ )
+      X[i] = SD_REDUCE( X[i] );
+   SD_BUTTERFLY_DIT( X, 0, 1, 0 );
+   SD_BUTTERFLY_DIT( X, 2, 3, 0 );
+   SD_BUTTERFLY_DIT( X, 4, 5, 0 );
+   SD_BUTTERFLY_DIT( X, 6, 7, 0 );
+   SD_BUTTERFLY_DIT( X, 0, 2, 0 );
+   SD_BUTTERFLY_DIT( X, 4, 6, 0 );
+   SD_BUTTERFLY_DIT( X, 1, 3, 2 );
+   SD_BUTTERFLY_DIT( X, 5, 7, 2 );
+   X[3] = SD_REDUCE( X[3] );
+   SD_BUTTERFLY_DIT( X, 0, 4, 0 );
+   SD_BUTTERFLY_DIT( X, 1, 5, 1 );
+   SD_BUTTERFLY_DIT( X, 2, 6, 2 );
+   SD_BUTTERFLY_DIT( X, 3, 7, 3 );
+
+   for ( int i = 0; i < 8; i++ )
+      A[i] = SD_REDUCE_FULL( X[i] );
+}
+
+static inline void KN( simd512_fft128 )( V *A )
+{
+   V B[8];
+
+   for ( int i = 0; i < 8; i++ )
+   {
+      B[i]   = SD_REDUCE_FULL( V_ADD16( A[i], A[i+8] ) );
+      A[i+8] = SD_REDUCE_FULL( V_SUB16( A[i], A[i+8] ) );
+      A[i+8] = SD_REDUCE_FULL( V_MUL16( A[i+8],
+                                 SD_TWIDDLE( simd_fft128_twiddle, i ) ) );
+   }
+
+   KN( simd512_fft64 )( B );
+   KN( simd512_fft64 )( A+8 );
+
+   for ( int i = 0; i < 8; i++ )
+   {
+      const V t = A[i+8];
+      A[2*i]   = V_UNPACKLO16( B[i], t );
+      A[2*i+1] = V_UNPACKHI16( B[i], t );
+   }
+}
+
+// One compression, M is the 128 byte block and final tweaks the last
+// butterflies to tell the length block apart.
+static inline void KN( simd512_compress )( V *S, const V *M, int final )
+{
+   V W[32];
+   const V zero = V_ZERO;
+   const V tweak = V_BCAST( final ? _mm_set_epi16( 1, 0, 1, 0, 0, 0, 0, 0 )
+                                  : _mm_set_epi16( 1, 0, 0, 0, 0, 0, 0, 0 ) );
+
+   // the message bytes as 16 bit values and their twiddled copies, X^127
+   // comes in through the tweak of the last pair
+   for ( int i = 0; i < 8; i++ )
+   {
+      V lo = V_UNPACKLO8( M[i], zero );
+      V hi = V_UNPACKHI8( M[i], zero );
+      V hi2 = hi;
+      if ( i == 7 )
+      {
+         hi = V_ADD16( hi2, tweak );
+         hi2 = V_SUB16( hi2, tweak );
+      }
+      W[2*i]    = lo;
+      W[2*i+16] = SD_REDUCE( V_MUL16( lo,
+                             SD_TWIDDLE( simd_fft256_twiddle, 2*i ) ) );
+      W[2*i+1]  = hi;
+      W[2*i+17] = SD_REDUCE( V_MUL16( hi2,
+                             SD_TWIDDLE( simd_fft256_twiddle, 2*i+1 ) ) );
+   }
+   KN( simd512_fft128 )( W );
+   KN( simd512_fft128 )( W+16 );
+
+   {
+      const V code0 = V_SET1_16( 185 );
+      const V code1 = V_SET1_16( 233 );
+      V S0l = V_XOR( S[0], M[0] ), S0h = V_XOR( S[1], M[1] );
+      V S1l = V_XOR( S[2], M[2] ), S1h = V_XOR( S[3], M[3] );
+      V S2l = V_XOR( S[4], M[4] ), S2h = V_XOR( S[5], M[5] );
+      V S3l = V_XOR( S[6], M[6] ), S3h = V_XOR( S[7], M[7] );
+
+      // 4 rounds with code 185, 4 with code 233
+      SD_ROUND(  2, 10, 0,  3, 11, 0,  0,  8, 0,  1,  9, 0,
+                 0,  3, 23, 17, 27, code0, 0 );
+      SD_ROUND(  3, 11, 1,  2, 10, 1,  1,  9, 1,  0,  8, 1,
+                 1,  3, 23, 17, 27, code0, 4 );
+      SD_ROUND(  7, 15, 1,  5, 13, 1,  6, 14, 0,  4, 12, 0,
+                 0, 28, 19, 22,  7, code0, 1 );
+      SD_ROUND(  4, 12, 1,  6, 14, 1,  5, 13, 0,  7, 15, 0,
+                 1, 28, 19, 22,  7, code0, 5 );
+      SD_ROUND(  0,  4, 1,  1,  5, 0,  3,  7, 1,  2,  6, 0,
+                 0, 29,  9, 15,  5, code1, 2 );
+      SD_ROUND(  3,  7, 0,  2,  6, 1,  0,  4, 0,  1,  5, 1,
+                 1, 29,  9, 15,  5, code1, 6 );
+      SD_ROUND( 11, 15, 0,  8, 12, 0,  8, 12, 1, 11, 15, 1,
+                 0,  4, 13, 10, 25, code1, 3 );
+      SD_ROUND(  9, 13, 1, 10, 14, 1, 10, 14, 0,  9, 13, 0,
+                 1,  4, 13, 10, 25, code1, 0 );
+
+      // feed forward
+      SD_STEP( S0, S1, S2, S3, S[0], S[1], 0,  4, 13, 4 );
+      SD_STEP( S3, S0, S1, S2, S[2], S[3], 0, 13, 10, 5 );
+      SD_STEP( S2, S3, S0, S1, S[4], S[5], 0, 10, 25, 6 );
+      SD_STEP( S1, S2, S3, S0, S[6], S[7], 0, 25,  4, 0 );
+
+      S[0] = S0l;  S[1] = S0h;  S[2] = S1l;  S[3] = S1h;
+      S[4] = S2l;  S[5] = S2h;  S[6] = S3l;  S[7] = S3h;
+   }
+}
+
+// hash[i] holds len bytes of lane i, 1 to 128, and gets the digest.
+static void KN( simd512 )( void * const hash[], int len )
+{
+   __m128i blk[8][LANES] __attribute__ ((aligned (64)));
+   V S[8], M[8];
+
+   for ( int i = 0; i < 8; i++ )
+      S[i] = V_BCAST( _mm_load_si128( (const __m128i*)simd_iv512 + i ) );
+
+   // the message zero padded to one block
+   for ( int l = 0; l < LANES; l++ )
+   {
+      unsigned char b[128];
+      memcpy( b, hash[l], len );
+      memset( b + len, 0, 128 - len );
+      for ( int j = 0; j < 8; j++ )
+         blk[j][l] = _mm_loadu_si128( (const __m128i*)b + j );
+   }
+   for ( int j = 0; j < 8; j++ )
+      M[j] = V_LOAD( blk[j] );
+   KN( simd512_compress )( S, M, 0 );
+
+   // the message size in bits, little endian
+   M[0] = V_BCAST( _mm_cvtsi32_si128( len << 3 ) );
+   for ( int j = 1; j < 8; j++ )
+      M[j] = V_ZERO;
+   KN( simd512_compress )( S, M, 1 );
+
+   for ( int j = 0; j < 4; j++ )
+      V_STORE( blk[j], S[j] );
+   for ( int l = 0; l < LANES; l++ )
+      for ( int j = 0; j < 4; j++ )
+         _mm_storeu_si128( (__m128i*)hash[l] + j, blk[j][l] );
+}
@@ -0,0 +1,116 @@
+#include <string.h>
+#include <immintrin.h>
+
+#include "simd-hash-4way.h"
+#include "sse2/nist.h"
+#include "avxdefs.h"
+
+#if defined(__AVX2__)
+
+static const uint32_t simd_iv512[32] __attribute__ ((aligned (16))) =
+{
+   0x0ba16b95, 0x72f999ad, 0x9fecc2ae, 0xba3264fc,
+   0x5e894929, 0x8e9f30e5, 0x2f1daa37, 0xf0f2c558,
+   0xac506643, 0xa90635a5, 0xe25b878b, 0xaab7878f,
+   0x88817f7a, 0x0a02892b, 0x559a7550, 0x598f657e,
+   0x7eef60a1, 0x6b70e3e8, 0x9c1714d1, 0xb958e2a8,
+   0xab02675e, 0xed1c014f, 0xcd8d65bb, 0xfdb7a257,
+   0x09254899, 0xd699c7bc, 0x9019b6dc, 0x2b9022e4,
+   0x8fa14956, 0x21bf9bd3, 0xb94d0943, 0x6ffddc22
+};
+
+#endif
+
+#if defined(__AVX512BW__)
+
+// 4 lanes, zmm
+
+#define V                   __m512i
+#define LANES               4
+#define KERNEL_SUFFIX       _4way
+#define V_ZERO              _mm512_setzero_si512()
+#define V_LOAD( p )         _mm512_load_si512( (const void*)(p) )
+#define V_STORE( p, x )     _mm512_store_si512( (void*)(p), x )
+#define V_BCAST( x )        _mm512_broadcast_i32x4( x )
+#define V_SET1_16( x )      _mm512_set1_epi16( x )
+#define V_XOR               _mm512_xor_si512
+#define V_AND               _mm512_and_si512
+#define V_OR                _mm512_or_si512
+#define V_ADD16             _mm512_add_epi16
+#define V_SUB16             _mm512_sub_epi16
+#define V_MUL16             _mm512_mullo_epi16
+#define V_SLLI16            _mm512_slli_epi16
+#define V_SRAI16            _mm512_srai_epi16
+#define V_ADD32             _mm512_add_epi32
+#define V_ROTL32            _mm512_rol_epi32
+#define V_SHUF32            _mm512_shuffle_epi32
+#define V_UNPACKLO8         _mm512_unpacklo_epi8
+#define V_UNPACKHI8         _mm512_unpackhi_epi8
+#define V_UNPACKLO16        _mm512_unpacklo_epi16
+#define V_UNPACKHI16        _mm512_unpackhi_epi16
+// x > 128 ? x - 257 : x
+#define V_EXTRA_REDUCE( x ) \
+   _mm512_mask_sub_epi16( x, \
+          _mm512_cmpgt_epi16_mask( x, _mm512_set1_epi16( 128 ) ), \
+          x, _mm512_set1_epi16( 257 ) )
+
+#include "simd-hash-4way-kernel.h"
+
+#elif defined(__AVX2__)
+
+// 2 lanes, ymm
+
+#define V                   __m256i
+#define LANES               2
+#define KERNEL_SUFFIX       _2way
+#define V_ZERO              _mm256_setzero_si256()
+#define V_LOAD( p )         _mm256_load_si256( (const __m256i*)(p) )
+#define V_STORE( p, x )     _mm256_store_si256( (__m256i*)(p), x )
+#define V_BCAST( x )        _mm256_broadcastsi128_si256( x )
+#define V_SET1_16( x )      _mm256_set1_epi16( x )
+#define V_XOR               _mm256_xor_si256
+#define V_AND               _mm256_and_si256
+#define V_OR                _mm256_or_si256
+#define V_ADD16             _mm256_add_epi16
+#define V_SUB16             _mm256_sub_epi16
+#define V_MUL16             _mm256_mullo_epi16
+#define V_SLLI16            _mm256_slli_epi16
+#define V_SRAI16            _mm256_srai_epi16
+#define V_ADD32             _mm256_add_epi32
+#define V_ROTL32            mm256_rotl_32
+#define V_SHUF32            _mm256_shuffle_epi32
+#define V_UNPACKLO8         _mm256_unpacklo_epi8
+#define V_UNPACKHI8         _mm256_unpackhi_epi8
+#define V_UNPACKLO16        _mm256_unpacklo_epi16
+#define V_UNPACKHI16        _mm256_unpackhi_epi16
+// x > 128 ? x - 257 : x
+#define V_EXTRA_REDUCE( x ) \
+   _mm256_sub_epi16( x, _mm256_and_si256( _mm256_set1_epi16( 257 ), \
+                  _mm256_cmpgt_epi16( x, _mm256_set1_epi16( 128 ) ) ) )
+
+#include "simd-hash-4way-kernel.h"
+
+#endif
+
+void simd512_x4( void * const hash[4], int len )
+{
+#if defined(__AVX512BW__)
+   simd512_4way( hash, len );
+#elif defined(__AVX2__)
+   simd512_2way( hash, len );
+   simd512_2way( hash + 2, len );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      if ( len == 64 )
+         simd512_64( hash[i], hash[i] );
+      else
+      {
+         hashState_sd ctx;
+         init_sd( &ctx, 512 );
+         update_sd( &ctx, (const BitSequence*)hash[i], (DataLength)len << 3 );
+         final_sd( &ctx, (BitSequence*)hash[i] );
+      }
+   }
+#endif
+}
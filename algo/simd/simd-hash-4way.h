@@ -0,0 +1,14 @@
+#ifndef SIMD_HASH_4WAY_H__
+#define SIMD_HASH_4WAY_H__
+
+// SIMD-512 of 4 independent short messages. The FFT and the rounds of
+// sse2/vector.c run on wider vectors with one message per 128 bit lane:
+// four per zmm register with AVX512BW, two per ymm register with AVX2.
+// Without either the messages go through the SSE2 code one at a time.
+//
+// hash[i] holds len bytes of message i on entry and its 64 byte digest on
+// return, len is 1 to 128 so the padded message is a single block.
+
+void simd512_x4( void * const hash[4], int len );
+
+#endif
@@ -253,6 +253,33 @@ HashReturn final_sd(hashState_sd *state, BitSequence *hashval) {
 
 
 
+/*
+ * SIMD-512 of exactly 64 bytes, one zero padded message block and the
+ * length block. Starts from the precomputed IV instead of a context and
+ * skips the buffer handling of update_sd and final_sd.
+ */
+HashReturn simd512_64(void *hashval, const void *data) {
+  hashState_sd state;
+  DATA_ALIGN(unsigned char block[128]);
+
+  state.hashbitlen = 512;
+  memcpy(state.A, IV_512, sizeof state.A);
+
+  memcpy(block, data, 64);
+  memset(block+64, 0, 64);
+  SIMD_Compress(&state, block, 0);
+
+  /* 512 bits hashed, little endian, short message */
+  memset(block, 0, 128);
+  block[1] = 512 >> 8;
+  SIMD_Compress(&state, block, 2);
+
+  /* A holds the little endian words of the digest */
+  memcpy(hashval, state.A, 64);
+  return SUCCESS;
+}
+
+
 /*HashReturn Hash(int hashbitlen, const BitSequence *data, DataLength databitlen,
                 BitSequence *hashval) {
   hashState_sd s;
@@ -57,6 +57,7 @@ typedef struct {
 HashReturn init_sd(hashState_sd *state, int hashbitlen);
 HashReturn update_sd(hashState_sd *state, const BitSequence *data, DataLength databitlen);
 HashReturn final_sd(hashState_sd *state, BitSequence *hashval);
+HashReturn simd512_64(void *hashval, const void *data);
 //HashReturn Hash(int hashbitlen, const BitSequence *data, DataLength databitlen,
 //                BitSequence *hashval);
 
@@ -0,0 +1,243 @@
+#include <string.h>
+
+#include "skein-hash-4way.h"
+#include "sph_skein.h"
+
+#if defined(__AVX2__)
+
+static const uint64_t IV256[8] = {
+   0xCCD044A12FDB3E13, 0xE83590301A79A9EB,
+   0x55AEA0614F816E6F, 0x2A2767A4AE9B94DB,
+   0xEC06025E74DD7683, 0xE7A436CDC4746251,
+   0xC36FBAF9393AD185, 0x3EEDBA1833EDFC13
+};
+
+static const uint64_t IV512[8] = {
+   0x4903ADFF749C51CE, 0x0D95DE399746DF03,
+   0x8FD1934127C79BCE, 0x9A255629FF352CB1,
+   0x5DB62599DF6CA7B0, 0xEABE394CA9D5C3F4,
+   0x991112C71A75B523, 0xAE18A40B660FCC33
+};
+
+#define TFBIG_MIX_4WAY( x0, x1, rc ) \
+do { \
+   x0 = _mm256_add_epi64( x0, x1 ); \
+   x1 = _mm256_xor_si256( mm256_rotl_64( x1, rc ), x0 ); \
+} while (0)
+
+#define TFBIG_MIX8_4WAY( w0, w1, w2, w3, w4, w5, w6, w7, \
+                         rc0, rc1, rc2, rc3 ) \
+do { \
+   TFBIG_MIX_4WAY( w0, w1, rc0 ); \
+   TFBIG_MIX_4WAY( w2, w3, rc1 ); \
+   TFBIG_MIX_4WAY( w4, w5, rc2 ); \
+   TFBIG_MIX_4WAY( w6, w7, rc3 ); \
+} while (0)
+
+#define TFBIG_ADDKEY_4WAY( s ) \
+do { \
+   p0 = _mm256_add_epi64( p0, k[ ( (s) + 0 ) % 9 ] ); \
+   p1 = _mm256_add_epi64( p1, k[ ( (s) + 1 ) % 9 ] ); \
+   p2 = _mm256_add_epi64( p2, k[ ( (s) + 2 ) % 9 ] ); \
+   p3 = _mm256_add_epi64( p3, k[ ( (s) + 3 ) % 9 ] ); \
+   p4 = _mm256_add_epi64( p4, k[ ( (s) + 4 ) % 9 ] ); \
+   p5 = _mm256_add_epi64( p5, _mm256_add_epi64( k[ ( (s) + 5 ) % 9 ], \
+                                   _mm256_set1_epi64x( t[ (s) % 3 ] ) ) ); \
+   p6 = _mm256_add_epi64( p6, _mm256_add_epi64( k[ ( (s) + 6 ) % 9 ], \
+                                   _mm256_set1_epi64x( t[ ( (s) + 1 ) % 3 ] ) ) ); \
+   p7 = _mm256_add_epi64( p7, _mm256_add_epi64( k[ ( (s) + 7 ) % 9 ], \
+                                   _mm256_set1_epi64x( s ) ) ); \
+} while (0)
+
+#define TFBIG_4e_4WAY( s ) \
+do { \
+   TFBIG_ADDKEY_4WAY( s ); \
+   TFBIG_MIX8_4WAY( p0, p1, p2, p3, p4, p5, p6, p7, 46, 36, 19, 37 ); \
+   TFBIG_MIX8_4WAY( p2, p1, p4, p7, p6, p5, p0, p3, 33, 27, 14, 42 ); \
+   TFBIG_MIX8_4WAY( p4, p1, p6, p3, p0, p5, p2, p7, 17, 49, 36, 39 ); \
+   TFBIG_MIX8_4WAY( p6, p1, p0, p7, p2, p5, p4, p3, 44,  9, 54, 56 ); \
+} while (0)
+
+#define TFBIG_4o_4WAY( s ) \
+do { \
+   TFBIG_ADDKEY_4WAY( s ); \
+   TFBIG_MIX8_4WAY( p0, p1, p2, p3, p4, p5, p6, p7, 39, 30, 34, 24 ); \
+   TFBIG_MIX8_4WAY( p2, p1, p4, p7, p6, p5, p0, p3, 13, 50, 10, 17 ); \
+   TFBIG_MIX8_4WAY( p4, p1, p6, p3, p0, p5, p2, p7, 25, 29, 39, 43 ); \
+   TFBIG_MIX8_4WAY( p6, p1, p0, p7, p2, p5, p4, p3,  8, 35, 56, 22 ); \
+} while (0)
+
+// One UBI block: h = Threefish-512( h, tweak, buf ) ^ buf.
+// etype and extra are as in sph_skein's UBI_BIG.
+static void skein_4way_ubi( skein_4way_big_context *ctx, unsigned etype,
+                            unsigned extra )
+{
+   const __m256i *m = ctx->buf;
+   __m256i k[9];
+   uint64_t t[3];
+   __m256i p0, p1, p2, p3, p4, p5, p6, p7;
+
+   t[0] = ( ctx->bcount << 6 ) + (uint64_t)extra;
+   t[1] = ( ctx->bcount >> 58 ) + ( (uint64_t)etype << 55 );
+   t[2] = t[0] ^ t[1];
+
+   k[8] = _mm256_set1_epi64x( 0x1BD11BDAA9FC1A22 );
+   for ( int i = 0; i < 8; i++ )
+   {
+      k[i] = ctx->h[i];
+      k[8] = _mm256_xor_si256( k[8], k[i] );
+   }
+
+   p0 = m[0];
+   p1 = m[1];
+   p2 = m[2];
+   p3 = m[3];
+   p4 = m[4];
+   p5 = m[5];
+   p6 = m[6];
+   p7 = m[7];
+
+   TFBIG_4e_4WAY(  0 );
+   TFBIG_4o_4WAY(  1 );
+   TFBIG_4e_4WAY(  2 );
+   TFBIG_4o_4WAY(  3 );
+   TFBIG_4e_4WAY(  4 );
+   TFBIG_4o_4WAY(  5 );
+   TFBIG_4e_4WAY(  6 );
+   TFBIG_4o_4WAY(  7 );
+   TFBIG_4e_4WAY(  8 );
+   TFBIG_4o_4WAY(  9 );
+   TFBIG_4e_4WAY( 10 );
+   TFBIG_4o_4WAY( 11 );
+   TFBIG_4e_4WAY( 12 );
+   TFBIG_4o_4WAY( 13 );
+   TFBIG_4e_4WAY( 14 );
+   TFBIG_4o_4WAY( 15 );
+   TFBIG_4e_4WAY( 16 );
+   TFBIG_4o_4WAY( 17 );
+   TFBIG_ADDKEY_4WAY( 18 );
+
+   ctx->h[0] = _mm256_xor_si256( m[0], p0 );
+   ctx->h[1] = _mm256_xor_si256( m[1], p1 );
+   ctx->h[2] = _mm256_xor_si256( m[2], p2 );
+   ctx->h[3] = _mm256_xor_si256( m[3], p3 );
+   ctx->h[4] = _mm256_xor_si256( m[4], p4 );
+   ctx->h[5] = _mm256_xor_si256( m[5], p5 );
+   ctx->h[6] = _mm256_xor_si256( m[6], p6 );
+   ctx->h[7] = _mm256_xor_si256( m[7], p7 );
+}
+
+static void skein_4way_init( skein_4way_big_context *ctx,
+                             const uint64_t *iv )
+{
+   for ( int i = 0; i < 8; i++ )
+      ctx->h[i] = _mm256_set1_epi64x( iv[i] );
+   ctx->ptr = 0;
+   ctx->bcount = 0;
+}
+
+// A full block is only compressed once more data follows, the last block
+// must be compressed by close with the final bit set.
+static void skein_4way_core( skein_4way_big_context *ctx, const void *data,
+                             size_t len )
+{
+   const __m256i *vdata = (const __m256i*)data;
+   size_t ptr = ctx->ptr;
+
+   while ( len > 0 )
+   {
+      if ( ptr == 64 )
+      {
+         unsigned first = ( ctx->bcount == 0 ) << 7;
+         ctx->bcount++;
+         skein_4way_ubi( ctx, 96 + first, 0 );
+         ptr = 0;
+      }
+      size_t clen = 64 - ptr;
+      if ( clen > len )
+         clen = len;
+      for ( size_t i = 0; i < clen >> 3; i++ )
+         ctx->buf[ ( ptr >> 3 ) + i ] = _mm256_loadu_si256( vdata + i );
+      vdata += clen >> 3;
+      len -= clen;
+      ptr += clen;
+   }
+   ctx->ptr = ptr;
+}
+
+static void skein_4way_close( skein_4way_big_context *ctx, void *dst,
+                              int out_w64 )
+{
+   __m256i *out = (__m256i*)dst;
+   size_t ptr = ctx->ptr;
+
+   for ( size_t i = ptr >> 3; i < 8; i++ )
+      ctx->buf[i] = _mm256_setzero_si256();
+   skein_4way_ubi( ctx, 352 + ( ( ctx->bcount == 0 ) << 7 ), ptr );
+
+   // output block, the encoding of 0 over 8 bytes
+   for ( int i = 0; i < 8; i++ )
+      ctx->buf[i] = _mm256_setzero_si256();
+   ctx->bcount = 0;
+   skein_4way_ubi( ctx, 510, 8 );
+
+   for ( int i = 0; i < out_w64; i++ )
+      _mm256_storeu_si256( out + i, ctx->h[i] );
+}
+
+void skein256_4way_init( skein256_4way_context *ctx )
+{
+   skein_4way_init( ctx, IV256 );
+}
+
+void skein256_4way( skein256_4way_context *ctx, const void *data,
+                    size_t len )
+{
+   skein_4way_core( ctx, data, len );
+}
+
+void skein256_4way_close( skein256_4way_context *ctx, void *dst )
+{
+   skein_4way_close( ctx, dst, 4 );
+}
+
+void skein512_4way_init( skein512_4way_context *ctx )
+{
+   skein_4way_init( ctx, IV512 );
+}
+
+void skein512_4way( skein512_4way_context *ctx, const void *data,
+                    size_t len )
+{
+   skein_4way_core( ctx, data, len );
+}
+
+void skein512_4way_close( skein512_4way_context *ctx, void *dst )
+{
+   skein_4way_close( ctx, dst, 8 );
+}
+
+#endif
+
+void skein512_x4( void * const hash[4], int len )
+{
+#if defined(__AVX2__)
+   __m256i vdata[16] __attribute__ ((aligned (64)));
+   skein512_4way_context ctx;
+
+   mm256_interleave_4x64( vdata, hash[0], hash[1], hash[2], hash[3],
+                          len << 3 );
+   skein512_4way_init( &ctx );
+   skein512_4way( &ctx, vdata, len );
+   skein512_4way_close( &ctx, vdata );
+   mm256_deinterleave_4x64( hash[0], hash[1], hash[2], hash[3], vdata, 512 );
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      sph_skein512_context ctx;
+      sph_skein512_init( &ctx );
+      sph_skein512( &ctx, hash[i], len );
+      sph_skein512_close( &ctx, hash[i] );
+   }
+#endif
+}
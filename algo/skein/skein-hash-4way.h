@@ -0,0 +1,43 @@
+#ifndef SKEIN_HASH_4WAY_H__
+#define SKEIN_HASH_4WAY_H__
+
+// Skein-512-256 and Skein-512-512 for 4 lanes in parallel, one lane per
+// 64 bit element of a ymm register. Input and output are interleaved 4x64,
+// lengths are bytes per lane and must be a multiple of 8. Output matches
+// sph_skein256 and sph_skein512 for each lane.
+//
+// skein512_x4 is the fixed length form for the chains: hash[i] holds len
+// bytes of message i on entry and its 64 byte digest on return, len is a
+// multiple of 8 up to 128. Without AVX2 the messages go through sph_skein
+// one at a time.
+
+void skein512_x4( void * const hash[4], int len );
+
+#if defined(__AVX2__)
+
+#include <stddef.h>
+#include "avxdefs.h"
+
+typedef struct {
+   __m256i buf[8] __attribute__ ((aligned (64)));
+   __m256i h[8];
+   size_t ptr;          // bytes per lane in buf
+   uint64_t bcount;     // blocks compressed so far
+} skein_4way_big_context;
+
+typedef skein_4way_big_context skein256_4way_context;
+typedef skein_4way_big_context skein512_4way_context;
+
+void skein256_4way_init( skein256_4way_context *ctx );
+void skein256_4way( skein256_4way_context *ctx, const void *data,
+                    size_t len );
+void skein256_4way_close( skein256_4way_context *ctx, void *dst );
+
+void skein512_4way_init( skein512_4way_context *ctx );
+void skein512_4way( skein512_4way_context *ctx, const void *data,
+                    size_t len );
+void skein512_4way_close( skein512_4way_context *ctx, void *dst );
+
+#endif
+
+#endif
@@ -7,6 +7,7 @@
 #include <openssl/sha.h>
 
 #include "sph_skein.h"
+#include "skein-hash-4way.h"
 
 typedef struct {
         sph_skein512_context skein;
@@ -22,28 +23,105 @@ void init_skein_ctx()
 }
 
 
-void skeinhash(void *state, const void *input)
-{
-     skein_ctx_holder ctx;
-     memcpy( &ctx, &skein_ctx, sizeof(skein_ctx) );
+// Skein-512 state after the 76 nonce invariant bytes of the header, set by
+// skein_prehash before each scan. Skein holds back the last full block until
+// it knows whether more data follows, absorbing past 64 bytes makes sure
+// the first block is already compressed.
+static __thread sph_skein512_context skein_mid;
 
+static void skeinhash_ctx( skein_ctx_holder *ctx, void *state,
+                           const void *input, size_t len )
+{
 // 	sph_skein512_context ctx_skein;
 //	SHA256_CTX sha256;
 
 	uint32_t hash[16];
 	
 //	sph_skein512_init(&ctx_skein);
-	sph_skein512(&ctx.skein, input, 80);
-	sph_skein512_close(&ctx.skein, hash);
+	sph_skein512(&ctx->skein, input, len);
+	sph_skein512_close(&ctx->skein, hash);
 
 //	SHA256_Init(&sha256);
-	SHA256_Update(&ctx.sha256, hash, 64);
-	SHA256_Final((unsigned char*) hash, &ctx.sha256);
+	SHA256_Update(&ctx->sha256, hash, 64);
+	SHA256_Final((unsigned char*) hash, &ctx->sha256);
 
 	memcpy(state, hash, 32);
 
 }
 
+void skeinhash(void *state, const void *input)
+{
+     skein_ctx_holder ctx;
+     memcpy( &ctx, &skein_ctx, sizeof(skein_ctx) );
+     skeinhash_ctx( &ctx, state, input, 80 );
+}
+
+// input is the full big endian header, only the nonce is read.
+static void skeinhash_mid( void *state, const void *input )
+{
+     skein_ctx_holder ctx;
+     memcpy( &ctx, &skein_ctx, sizeof(skein_ctx) );
+     memcpy( &ctx.skein, &skein_mid, sizeof ctx.skein );
+     skeinhash_ctx( &ctx, state, (const uint32_t*)input + 19, 4 );
+}
+
+#if defined(__AVX2__)
+
+// The same for 4 lanes. The 4 way core takes whole 64 bit words, so it
+// stops after word 17 and only words 18 and 19 are left per nonce.
+static __thread skein512_4way_context skein_mid4;
+
+static void skein_prehash_4way( const uint32_t *endiandata )
+{
+	uint64_t _ALIGN(64) vdata[4*9];
+
+	mm256_interleave_4x64( vdata, endiandata, endiandata, endiandata,
+	                       endiandata, 576 );
+	skein512_4way_init( &skein_mid4 );
+	skein512_4way( &skein_mid4, vdata, 72 );
+}
+
+// hash[i] gets the hash of the header with nonce n + i, w18 is the big
+// endian header word 18.
+static void skeinhash_4way( uint32_t hash[4][8], uint32_t w18, uint32_t n )
+{
+	uint64_t _ALIGN(64) vdata[4];
+	uint64_t _ALIGN(64) vhash[4*8];
+	uint64_t _ALIGN(64) hash64[4][8];
+	skein512_4way_context ctx;
+
+	for (int i = 0; i < 4; i++)
+		vdata[i] = ( (uint64_t)swab32( n + i ) << 32 ) | w18;
+	memcpy( &ctx, &skein_mid4, sizeof ctx );
+	skein512_4way( &ctx, vdata, 8 );
+	skein512_4way_close( &ctx, vhash );
+	mm256_deinterleave_4x64( hash64[0], hash64[1], hash64[2], hash64[3],
+	                         vhash, 512 );
+
+	for (int i = 0; i < 4; i++)
+	{
+		SHA256_CTX sha256;
+		memcpy( &sha256, &skein_ctx.sha256, sizeof sha256 );
+		SHA256_Update( &sha256, hash64[i], 64 );
+		SHA256_Final( (unsigned char*)hash[i], &sha256 );
+	}
+}
+
+#endif
+
+void skein_prehash( struct work *work )
+{
+	uint32_t _ALIGN(64) endiandata[19];
+
+	for (int i=0; i < 19; i++)
+		be32enc(&endiandata[i], work->data[i]);
+	memcpy( &skein_mid, &skein_ctx.skein, sizeof skein_mid );
+	sph_skein512(&skein_mid, endiandata, 76);
+#if defined(__AVX2__)
+	skein_prehash_4way( endiandata );
+#endif
+}
+
 int scanhash_skein(int thr_id, struct work *work,
 	uint32_t max_nonce, uint64_t *hashes_done)
 {
@@ -61,9 +139,26 @@ int scanhash_skein(int thr_id, struct work *work,
 		be32enc(&endiandata[i], pdata[i]);
 	};
 
+#if defined(__AVX2__)
+	while ( n < max_nonce && max_nonce - n > 4
+	        && !work_restart[thr_id].restart )
+	{
+		uint32_t _ALIGN(64) hash[4][8];
+
+		skeinhash_4way( hash, endiandata[18], n );
+		for (int i = 0; i < 4; i++)
+		if (hash[i][7] < Htarg && fulltest(hash[i], ptarget)) {
+			*hashes_done = n + i - first_nonce + 1;
+			pdata[19] = n + i;
+			return true;
+		}
+		n += 4;
+	}
+#endif
+
 	do {
 		be32enc(&endiandata[19], n); 
-		skeinhash(hash64, endiandata);
+		skeinhash_mid(hash64, endiandata);
 		if (hash64[7] < Htarg && fulltest(hash64, ptarget)) {
 			*hashes_done = n - first_nonce + 1;
 			pdata[19] = n;
@@ -88,6 +183,7 @@ bool register_skein_algo( algo_gate_t* gate )
     gate->scanhash  = (void*)&scanhash_skein;
     gate->hash      = (void*)&skeinhash;
     gate->get_max64 = (void*)&skein_get_max64;
+    gate->prehash   = (void*)&skein_prehash;
     return true;
 };
 
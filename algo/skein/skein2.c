@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "sph_skein.h"
+#include "skein-hash-4way.h"
 
 // ctx caching seems slower with this algo
 //typedef struct {
@@ -17,24 +18,96 @@
 //        sph_skein512_init(&skein2_ctx.skein);
 //}
 
-void skein2hash(void *output, const void *input)
-{
-	sph_skein512_context ctx_skein;
+// Skein-512 state after the 76 nonce invariant bytes of the header, set by
+// skein2_prehash before each scan.
+static __thread sph_skein512_context skein2_mid;
 
+// ctx_skein has already absorbed everything before input.
+static void skein2hash_ctx( sph_skein512_context *ctx_skein, void *output,
+                            const void *input, size_t len )
+{
 	uint32_t hash[16];
 
-	sph_skein512_init(&ctx_skein);
-	sph_skein512(&ctx_skein, input, 80);
-	sph_skein512_close(&ctx_skein, hash);
+	sph_skein512(ctx_skein, input, len);
+	sph_skein512_close(ctx_skein, hash);
 
 //	sph_skein512_init(&ctx_skein);
-	sph_skein512(&ctx_skein, hash, 64);
-	sph_skein512_close(&ctx_skein, hash);
+	sph_skein512(ctx_skein, hash, 64);
+	sph_skein512_close(ctx_skein, hash);
 
 	memcpy(output, hash, 32);
 
 }
 
+void skein2hash(void *output, const void *input)
+{
+	sph_skein512_context ctx_skein;
+
+	sph_skein512_init(&ctx_skein);
+	skein2hash_ctx(&ctx_skein, output, input, 80);
+}
+
+// input is the full big endian header, only the nonce is read.
+static void skein2hash_mid(void *output, const void *input)
+{
+	sph_skein512_context ctx_skein;
+
+	memcpy(&ctx_skein, &skein2_mid, sizeof ctx_skein);
+	skein2hash_ctx(&ctx_skein, output, (const uint32_t*)input + 19, 4);
+}
+
+#if defined(__AVX2__)
+
+// The same for 4 lanes. The 4 way core takes whole 64 bit words, so it
+// stops after word 17 and only words 18 and 19 are left per nonce.
+static __thread skein512_4way_context skein2_mid4;
+
+static void skein2_prehash_4way( const uint32_t *endiandata )
+{
+	uint64_t _ALIGN(64) vdata[4*9];
+
+	mm256_interleave_4x64( vdata, endiandata, endiandata, endiandata,
+	                       endiandata, 576 );
+	skein512_4way_init( &skein2_mid4 );
+	skein512_4way( &skein2_mid4, vdata, 72 );
+}
+
+// hash[i] gets the hash of the header with nonce n + i, w18 is the big
+// endian header word 18.
+static void skein2hash_4way( uint32_t hash[4][8], uint32_t w18, uint32_t n )
+{
+	uint64_t _ALIGN(64) vdata[4];
+	uint64_t _ALIGN(64) vhash[4*8];
+	skein512_4way_context ctx;
+
+	for (int i = 0; i < 4; i++)
+		vdata[i] = ( (uint64_t)swab32( n + i ) << 32 ) | w18;
+	memcpy( &ctx, &skein2_mid4, sizeof ctx );
+	skein512_4way( &ctx, vdata, 8 );
+	skein512_4way_close( &ctx, vhash );
+
+	skein512_4way_init( &ctx );
+	skein512_4way( &ctx, vhash, 64 );
+	skein512_4way_close( &ctx, vhash );
+	mm256_deinterleave_4x64( hash[0], hash[1], hash[2], hash[3],
+	                         vhash, 256 );
+}
+
+#endif
+
+void skein2_prehash( struct work *work )
+{
+	uint32_t _ALIGN(64) endiandata[19];
+
+	for (int i=0; i < 19; i++)
+		be32enc(&endiandata[i], work->data[i]);
+	sph_skein512_init(&skein2_mid);
+	sph_skein512(&skein2_mid, endiandata, 76);
+#if defined(__AVX2__)
+	skein2_prehash_4way( endiandata );
+#endif
+}
+
 int scanhash_skein2(int thr_id, struct work *work,
 	uint32_t max_nonce, uint64_t *hashes_done)
 {
@@ -53,9 +126,26 @@ int scanhash_skein2(int thr_id, struct work *work,
 		be32enc(&endiandata[i], pdata[i]);
 	};
 
+#if defined(__AVX2__)
+	while ( n < max_nonce && max_nonce - n > 4
+	        && !work_restart[thr_id].restart )
+	{
+		uint32_t _ALIGN(64) hash[4][8];
+
+		skein2hash_4way( hash, endiandata[18], n );
+		for (int i = 0; i < 4; i++)
+		if (hash[i][7] < Htarg && fulltest(hash[i], ptarget)) {
+			*hashes_done = n + i - first_nonce + 1;
+			pdata[19] = n + i;
+			return true;
+		}
+		n += 4;
+	}
+#endif
+
 	do {
 		be32enc(&endiandata[19], n);
-		skein2hash(hash64, endiandata);
+		skein2hash_mid(hash64, endiandata);
 		if (hash64[7] < Htarg && fulltest(hash64, ptarget)) {
 			*hashes_done = n - first_nonce + 1;
 			pdata[19] = n;
@@ -82,6 +172,7 @@ bool register_skein2_algo( algo_gate_t* gate )
   gate->scanhash  = (void*)&scanhash_skein2;
   gate->hash      = (void*)&skein2hash;
   gate->get_max64 = (void*)&skein2_get_max64;
+  gate->prehash   = (void*)&skein2_prehash;
   return true;
 };
 
@@ -0,0 +1,264 @@
+#include <string.h>
+#include <stdbool.h>
+
+#include "whirlpool-hash-4way.h"
+
+#if defined(__AVX2__)
+
+#include "avxdefs.h"
+
+// Column j of message l is the 64 bit element l of s[j], row i in byte i.
+// ShiftColumns moves column j down by j rows, a byte rotation of the
+// element, and MixRows sums whole registers times the circulant
+// coefficients 1, 1, 4, 1, 8, 5, 2, 9.
+
+static const uint64_t whirlpool_RC[10] = {
+   0x4F01B887E8C62318, 0x52916F79F5D2A636,
+   0x357B0CA38E9BBC60, 0x57FE4B2EC2D7E01D,
+   0xDA4AF09FE5377715, 0x856BA0B10A29C958,
+   0x67053ECBF4105DBD, 0xD8957DA78B4127E4,
+   0x9E4717DD667CEEFB, 0x33835AAD07BF2DCA
+};
+
+// Round keys of the all zero chaining value the first block starts from,
+// by column.
+static const uint64_t whirlpool_K0[10][8] = {
+   { 0x2828282828282830, 0x282828282828280B,
+     0x28282828282828EE, 0x28282828282828C0,
+     0x28282828282828AF, 0x2828282828282890,
+     0x2828282828282829, 0x2828282828282867 },
+   { 0xF8968F48C570443B, 0xA879F7ACFAFE45AB,
+     0xF8140EC0A9A44589, 0x6807265CE1A466F8,
+     0xB8D790FCE1C545EA, 0xC8858FFCCCA4E9D1,
+     0x78798FB8E1B2CBAE, 0xF87969FCA089AF24 },
+   { 0x7BDC7344810129D3, 0x8D675B5E632C5B19,
+     0x3B092C609E8A23BF, 0xF024CF7AB1C2D1DB,
+     0xD7EFBCB0C08BAF30, 0x3BED8CB2B295CF46,
+     0x7DDDBC0906AC3770, 0x19D371DBA798DB58 },
+   { 0x32FB0111C5F36838, 0x56C9C509E2377CBE,
+     0xDC52D6F042FAF3AA, 0x0CF1EDE858DBD0C1,
+     0xC77B1099EE984ADE, 0xF128B06E35AD8711,
+     0x27EC34248DF03365, 0x40D3017EBC577F86 },
+   { 0xD4B1BE9691E6C1AF, 0xF07BE95A5D0F3625,
+     0xC9593154E67D26A5, 0x3618CBCCBB86A920,
+     0x2796624CE277E394, 0x598432FE6A40C49B,
+     0xAF6A3A5E06F953CF, 0x3147A68D29E14D14 },
+   { 0x92DC97B37A6039E2, 0x77AD49F3A58A2BF9,
+     0x4FE83F4637F8CBB5, 0x49BA48A164CEA2C0,
+     0xED1E78FA41FA1625, 0xB00002838C348437,
+     0x328FCF3F928C940B, 0x3D237C891914A5B0 },
+   { 0xACB023C8F4BFFF75, 0x3016F4DFA87DFA41,
+     0xCD105A5A60023863, 0x29125544C249D082,
+     0x680204EE9A3E5577, 0x33F9755DE598034D,
+     0x33E2009DCEF346FF, 0x1D8CA4270B61002F },
+   { 0xD9A61B21E24C9903, 0x18128EFF9C43406B,
+     0x903B0011CF3EC6F1, 0x0EF7CBA0D3176282,
+     0x3BA36C424C4BD868, 0x2847E4DFFF194684,
+     0x33B74B2686C271AD, 0xCACE1353C5106389 },
+   { 0x2A08777447882AD0, 0xF62A17A64A42941C,
+     0x583BE6925C222F67, 0xEB0B8C5DC746537A,
+     0x8153C4A53DFE4A0A, 0x4DEC735C58AC639A,
+     0xE71A5C6F35A8B62C, 0x62C639A159B4B2F9 },
+   { 0x6A634354C2E0A548, 0x7A1941B78CCE0D95,
+     0x4E354B9C4A3D6B48, 0xF6BB8AD5DBCFC6B6,
+     0x37DB977FC0886B01, 0x01F67D71F626EDEE,
+     0x82150B859C5A8EBC, 0x277A7B13E975813A }
+};
+
+// The S box from its 4 bit mini boxes: with u and l the high and low
+// nibbles, a = E[u], b = E^-1[l] and r = R[a^b], the result is
+// E[a^r] : E^-1[b^r].
+static inline __m256i wp_sbox( const __m256i x )
+{
+   const __m256i E  = _mm256_broadcastsi128_si256( _mm_setr_epi8(
+                         0x1, 0xB, 0x9, 0xC, 0xD, 0x6, 0xF, 0x3,
+                         0xE, 0x8, 0x7, 0x4, 0xA, 0x2, 0x5, 0x0 ) );
+   const __m256i Ei = _mm256_broadcastsi128_si256( _mm_setr_epi8(
+                         0xF, 0x0, 0xD, 0x7, 0xB, 0xE, 0x5, 0xA,
+                         0x9, 0x2, 0xC, 0x1, 0x3, 0x4, 0x8, 0x6 ) );
+   const __m256i R  = _mm256_broadcastsi128_si256( _mm_setr_epi8(
+                         0x7, 0xC, 0xB, 0xD, 0xE, 0x4, 0x9, 0xF,
+                         0x6, 0x3, 0x8, 0xA, 0x2, 0x5, 0x1, 0x0 ) );
+   const __m256i Eh = _mm256_slli_epi16( E, 4 );
+   const __m256i lo = _mm256_set1_epi8( 0x0F );
+   const __m256i a  = _mm256_shuffle_epi8( E,
+                          _mm256_and_si256( _mm256_srli_epi16( x, 4 ), lo ) );
+   const __m256i b  = _mm256_shuffle_epi8( Ei, _mm256_and_si256( x, lo ) );
+   const __m256i r  = _mm256_shuffle_epi8( R, _mm256_xor_si256( a, b ) );
+
+   return _mm256_or_si256(
+                 _mm256_shuffle_epi8( Eh, _mm256_xor_si256( a, r ) ),
+                 _mm256_shuffle_epi8( Ei, _mm256_xor_si256( b, r ) ) );
+}
+
+// Every byte times 2 modulo x^8 + x^4 + x^3 + x^2 + 1.
+static inline __m256i wp_mul2( const __m256i x )
+{
+   return _mm256_xor_si256( _mm256_add_epi8( x, x ),
+           _mm256_and_si256( _mm256_cmpgt_epi8( _mm256_setzero_si256(), x ),
+                             _mm256_set1_epi8( 0x1D ) ) );
+}
+
+// Rotate every 64 bit element left by n bytes, n is 1 to 7.
+#if defined(__AVX512VL__)
+#define WP_ROTB( x, n )   mm256_rotl_64( x, 8*(n) )
+#else
+#define WP_ROTB_IDX( n ) \
+   ( ( (uint64_t)0x0706050403020100 << ( 8*(n) ) ) \
+   | ( (uint64_t)0x0706050403020100 >> ( 64 - 8*(n) ) ) )
+#define WP_ROTB( x, n ) \
+   _mm256_shuffle_epi8( x, _mm256_set_epi64x( \
+                             WP_ROTB_IDX( n ) + 0x0808080808080808, \
+                             WP_ROTB_IDX( n ), \
+                             WP_ROTB_IDX( n ) + 0x0808080808080808, \
+                             WP_ROTB_IDX( n ) ) )
+#endif
+
+// s = MixRows( ShiftColumns( SubBytes( s ) ) ) ^ k
+static inline void wp_round( __m256i *s, const __m256i *k )
+{
+   __m256i t[8];
+
+   t[0] = wp_sbox( s[0] );
+   t[1] = WP_ROTB( wp_sbox( s[1] ), 1 );
+   t[2] = WP_ROTB( wp_sbox( s[2] ), 2 );
+   t[3] = WP_ROTB( wp_sbox( s[3] ), 3 );
+   t[4] = WP_ROTB( wp_sbox( s[4] ), 4 );
+   t[5] = WP_ROTB( wp_sbox( s[5] ), 5 );
+   t[6] = WP_ROTB( wp_sbox( s[6] ), 6 );
+   t[7] = WP_ROTB( wp_sbox( s[7] ), 7 );
+
+   // column j gets t[j-4]^t[j-7] times 8, t[j-2]^t[j-5] times 4, t[j-6]
+   // times 2 and the rest once, multiplied Horner style
+   for ( int j = 0; j < 8; j++ )
+   {
+      __m256i x = wp_mul2( _mm256_xor_si256( t[ (j+4) & 7 ],
+                                             t[ (j+1) & 7 ] ) );
+      x = wp_mul2( _mm256_xor_si256( x,
+                 _mm256_xor_si256( t[ (j+6) & 7 ], t[ (j+3) & 7 ] ) ) );
+      x = wp_mul2( _mm256_xor_si256( x, t[ (j+2) & 7 ] ) );
+      x = _mm256_xor_si256( _mm256_xor_si256( x, k[j] ),
+                            _mm256_xor_si256( t[j], t[ (j+7) & 7 ] ) );
+      s[j] = _mm256_xor_si256( x, _mm256_xor_si256( t[ (j+5) & 7 ],
+                        _mm256_xor_si256( t[ (j+3) & 7 ], t[ (j+1) & 7 ] ) ) );
+   }
+}
+
+// Compress block m into h, both by column. The first block starts from
+// the zero chaining value, whose key schedule is whirlpool_K0.
+static void wp_compress( __m256i *h, const __m256i *m, bool first )
+{
+   __m256i s[8], k[8];
+
+   if ( first )
+   {
+      for ( int j = 0; j < 8; j++ )
+         s[j] = m[j];
+      for ( int r = 0; r < 10; r++ )
+      {
+         for ( int j = 0; j < 8; j++ )
+            k[j] = _mm256_set1_epi64x( whirlpool_K0[r][j] );
+         wp_round( s, k );
+      }
+      for ( int j = 0; j < 8; j++ )
+         h[j] = _mm256_xor_si256( s[j], m[j] );
+      return;
+   }
+
+   for ( int j = 0; j < 8; j++ )
+   {
+      k[j] = h[j];
+      s[j] = _mm256_xor_si256( m[j], h[j] );
+   }
+   for ( int r = 0; r < 10; r++ )
+   {
+      __m256i c[8];
+      // the round constant is row 0
+      for ( int j = 0; j < 8; j++ )
+         c[j] = _mm256_set1_epi64x( ( whirlpool_RC[r] >> ( 8*j ) ) & 0xFF );
+      wp_round( k, c );
+      wp_round( s, k );
+   }
+   for ( int j = 0; j < 8; j++ )
+      h[j] = _mm256_xor_si256( h[j], _mm256_xor_si256( s[j], m[j] ) );
+}
+
+#define WP_SWAP( a, b, n, mask ) \
+do { \
+   const __m256i t_ = _mm256_and_si256( \
+                   _mm256_xor_si256( _mm256_srli_epi64( a, n ), b ), mask ); \
+   b = _mm256_xor_si256( b, t_ ); \
+   a = _mm256_xor_si256( a, _mm256_slli_epi64( t_, n ) ); \
+} while (0)
+
+// Transpose the 8x8 byte matrix held by x[0..7] in each 64 bit element,
+// rows to columns and back.
+static inline void wp_transpose( __m256i *x )
+{
+   const __m256i m8  = _mm256_set1_epi64x( 0x00FF00FF00FF00FF );
+   const __m256i m16 = _mm256_set1_epi64x( 0x0000FFFF0000FFFF );
+   const __m256i m32 = _mm256_set1_epi64x( 0x00000000FFFFFFFF );
+
+   WP_SWAP( x[0], x[1],  8, m8  );
+   WP_SWAP( x[2], x[3],  8, m8  );
+   WP_SWAP( x[4], x[5],  8, m8  );
+   WP_SWAP( x[6], x[7],  8, m8  );
+   WP_SWAP( x[0], x[2], 16, m16 );
+   WP_SWAP( x[1], x[3], 16, m16 );
+   WP_SWAP( x[4], x[6], 16, m16 );
+   WP_SWAP( x[5], x[7], 16, m16 );
+   WP_SWAP( x[0], x[4], 32, m32 );
+   WP_SWAP( x[1], x[5], 32, m32 );
+   WP_SWAP( x[2], x[6], 32, m32 );
+   WP_SWAP( x[3], x[7], 32, m32 );
+}
+
+#else
+
+#include "sph_whirlpool.h"
+
+#endif
+
+void whirlpool_x4( void * const hash[4], int len )
+{
+#if defined(__AVX2__)
+   uint64_t buf[4][24] __attribute__ ((aligned (64)));
+   uint64_t out[8][4] __attribute__ ((aligned (32)));
+   const int nblk = ( len + 33 + 63 ) / 64;
+   __m256i h[8], m[8];
+
+   // a 1 bit, zeros and the 256 bit length big endian end the last block
+   for ( int l = 0; l < 4; l++ )
+   {
+      unsigned char *b = (unsigned char*)buf[l];
+      memcpy( b, hash[l], len );
+      b[len] = 0x80;
+      memset( b + len + 1, 0, nblk*64 - len - 1 );
+      buf[l][ nblk*8 - 1 ] = __builtin_bswap64( (uint64_t)len << 3 );
+   }
+
+   for ( int n = 0; n < nblk; n++ )
+   {
+      for ( int i = 0; i < 8; i++ )
+         m[i] = _mm256_set_epi64x( buf[3][ 8*n + i ], buf[2][ 8*n + i ],
+                                   buf[1][ 8*n + i ], buf[0][ 8*n + i ] );
+      wp_transpose( m );
+      wp_compress( h, m, n == 0 );
+   }
+
+   wp_transpose( h );
+   for ( int i = 0; i < 8; i++ )
+      _mm256_store_si256( (__m256i*)out[i], h[i] );
+   for ( int l = 0; l < 4; l++ )
+      for ( int i = 0; i < 8; i++ )
+         ( (uint64_t*)hash[l] )[i] = out[i][l];
+#else
+   for ( int i = 0; i < 4; i++ )
+   {
+      sph_whirlpool_context ctx;
+      sph_whirlpool_init( &ctx );
+      sph_whirlpool( &ctx, hash[i], len );
+      sph_whirlpool_close( &ctx, hash[i] );
+   }
+#endif
+}
@@ -0,0 +1,15 @@
+#ifndef WHIRLPOOL_HASH_4WAY_H__
+#define WHIRLPOOL_HASH_4WAY_H__
+
+// Whirlpool of 4 independent short messages. With AVX2 the state is held by
+// column, one message per 64 bit element of a ymm register, so the S box is
+// computed with byte shuffles of its 4 bit mini boxes instead of the 8 KB
+// of lookup tables sph_whirlpool walks one byte at a time. Without AVX2 the
+// messages go through sph_whirlpool one at a time.
+//
+// hash[i] holds len bytes of message i on entry and its 64 byte digest on
+// return, len is up to 128.
+
+void whirlpool_x4( void * const hash[4], int len );
+
+#endif
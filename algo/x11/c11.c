@@ -15,6 +15,7 @@
 //#include "algo/luffa/sph_luffa.h"
 //#include "algo/cubehash/sph_cubehash.h"
 #include "algo/shavite/sph_shavite.h"
+#include "algo/shavite/shavite-hash-4way.h"
 //#include "algo/simd/sph_simd.h"
 //#include "algo/echo/sph_echo.h"
 
@@ -36,52 +37,23 @@
 #include "algo/jh/sse2/jh_sse2_opt64.h"
 
 
-typedef struct {
-    sph_shavite512_context  shavite;
-//    sph_groestl512_context  groestl;
-        sph_skein512_context     skein;
-//        sph_jh512_context        jh;
-//        sph_keccak512_context    keccak;
 #ifdef NO_AES_NI
+// One stage runs at a time, the sph contexts share the space and each is
+// initialized right before use rather than copied from a global.
+typedef union {
     sph_groestl512_context  groestl;
     sph_echo512_context     echo;
-#else
-     hashState_echo          echo;
-     hashState_groestl       groestl;
-#endif
-     hashState_luffa         luffa;
-     cubehashParam           cube;
-     hashState_sd            simd;
-} c11_ctx_holder;
-
-c11_ctx_holder c11_ctx;
-
-void init_c11_ctx()
-{
-     init_luffa( &c11_ctx.luffa, 512 );
-     cubehashInit( &c11_ctx.cube, 512, 16, 32 );
-     sph_shavite512_init( &c11_ctx.shavite );
-     init_sd( &c11_ctx.simd, 512 );
-//        sph_jh512_init(&c11_ctx.jh);
-//        sph_keccak512_init(&c11_ctx.keccak);
-//        sph_skein512_init(&c11_ctx.skein);
-//     sph_groestl512_init( &c11_ctx.groestl );
-#ifdef NO_AES_NI
-     sph_groestl512_init( &c11_ctx.groestl );
-     sph_echo512_init( &c11_ctx.echo );
-#else
-     init_echo( &c11_ctx.echo, 512 );
-     init_groestl( &c11_ctx.groestl );
+} c11_ctx_overlay;
 #endif
-}
 
 void c11hash(void *output, const void *input)
 {
         unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
 //	uint32_t _ALIGN(64) hash[16];
 
-     c11_ctx_holder ctx;
-     memcpy( &ctx, &c11_ctx, sizeof(c11_ctx) );
+#ifdef NO_AES_NI
+     c11_ctx_overlay ctx;
+#endif
 
      size_t hashptr;
      unsigned char hashbuf[128];
@@ -110,11 +82,11 @@ void c11hash(void *output, const void *input)
 //           GRS_U;
 //           GRS_C;
 //
+     sph_groestl512_init(&ctx.groestl);
      sph_groestl512 (&ctx.groestl, hash, 64);
      sph_groestl512_close(&ctx.groestl, hash);
 #else
-       update_groestl( &ctx.groestl, (char*)hash,512);
-       final_groestl( &ctx.groestl, (char*)hash);
+       groestl512_64( hash, hash );
 #endif
 
      DECL_JH;
@@ -139,24 +111,20 @@ void c11hash(void *output, const void *input)
         sph_skein512 (&ctx.skein, hash, 64);
         sph_skein512_close (&ctx.skein, hash);
 */
-     update_luffa( &ctx.luffa, (const BitSequence*)hash,512);
-     final_luffa( &ctx.luffa, (BitSequence*)hash+64);
+     luffa512_64( hash+64, hash );
 
-     cubehashUpdate( &ctx.cube, (const byte*) hash+64,64);
-     cubehashDigest( &ctx.cube, (byte*)hash);
+     cubehash512_64( hash, hash+64 );
 
-     sph_shavite512( &ctx.shavite, hash, 64);
-     sph_shavite512_close( &ctx.shavite, hash+64);
+     shavite512_64( hash+64, hash );
 
-     update_sd( &ctx.simd, (const BitSequence *)hash+64,512);
-     final_sd( &ctx.simd, (BitSequence *)hash);
+     simd512_64( hash, hash+64 );
 
 #ifdef NO_AES_NI
+     sph_echo512_init(&ctx.echo);
      sph_echo512 (&ctx.echo, hash, 64);
      sph_echo512_close(&ctx.echo, hash+64);
 #else
-     update_echo ( &ctx.echo, (const BitSequence *) hash, 512);
-     final_echo( &ctx.echo, (BitSequence *) hash+64 );
+     echo512_64( hash+64, hash );
 #endif
 
 
@@ -252,7 +220,6 @@ bool register_c11_algo( algo_gate_t* gate )
   gate->scanhash = (void*)&scanhash_c11;
   gate->hash     = (void*)&c11hash;
   gate->hash_alt = (void*)&c11hash;
-  gate->init_ctx = (void*)&init_c11_ctx;
   gate->get_max64 = (void*)&get_max64_0x3ffff;
   return true;
 };
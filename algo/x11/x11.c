@@ -33,6 +33,19 @@
 #include "algo/bmw/sse2/bmw.c"
 #include "algo/skein/sse2/skein.c"
 #include "algo/jh/sse2/jh_sse2_opt64.h"
+#include "algo/shavite/shavite-hash-4way.h"
+#include "algo/simd/simd-hash-4way.h"
+#include "algo/bmw/bmw-hash-4way.h"
+#include "algo/skein/skein-hash-4way.h"
+#include "algo/jh/jh-hash-4way.h"
+#include "algo/keccak/keccak-hash-4way.h"
+#include "algo/luffa/luffa-hash-2way.h"
+#include "algo/cubehash/cube-hash-2way.h"
+
+#ifndef NO_AES_NI
+  #include "algo/groestl/groestl-hash-4way.h"
+  #include "algo/echo/echo-hash-4way.h"
+#endif
 
 /*define data alignment for different C compilers*/
 #if defined(__GNUC__)
@@ -42,62 +55,32 @@
 #endif
 
 
-typedef struct {
-    sph_shavite512_context  shavite;
-#ifdef NO_AES_NI
-    sph_groestl512_context  groestl;
-    sph_echo512_context     echo;
-#else
-     hashState_echo          echo;
-     hashState_groestl       groestl;
-#endif
-     hashState_luffa         luffa;
-     cubehashParam           cube;
-     hashState_sd            simd;
-} x11_ctx_holder;
-
-x11_ctx_holder x11_ctx;
+// The chain is split so x11_hash_4way can run every stage but Blake on 4
+// lanes at once. Without AVX2 only Groestl and the stages after Cubehash do.
+// Each part reads and writes the 64 bytes at hash, hash+64 is scratch.
 
-void init_x11_ctx()
+// blake of the 80 byte header
+static inline void x11_blake( unsigned char *hash, const void *input )
 {
-     init_luffa( &x11_ctx.luffa, 512 );
-     cubehashInit( &x11_ctx.cube, 512, 16, 32 );
-     sph_shavite512_init( &x11_ctx.shavite );
-     init_sd( &x11_ctx.simd, 512 );
-#ifdef NO_AES_NI
-     sph_groestl512_init( &x11_ctx.groestl );
-     sph_echo512_init( &x11_ctx.echo );
-#else
-     init_echo( &x11_ctx.echo, 512 );
-     init_groestl( &x11_ctx.groestl );
-#endif
-}
-
-static void x11_hash( void *state, const void *input )
-{
-#ifdef NO_AES_NI
-     grsoState sts_grs;
-#endif
-     x11_ctx_holder ctx;
-     memcpy( &ctx, &x11_ctx, sizeof(x11_ctx) );
-
-//        DATA_ALIGNXY(unsigned char hashbuf[128],16);
-     size_t hashptr;
-//        DATA_ALIGNXY(sph_u64 hashctA,8);
-//        DATA_ALIGNXY(sph_u64 hashctB,8);
-
-//        DATA_ALIGNXY(unsigned char hash[128],16);
      unsigned char hashbuf[128];
+     size_t hashptr;
      sph_u64 hashctA;
      sph_u64 hashctB;
 
-     unsigned char hash[128];
-//     unsigned char hash[128] __attribute__ ((aligned (16)));
-
      DECL_BLK;
      BLK_I;
      BLK_W;
      BLK_C;
+}
+
+// blake and bmw of the 80 byte header
+static inline void x11_front( unsigned char *hash, const void *input )
+{
+     unsigned char hashbuf[128];
+     size_t hashptr;
+     sph_u64 hashctA;
+
+     x11_blake( hash, input );
 
      //---bmw2---
 
@@ -111,20 +94,25 @@ static void x11_hash( void *state, const void *input )
      #undef M
      #undef H
      #undef dH
+}
 
-     //---grs3----
+// luffa and cubehash
+static inline void x11_luffa_cube( unsigned char *hash )
+{
+     //--- luffa7
+     luffa512_64( hash+64, hash );
 
-#ifdef NO_AES_NI
-           GRS_I;
-           GRS_U;
-           GRS_C;
+     //---cubehash---
 
-//     sph_groestl512 (&ctx.groestl, hash, 64);
-//     sph_groestl512_close(&ctx.groestl, hash);
-#else
-     update_groestl( &ctx.groestl, (char*)hash,512);
-     final_groestl( &ctx.groestl, (char*)hash);
-#endif
+     cubehash512_64( hash, hash+64 );
+}
+
+// skein through cubehash
+static inline void x11_mid( unsigned char *hash )
+{
+     unsigned char hashbuf[128];
+     size_t hashptr;
+     sph_u64 hashctA;
 
      //---skein4---
 
@@ -145,42 +133,89 @@ static void x11_hash( void *state, const void *input )
      KEC_U;
      KEC_C;
 
-//   asm volatile ("emms");
+     x11_luffa_cube( hash );
+}
 
-     //--- luffa7
+static void x11_hash( void *state, const void *input )
+{
+#ifdef NO_AES_NI
+     grsoState sts_grs;
+     sph_echo512_context ctx_echo;
+#endif
+     unsigned char hash[128];
 
-     update_luffa( &ctx.luffa, (const BitSequence*)hash,512);
-     final_luffa( &ctx.luffa, (BitSequence*)hash+64);
+     x11_front( hash, input );
 
-     //---cubehash---
+     //---grs3----
+
+#ifdef NO_AES_NI
+     {
+        unsigned char hashbuf[128];
+        GRS_I;
+        GRS_U;
+        GRS_C;
+     }
+#else
+     groestl512_64( hash, hash );
+#endif
 
-     cubehashUpdate( &ctx.cube, (const byte*) hash+64,64);
-     cubehashDigest( &ctx.cube, (byte*)hash);
+     x11_mid( hash );
 
      //---shavite---
-  
-     sph_shavite512( &ctx.shavite, hash, 64);
-     sph_shavite512_close( &ctx.shavite, hash+64);
+
+     shavite512_64( hash, hash );
 
      //-------simd512 vect128 --------------
 
-     update_sd( &ctx.simd, (const BitSequence *)hash+64,512);
-     final_sd( &ctx.simd, (BitSequence *)hash);
+     simd512_64( hash, hash );
 
      //---echo---
 
 #ifdef NO_AES_NI
-     sph_echo512 (&ctx.echo, hash, 64);
-     sph_echo512_close(&ctx.echo, hash+64);
+     sph_echo512_init(&ctx_echo);
+     sph_echo512 (&ctx_echo, hash, 64);
+     sph_echo512_close(&ctx_echo, hash+64);
 #else
-     update_echo ( &ctx.echo, (const BitSequence *) hash, 512);
-     final_echo( &ctx.echo, (BitSequence *) hash+64 );
+     echo512_64( hash+64, hash );
 #endif
 
 //        asm volatile ("emms");
 	memcpy(state, hash+64, 32);
 }
 
+#ifndef NO_AES_NI
+
+// input is 4 consecutive 80 byte headers, output 4 consecutive hashes.
+static void x11_hash_4way( void *state, const void *input )
+{
+     unsigned char hash[4][128] __attribute__ ((aligned (64)));
+     void * const lanes[4] = { hash[0], hash[1], hash[2], hash[3] };
+
+#if defined(__AVX2__)
+     for ( int i = 0; i < 4; i++ )
+        x11_blake( hash[i], (const unsigned char*)input + 80*i );
+     bmw512_x4( lanes, 64 );
+     groestl512_x4( lanes, 64 );
+     skein512_x4( lanes, 64 );
+     jh512_x4( lanes, 64 );
+     keccak512_x4( lanes, 64 );
+     luffa512_x4( lanes, 64 );
+     cube512_x4( lanes, 64 );
+#else
+     for ( int i = 0; i < 4; i++ )
+        x11_front( hash[i], (const unsigned char*)input + 80*i );
+     groestl512_x4( lanes, 64 );
+     for ( int i = 0; i < 4; i++ )
+        x11_mid( hash[i] );
+#endif
+     shavite512_x4( lanes, 64 );
+     simd512_x4( lanes, 64 );
+     echo512_x4( lanes, 64 );
+     for ( int i = 0; i < 4; i++ )
+        memcpy( (unsigned char*)state + 32*i, hash[i], 32 );
+}
+
+#endif
 
 static void x11hash_alt( void *output, const void *input )
 {
@@ -299,6 +334,33 @@ int scanhash_x11(int thr_id, struct work *work,
 //		be32enc( &endiandata[kk], ((uint32_t*)pdata)[kk] );
 //	};
 
+#ifndef NO_AES_NI
+        // With AVX2 every stage but Blake takes 4 nonces at a time. The odd
+        // nonces at the end go through the single lane loops below.
+        {
+           uint32_t data4[4][20] __attribute__((aligned(64)));
+           uint32_t hash4[4][8] __attribute__((aligned(64)));
+
+           for ( int i = 0; i < 4; i++ )
+              memcpy( data4[i], endiandata, 80 );
+           while ( n + 1 < max_nonce && max_nonce - n > 4
+                   && !work_restart[thr_id].restart )
+           {
+              for ( int i = 0; i < 4; i++ )
+                 be32enc( &data4[i][19], n + 1 + i );
+              x11_hash_4way( hash4, data4 );
+              for ( int i = 0; i < 4; i++ )
+              if ( hash4[i][7] <= Htarg && fulltest( hash4[i], ptarget ) )
+              {
+                 pdata[19] = n + 1 + i;
+                 *hashes_done = pdata[19] - first_nonce + 1;
+                 return true;
+              }
+              n += 4;
+           }
+        }
+#endif
+
         if ( ptarget[7] == 0 )
         {
           do
@@ -436,7 +498,6 @@ int64_t get_x11_max64 ()
 bool register_x11_algo( algo_gate_t* gate )
 {
   gate->aes_ni_optimized = (void*)&return_true;
-  gate->init_ctx  = (void*)&init_x11_ctx;
   gate->scanhash  = (void*)&scanhash_x11;
   gate->hash      = (void*)&x11_hash;
 //  gate->get_max64 = (void*)&get_x11_max64;
@@ -8,6 +8,7 @@
 
 #include "algo/gost/sph_gost.h"
 #include "algo/shavite/sph_shavite.h"
+#include "algo/shavite/shavite-hash-4way.h"
 #include "algo/echo/sph_echo.h"
 
 #include "algo/luffa/sse2/luffa_for_sse2.h"
@@ -27,37 +28,14 @@
   #include "algo/echo/aes_ni/hash_api.h"
 #endif
 
-typedef struct {
+// One stage runs at a time, the sph contexts share the space and each is
+// initialized right before use rather than copied from a global.
+typedef union {
      sph_gost512_context     gost;
-     sph_shavite512_context  shavite;
-     hashState_luffa         luffa;
-     cubehashParam           cube;
-     hashState_sd            simd;
 #ifdef NO_AES_NI
      sph_echo512_context     echo;
-#else
-     hashState_echo          echo;
-     hashState_groestl       groestl;
 #endif
-} sib_ctx_holder;
-
-sib_ctx_holder sib_ctx;
-
-void init_sib_ctx()
-{
-     sph_gost512_init(&sib_ctx.gost);
-     sph_shavite512_init(&sib_ctx.shavite);
-     init_luffa( &sib_ctx.luffa, 512 );
-     cubehashInit( &sib_ctx.cube, 512, 16, 32 );
-     init_sd( &sib_ctx.simd, 512 );
-#ifdef NO_AES_NI
-     sph_echo512_init( &sib_ctx.echo );
-#else
-     init_echo( &sib_ctx.echo, 512 );
-     init_groestl( &sib_ctx.groestl );
-#endif
-
-}
+} sib_ctx_overlay;
 
 
 void sibhash(void *output, const void *input)
@@ -75,8 +53,7 @@ void sibhash(void *output, const void *input)
      sph_u64 hashctA;
      sph_u64 hashctB;
 
-     sib_ctx_holder ctx;
-     memcpy( &ctx, &sib_ctx, sizeof(sib_ctx) );
+     sib_ctx_overlay ctx;
 
      DECL_BLK;
      BLK_I;
@@ -99,8 +76,7 @@ void sibhash(void *output, const void *input)
           GRS_U;
           GRS_C;
      #else
-          update_groestl( &ctx.groestl, (char*)hash,512);
-          final_groestl( &ctx.groestl, (char*)hash);
+          groestl512_64( hash, hash );
      #endif
 
      DECL_SKN;
@@ -116,27 +92,24 @@ void sibhash(void *output, const void *input)
      KEC_U;
      KEC_C;
 
+     sph_gost512_init(&ctx.gost);
      sph_gost512(&ctx.gost, hashA, 64);
      sph_gost512_close(&ctx.gost, hashB);
 
-     update_luffa( &ctx.luffa, (const BitSequence*)hashB,512);
-     final_luffa( &ctx.luffa, (BitSequence*)hashA);
+     luffa512_64( hashA, hashB );
 
-     cubehashUpdate( &ctx.cube, (const byte*) hashA,64);
-     cubehashDigest( &ctx.cube, (byte*)hashB);
+     cubehash512_64( hashB, hashA );
 
-     sph_shavite512(&ctx.shavite, hashB, 64);
-     sph_shavite512_close(&ctx.shavite, hashA);
+     shavite512_64( hashA, hashB );
 
-     update_sd( &ctx.simd, (const BitSequence *)hashA,512);
-     final_sd( &ctx.simd, (BitSequence *)hashB);
+     simd512_64( hashB, hashA );
 
 #ifdef NO_AES_NI
+	sph_echo512_init(&ctx.echo);
 	sph_echo512(&ctx.echo, hashB, 64);
 	sph_echo512_close(&ctx.echo, hashA);
 #else
-     update_echo ( &ctx.echo, (const BitSequence *) hashB, 512);
-     final_echo( &ctx.echo, (BitSequence *) hashA );
+     echo512_64( hashA, hashB );
 #endif
 
      memcpy(output, hashA, 32);
@@ -185,6 +158,5 @@ bool register_sib_algo( algo_gate_t* gate )
     gate->scanhash = (void*)&scanhash_sib;
     gate->hash     = (void*)&sibhash;
     gate->hash_alt = (void*)&sibhash;
-    gate->init_ctx = (void*)&init_sib_ctx;
     gate->get_max64 = (void*)&get_max64_0x3ffff;
 }
@@ -28,6 +28,21 @@
 #include "algo/keccak/sse2/keccak.c"
 #include "algo/skein/sse2/skein.c"
 #include "algo/jh/sse2/jh_sse2_opt64.h"
+#include "algo/shavite/shavite-hash-4way.h"
+#include "algo/fugue/fugue-hash-4way.h"
+#include "algo/simd/simd-hash-4way.h"
+#include "algo/bmw/bmw-hash-4way.h"
+#include "algo/skein/skein-hash-4way.h"
+#include "algo/jh/jh-hash-4way.h"
+#include "algo/keccak/keccak-hash-4way.h"
+#include "algo/luffa/luffa-hash-2way.h"
+#include "algo/cubehash/cube-hash-2way.h"
+#include "algo/hamsi/hamsi-hash-4way.h"
+
+#ifndef NO_AES_NI
+  #include "algo/groestl/groestl-hash-4way.h"
+  #include "algo/echo/echo-hash-4way.h"
+#endif
 
 #ifdef NO_AES_NI
   #include "algo/groestl/sse2/grso.h"
@@ -37,65 +52,44 @@
   #include "algo/echo/aes_ni/hash_api.h"
 #endif
 
-typedef struct {
+// One stage runs at a time, the sph contexts share the space and each is
+// initialized right before use rather than copied from a global.
+typedef union {
 #ifdef NO_AES_NI
         sph_groestl512_context   groestl;
         sph_echo512_context      echo;
-#else
-        hashState_groestl       groestl;
-        hashState_echo          echo;
 #endif
-        hashState_luffa         luffa;
-        cubehashParam           cubehash;
-        sph_shavite512_context  shavite;
-        hashState_sd            simd;
         sph_hamsi512_context    hamsi;
-        sph_fugue512_context    fugue;
-} x13_ctx_holder;
+} x13_ctx_overlay;
 
-x13_ctx_holder x13_ctx;
+#define hashB hash+64
 
-void init_x13_ctx()
-{
-#ifdef NO_AES_NI
-        sph_groestl512_init(&x13_ctx.groestl);
-        sph_echo512_init(&x13_ctx.echo);
-#else
-        init_echo( &x13_ctx.echo, 512 );
-        init_groestl (&x13_ctx.groestl );
-#endif
-        init_luffa( &x13_ctx.luffa, 512 );
-        cubehashInit( &x13_ctx.cubehash, 512, 16, 32 );
-        sph_shavite512_init( &x13_ctx.shavite );
-        init_sd( &x13_ctx.simd, 512 );
-        sph_hamsi512_init( &x13_ctx.hamsi );
-        sph_fugue512_init( &x13_ctx.fugue );
-};
+// The chain is split so x13hash_4way can run every stage but Blake on 4
+// lanes at once. Without AVX2 only Groestl and the stages after Cubehash do.
+// Each part reads and writes the 64 bytes at hash, hash+64 is scratch.
 
-static void x13hash(void *output, const void *input)
+// blake of the 80 byte header
+static inline void x13hash_blake( unsigned char *hash, const void *input )
 {
-	unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
-	#define hashB hash+64
-      
-        x13_ctx_holder ctx;
-        memcpy( &ctx, &x13_ctx, sizeof(x13_ctx) );
-#ifdef NO_AES_NI
-        grsoState sts_grs;
-#endif
-
-        // X11 algos
-
         unsigned char hashbuf[128];
         size_t hashptr;
         sph_u64 hashctA;
         sph_u64 hashctB;
 
-        //---blake1---
-
         DECL_BLK;
         BLK_I;
         BLK_W;
         BLK_C;
+}
+
+// blake and bmw of the 80 byte header
+static inline void x13hash_front( unsigned char *hash, const void *input )
+{
+        unsigned char hashbuf[128];
+        size_t hashptr;
+        sph_u64 hashctA;
+
+        x13hash_blake( hash, input );
 
         //---bmw2---
 
@@ -112,20 +106,24 @@ static void x13hash(void *output, const void *input)
         #undef M
         #undef H
         #undef dH
-        
-        //---groetl----
+}
 
-#ifdef NO_AES_NI
-// use GRS if possible
-          GRS_I;
-          GRS_U;
-          GRS_C;
-//        sph_groestl512 (&ctx.groestl, hash, 64);
-//        sph_groestl512_close(&ctx.groestl, hash);
-#else
-        update_groestl( &ctx.groestl, (char*)hash,512);
-        final_groestl( &ctx.groestl, (char*)hash);
-#endif
+// luffa and cubehash
+static inline void x13hash_luffa_cube( unsigned char *hash )
+{
+        //--- luffa7
+        luffa512_64( hashB, hash );
+
+        // 8 Cube
+        cubehash512_64( hash, hashB );
+}
+
+// skein through cubehash
+static inline void x13hash_mid( unsigned char *hash )
+{
+        unsigned char hashbuf[128];
+        size_t hashptr;
+        sph_u64 hashctA;
 
         //---skein4---
 
@@ -146,45 +144,113 @@ static void x13hash(void *output, const void *input)
         KEC_U;
         KEC_C;
 
-        //--- luffa7
-        update_luffa( &ctx.luffa, (const BitSequence*)hash,512);
-        final_luffa( &ctx.luffa, (BitSequence*)hashB);
+        x13hash_luffa_cube( hash );
+}
 
-        // 8 Cube
-        cubehashUpdate( &ctx.cubehash, (const byte*) hashB,64);
-        cubehashDigest( &ctx.cubehash, (byte*)hash);
+// hamsi, after echo
+static inline void x13hash_back( unsigned char *hash )
+{
+        x13_ctx_overlay ctx;
+
+        // X13 algos
+        // 12 Hamsi
+	sph_hamsi512_init(&ctx.hamsi);
+	sph_hamsi512(&ctx.hamsi, hash, 64);
+	sph_hamsi512_close(&ctx.hamsi, hash);
+}
+
+static void x13hash(void *output, const void *input)
+{
+	unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
+
+#ifdef NO_AES_NI
+        x13_ctx_overlay ctx;
+        grsoState sts_grs;
+#endif
+
+        x13hash_front( hash, input );
+
+        //---groestl----
+
+#ifdef NO_AES_NI
+        {
+           unsigned char hashbuf[128];
+// use GRS if possible
+          GRS_I;
+          GRS_U;
+          GRS_C;
+//        sph_groestl512 (&ctx.groestl, hash, 64);
+//        sph_groestl512_close(&ctx.groestl, hash);
+        }
+#else
+        groestl512_64( hash, hash );
+#endif
+
+        x13hash_mid( hash );
 
         // 9 Shavite
-        sph_shavite512( &ctx.shavite, hash, 64);
-        sph_shavite512_close( &ctx.shavite, hashB);
+        shavite512_64( hash, hash );
 
         // 10 Simd
-        update_sd( &ctx.simd, (const BitSequence *)hashB,512);
-        final_sd( &ctx.simd, (BitSequence *)hash);
+        simd512_64( hash, hash );
 
         //11---echo---
 
 #ifdef NO_AES_NI
+        sph_echo512_init(&ctx.echo);
         sph_echo512(&ctx.echo, hash, 64);
-        sph_echo512_close(&ctx.echo, hashB);
+        sph_echo512_close(&ctx.echo, hash);
 #else
-        update_echo ( &ctx.echo, (const BitSequence *) hash, 512);
-        final_echo( &ctx.echo, (BitSequence *) hashB);
+        echo512_64( hash, hash );
 #endif
 
-        // X13 algos
-        // 12 Hamsi
-	sph_hamsi512(&ctx.hamsi, hashB, 64);
-	sph_hamsi512_close(&ctx.hamsi, hash);
+        x13hash_back( hash );
 
         // 13 Fugue
-	sph_fugue512(&ctx.fugue, hash, 64);
-	sph_fugue512_close(&ctx.fugue, hashB);
+        fugue512_64( hash, hash );
 
         asm volatile ("emms");
-	memcpy(output, hashB, 32);
+	memcpy(output, hash, 32);
 }
 
+#ifndef NO_AES_NI
+
+// input is 4 consecutive 80 byte headers, output 4 consecutive hashes.
+static void x13hash_4way( void *output, const void *input )
+{
+        unsigned char hash[4][128] __attribute__ ((aligned (64)));
+        void * const lanes[4] = { hash[0], hash[1], hash[2], hash[3] };
+
+#if defined(__AVX2__)
+        for ( int i = 0; i < 4; i++ )
+           x13hash_blake( hash[i], (const unsigned char*)input + 80*i );
+        bmw512_x4( lanes, 64 );
+        groestl512_x4( lanes, 64 );
+        skein512_x4( lanes, 64 );
+        jh512_x4( lanes, 64 );
+        keccak512_x4( lanes, 64 );
+        luffa512_x4( lanes, 64 );
+        cube512_x4( lanes, 64 );
+#else
+        for ( int i = 0; i < 4; i++ )
+           x13hash_front( hash[i], (const unsigned char*)input + 80*i );
+        groestl512_x4( lanes, 64 );
+        for ( int i = 0; i < 4; i++ )
+           x13hash_mid( hash[i] );
+#endif
+        shavite512_x4( lanes, 64 );
+        simd512_x4( lanes, 64 );
+        echo512_x4( lanes, 64 );
+        hamsi512_x4( lanes, 64 );
+        fugue512_x4( lanes, 64 );
+        for ( int i = 0; i < 4; i++ )
+        {
+           memcpy( (unsigned char*)output + 32*i, hash[i], 32 );
+        }
+}
+
+#endif
+
 void x13hash_alt(void *output, const void *input)
 {
         unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
@@ -330,6 +396,33 @@ int scanhash_x13(int thr_id, struct work *work, uint32_t max_nonce,
 //	for (int kk=0; kk < 32; kk++) {
 //		be32enc(&endiandata[kk], ((uint32_t*)pdata)[kk]);
 //	};
+#ifndef NO_AES_NI
+        // With AVX2 every stage but Blake takes 4 nonces at a time. The odd
+        // nonces at the end go through the single lane loop below.
+        {
+           uint32_t data4[4][20] __attribute__((aligned(64)));
+           uint32_t hash4[4][8] __attribute__((aligned(64)));
+
+           for ( int i = 0; i < 4; i++ )
+              memcpy( data4[i], endiandata, 80 );
+           while ( n + 1 < max_nonce && max_nonce - n > 4
+                   && !work_restart[thr_id].restart )
+           {
+              for ( int i = 0; i < 4; i++ )
+                 be32enc( &data4[i][19], n + 1 + i );
+              x13hash_4way( hash4, data4 );
+              for ( int i = 0; i < 4; i++ )
+              if ( hash4[i][7] <= Htarg && fulltest( hash4[i], ptarget ) )
+              {
+                 pdata[19] = n + 1 + i;
+                 *hashes_done = pdata[19] - first_nonce + 1;
+                 return true;
+              }
+              n += 4;
+           }
+        }
+#endif
+
 #ifdef DEBUG_ALGO
 	printf("[%d] Htarg=%X\n", thr_id, Htarg);
 #endif
@@ -379,7 +472,6 @@ int scanhash_x13(int thr_id, struct work *work, uint32_t max_nonce,
 bool register_x13_algo( algo_gate_t* gate )
 {
   gate->aes_ni_optimized = (void*)&return_true;
-  gate->init_ctx = (void*)&init_x13_ctx;
   gate->scanhash = (void*)&scanhash_x13;
   gate->hash     = (void*)&x13hash;
   gate->hash_alt = (void*)&x13hash_alt;
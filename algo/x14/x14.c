@@ -13,12 +13,14 @@
 #include "algo/keccak/sph_keccak.h"
 #include "algo/skein/sph_skein.h"
 #include "algo/shavite/sph_shavite.h"
+#include "algo/shavite/shavite-hash-4way.h"
 #include "algo/luffa/sph_luffa.h"
 #include "algo/cubehash/sph_cubehash.h"
 #include "algo/simd/sph_simd.h"
 #include "algo/echo/sph_echo.h"
 #include "algo/hamsi/sph_hamsi.h"
 #include "algo/fugue/sph_fugue.h"
+#include "algo/fugue/fugue-hash-4way.h"
 #include "algo/shabal/sph_shabal.h"
 
 #include "algo/luffa/sse2/luffa_for_sse2.h"
@@ -30,6 +32,20 @@
 #include "algo/keccak/sse2/keccak.c"
 #include "algo/skein/sse2/skein.c"
 #include "algo/jh/sse2/jh_sse2_opt64.h"
+#include "algo/simd/simd-hash-4way.h"
+#include "algo/bmw/bmw-hash-4way.h"
+#include "algo/skein/skein-hash-4way.h"
+#include "algo/jh/jh-hash-4way.h"
+#include "algo/keccak/keccak-hash-4way.h"
+#include "algo/luffa/luffa-hash-2way.h"
+#include "algo/cubehash/cube-hash-2way.h"
+#include "algo/hamsi/hamsi-hash-4way.h"
+#include "algo/shabal/shabal-hash-4way.h"
+
+#ifndef NO_AES_NI
+  #include "algo/groestl/groestl-hash-4way.h"
+  #include "algo/echo/echo-hash-4way.h"
+#endif
 
 #ifdef NO_AES_NI
   #include "algo/groestl/sse2/grso.h"
@@ -39,50 +55,23 @@
   #include "algo/echo/aes_ni/hash_api.h"
 #endif
 
-typedef struct {
+// One stage runs at a time, the sph contexts share the space and each is
+// initialized right before use rather than copied from a global.
+typedef union {
 #ifdef NO_AES_NI
         sph_groestl512_context  groestl;
         sph_echo512_context     echo;
-#else
-        hashState_echo          echo;
-        hashState_groestl       groestl;
 #endif
-        hashState_luffa         luffa;
-        cubehashParam           cubehash;
-        sph_shavite512_context  shavite;
-        hashState_sd            simd;
         sph_hamsi512_context    hamsi;
-        sph_fugue512_context    fugue;
         sph_shabal512_context   shabal;
-} x14_ctx_holder;
-
-x14_ctx_holder x14_ctx;
-
-void init_x14_ctx()
-{
-#ifdef NO_AES_NI
-        sph_groestl512_init(&x14_ctx.groestl);
-        sph_echo512_init(&x14_ctx.echo);
-#else
-        init_echo(&x14_ctx.echo, 512);
-        init_groestl(&x14_ctx.groestl);
-#endif
-        init_luffa(&x14_ctx.luffa,512);
-        cubehashInit(&x14_ctx.cubehash,512,16,32);
-        sph_shavite512_init(&x14_ctx.shavite);
-        init_sd(&x14_ctx.simd,512);
-        sph_hamsi512_init(&x14_ctx.hamsi);
-        sph_fugue512_init(&x14_ctx.fugue);
-        sph_shabal512_init(&x14_ctx.shabal);
-};
+} x14_ctx_overlay;
 
 static void x14hash(void *output, const void *input)
 {
 	unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
 	#define hashB hash+64
 
-        x14_ctx_holder ctx;
-        memcpy(&ctx, &x14_ctx, sizeof(x14_ctx));
+        x14_ctx_overlay ctx;
 
 #ifdef NO_AES_NI
       grsoState sts_grs;
@@ -126,8 +115,7 @@ static void x14hash(void *output, const void *input)
 //        sph_groestl512 (&ctx.groestl, hash, 64);
 //        sph_groestl512_close(&ctx.groestl, hash);
 #else
-        update_groestl( &ctx.groestl, (char*)hash,512);
-        final_groestl( &ctx.groestl, (char*)hash);
+        groestl512_64( hash, hash );
 #endif
 
         //---skein4---
@@ -150,42 +138,39 @@ static void x14hash(void *output, const void *input)
         KEC_C;
 
         //--- luffa7
-        update_luffa( &ctx.luffa, (const BitSequence*)hash,512);
-        final_luffa( &ctx.luffa, (BitSequence*)hashB);
+        luffa512_64( hashB, hash );
 
         // 8 Cube
-        cubehashUpdate( &ctx.cubehash, (const byte*) hashB,64);
-        cubehashDigest( &ctx.cubehash, (byte*)hash);
+        cubehash512_64( hash, hashB );
 
         // 9 Shavite
-        sph_shavite512( &ctx.shavite, hash, 64);
-        sph_shavite512_close( &ctx.shavite, hashB);
+        shavite512_64( hashB, hash );
 
         // 10 Simd
-        update_sd( &ctx.simd, (const BitSequence *)hashB,512);
-        final_sd( &ctx.simd, (BitSequence *)hash);
+        simd512_64( hash, hashB );
 
         //11---echo---
 
 #ifdef NO_AES_NI
+        sph_echo512_init(&ctx.echo);
         sph_echo512(&ctx.echo, hash, 64);
         sph_echo512_close(&ctx.echo, hashB);
 #else
-        update_echo ( &ctx.echo, (const BitSequence *) hash, 512);
-        final_echo( &ctx.echo, (BitSequence *) hashB);
+        echo512_64( hashB, hash );
 #endif
 
         // X13 algos
 
         // 12 Hamsi
+        sph_hamsi512_init(&ctx.hamsi);
         sph_hamsi512(&ctx.hamsi, hashB, 64);
         sph_hamsi512_close(&ctx.hamsi, hash);
 
         // 13 Fugue
-        sph_fugue512(&ctx.fugue, hash, 64);
-        sph_fugue512_close(&ctx.fugue, hashB);
+        fugue512_64( hashB, hash );
 
         // X14 Shabal
+	sph_shabal512_init(&ctx.shabal);
 	sph_shabal512(&ctx.shabal, hashB, 64);
 	sph_shabal512_close(&ctx.shabal, hash);
 
@@ -194,6 +179,56 @@ static void x14hash(void *output, const void *input)
 	memcpy(output, hash, 32);
 }
 
+#if !defined(NO_AES_NI) && defined(__AVX2__)
+
+// blake of the 80 byte header
+static inline void x14hash_blake( unsigned char *hash, const void *input )
+{
+        unsigned char hashbuf[128];
+        size_t hashptr;
+        sph_u64 hashctA;
+        sph_u64 hashctB;
+
+        DECL_BLK;
+        BLK_I;
+        BLK_W;
+        BLK_C;
+}
+
+// input is 4 consecutive 80 byte headers, output 4 consecutive hashes.
+// Every stage but Blake runs on the 4 lanes at once. Without AVX2 most of
+// the 4 lane kernels would fall back to sph, x14hash is faster then. The
+// last stage tests the lanes against target, only the lanes in the returned
+// mask are written to output.
+static int x14hash_4way( void *output, const void *input,
+                        const uint32_t *target )
+{
+        unsigned char hash[4][128] __attribute__ ((aligned (64)));
+        void * const lanes[4] = { hash[0], hash[1], hash[2], hash[3] };
+
+        for ( int i = 0; i < 4; i++ )
+           x14hash_blake( hash[i], (const unsigned char*)input + 80*i );
+        bmw512_x4( lanes, 64 );
+        groestl512_x4( lanes, 64 );
+        skein512_x4( lanes, 64 );
+        jh512_x4( lanes, 64 );
+        keccak512_x4( lanes, 64 );
+        luffa512_x4( lanes, 64 );
+        cube512_x4( lanes, 64 );
+        shavite512_x4( lanes, 64 );
+        simd512_x4( lanes, 64 );
+        echo512_x4( lanes, 64 );
+        hamsi512_x4( lanes, 64 );
+        fugue512_x4( lanes, 64 );
+        const int mask = shabal512_x4_target( lanes, 64, target );
+        for ( int i = 0; i < 4; i++ )
+        if ( mask & ( 1 << i ) )
+           memcpy( (unsigned char*)output + 32*i, hash[i], 32 );
+        return mask;
+}
+
+#endif
+
 void x14hash_alt(void *output, const void *input)
 {
         unsigned char hash[128]; // uint32_t hashA[16], hashB[16];
@@ -344,6 +379,33 @@ int scanhash_x14(int thr_id, struct work *work,
 //	for (int kk=0; kk < 32; kk++) {
 //		be32enc(&endiandata[kk], ((uint32_t*)pdata)[kk]);
 //	};
+#if !defined(NO_AES_NI) && defined(__AVX2__)
+        // Every stage but Blake takes 4 nonces at a time. The odd nonces
+        // at the end go through the single lane loop below.
+        {
+           uint32_t data4[4][20] __attribute__((aligned(64)));
+           uint32_t hash4[4][8] __attribute__((aligned(64)));
+
+           for ( int i = 0; i < 4; i++ )
+              memcpy( data4[i], endiandata, 80 );
+           while ( n + 1 < max_nonce && max_nonce - n > 4
+                   && !work_restart[thr_id].restart )
+           {
+              for ( int i = 0; i < 4; i++ )
+                 be32enc( &data4[i][19], n + 1 + i );
+              const int mask = x14hash_4way( hash4, data4, ptarget );
+              for ( int i = 0; i < 4; i++ )
+              if ( mask & ( 1 << i ) )
+              {
+                 pdata[19] = n + 1 + i;
+                 *hashes_done = pdata[19] - first_nonce + 1;
+                 return true;
+              }
+              n += 4;
+           }
+        }
+#endif
+
 #ifdef DEBUG_ALGO
 	if (Htarg != 0)
 		printf("[%d] Htarg=%X\n", thr_id, Htarg);
@@ -391,7 +453,6 @@ int64_t x14_get_max64 ()
 bool register_x14_algo( algo_gate_t* gate )
 {
   gate->aes_ni_optimized = (void*)&return_true;
-  gate->init_ctx  = (void*)&init_x14_ctx;
   gate->scanhash  = (void*)&scanhash_x14;
   gate->hash      = (void*)&x14hash;
   gate->hash_alt  = (void*)&x14hash_alt;
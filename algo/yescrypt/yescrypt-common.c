@@ -325,17 +325,16 @@ uint8_t* yescrypt_gensalt(uint32_t N_log2, uint32_t r, uint32_t p, yescrypt_flag
 	    buf, sizeof(buf));
 }
 
-static int yescrypt_bsty(const uint8_t * passwd, size_t passwdlen,
-    const uint8_t * salt, size_t saltlen, uint64_t N, uint32_t r, uint32_t p,
-    uint8_t * buf, size_t buflen)
+/* "shared" could in fact be shared, but it's simpler to keep it private
+ * along with "local".  It's dummy and tiny anyway.  local is kept for the
+ * life of the thread so the region is only allocated once. */
+static __thread int initialized = 0;
+static __thread yescrypt_shared_t shared;
+static __thread yescrypt_local_t local;
+
+static int yescrypt_thread_init()
 {
-	static __thread int initialized = 0;
-	static __thread yescrypt_shared_t shared;
-	static __thread yescrypt_local_t local;
-	int retval;
 	if (!initialized) {
-/* "shared" could in fact be shared, but it's simpler to keep it private
- * along with "local".  It's dummy and tiny anyway. */
 		if (yescrypt_init_shared(&shared, NULL, 0,
 		    0, 0, 0, YESCRYPT_SHARED_DEFAULTS, 0, NULL, 0))
 			return -1;
@@ -345,19 +344,18 @@ static int yescrypt_bsty(const uint8_t * passwd, size_t passwdlen,
 		}
 		initialized = 1;
 	}
-	retval = yescrypt_kdf(&shared, &local,
+	return 0;
+}
+
+static int yescrypt_bsty(const uint8_t * passwd, size_t passwdlen,
+    const uint8_t * salt, size_t saltlen, uint64_t N, uint32_t r, uint32_t p,
+    uint8_t * buf, size_t buflen)
+{
+	if (yescrypt_thread_init())
+		return -1;
+	return yescrypt_kdf(&shared, &local,
 	    passwd, passwdlen, salt, saltlen, N, r, p, 0, YESCRYPT_FLAGS,
 	    buf, buflen);
-#if 0
-	if (yescrypt_free_local(&local)) {
-		yescrypt_free_shared(&shared);
-		return -1;
-	}
-	if (yescrypt_free_shared(&shared))
-		return -1;
-	initialized = 0;
-#endif
-	return retval;
 }
 
 /* main hash 80 bytes input */
@@ -372,3 +370,33 @@ void yescrypthash(void *output, const void *input)
 	yescrypt_hash((char*) input, (char*) output, 80);
 }
 
+#if defined(__x86_64__)
+void yescrypt_hash_lanes(const char *input, char *output)
+{
+	const uint8_t *in[YESCRYPT_LANES];
+	uint8_t *out[YESCRYPT_LANES];
+	int i;
+
+	for (i = 0; i < YESCRYPT_LANES; i++) {
+		in[i] = (const uint8_t*)input + i * 80;
+		out[i] = (uint8_t*)output + i * 32;
+	}
+	if (!yescrypt_thread_init() &&
+	    !yescrypt_kdf_lanes(&shared, &local, in, 80, in, 80, 2048, 8,
+	    out, 32, YESCRYPT_LANES))
+		return;
+
+	/* the lane region could not be set up, hash the batch one at a time */
+	for (i = 0; i < YESCRYPT_LANES; i++)
+		yescrypt_hash((const char*)in[i], (char*)out[i], 80);
+}
+#endif
+
+unsigned char* yescrypt_thread_region()
+{
+	if (yescrypt_thread_init())
+		return NULL;
+	if (yescrypt_reserve_local(&local, 2048, 8, YESCRYPT_LANES))
+		return NULL;
+	return (unsigned char*)local.aligned;
+}
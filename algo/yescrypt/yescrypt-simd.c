@@ -636,6 +636,147 @@ blockmix_xor_save(const salsa20_blk_t *restrict Bin1,
 	return _mm_cvtsi128_si32(X0);
 }
 
+#if defined(__x86_64__)
+/*
+ * Multi-lane pwxform.  Each lane is an independent password with its own V,
+ * XY and S-boxes; the lanes only share the instruction stream, so the S-box
+ * loads of one lane are in flight while the others multiply and add.  lanes
+ * must be a compile time constant (2 or 4) once these are inlined, that is
+ * what keeps X[][] in registers.
+ */
+#define YESCRYPT_MAX_LANES 4
+
+#define FOR_EACH_LANE(M) \
+	{ M(0) } \
+	if (lanes > 1) { M(1) } \
+	if (lanes > 2) { M(2) } \
+	if (lanes > 3) { M(3) }
+
+#define PWXFORM_LANE_SIMD(X, S0, S1) \
+	{ \
+		uint64_t x = EXTRACT64(X) & S_MASK2; \
+		__m128i s0 = *(const __m128i *)((S0) + (uint32_t)x); \
+		__m128i s1 = *(const __m128i *)((S1) + (x >> 32)); \
+		X = _mm_mul_epu32(HI32(X), X); \
+		X = _mm_add_epi64(X, s0); \
+		X = _mm_xor_si128(X, s1); \
+	}
+
+#define PWXFORM_LANE(l) \
+	PWXFORM_LANE_SIMD(X[l][0], S0[l], S1[l]) \
+	PWXFORM_LANE_SIMD(X[l][1], S0[l], S1[l]) \
+	PWXFORM_LANE_SIMD(X[l][2], S0[l], S1[l]) \
+	PWXFORM_LANE_SIMD(X[l][3], S0[l], S1[l])
+
+#define PWXFORM_LANES_ROUND \
+	FOR_EACH_LANE(PWXFORM_LANE)
+
+#define PWXFORM_LANES \
+	PWXFORM_LANES_ROUND PWXFORM_LANES_ROUND \
+	PWXFORM_LANES_ROUND PWXFORM_LANES_ROUND \
+	PWXFORM_LANES_ROUND PWXFORM_LANES_ROUND
+
+#define BLOCKMIX_LANE_INIT(l) \
+	S0[l] = (const uint8_t *)S[l]; \
+	S1[l] = (const uint8_t *)S[l] + S_SIZE_ALL / 2; \
+	PREFETCH(&Bin1[l][r], _MM_HINT_T0) \
+	if (mode) \
+		PREFETCH(&Bin2[l][r], _MM_HINT_T0) \
+	for (i = 0; i < r; i++) { \
+		PREFETCH(&Bin1[l][i], _MM_HINT_T0) \
+		if (mode) \
+			PREFETCH(&Bin2[l][i], _MM_HINT_T0) \
+	} \
+	X[l][0] = Bin1[l][r].q[0]; \
+	X[l][1] = Bin1[l][r].q[1]; \
+	X[l][2] = Bin1[l][r].q[2]; \
+	X[l][3] = Bin1[l][r].q[3]; \
+	if (mode) { \
+		X[l][0] = _mm_xor_si128(X[l][0], Bin2[l][r].q[0]); \
+		X[l][1] = _mm_xor_si128(X[l][1], Bin2[l][r].q[1]); \
+		X[l][2] = _mm_xor_si128(X[l][2], Bin2[l][r].q[2]); \
+		X[l][3] = _mm_xor_si128(X[l][3], Bin2[l][r].q[3]); \
+	}
+
+/* X <-- X \xor Bin1_i, or X \xor Bin1_i \xor Bin2_i, optionally saving the
+   xor of the two inputs back to Bin2_i. */
+#define BLOCKMIX_LANE_XOR1(l, k) \
+	{ \
+		__m128i Y = Bin1[l][i].q[k]; \
+		if (mode) \
+			Y = _mm_xor_si128(Y, Bin2[l][i].q[k]); \
+		if (mode == 2) \
+			Bin2[l][i].q[k] = Y; \
+		X[l][k] = _mm_xor_si128(X[l][k], Y); \
+	}
+
+#define BLOCKMIX_LANE_XOR(l) \
+	BLOCKMIX_LANE_XOR1(l, 0) BLOCKMIX_LANE_XOR1(l, 1) \
+	BLOCKMIX_LANE_XOR1(l, 2) BLOCKMIX_LANE_XOR1(l, 3)
+
+#define BLOCKMIX_LANE_OUT(l) \
+	Bout[l][i].q[0] = X[l][0]; \
+	Bout[l][i].q[1] = X[l][1]; \
+	Bout[l][i].q[2] = X[l][2]; \
+	Bout[l][i].q[3] = X[l][3];
+
+#define BLOCKMIX_LANE_SALSA(l) \
+	{ \
+		__m128i X0 = X[l][0], X1 = X[l][1], X2 = X[l][2], X3 = X[l][3]; \
+		SALSA20_8(Bout[l][r].q) \
+		j[l] = _mm_cvtsi128_si32(X0); \
+	}
+
+/**
+ * blockmix_pwxform_lanes(Bin1, Bin2, Bout, r, S, j, lanes, mode):
+ * blockmix() (mode 0), blockmix_xor() (mode 1) or blockmix_xor_save()
+ * (mode 2) for each of lanes independent blocks, with the pwxform rounds of
+ * all lanes interleaved.  Bin2 is unused in mode 0.  The Integerify value of
+ * each output is returned in j.
+ */
+static inline __attribute__ ((always_inline)) void
+blockmix_pwxform_lanes(salsa20_blk_t *const *Bin1,
+    salsa20_blk_t *const *Bin2, salsa20_blk_t *const *Bout,
+    size_t r, void *const *S, uint32_t *j, const int lanes, const int mode)
+{
+	const uint8_t * S0[YESCRYPT_MAX_LANES], * S1[YESCRYPT_MAX_LANES];
+	__m128i X[YESCRYPT_MAX_LANES][4];
+	size_t i;
+
+	/* Convert 128-byte blocks to 64-byte blocks */
+	r = r * 2 - 1;
+
+	/* X <-- B_{r1 - 1} */
+	FOR_EACH_LANE(BLOCKMIX_LANE_INIT)
+
+	/* for i = 0 to r1 - 1 do */
+	for (i = 0; i < r; i++) {
+		/* X <-- H'(X \xor B_i) */
+		FOR_EACH_LANE(BLOCKMIX_LANE_XOR)
+		PWXFORM_LANES
+		/* B'_i <-- X */
+		FOR_EACH_LANE(BLOCKMIX_LANE_OUT)
+	}
+
+	/* Last iteration of the loop above */
+	FOR_EACH_LANE(BLOCKMIX_LANE_XOR)
+	PWXFORM_LANES
+
+	/* B'_i <-- H(B'_i) */
+	FOR_EACH_LANE(BLOCKMIX_LANE_SALSA)
+}
+
+#undef PWXFORM_LANE_SIMD
+#undef PWXFORM_LANE
+#undef PWXFORM_LANES_ROUND
+#undef PWXFORM_LANES
+#undef BLOCKMIX_LANE_INIT
+#undef BLOCKMIX_LANE_XOR1
+#undef BLOCKMIX_LANE_XOR
+#undef BLOCKMIX_LANE_OUT
+#undef BLOCKMIX_LANE_SALSA
+#endif
+
 #undef ARX
 #undef SALSA20_2ROUNDS
 #undef SALSA20_8
@@ -1128,6 +1269,29 @@ smix(uint8_t * B, size_t r, uint32_t N, uint32_t p, uint32_t t,
 #endif
 }
 
+/* B, V, XY and S of one p = 1 lane, every part a multiple of 64 bytes */
+static size_t
+lane_size(uint64_t N, uint32_t r)
+{
+	return (size_t)128 * r + (size_t)128 * r * N + (size_t)256 * r +
+	    S_SIZE_ALL;
+}
+
+int
+yescrypt_reserve_local(yescrypt_local_t * local, uint64_t N, uint32_t r,
+    int lanes)
+{
+	size_t need = lane_size(N, r) * lanes;
+
+	if (local->aligned_size >= need)
+		return 0;
+	if (free_region(local))
+		return -1;
+	if (!alloc_region(local, need))
+		return -1;
+	return 0;
+}
+
 /**
  * yescrypt_kdf(shared, local, passwd, passwdlen, salt, saltlen,
  *     N, r, p, t, flags, buf, buflen):
@@ -1379,3 +1543,315 @@ yescrypt_kdf(const yescrypt_shared_t * shared, yescrypt_local_t * local,
 	/* Success! */
 	return 0;
 }
+
+#if defined(__x86_64__)
+/**
+ * smix1_lanes(B, r, N, V, XY, S, lanes):
+ * smix1() for lanes independent blocks, YESCRYPT_RW with pwxform and no ROM
+ * only.  Each lane has its own B, V, XY and S.
+ */
+static inline __attribute__ ((always_inline)) void
+smix1_lanes(uint8_t *const *B, size_t r, uint32_t N,
+    salsa20_blk_t *const *V, salsa20_blk_t *const *XY, void *const *S,
+    const int lanes)
+{
+	size_t s = 2 * r;
+	salsa20_blk_t * X[YESCRYPT_MAX_LANES], * Y[YESCRYPT_MAX_LANES];
+	salsa20_blk_t * V_j[YESCRYPT_MAX_LANES];
+	uint32_t j[YESCRYPT_MAX_LANES];
+	uint32_t i, n;
+	size_t k;
+	int l;
+
+	/* 1: X <-- B */
+	/* 3: V_i <-- X */
+	for (l = 0; l < lanes; l++) {
+		X[l] = V[l];
+		for (k = 0; k < 2 * r; k++) {
+			for (i = 0; i < 16; i++) {
+				X[l][k].w[i] =
+				    le32dec(&B[l][(k * 16 + (i * 5 % 16)) * 4]);
+			}
+		}
+		Y[l] = &V[l][s];
+	}
+
+	/* 4: X <-- H(X) */
+	/* 3: V_i <-- X */
+	blockmix_pwxform_lanes(X, NULL, Y, r, S, j, lanes, 0);
+
+	/* 4: X <-- H(X) */
+	/* 3: V_i <-- X */
+	for (l = 0; l < lanes; l++)
+		X[l] = &V[l][2 * s];
+	blockmix_pwxform_lanes(Y, NULL, X, r, S, j, lanes, 0);
+
+	for (n = 2; n < N; n <<= 1) {
+		uint32_t m = (n < N / 2) ? n : (N - 1 - n);
+
+		/* 2: for i = 0 to N - 1 do */
+		for (i = 1; i < m; i += 2) {
+			for (l = 0; l < lanes; l++) {
+				Y[l] = &V[l][(n + i) * s];
+				/* j <-- Wrap(Integerify(X), i) */
+				j[l] &= n - 1;
+				j[l] += i - 1;
+				V_j[l] = &V[l][j[l] * s];
+			}
+
+			/* X <-- X \xor V_j */
+			/* 4: X <-- H(X) */
+			/* 3: V_i <-- X */
+			blockmix_pwxform_lanes(X, V_j, Y, r, S, j, lanes, 1);
+
+			for (l = 0; l < lanes; l++) {
+				/* j <-- Wrap(Integerify(X), i) */
+				j[l] &= n - 1;
+				j[l] += i;
+				V_j[l] = &V[l][j[l] * s];
+				X[l] = &V[l][(n + i + 1) * s];
+			}
+
+			/* X <-- X \xor V_j */
+			/* 4: X <-- H(X) */
+			/* 3: V_i <-- X */
+			blockmix_pwxform_lanes(Y, V_j, X, r, S, j, lanes, 1);
+		}
+	}
+
+	n >>= 1;
+
+	for (l = 0; l < lanes; l++) {
+		/* j <-- Wrap(Integerify(X), i) */
+		j[l] &= n - 1;
+		j[l] += N - 2 - n;
+		V_j[l] = &V[l][j[l] * s];
+		Y[l] = &V[l][(N - 1) * s];
+	}
+
+	/* X <-- X \xor V_j */
+	/* 4: X <-- H(X) */
+	/* 3: V_i <-- X */
+	blockmix_pwxform_lanes(X, V_j, Y, r, S, j, lanes, 1);
+
+	for (l = 0; l < lanes; l++) {
+		/* j <-- Wrap(Integerify(X), i) */
+		j[l] &= n - 1;
+		j[l] += N - 1 - n;
+		V_j[l] = &V[l][j[l] * s];
+		X[l] = XY[l];
+	}
+
+	/* X <-- X \xor V_j */
+	/* 4: X <-- H(X) */
+	blockmix_pwxform_lanes(Y, V_j, X, r, S, j, lanes, 1);
+
+	/* B' <-- X */
+	for (l = 0; l < lanes; l++) {
+		for (k = 0; k < 2 * r; k++) {
+			for (i = 0; i < 16; i++) {
+				le32enc(&B[l][(k * 16 + (i * 5 % 16)) * 4],
+				    X[l][k].w[i]);
+			}
+		}
+	}
+}
+
+/**
+ * smix2_lanes(B, r, N, Nloop, rw, V, XY, S, lanes):
+ * smix2() for lanes independent blocks, with pwxform and no ROM only.  rw
+ * selects the YESCRYPT_RW loop that writes back to V.
+ */
+static inline __attribute__ ((always_inline)) void
+smix2_lanes(uint8_t *const *B, size_t r, uint32_t N, uint64_t Nloop,
+    int rw, salsa20_blk_t *const *V, salsa20_blk_t *const *XY,
+    void *const *S, const int lanes)
+{
+	size_t s = 2 * r;
+	salsa20_blk_t * X[YESCRYPT_MAX_LANES], * Y[YESCRYPT_MAX_LANES];
+	salsa20_blk_t * V_j[YESCRYPT_MAX_LANES];
+	uint32_t j[YESCRYPT_MAX_LANES];
+	uint64_t i;
+	size_t k;
+	int l;
+
+	if (Nloop == 0)
+		return;
+
+	/* X <-- B' */
+	for (l = 0; l < lanes; l++) {
+		X[l] = XY[l];
+		Y[l] = &XY[l][s];
+		for (k = 0; k < 2 * r; k++) {
+			for (i = 0; i < 16; i++) {
+				X[l][k].w[i] =
+				    le32dec(&B[l][(k * 16 + (i * 5 % 16)) * 4]);
+			}
+		}
+		/* 7: j <-- Integerify(X) mod N */
+		j[l] = integerify(X[l], r) & (N - 1);
+	}
+
+	/* 6: for i = 0 to N - 1 do */
+	for (i = 0; i < Nloop; i += 2) {
+		for (l = 0; l < lanes; l++)
+			V_j[l] = &V[l][j[l] * s];
+
+		/* 8: X <-- H(X \xor V_j) */
+		/* V_j <-- Xprev \xor V_j */
+		/* 7: j <-- Integerify(X) mod N */
+		if (rw)
+			blockmix_pwxform_lanes(X, V_j, Y, r, S, j, lanes, 2);
+		else
+			blockmix_pwxform_lanes(X, V_j, Y, r, S, j, lanes, 1);
+
+		for (l = 0; l < lanes; l++) {
+			j[l] &= N - 1;
+			V_j[l] = &V[l][j[l] * s];
+		}
+
+		/* 8: X <-- H(X \xor V_j) */
+		/* V_j <-- Xprev \xor V_j */
+		/* 7: j <-- Integerify(X) mod N */
+		if (rw)
+			blockmix_pwxform_lanes(Y, V_j, X, r, S, j, lanes, 2);
+		else
+			blockmix_pwxform_lanes(Y, V_j, X, r, S, j, lanes, 1);
+
+		for (l = 0; l < lanes; l++)
+			j[l] &= N - 1;
+	}
+
+	/* 10: B' <-- X */
+	for (l = 0; l < lanes; l++) {
+		for (k = 0; k < 2 * r; k++) {
+			for (i = 0; i < 16; i++) {
+				le32enc(&B[l][(k * 16 + (i * 5 % 16)) * 4],
+				    X[l][k].w[i]);
+			}
+		}
+	}
+}
+
+/**
+ * smix_lanes(B, r, N, V, XY, S, shared, lanes):
+ * smix() at p = 1, t = 0, YESCRYPT_RW | YESCRYPT_PWXFORM and no ROM for
+ * lanes independent blocks.
+ */
+static inline __attribute__ ((always_inline)) void
+smix_lanes(uint8_t *const *B, size_t r, uint32_t N,
+    salsa20_blk_t *const *V, salsa20_blk_t *const *XY, void *const *S,
+    const yescrypt_shared_t * shared, const int lanes)
+{
+	uint64_t Nloop_all, Nloop_rw;
+	int l;
+
+	Nloop_all = (N + 2) / 3; /* 1/3, round up */
+	Nloop_rw = Nloop_all;
+	Nloop_all++; Nloop_all &= ~(uint64_t)1; /* round up to even */
+	Nloop_rw &= ~(uint64_t)1; /* round down to even */
+
+	/* The S-box fill is plain salsa20/8 and doesn't need the lanes */
+	for (l = 0; l < lanes; l++)
+		smix1(B[l], 1, S_SIZE_ALL / 128, YESCRYPT_RW, S[l], 0, shared,
+		    XY[l], NULL);
+	smix1_lanes(B, r, N, V, XY, S, lanes);
+	smix2_lanes(B, r, N, Nloop_rw, 1, V, XY, S, lanes);
+	smix2_lanes(B, r, N, Nloop_all - Nloop_rw, 0, V, XY, S, lanes);
+}
+
+static void
+smix_2way(uint8_t *const *B, size_t r, uint32_t N,
+    salsa20_blk_t *const *V, salsa20_blk_t *const *XY, void *const *S,
+    const yescrypt_shared_t * shared)
+{
+	smix_lanes(B, r, N, V, XY, S, shared, 2);
+}
+
+static void
+smix_4way(uint8_t *const *B, size_t r, uint32_t N,
+    salsa20_blk_t *const *V, salsa20_blk_t *const *XY, void *const *S,
+    const yescrypt_shared_t * shared)
+{
+	smix_lanes(B, r, N, V, XY, S, shared, 4);
+}
+
+int
+yescrypt_kdf_lanes(const yescrypt_shared_t * shared,
+    yescrypt_local_t * local,
+    const uint8_t *const * passwd, size_t passwdlen,
+    const uint8_t *const * salt, size_t saltlen,
+    uint64_t N, uint32_t r, uint8_t *const * buf, size_t buflen, int lanes)
+{
+	uint8_t _ALIGN(128) sha256[YESCRYPT_MAX_LANES][32];
+	uint8_t * B[YESCRYPT_MAX_LANES];
+	salsa20_blk_t * V[YESCRYPT_MAX_LANES], * XY[YESCRYPT_MAX_LANES];
+	void * S[YESCRYPT_MAX_LANES];
+	size_t B_size = (size_t)128 * r;
+	size_t V_size = (size_t)128 * r * N;
+	size_t XY_size = (size_t)256 * r;
+	int l;
+
+	if ((lanes != 2 && lanes != 4) || shared->shared1.aligned ||
+	    ((N & (N - 1)) != 0) || (N <= 7) || (N > UINT32_MAX) || (r < 1) ||
+	    (r > SIZE_MAX / 256) || (N > SIZE_MAX / 128 / r / lanes)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (yescrypt_reserve_local(local, N, r, lanes))
+		return -1;
+
+	for (l = 0; l < lanes; l++) {
+		B[l] = (uint8_t *)local->aligned + lane_size(N, r) * l;
+		V[l] = (salsa20_blk_t *)(B[l] + B_size);
+		XY[l] = (salsa20_blk_t *)((uint8_t *)V[l] + V_size);
+		S[l] = (uint8_t *)XY[l] + XY_size;
+
+		{
+			SHA256_CTX_Y ctx;
+			SHA256_Init_Y(&ctx);
+			SHA256_Update_Y(&ctx, passwd[l], passwdlen);
+			SHA256_Final_Y(sha256[l], &ctx);
+		}
+
+		/* 1: (B_0 ... B_{p-1}) <-- PBKDF2(P, S, 1, p * MFLen) */
+		PBKDF2_SHA256(sha256[l], sizeof(sha256[l]), salt[l], saltlen,
+		    1, B[l], B_size);
+
+		memcpy(sha256[l], B[l], sizeof(sha256[l]));
+	}
+
+	if (lanes == 4)
+		smix_4way(B, r, N, V, XY, S, shared);
+	else
+		smix_2way(B, r, N, V, XY, S, shared);
+
+	for (l = 0; l < lanes; l++) {
+		/* 5: DK <-- PBKDF2(P, B, 1, dkLen) */
+		PBKDF2_SHA256(sha256[l], sizeof(sha256[l]), B[l], B_size, 1,
+		    buf[l], buflen);
+
+		if (buflen == sizeof(sha256[l])) {
+			/* Compute ClientKey */
+			{
+				HMAC_SHA256_CTX_Y ctx;
+				HMAC_SHA256_Init_Y(&ctx, buf[l], buflen);
+				/* GlobalBoost-Y buggy yescrypt */
+				HMAC_SHA256_Update_Y(&ctx, salt[l], saltlen);
+				HMAC_SHA256_Final_Y(sha256[l], &ctx);
+			}
+			/* Compute StoredKey */
+			{
+				SHA256_CTX_Y ctx;
+				SHA256_Init_Y(&ctx);
+				SHA256_Update_Y(&ctx, sha256[l],
+				    sizeof(sha256[l]));
+				SHA256_Final_Y(buf[l], &ctx);
+			}
+		}
+	}
+
+	return 0;
+}
+#endif
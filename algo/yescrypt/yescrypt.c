@@ -27,6 +27,38 @@ int scanhash_yescrypt(int thr_id, struct work *work, uint32_t max_nonce, uint64_
 		be32enc(&endiandata[i], pdata[i]);
 	}
 
+#if YESCRYPT_LANES > 1
+	{
+	uint32_t _ALIGN(64) vhashN[8*YESCRYPT_LANES];
+	uint32_t _ALIGN(64) endiandataN[20*YESCRYPT_LANES];
+
+	for (int l = 0; l < YESCRYPT_LANES; l++)
+		memcpy(&endiandataN[20*l], endiandata, 76);
+
+	while (n < max_nonce && max_nonce - n >= YESCRYPT_LANES
+	       && !work_restart[thr_id].restart) {
+		for (int l = 0; l < YESCRYPT_LANES; l++)
+			be32enc(&endiandataN[20*l + 19], n + l);
+		yescrypt_hash_lanes((char*) endiandataN, (char*) vhashN);
+		for (int l = 0; l < YESCRYPT_LANES; l++) {
+			uint32_t *hash = &vhashN[8*l];
+			if (hash[7] < Htarg && fulltest(hash, ptarget)) {
+				work_set_target_ratio( work, hash );
+				*hashes_done = n + l - first_nonce + 1;
+				pdata[19] = n + l;
+				return true;
+			}
+		}
+		n += YESCRYPT_LANES;
+	}
+	if (n >= max_nonce || work_restart[thr_id].restart) {
+		*hashes_done = n - first_nonce + 1;
+		pdata[19] = n;
+		return 0;
+	}
+	}
+#endif
+
 	do {
 		be32enc(&endiandata[19], n);
 		yescrypt_hash((char*) endiandata, (char*) vhash, 80);
@@ -57,6 +89,13 @@ void yescrypt_set_target( struct work* work, double job_diff )
 }
 
 
+// The local region lives for the whole thread, sized for all lanes.
+bool yescrypt_get_scratchbuf( unsigned char** scratchbuf )
+{
+  *scratchbuf = yescrypt_thread_region();
+  return NULL == *scratchbuf ? false : true;
+}
+
 bool register_yescrypt_algo ( algo_gate_t* gate )
 {
    gate->scanhash   = (void*)&scanhash_yescrypt;
@@ -65,6 +104,7 @@ bool register_yescrypt_algo ( algo_gate_t* gate )
 //   gate->set_target = (void*)&yescrypt_set_target;
    gate->set_target = (void*)&scrypt_set_target;
    gate->get_max64  = (void*)&yescrypt_get_max64;
+   gate->get_scratchbuf = (void*)&yescrypt_get_scratchbuf;
    return true;
 }
 
@@ -44,6 +44,20 @@ void yescrypt_hash(const char* input, char* output, uint32_t len);
 
 void yescrypthash(void *output, const void *input);
 
+#if defined(__x86_64__)
+// 2 or 4. Each lane has its own 2 MiB V, with 4 lanes the working set
+// per thread no longer fits in cache and it ends up slower than 2.
+#define YESCRYPT_LANES 2
+
+/* YESCRYPT_LANES 80 byte inputs in, YESCRYPT_LANES 32 byte hashes out */
+void yescrypt_hash_lanes(const char* input, char* output);
+#else
+#define YESCRYPT_LANES 1
+#endif
+
+/* The per thread local region, allocated on first use */
+unsigned char* yescrypt_thread_region(void);
+
 /**
  * crypto_scrypt(passwd, passwdlen, salt, saltlen, N, r, p, buf, buflen):
  * Compute scrypt(passwd[0 .. passwdlen - 1], salt[0 .. saltlen - 1], N, r,
@@ -318,6 +332,38 @@ extern uint8_t * yescrypt_r(const yescrypt_shared_t * __shared,
     const uint8_t * __setting,
     uint8_t * __buf, size_t __buflen);
 
+#if defined(__x86_64__)
+/**
+ * yescrypt_kdf_lanes(shared, local, passwd, passwdlen, salt, saltlen,
+ *     N, r, buf, buflen, lanes):
+ * Compute lanes (2 or 4) independent yescrypt_kdf() results at once, with
+ * p = 1, t = 0 and flags YESCRYPT_RW | YESCRYPT_PWXFORM.  passwd, salt and
+ * buf are arrays of lanes pointers.  shared must be dummy (no ROM).  The
+ * pwxform S-box lookups of the lanes are interleaved to hide their latency.
+ *
+ * Return 0 on success; or -1 on error.
+ *
+ * MT-safe as long as local and buf are local to the thread.
+ */
+extern int yescrypt_kdf_lanes(const yescrypt_shared_t * __shared,
+    yescrypt_local_t * __local,
+    const uint8_t * const * __passwd, size_t __passwdlen,
+    const uint8_t * const * __salt, size_t __saltlen,
+    uint64_t __N, uint32_t __r,
+    uint8_t * const * __buf, size_t __buflen, int __lanes);
+#endif
+
+/**
+ * yescrypt_reserve_local(local, N, r, lanes):
+ * Make sure local is large enough for yescrypt_kdf_lanes() with these
+ * parameters, which is also enough for yescrypt_kdf() at p = 1 (lanes may be
+ * 1 for that alone).
+ *
+ * Return 0 on success; or -1 on error.
+ */
+extern int yescrypt_reserve_local(yescrypt_local_t * __local,
+    uint64_t __N, uint32_t __r, int __lanes);
+
 /**
  * yescrypt(passwd, setting):
  * Compute and encode an scrypt or enhanced scrypt hash of passwd given the
@@ -40,6 +40,9 @@
 #else
   #include "algo/groestl/aes_ni/hash-groestl.h"
   #include "algo/echo/aes_ni/hash_api.h"
+  #include "algo/groestl/groestl-hash-4way.h"
+  #include "algo/skein/skein-hash-4way.h"
+  #include "algo/jh/jh-hash-4way.h"
 #endif
 
 #include "algo/jh/sse2/jh_sse2_opt64.h"
@@ -60,39 +63,6 @@
 #define POK_BOOL_MASK 0x00008000
 #define POK_DATA_MASK 0xFFFF0000
 
-typedef struct {
-  #ifndef NO_AES_NI
-   hashState_groestl       groestl;
-  #endif
-  sph_keccak512_context    keccak;
-} zr5_ctx_holder;
-
-zr5_ctx_holder zr5_ctx;
-
-void init_zr5_ctx()
-{
-  #ifndef NO_AES_NI
-     init_groestl( &zr5_ctx.groestl );
-  #endif
-     sph_keccak512_init(&zr5_ctx.keccak);
-}  
-
-static void zr5hash(void *state, const void *input) {
-    
-sph_keccak512_context    ctx_keccak;
-   
-DATA_ALIGN16(unsigned char hashbuf[128]);
-DATA_ALIGN16(unsigned char hash[128]);
-DATA_ALIGN16(size_t hashptr);
-DATA_ALIGN16(sph_u64 hashctA);
-DATA_ALIGN16(sph_u64 hashctB);
-
-//memset(hash, 0, 128);
-
-#ifdef NO_AES_NI
-  grsoState sts_grs;
-#endif
-
 static const int arrOrder[][4] =
 {
    { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 1, 3 }, { 0, 2, 3, 1 },
@@ -103,42 +73,44 @@ static const int arrOrder[][4] =
    { 3, 1, 0, 2 }, { 3, 1, 2, 0 }, { 3, 2, 0, 1 }, { 3, 2, 1, 0 }
 };
 
-    zr5_ctx_holder ctx;
-    memcpy( &ctx, &zr5_ctx, sizeof(zr5_ctx) );
+// Keccak-512 state after the 76 nonce invariant bytes of the header with
+// the POK bits cleared, set by zr5_prehash before each scan.
+static __thread sph_keccak512_context zr5_keccak_mid;
 
-//    sph_keccak512_init(&ctx_keccak);
-    sph_keccak512 (&ctx.keccak, input, 80);
-    sph_keccak512_close(&ctx.keccak, hash);
-  
-    //unsigned int round;
-    unsigned int nOrder = *(unsigned int *)(&hash) % 24;
-    unsigned int i = 0;
+// One stage on the 64 bytes at hash, in place.
+static void zr5_stage( unsigned char *hash, int stage )
+{
+DATA_ALIGN16(unsigned char hashbuf[128]);
+DATA_ALIGN16(size_t hashptr);
+DATA_ALIGN16(sph_u64 hashctA);
+DATA_ALIGN16(sph_u64 hashctB);
 
-    for (i = 0; i < 4; i++)
-    {
-       switch (arrOrder[nOrder][i])
+#ifdef NO_AES_NI
+  grsoState sts_grs;
+#endif
+
+       switch (stage)
        {
-         case 0:
+         case ZR_BLAKE:
 		{DECL_BLK;
 		BLK_I;
 		BLK_U;
 		BLK_C;}
 		break;
-         case 1:
+         case ZR_GROESTL:
             #ifdef NO_AES_NI
 		{GRS_I;
 		GRS_U;
 		GRS_C; }
             #else
-                update_groestl( &ctx.groestl, (char*)hash,512);
-                final_groestl( &ctx.groestl, (char*)hash);
+                groestl512_64( hash, hash );
             #endif
 	    break;
-         case 2:
+         case ZR_JH:
 		{DECL_JH;
 		JH_H;} 
 		break;
-         case 3:
+         case ZR_SKEIN:
 		{DECL_SKN;
                 SKN_I;
                 SKN_U;
@@ -147,11 +119,172 @@ static const int arrOrder[][4] =
          default:
            break;
        }
-    }
+}
+
+// keccak is the state to resume the first stage from, input and len the
+// part of the header it hasn't absorbed yet.
+static void zr5hash_from( void *state, const sph_keccak512_context *keccak,
+                          const void *input, size_t len )
+{
+    sph_keccak512_context ctx_keccak;
+    DATA_ALIGN16(unsigned char hash[64]);
+
+    memcpy( &ctx_keccak, keccak, sizeof ctx_keccak );
+
+    sph_keccak512 (&ctx_keccak, input, len);
+    sph_keccak512_close(&ctx_keccak, hash);
+  
+    unsigned int nOrder = *(unsigned int *)(&hash) % 24;
+
+    for ( int i = 0; i < 4; i++ )
+       zr5_stage( hash, arrOrder[nOrder][i] );
 	asm volatile ("emms");
 	memcpy(state, hash, 32);
 }
 
+#ifndef NO_AES_NI
+
+// Nonces hashed per batch. The stage order differs per nonce, so lanes are
+// grouped by the stage they need next rather than stepped together.
+#define ZR5_LANES 8
+
+// Stages with a 4 lane kernel, the others run one lane at a time.
+static const bool zr5_batched[4] =
+{
+   [ZR_BLAKE] = false, [ZR_GROESTL] = true,
+#if defined(__AVX2__)
+   [ZR_JH] = true, [ZR_SKEIN] = true
+#else
+   [ZR_JH] = false, [ZR_SKEIN] = false
+#endif
+};
+
+// Runs stage on the n lanes in hash, 4 at a time when it has a kernel. A
+// short group is padded with spare lanes.
+static void zr5_stage_lanes( unsigned char **hash, int n, int stage )
+{
+   unsigned char spare[4][64] __attribute__ ((aligned (64)));
+
+   for ( int i = 0; i < n; i += 4 )
+   {
+      const int m = n - i < 4 ? n - i : 4;
+      void *lanes[4];
+
+      if ( m == 1 || !zr5_batched[stage] )
+      {
+         for ( int j = 0; j < m; j++ )
+            zr5_stage( hash[i+j], stage );
+         continue;
+      }
+      for ( int j = 0; j < 4; j++ )
+         lanes[j] = j < m ? hash[i+j] : spare[j];
+      memset( spare, 0, sizeof spare );
+      if ( stage == ZR_GROESTL )
+         groestl512_x4( lanes, 64 );
+      else if ( stage == ZR_JH )
+         jh512_x4( lanes, 64 );
+      else
+         skein512_x4( lanes, 64 );
+   }
+}
+
+// hash[l] holds the Keccak digest of lane l and gets the result of its 4
+// stages, in the order that digest picks. Each pass first runs every lane
+// whose next stage has no 4 lane kernel, those cost the same one at a time
+// anyway, so lanes pile up on the batched stages. When all waiting lanes
+// need a batched stage, the one most of them need runs on all of them.
+static void zr5_stages_lanes( unsigned char hash[][64], int n )
+{
+   int order[ZR5_LANES], step[ZR5_LANES];
+   int left = 4 * n;
+
+   for ( int l = 0; l < n; l++ )
+   {
+      order[l] = *(unsigned int*)hash[l] % 24;
+      step[l] = 0;
+   }
+
+   while ( left )
+   {
+      unsigned char *group[ZR5_LANES];
+      int count[4] = { 0 };
+      int stage = -1, m = 0;
+
+      for ( int l = 0; l < n; l++ )
+         if ( step[l] < 4 )
+         {
+            const int s = arrOrder[ order[l] ][ step[l] ];
+            count[s]++;
+            if ( !zr5_batched[s] )
+               stage = s;
+         }
+      if ( stage < 0 )
+         for ( int s = 0; s < 4; s++ )
+            if ( stage < 0 || count[s] > count[stage] )
+               stage = s;
+
+      for ( int l = 0; l < n; l++ )
+         if ( step[l] < 4 && arrOrder[ order[l] ][ step[l] ] == stage )
+         {
+            group[m++] = hash[l];
+            step[l]++;
+         }
+      zr5_stage_lanes( group, m, stage );
+      left -= m;
+   }
+   asm volatile ("emms");
+}
+
+// Both passes of zr5 for the n headers in data, hash[l] gets the digest of
+// data[l]. data[l][0] must hold the version with the POK bits clear and
+// gets the POK bits of the first pass, as the second pass hashes it.
+static void zr5hash_lanes( uint32_t hash[][8], uint32_t data[][20], int n )
+{
+   unsigned char h[ZR5_LANES][64] __attribute__ ((aligned (64)));
+
+   for ( int l = 0; l < n; l++ )
+   {
+      sph_keccak512_context ctx_keccak;
+      memcpy( &ctx_keccak, &zr5_keccak_mid, sizeof ctx_keccak );
+      sph_keccak512( &ctx_keccak, data[l] + 19, 4 );
+      sph_keccak512_close( &ctx_keccak, h[l] );
+   }
+   zr5_stages_lanes( h, n );
+
+   for ( int l = 0; l < n; l++ )
+   {
+      sph_keccak512_context ctx_keccak;
+      data[l][0] |= *(uint32_t*)h[l] & POK_DATA_MASK;
+      sph_keccak512_init( &ctx_keccak );
+      sph_keccak512( &ctx_keccak, data[l], 80 );
+      sph_keccak512_close( &ctx_keccak, h[l] );
+   }
+   zr5_stages_lanes( h, n );
+
+   for ( int l = 0; l < n; l++ )
+      memcpy( hash[l], h[l], 32 );
+}
+
+#endif
+
+static void zr5hash(void *state, const void *input)
+{
+   sph_keccak512_context keccak;
+
+   sph_keccak512_init( &keccak );
+   zr5hash_from( state, &keccak, input, 80 );
+}
+
+void zr5_prehash( struct work *work )
+{
+   uint32_t tmpdata[19];
+
+   memcpy( tmpdata, work->data, 76 );
+   tmpdata[0] = work->data[0] & (~POK_DATA_MASK);
+   sph_keccak512_init( &zr5_keccak_mid );
+   sph_keccak512( &zr5_keccak_mid, tmpdata, 76 );
+}
+
 int scanhash_zr5( int thr_id, struct work *work,
                    uint32_t max_nonce, unsigned long *hashes_done)
 {
@@ -165,12 +298,45 @@ int scanhash_zr5( int thr_id, struct work *work,
 
   memcpy(tmpdata, pdata, 80);
 
+#ifndef NO_AES_NI
+  {
+    uint32_t data8[ZR5_LANES][20] __attribute__((aligned(64)));
+    uint32_t hash8[ZR5_LANES][8] __attribute__((aligned(64)));
+
+    for ( int i = 0; i < ZR5_LANES; i++ )
+       memcpy( data8[i], pdata, 80 );
+    while ( nonce < max_nonce && max_nonce - nonce > ZR5_LANES
+            && !work_restart[thr_id].restart )
+    {
+       for ( int i = 0; i < ZR5_LANES; i++ )
+       {
+          data8[i][0] = version;
+          data8[i][19] = nonce + i;
+       }
+       zr5hash_lanes( hash8, data8, ZR5_LANES );
+       for ( int i = 0; i < ZR5_LANES; i++ )
+       if ( hash8[i][7] <= ptarget[7] && fulltest( hash8[i], ptarget ) )
+       {
+          pdata[0] = data8[i][0];
+          pdata[19] = nonce + i;
+          *hashes_done = pdata[19] - first_nonce + 1;
+          if (opt_debug)
+            applog(LOG_INFO, "found nonce %x", nonce + i);
+          return 1;
+       }
+       nonce += ZR5_LANES;
+    }
+  }
+#endif
+
   do
   {
     #define Htarg ptarget[7]
     tmpdata[0] = version;
     tmpdata[19] = nonce;
-    zr5hash(hash, tmpdata);
+    // only the first pass can resume from the midstate, the second one has
+    // the POK bits of the first result in tmpdata[0]
+    zr5hash_from(hash, &zr5_keccak_mid, tmpdata + 19, 4);
     tmpdata[0] = version | (hash[0] & POK_DATA_MASK);
     zr5hash(hash, tmpdata);
     if (hash[7] <= Htarg )
@@ -248,7 +414,6 @@ void zr5_reverse_endian_17_19( uint32_t* ntime, uint32_t* nonce,
 bool register_zr5_algo( algo_gate_t* gate )
 {
     gate->aes_ni_optimized = (void*)&return_true;
-    gate->init_ctx      = (void*)&init_zr5_ctx;
     gate->scanhash      = (void*)&scanhash_zr5;
     gate->hash          = (void*)&zr5hash;
     gate->hash_alt      = (void*)&zr5hash;
@@ -260,6 +425,7 @@ bool register_zr5_algo( algo_gate_t* gate )
     gate->set_data_and_target_size = (void*)&zr5_set_data_and_target_size;
     gate->set_work_data_endian = (void*)&swab_work_data;
     gate->encode_endian_17_19  = (void*)&encode_big_endian_17_19;
+    gate->prehash       = (void*)&zr5_prehash;
     return true;
 };
 
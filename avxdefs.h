@@ -0,0 +1,169 @@
+#ifndef AVXDEFS_H__
+#define AVXDEFS_H__
+
+// Helpers shared by the multi lane (4way, 2way) hash kernels.
+//
+// Lane data is kept interleaved so one vector holds the same word of every
+// lane. The interleave functions convert between that layout and ordinary
+// per lane buffers, bit_len is the length of one lane's data in bits and
+// must be a multiple of the interleave word size.
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+//
+// 128 bit, 4 lanes of 32 bit words
+
+#if defined(__AVX512VL__)
+
+#define mm_rotl_32( x, c )  _mm_rol_epi32( x, c )
+#define mm_rotr_32( x, c )  _mm_ror_epi32( x, c )
+
+#else
+
+#define mm_rotl_32( x, c ) \
+   _mm_or_si128( _mm_slli_epi32( x, c ), _mm_srli_epi32( x, 32-(c) ) )
+
+#define mm_rotr_32( x, c ) \
+   _mm_or_si128( _mm_srli_epi32( x, c ), _mm_slli_epi32( x, 32-(c) ) )
+
+#endif
+
+// Byte swap every 32 bit element.
+#define mm_bswap_32( x ) \
+   _mm_shuffle_epi8( x, _mm_set_epi8( 12,13,14,15,  8, 9,10,11, \
+                                       4, 5, 6, 7,  0, 1, 2, 3 ) )
+
+static inline void mm_interleave_4x32( void *dst, const void *src0,
+               const void *src1, const void *src2, const void *src3,
+               int bit_len )
+{
+   uint32_t *d = (uint32_t*)dst;
+   const uint32_t *s0 = (const uint32_t*)src0;
+   const uint32_t *s1 = (const uint32_t*)src1;
+   const uint32_t *s2 = (const uint32_t*)src2;
+   const uint32_t *s3 = (const uint32_t*)src3;
+   for ( int i = 0; i < bit_len >> 5; i++, d += 4 )
+   {
+      d[0] = s0[i];
+      d[1] = s1[i];
+      d[2] = s2[i];
+      d[3] = s3[i];
+   }
+}
+
+static inline void mm_deinterleave_4x32( void *dst0, void *dst1, void *dst2,
+               void *dst3, const void *src, int bit_len )
+{
+   uint32_t *d0 = (uint32_t*)dst0;
+   uint32_t *d1 = (uint32_t*)dst1;
+   uint32_t *d2 = (uint32_t*)dst2;
+   uint32_t *d3 = (uint32_t*)dst3;
+   const uint32_t *s = (const uint32_t*)src;
+   for ( int i = 0; i < bit_len >> 5; i++, s += 4 )
+   {
+      d0[i] = s[0];
+      d1[i] = s[1];
+      d2[i] = s[2];
+      d3[i] = s[3];
+   }
+}
+
+#if defined(__AVX2__)
+
+//
+// 256 bit, 4 lanes of 64 bit words or 2 lanes of 128 bit words
+
+#if defined(__AVX512VL__)
+
+#define mm256_rotl_64( x, c )  _mm256_rol_epi64( x, c )
+#define mm256_rotr_64( x, c )  _mm256_ror_epi64( x, c )
+#define mm256_rotl_32( x, c )  _mm256_rol_epi32( x, c )
+
+#else
+
+#define mm256_rotl_64( x, c ) \
+   _mm256_or_si256( _mm256_slli_epi64( x, c ), \
+                    _mm256_srli_epi64( x, 64-(c) ) )
+
+#define mm256_rotr_64( x, c ) \
+   _mm256_or_si256( _mm256_srli_epi64( x, c ), \
+                    _mm256_slli_epi64( x, 64-(c) ) )
+
+#define mm256_rotl_32( x, c ) \
+   _mm256_or_si256( _mm256_slli_epi32( x, c ), \
+                    _mm256_srli_epi32( x, 32-(c) ) )
+
+#endif
+
+// Byte swap every 32 bit element.
+#define mm256_bswap_32( x ) \
+   _mm256_shuffle_epi8( x, _mm256_set_epi8( \
+                          12,13,14,15,  8, 9,10,11,  4, 5, 6, 7,  0, 1, 2, 3, \
+                          12,13,14,15,  8, 9,10,11,  4, 5, 6, 7,  0, 1, 2, 3 ) )
+
+static inline void mm256_interleave_4x64( void *dst, const void *src0,
+               const void *src1, const void *src2, const void *src3,
+               int bit_len )
+{
+   uint64_t *d = (uint64_t*)dst;
+   const uint64_t *s0 = (const uint64_t*)src0;
+   const uint64_t *s1 = (const uint64_t*)src1;
+   const uint64_t *s2 = (const uint64_t*)src2;
+   const uint64_t *s3 = (const uint64_t*)src3;
+   for ( int i = 0; i < bit_len >> 6; i++, d += 4 )
+   {
+      d[0] = s0[i];
+      d[1] = s1[i];
+      d[2] = s2[i];
+      d[3] = s3[i];
+   }
+}
+
+static inline void mm256_deinterleave_4x64( void *dst0, void *dst1,
+               void *dst2, void *dst3, const void *src, int bit_len )
+{
+   uint64_t *d0 = (uint64_t*)dst0;
+   uint64_t *d1 = (uint64_t*)dst1;
+   uint64_t *d2 = (uint64_t*)dst2;
+   uint64_t *d3 = (uint64_t*)dst3;
+   const uint64_t *s = (const uint64_t*)src;
+   for ( int i = 0; i < bit_len >> 6; i++, s += 4 )
+   {
+      d0[i] = s[0];
+      d1[i] = s[1];
+      d2[i] = s[2];
+      d3[i] = s[3];
+   }
+}
+
+static inline void mm256_interleave_2x128( void *dst, const void *src0,
+               const void *src1, int bit_len )
+{
+   __m128i *d = (__m128i*)dst;
+   const __m128i *s0 = (const __m128i*)src0;
+   const __m128i *s1 = (const __m128i*)src1;
+   for ( int i = 0; i < bit_len >> 7; i++, d += 2 )
+   {
+      d[0] = _mm_loadu_si128( s0 + i );
+      d[1] = _mm_loadu_si128( s1 + i );
+   }
+}
+
+static inline void mm256_deinterleave_2x128( void *dst0, void *dst1,
+               const void *src, int bit_len )
+{
+   __m128i *d0 = (__m128i*)dst0;
+   __m128i *d1 = (__m128i*)dst1;
+   const __m128i *s = (const __m128i*)src;
+   for ( int i = 0; i < bit_len >> 7; i++, s += 2 )
+   {
+      _mm_storeu_si128( d0 + i, s[0] );
+      _mm_storeu_si128( d1 + i, s[1] );
+   }
+}
+
+#endif  // __AVX2__
+
+#endif  // AVXDEFS_H__
@@ -1639,6 +1639,7 @@ static void *miner_thread(void *userdata)
 
      algo_gate.get_pseudo_random_data( &work, scratchbuf, thr_id );
      algo_gate.thread_barrier_wait();
+     algo_gate.prehash( &work );
 
 //     if (firstwork_time == 0)
 //	firstwork_time = time(NULL);
@@ -281,6 +281,7 @@ size_t address_to_script( unsigned char *out, size_t outsz, const char *addr );
 int    timeval_subtract( struct timeval *result, struct timeval *x,
                            struct timeval *y);
 bool   fulltest( const uint32_t *hash, const uint32_t *target );
+int    fulltest_4x32( const void *hash, const uint32_t *target );
 void   work_set_target( struct work* work, double diff );
 double target_to_diff( uint32_t* target );
 extern void diff_to_target(uint32_t *target, double diff);
@@ -291,6 +292,9 @@ void   work_set_target_ratio( struct work* work, uint32_t* hash );
 void   get_currentalgo( char* buf, int sz );
 bool   has_aes_ni( void );
 bool   has_sse2( void );
+bool   has_avx2( void );
+bool   has_vaes( void );
+bool   has_avx512( void );
 void   bestcpu_feature( char *outbuf, int maxsz );
 void   processor_id ( int functionnumber, int output[4] );
 
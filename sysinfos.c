@@ -142,6 +142,13 @@ void processor_id ( int functionnumber, int output[4] )
 #define SSE2_Flag     (1 << 26) // EDX
 
 #define AVX2_Flag     (1 << 5) // ADV EBX
+#define AVX512F_Flag  (1 << 16) // ADV EBX
+#define AVX512BW_Flag (1 << 30) // ADV EBX
+#define VAES_Flag     (1 << 9) // ADV ECX
+
+// XCR0 bits, the OS saves the ymm and the zmm/mask registers on a switch
+#define XCR0_YMM      0x06
+#define XCR0_ZMM      0xe6
 
 bool has_aes_ni()
 {
@@ -193,6 +200,71 @@ bool has_sse2()
 #endif
 }
 
+#ifndef __arm__
+static inline unsigned xcr0()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    unsigned a, d;
+    asm volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return a;
+#else
+    return (unsigned)_xgetbv(0);
+#endif
+}
+#endif
+
+// VAES on ymm registers, needs AVX2 and OS support for the ymm state.
+bool has_vaes()
+{
+#ifdef __arm__
+    return false;
+#else
+    int cpu_info[4] = { 0 };
+    int cpu_info_adv[4] = { 0 };
+    cpuid(1, cpu_info);
+    if ( !( cpu_info[2] & OSXSAVE_Flag ) )
+        return false;
+    cpuid(7, cpu_info_adv);
+    return ( cpu_info_adv[1] & AVX2_Flag ) && ( cpu_info_adv[2] & VAES_Flag )
+        && ( ( xcr0() & XCR0_YMM ) == XCR0_YMM );
+#endif
+}
+
+// AVX2 with OS support for the ymm state.
+bool has_avx2()
+{
+#ifdef __arm__
+    return false;
+#else
+    int cpu_info[4] = { 0 };
+    int cpu_info_adv[4] = { 0 };
+    cpuid(1, cpu_info);
+    if ( !( cpu_info[2] & OSXSAVE_Flag ) )
+        return false;
+    cpuid(7, cpu_info_adv);
+    return ( cpu_info_adv[1] & AVX2_Flag )
+        && ( ( xcr0() & XCR0_YMM ) == XCR0_YMM );
+#endif
+}
+
+// AVX512F and AVX512BW with OS support for the zmm state.
+bool has_avx512()
+{
+#ifdef __arm__
+    return false;
+#else
+    int cpu_info[4] = { 0 };
+    int cpu_info_adv[4] = { 0 };
+    cpuid(1, cpu_info);
+    if ( !( cpu_info[2] & OSXSAVE_Flag ) )
+        return false;
+    cpuid(7, cpu_info_adv);
+    return ( cpu_info_adv[1] & AVX512F_Flag )
+        && ( cpu_info_adv[1] & AVX512BW_Flag )
+        && ( ( xcr0() & XCR0_ZMM ) == XCR0_ZMM );
+#endif
+}
+
 
 
 
@@ -41,6 +41,10 @@
 #include <libgen.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "miner.h"
 #include "elist.h"
 #include "algo-gate-api.h"
@@ -922,6 +926,49 @@ bool fulltest(const uint32_t *hash, const uint32_t *target)
 	return rc;
 }
 
+/*
+ * fulltest of 4 hashes interleaved 4x32 as in avxdefs.h, hash holds word i
+ * of lane l at 32 bit element 4*i + l. Returns a mask with bit l set when
+ * lane l is at or below target. The most significant words are compared
+ * first, all 4 at once, and the remaining words are only looked at while
+ * some lane is still tied with the target.
+ */
+int fulltest_4x32(const void *hash, const uint32_t *target)
+{
+#if defined(__SSE2__)
+	const __m128i *h = (const __m128i *)hash;
+	const __m128i sign = _mm_set1_epi32(0x80000000);
+	__m128i le = _mm_setzero_si128();
+	__m128i tied = _mm_set1_epi32(-1);
+	int i;
+
+	/* unsigned compares as signed ones with the sign bit flipped */
+	for (i = 7; i >= 0; i--) {
+		const __m128i x = _mm_xor_si128(_mm_loadu_si128(h + i), sign);
+		const __m128i t = _mm_set1_epi32((int)(target[i] ^ 0x80000000));
+		const __m128i lt = _mm_cmplt_epi32(x, t);
+		le = _mm_or_si128(le, _mm_and_si128(tied, lt));
+		tied = _mm_and_si128(tied, _mm_cmpeq_epi32(x, t));
+		if (!_mm_movemask_epi8(tied))
+			break;
+	}
+	return _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(le, tied)));
+#else
+	const uint32_t *h = (const uint32_t *)hash;
+	int mask = 0;
+	int i, l;
+
+	for (l = 0; l < 4; l++) {
+		for (i = 7; i >= 0; i--)
+			if (h[4*i + l] != target[i])
+				break;
+		if (i < 0 || h[4*i + l] < target[i])
+			mask |= 1 << l;
+	}
+	return mask;
+#endif
+}
+
 void diff_to_target(uint32_t *target, double diff)
 {
 	uint64_t m;